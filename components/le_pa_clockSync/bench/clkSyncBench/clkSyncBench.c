@@ -0,0 +1,214 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file clkSyncBench.c
+ *
+ * Benchmark of the time retrievals of the Linux Clock Service Adapter. Each of
+ * pa_clkSync_GetTimeWithTimeProtocol() and pa_clkSync_GetTimeWithNetworkTimeProtocol() is run a
+ * number of times on each of the native and command engines, get only, against the mock server
+ * started on a loopback address. The latency report of each run is then printed, one line per
+ * protocol engine, so that two builds or two engines can be compared line by line.
+ *
+ * Usage: clkSyncBench [-n <count>] [-a <address>] [-s <server>]
+ *  - count: retrievals run per protocol engine, 64 by default, which is also the number of last
+ *    retrievals a latency report covers
+ *  - address: loopback address the mock server listens on, 127.0.0.1 by default
+ *  - server: name or address the retrievals are made from, the mock server's address by default;
+ *    a name resolving to it also measures the resolution
+ *
+ * The command engine needs rdate and ntpdate on the target; its runs are reported as failed
+ * otherwise. The system clock is never updated.
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "interfaces.h"
+#include <inttypes.h>
+#include "pa_clkSync.h"
+#include "pa_clkSync_linux.h"
+#include "clkSyncMock.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Default number of retrievals run per protocol engine
+ */
+//--------------------------------------------------------------------------------------------------
+#define BENCH_DEFAULT_COUNT         64
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Nanoseconds per microsecond, the unit the latencies are printed in
+ */
+//--------------------------------------------------------------------------------------------------
+#define BENCH_NS_PER_USEC           1000
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Protocol engine benchmarked
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    pa_clkSync_Protocol_t protocol;     ///< Protocol, i.e. TP or NTP
+    pa_clkSync_Engine_t engine;         ///< Engine selected for the protocol
+    const char* namePtr;                ///< Name printed
+}
+Bench_Run_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Protocol engines benchmarked, in the order printed
+ */
+//--------------------------------------------------------------------------------------------------
+static const Bench_Run_t Runs[] =
+{
+    { PA_CLKSYNC_PROTOCOL_TP,  PA_CLKSYNC_ENGINE_NATIVE,  "TP native"   },
+    { PA_CLKSYNC_PROTOCOL_TP,  PA_CLKSYNC_ENGINE_COMMAND, "TP command"  },
+    { PA_CLKSYNC_PROTOCOL_NTP, PA_CLKSYNC_ENGINE_NATIVE,  "NTP native"  },
+    { PA_CLKSYNC_PROTOCOL_NTP, PA_CLKSYNC_ENGINE_COMMAND, "NTP command" },
+};
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Options of the benchmark
+ */
+//--------------------------------------------------------------------------------------------------
+static int Count = BENCH_DEFAULT_COUNT;
+static const char* MockAddrPtr = CLKSYNC_MOCK_DEFAULT_ADDR;
+static const char* ServerPtr = NULL;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Select the engine of a protocol
+ *
+ * @return
+ *      See pa_clkSync_SetTpEngine()
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t SetEngine
+(
+    const Bench_Run_t* runPtr           ///< [IN] Protocol engine
+)
+{
+    if (PA_CLKSYNC_PROTOCOL_TP == runPtr->protocol)
+    {
+        return pa_clkSync_SetTpEngine(runPtr->engine);
+    }
+    return pa_clkSync_SetNtpEngine(runPtr->engine);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Run the retrievals of a protocol engine and print its latency report
+ */
+//--------------------------------------------------------------------------------------------------
+static void RunBench
+(
+    const Bench_Run_t* runPtr           ///< [IN] Protocol engine
+)
+{
+    pa_clkSync_LatencyReport_t report;
+    le_clkSync_ClockTime_t time;
+    le_result_t result;
+    int failures = 0;
+    int i;
+
+    result = SetEngine(runPtr);
+    if (LE_OK != result)
+    {
+        printf("%-12s skipped: %s\n", runPtr->namePtr, LE_RESULT_TXT(result));
+        return;
+    }
+
+    pa_clkSync_ResetLatencyReports();
+    for (i = 0; i < Count; i++)
+    {
+        if (PA_CLKSYNC_PROTOCOL_TP == runPtr->protocol)
+        {
+            result = pa_clkSync_GetTimeWithTimeProtocol(ServerPtr, true, &time);
+        }
+        else
+        {
+            result = pa_clkSync_GetTimeWithNetworkTimeProtocol(ServerPtr, true, &time);
+        }
+        if (LE_OK != result)
+        {
+            failures++;
+        }
+    }
+
+    if (LE_OK != pa_clkSync_GetLatencyReport(runPtr->protocol, runPtr->engine, &report))
+    {
+        printf("%-12s no report\n", runPtr->namePtr);
+        return;
+    }
+
+    // Latencies are printed as p50/p99 in microseconds
+    printf("%-12s n=%" PRIu32 " failed=%d"
+           " dns=%" PRId64 "/%" PRId64 " spawn=%" PRId64 "/%" PRId64
+           " network=%" PRId64 "/%" PRId64 " parse=%" PRId64 "/%" PRId64
+           " total=%" PRId64 "/%" PRId64 " us cpu=%" PRId64 " us rss=%" PRIu32
+           " kB child_rss=%" PRIu32 " kB\n",
+           runPtr->namePtr, report.count, failures,
+           report.p50Ns[PA_CLKSYNC_PHASE_DNS] / BENCH_NS_PER_USEC,
+           report.p99Ns[PA_CLKSYNC_PHASE_DNS] / BENCH_NS_PER_USEC,
+           report.p50Ns[PA_CLKSYNC_PHASE_SPAWN] / BENCH_NS_PER_USEC,
+           report.p99Ns[PA_CLKSYNC_PHASE_SPAWN] / BENCH_NS_PER_USEC,
+           report.p50Ns[PA_CLKSYNC_PHASE_NETWORK] / BENCH_NS_PER_USEC,
+           report.p99Ns[PA_CLKSYNC_PHASE_NETWORK] / BENCH_NS_PER_USEC,
+           report.p50Ns[PA_CLKSYNC_PHASE_PARSE] / BENCH_NS_PER_USEC,
+           report.p99Ns[PA_CLKSYNC_PHASE_PARSE] / BENCH_NS_PER_USEC,
+           report.totalP50Ns / BENCH_NS_PER_USEC, report.totalP99Ns / BENCH_NS_PER_USEC,
+           report.cpuNs / BENCH_NS_PER_USEC, report.peakRssKb, report.childPeakRssKb);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Run the benchmark once all the components are initialized, and exit
+ */
+//--------------------------------------------------------------------------------------------------
+static void RunAll
+(
+    void* param1Ptr,                    ///< [IN] Unused
+    void* param2Ptr                     ///< [IN] Unused
+)
+{
+    size_t i;
+
+    if (Count <= 0)
+    {
+        LE_ERROR("Invalid count %d", Count);
+        exit(EXIT_FAILURE);
+    }
+    if (LE_OK != clkSyncMock_Start(MockAddrPtr))
+    {
+        exit(EXIT_FAILURE);
+    }
+    if (!ServerPtr)
+    {
+        ServerPtr = MockAddrPtr;
+    }
+
+    for (i = 0; i < NUM_ARRAY_MEMBERS(Runs); i++)
+    {
+        RunBench(&Runs[i]);
+    }
+    fflush(stdout);
+    exit(EXIT_SUCCESS);
+}
+
+
+COMPONENT_INIT
+{
+    le_arg_SetIntVar(&Count, "n", "count");
+    le_arg_SetStringVar(&MockAddrPtr, "a", "address");
+    le_arg_SetStringVar(&ServerPtr, "s", "server");
+    le_arg_Scan();
+
+    le_event_QueueFunction(RunAll, NULL, NULL);
+}
@@ -0,0 +1,303 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file clkSyncMock.c
+ *
+ * Mock time server of the benchmark of the Linux Clock Service Adapter. It answers the Time
+ * Protocol (RFC 868) over TCP and the Network Time Protocol (RFC 5905) over UDP with the local
+ * system time, so that the retrievals measured cost a loopback exchange and nothing more. It
+ * doesn't depend on the adapter's own clients, which it thus exercises as a real server would.
+ *
+ * The server runs in a thread of its own, blocked in poll() rather than in an event loop, so that
+ * it keeps answering while the benchmark is blocked in the adapter's retrievals.
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include "clkSyncMock.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Standard ports of the protocols served
+ */
+//--------------------------------------------------------------------------------------------------
+#define MOCK_TP_PORT                37
+#define MOCK_NTP_PORT               123
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Seconds from the NTP and TP epoch, 1900, to the Unix epoch, 1970
+ */
+//--------------------------------------------------------------------------------------------------
+#define MOCK_EPOCH_OFFSET_SECS      2208988800ULL
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * NTP packet length and offsets of its fields
+ */
+//--------------------------------------------------------------------------------------------------
+#define MOCK_NTP_PACKET_LENGTH      48
+#define MOCK_NTP_OFFSET_STRATUM     1
+#define MOCK_NTP_OFFSET_POLL        2
+#define MOCK_NTP_OFFSET_PRECISION   3
+#define MOCK_NTP_OFFSET_REFID       12
+#define MOCK_NTP_OFFSET_REF_TS      16
+#define MOCK_NTP_OFFSET_ORIGIN_TS   24
+#define MOCK_NTP_OFFSET_RECEIVE_TS  32
+#define MOCK_NTP_OFFSET_TRANSMIT_TS 40
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * First octet of the replies: no leap second warning, the client's version, server mode
+ */
+//--------------------------------------------------------------------------------------------------
+#define MOCK_NTP_MODE_SERVER        4
+#define MOCK_NTP_VN(octet)          (((octet) >> 3) & 0x07)
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Stratum and precision advertised, those of a server synchronized to a close reference
+ */
+//--------------------------------------------------------------------------------------------------
+#define MOCK_NTP_STRATUM            2
+#define MOCK_NTP_PRECISION          (-20)
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Listening sockets of the protocols served
+ */
+//--------------------------------------------------------------------------------------------------
+static int TpFd = -1;
+static int NtpFd = -1;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Write the given system time as an NTP timestamp
+ */
+//--------------------------------------------------------------------------------------------------
+static void PutTimestamp
+(
+    const struct timespec* tsPtr,       ///< [IN]  System time
+    uint8_t* bufPtr                     ///< [OUT] NTP timestamp, 8 bytes
+)
+{
+    uint32_t secs = (uint32_t)((uint64_t)tsPtr->tv_sec + MOCK_EPOCH_OFFSET_SECS);
+    uint32_t frac = (uint32_t)(((uint64_t)tsPtr->tv_nsec << 32) / 1000000000ULL);
+
+    secs = htonl(secs);
+    frac = htonl(frac);
+    memcpy(bufPtr, &secs, sizeof(secs));
+    memcpy(bufPtr + sizeof(secs), &frac, sizeof(frac));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Open a socket of the given type bound to the given address and port, listening for TCP
+ *
+ * @return
+ *      The socket, -1 on failure
+ */
+//--------------------------------------------------------------------------------------------------
+static int OpenSocket
+(
+    const struct in_addr* addrPtr,      ///< [IN] Address to bind
+    uint16_t port,                      ///< [IN] Port to bind
+    int type                            ///< [IN] SOCK_STREAM or SOCK_DGRAM
+)
+{
+    struct sockaddr_in sa = {0};
+    int on = 1;
+    int fd;
+
+    fd = socket(AF_INET, type | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        LE_ERROR("Failed to create socket (%m)");
+        return -1;
+    }
+
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons(port);
+    sa.sin_addr = *addrPtr;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    if (bind(fd, (struct sockaddr*)&sa, sizeof(sa)) ||
+        ((SOCK_STREAM == type) && listen(fd, SOMAXCONN)))
+    {
+        LE_ERROR("Failed to bind port %u (%m)", port);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Answer a TP connection with the current time, in seconds since 1900, and close it
+ */
+//--------------------------------------------------------------------------------------------------
+static void ServeTp
+(
+    void
+)
+{
+    struct timespec ts;
+    uint32_t secs;
+    int fd;
+
+    fd = accept4(TpFd, NULL, NULL, SOCK_CLOEXEC);
+    if (fd < 0)
+    {
+        return;
+    }
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    secs = htonl((uint32_t)((uint64_t)ts.tv_sec + MOCK_EPOCH_OFFSET_SECS));
+    if (sizeof(secs) != write(fd, &secs, sizeof(secs)))
+    {
+        LE_WARN("Failed to answer TP client (%m)");
+    }
+    close(fd);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Answer an NTP client mode request with a server mode reply
+ */
+//--------------------------------------------------------------------------------------------------
+static void ServeNtp
+(
+    void
+)
+{
+    uint8_t request[MOCK_NTP_PACKET_LENGTH];
+    uint8_t reply[MOCK_NTP_PACKET_LENGTH] = {0};
+    struct sockaddr_storage peer;
+    socklen_t peerLen = sizeof(peer);
+    struct timespec receiveTs, transmitTs;
+    ssize_t len;
+
+    len = recvfrom(NtpFd, request, sizeof(request), 0, (struct sockaddr*)&peer, &peerLen);
+    clock_gettime(CLOCK_REALTIME, &receiveTs);
+    if (len < (ssize_t)sizeof(request))
+    {
+        return;
+    }
+
+    reply[0] = (uint8_t)((MOCK_NTP_VN(request[0]) << 3) | MOCK_NTP_MODE_SERVER);
+    reply[MOCK_NTP_OFFSET_STRATUM] = MOCK_NTP_STRATUM;
+    reply[MOCK_NTP_OFFSET_POLL] = request[MOCK_NTP_OFFSET_POLL];
+    reply[MOCK_NTP_OFFSET_PRECISION] = (uint8_t)MOCK_NTP_PRECISION;
+    memcpy(reply + MOCK_NTP_OFFSET_REFID, "MOCK", 4);
+    PutTimestamp(&receiveTs, reply + MOCK_NTP_OFFSET_REF_TS);
+    memcpy(reply + MOCK_NTP_OFFSET_ORIGIN_TS, request + MOCK_NTP_OFFSET_TRANSMIT_TS, 8);
+    PutTimestamp(&receiveTs, reply + MOCK_NTP_OFFSET_RECEIVE_TS);
+    clock_gettime(CLOCK_REALTIME, &transmitTs);
+    PutTimestamp(&transmitTs, reply + MOCK_NTP_OFFSET_TRANSMIT_TS);
+
+    if (sendto(NtpFd, reply, sizeof(reply), 0, (struct sockaddr*)&peer, peerLen) < 0)
+    {
+        LE_WARN("Failed to answer NTP client (%m)");
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Main function of the server's thread, which answers the clients until the process exits
+ *
+ * @return
+ *      NULL
+ */
+//--------------------------------------------------------------------------------------------------
+static void* ServerThread
+(
+    void* contextPtr                    ///< [IN] Unused
+)
+{
+    struct pollfd pfds[2] =
+    {
+        { .fd = TpFd, .events = POLLIN },
+        { .fd = NtpFd, .events = POLLIN },
+    };
+
+    for (;;)
+    {
+        if (poll(pfds, 2, -1) < 0)
+        {
+            if (EINTR != errno)
+            {
+                LE_ERROR("Failed to wait for clients (%m)");
+                return NULL;
+            }
+            continue;
+        }
+        if (pfds[0].revents & POLLIN)
+        {
+            ServeTp();
+        }
+        if (pfds[1].revents & POLLIN)
+        {
+            ServeNtp();
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start serving the local system time on the standard TP and NTP ports of the given IPv4 address,
+ * from a thread of its own. Binding these ports needs the privilege to do so.
+ *
+ * @return
+ *      - LE_OK             Server started
+ *      - LE_BAD_PARAMETER  Invalid address
+ *      - LE_FAULT          The ports couldn't be bound
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncMock_Start
+(
+    const char* addrStr                 ///< [IN] IPv4 address to listen on
+)
+{
+    struct in_addr addr;
+
+    if (!addrStr || (1 != inet_pton(AF_INET, addrStr, &addr)))
+    {
+        LE_ERROR("Invalid mock server address %s", addrStr ? addrStr : "(null)");
+        return LE_BAD_PARAMETER;
+    }
+
+    TpFd = OpenSocket(&addr, MOCK_TP_PORT, SOCK_STREAM);
+    NtpFd = OpenSocket(&addr, MOCK_NTP_PORT, SOCK_DGRAM);
+    if ((TpFd < 0) || (NtpFd < 0))
+    {
+        if (TpFd >= 0)
+        {
+            close(TpFd);
+        }
+        if (NtpFd >= 0)
+        {
+            close(NtpFd);
+        }
+        TpFd = NtpFd = -1;
+        return LE_FAULT;
+    }
+
+    le_thread_Start(le_thread_Create("ClkSyncMock", ServerThread, NULL));
+    LE_INFO("Mock TP and NTP server listening on %s", addrStr);
+    return LE_OK;
+}
+
+
+COMPONENT_INIT
+{
+}
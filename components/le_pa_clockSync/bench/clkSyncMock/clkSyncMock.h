@@ -0,0 +1,40 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file clkSyncMock.h
+ *
+ * Mock Time Protocol and Network Time Protocol server of the benchmark of the Linux Clock Service
+ * Adapter
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef CLKSYNC_MOCK_H_INCLUDE_GUARD
+#define CLKSYNC_MOCK_H_INCLUDE_GUARD
+
+#include "legato.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Default address the mock server listens on
+ */
+//--------------------------------------------------------------------------------------------------
+#define CLKSYNC_MOCK_DEFAULT_ADDR       "127.0.0.1"
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start serving the local system time on the standard TP and NTP ports of the given IPv4 address,
+ * from a thread of its own. Binding these ports needs the privilege to do so.
+ *
+ * @return
+ *      - LE_OK             Server started
+ *      - LE_BAD_PARAMETER  Invalid address
+ *      - LE_FAULT          The ports couldn't be bound
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncMock_Start
+(
+    const char* addrStr                 ///< [IN] IPv4 address to listen on
+);
+
+#endif // CLKSYNC_MOCK_H_INCLUDE_GUARD
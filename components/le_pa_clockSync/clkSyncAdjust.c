@@ -0,0 +1,341 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file clkSyncAdjust.c
+ *
+ * Update of the system clock by the Linux Clock Service Adapter. Offsets within the step
+ * threshold are slewed with adjtimex(), the kernel then speeding up or slowing down the clock by
+ * at most 500 ppm until the offset is absorbed, so that the clock stays monotonic and no timer
+ * jumps. Larger offsets, which would take too long to slew, are stepped with clock_settime().
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include <sys/timex.h>
+#include "pa_clkSync_linux.h"
+#include "clkSyncLocal.h"
+#include "clkSyncAdjust.h"
+#include "clkSyncDrift.h"
+#include "clkSyncSnapshot.h"
+#include "clkSyncStats.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Largest offset slewed, in nanoseconds
+ */
+//--------------------------------------------------------------------------------------------------
+static int64_t StepThresholdNs =
+    (int64_t)PA_CLKSYNC_STEP_THRESHOLD_MS_DEFAULT * CLKSYNC_NS_PER_MSEC;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Last update of the system clock
+ */
+//--------------------------------------------------------------------------------------------------
+static pa_clkSync_ClockAdjust_t LastAdjust = PA_CLKSYNC_CLOCK_ADJUST_NONE;
+static int64_t LastOffsetNs;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start slewing the system clock by the given offset, in whole microseconds, replacing any slew in
+ * progress, of which the part not applied yet is returned
+ *
+ * @return
+ *      - LE_OK             Slew started
+ *      - LE_FAULT          Failed to slew the system clock
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t SlewClock
+(
+    int64_t offsetNs,               ///< [IN]  Offset to add to the system clock
+    int64_t* unappliedNsPtr         ///< [OUT] Part of the slew replaced still to be applied
+)
+{
+    struct timex tx = {0};
+
+    // Single-shot offsets, as set by adjtime(), are given in microseconds and applied outside of
+    // the kernel PLL, which needn't be enabled. The offset is truncated to whole microseconds, so
+    // that less than 1 us is not corrected: ADJ_OFFSET with ADJ_NANO would take nanoseconds, but
+    // through the PLL, which would then go on steering the clock on its own.
+    tx.modes = ADJ_OFFSET_SINGLESHOT;
+    tx.offset = (long)(offsetNs / CLKSYNC_NS_PER_USEC);
+    if (adjtimex(&tx) < 0)
+    {
+        LE_ERROR("Failed to slew system clock (%m)");
+        return LE_FAULT;
+    }
+
+    // The kernel gives back the remainder of the slew replaced, in microseconds too
+    *unappliedNsPtr = (int64_t)tx.offset * CLKSYNC_NS_PER_USEC;
+
+    LE_INFO("System clock slewing by %" PRId64 " us", offsetNs / CLKSYNC_NS_PER_USEC);
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Step the system clock by the given offset
+ *
+ * @return
+ *      - LE_OK             System clock updated
+ *      - LE_FAULT          Failed to update the system clock
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t StepClock
+(
+    int64_t offsetNs                ///< [IN] Offset to add to the system clock
+)
+{
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_REALTIME, &ts))
+    {
+        LE_ERROR("Failed to read system clock (%m)");
+        return LE_FAULT;
+    }
+
+    ts = clkSync_NsToTimespec(clkSync_TimespecToNs(&ts) + offsetNs);
+    if (clock_settime(CLOCK_REALTIME, &ts))
+    {
+        LE_ERROR("Failed to set system clock (%m)");
+        return LE_FAULT;
+    }
+
+    LE_INFO("System clock stepped by %" PRId64 " ms", offsetNs / CLKSYNC_NS_PER_MSEC);
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Correct the system clock by the given offset, slewing it when the offset is within the step
+ * threshold and stepping it otherwise, and record the update
+ *
+ * @return
+ *      - LE_OK             System clock updated
+ *      - LE_FAULT          Failed to update the system clock
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t CorrectClock
+(
+    int64_t offsetNs,               ///< [IN] Offset to add to the system clock
+    bool isMeasured                 ///< [IN] Whether the offset was measured against a server,
+                                    ///<      and is taken into the drift estimation
+)
+{
+    pa_clkSync_ClockAdjust_t adjust;
+    int64_t unappliedNs = 0;
+    le_result_t result;
+
+    if (!clkSyncAdjust_IsStep(offsetNs))
+    {
+        adjust = PA_CLKSYNC_CLOCK_ADJUST_SLEW;
+        result = SlewClock(offsetNs, &unappliedNs);
+    }
+    else
+    {
+        // A slew still in progress would otherwise go on adding its remainder after the step
+        if (StepThresholdNs > 0)
+        {
+            SlewClock(0, &unappliedNs);
+        }
+
+        adjust = PA_CLKSYNC_CLOCK_ADJUST_STEP;
+        result = StepClock(offsetNs);
+    }
+
+    if (LE_OK == result)
+    {
+        LastAdjust = adjust;
+        LastOffsetNs = offsetNs;
+        clkSyncStats_AddAdjust(adjust, offsetNs);
+        if (isMeasured)
+        {
+            clkSyncDrift_AddSample(offsetNs, unappliedNs);
+        }
+        clkSyncSnapshot_Save();
+    }
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Correct the system clock by the given offset, slewing it when the offset is within the step
+ * threshold and stepping it otherwise
+ *
+ * @return
+ *      - LE_OK             System clock updated
+ *      - LE_FAULT          Failed to update the system clock
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncAdjust_Apply
+(
+    int64_t offsetNs                ///< [IN] Offset to add to the system clock
+)
+{
+    return CorrectClock(offsetNs, true);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Correct the system clock by the given offset to an estimate of the present time from a local
+ * source, the same way as clkSyncAdjust_Apply(). The estimate isn't a measured offset and isn't
+ * taken into the drift estimation, its error being too large for the drift fit.
+ *
+ * @return
+ *      - LE_OK             System clock updated
+ *      - LE_FAULT          Failed to update the system clock
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncAdjust_ApplyEstimate
+(
+    int64_t offsetNs                ///< [IN] Offset to add to the system clock
+)
+{
+    return CorrectClock(offsetNs, false);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Record that the system clock was updated by a command
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncAdjust_ReportCommand
+(
+    void
+)
+{
+    LastAdjust = PA_CLKSYNC_CLOCK_ADJUST_COMMAND;
+    LastOffsetNs = 0;
+    clkSyncStats_AddAdjust(LastAdjust, 0);
+
+    // The drift can't be followed across a correction of unknown offset
+    clkSyncDrift_Reset();
+    clkSyncSnapshot_Save();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Step the system clock by the given offset to an estimate of the present time, which isn't a
+ * measured offset and isn't taken into the drift estimation
+ *
+ * @return
+ *      - LE_OK             System clock updated
+ *      - LE_FAULT          Failed to update the system clock
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncAdjust_Restore
+(
+    int64_t offsetNs                ///< [IN] Offset to add to the system clock
+)
+{
+    le_result_t result = StepClock(offsetNs);
+
+    if (LE_OK == result)
+    {
+        LastAdjust = PA_CLKSYNC_CLOCK_ADJUST_RESTORE;
+        LastOffsetNs = offsetNs;
+        clkSyncStats_AddAdjust(LastAdjust, offsetNs);
+    }
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the largest offset corrected by slewing; 0 always steps the clock
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncAdjust_SetStepThreshold
+(
+    uint32_t thresholdMs            ///< [IN] Largest offset slewed
+)
+{
+    StepThresholdNs = (int64_t)thresholdMs * CLKSYNC_NS_PER_MSEC;
+    LE_INFO("Step threshold set to %u ms", thresholdMs);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Tell whether an offset is corrected by stepping the system clock rather than slewing it
+ *
+ * @return
+ *      true if the offset is beyond the step threshold
+ */
+//--------------------------------------------------------------------------------------------------
+bool clkSyncAdjust_IsStep
+(
+    int64_t offsetNs                ///< [IN] Offset to add to the system clock
+)
+{
+    return (StepThresholdNs <= 0) || (offsetNs > StepThresholdNs) ||
+           (offsetNs < -StepThresholdNs);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get how the system clock was last updated
+ *
+ * @return
+ *      Kind of the last update, PA_CLKSYNC_CLOCK_ADJUST_NONE if none yet
+ */
+//--------------------------------------------------------------------------------------------------
+pa_clkSync_ClockAdjust_t clkSyncAdjust_GetLast
+(
+    int64_t* offsetNsPtr            ///< [OUT] Offset corrected, 0 if unknown; may be NULL
+)
+{
+    if (offsetNsPtr)
+    {
+        *offsetNsPtr = LastOffsetNs;
+    }
+    return LastAdjust;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the state of the kernel's discipline of the system clock, as run by a time daemon such as
+ * ntpd, chronyd or systemd-timesyncd
+ *
+ * @return
+ *      - LE_OK             The clock is synchronized; the offset the kernel has yet to correct is
+ *                          returned
+ *      - LE_UNAVAILABLE    No daemon keeps the clock synchronized
+ *      - LE_FAULT          Failed to read the state
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncAdjust_GetKernelSync
+(
+    int64_t* offsetNsPtr            ///< [OUT] Offset of the true time from the system clock
+)
+{
+    struct timex tx = {0};
+    int state = adjtimex(&tx);
+
+    if (state < 0)
+    {
+        LE_ERROR("Failed to read the kernel clock state (%m)");
+        return LE_FAULT;
+    }
+    if ((TIME_ERROR == state) || (tx.status & STA_UNSYNC))
+    {
+        LE_DEBUG("System clock not synchronized by the kernel discipline");
+        return LE_UNAVAILABLE;
+    }
+
+    // The remaining offset is in microseconds, or nanoseconds in nanosecond mode
+    *offsetNsPtr = (tx.status & STA_NANO) ? (int64_t)tx.offset :
+                                            (int64_t)tx.offset * CLKSYNC_NS_PER_USEC;
+    LE_DEBUG("System clock synchronized by the kernel discipline, estimated error %ld us",
+             tx.esterror);
+    return LE_OK;
+}
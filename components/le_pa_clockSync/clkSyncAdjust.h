@@ -0,0 +1,133 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file clkSyncAdjust.h
+ *
+ * Update of the system clock by stepping or slewing, for the Linux Clock Service Adapter
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef CLKSYNC_ADJUST_H_INCLUDE_GUARD
+#define CLKSYNC_ADJUST_H_INCLUDE_GUARD
+
+#include "legato.h"
+#include "pa_clkSync_linux.h"
+#include "clkSyncLocal.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Correct the system clock by the given offset, slewing it when the offset is within the step
+ * threshold and stepping it otherwise
+ *
+ * @return
+ *      - LE_OK             System clock updated
+ *      - LE_FAULT          Failed to update the system clock
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncAdjust_Apply
+(
+    int64_t offsetNs                ///< [IN] Offset to add to the system clock
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Correct the system clock by the given offset to an estimate of the present time from a local
+ * source, the same way as clkSyncAdjust_Apply(). The estimate isn't a measured offset and isn't
+ * taken into the drift estimation, its error being too large for the drift fit.
+ *
+ * @return
+ *      - LE_OK             System clock updated
+ *      - LE_FAULT          Failed to update the system clock
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncAdjust_ApplyEstimate
+(
+    int64_t offsetNs                ///< [IN] Offset to add to the system clock
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Step the system clock by the given offset to an estimate of the present time, which isn't a
+ * measured offset and isn't taken into the drift estimation
+ *
+ * @return
+ *      - LE_OK             System clock updated
+ *      - LE_FAULT          Failed to update the system clock
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncAdjust_Restore
+(
+    int64_t offsetNs                ///< [IN] Offset to add to the system clock
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Record that the system clock was updated by a command
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncAdjust_ReportCommand
+(
+    void
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the largest offset corrected by slewing; 0 always steps the clock
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncAdjust_SetStepThreshold
+(
+    uint32_t thresholdMs            ///< [IN] Largest offset slewed
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Tell whether an offset is corrected by stepping the system clock rather than slewing it
+ *
+ * @return
+ *      true if the offset is beyond the step threshold
+ */
+//--------------------------------------------------------------------------------------------------
+bool clkSyncAdjust_IsStep
+(
+    int64_t offsetNs                ///< [IN] Offset to add to the system clock
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get how the system clock was last updated
+ *
+ * @return
+ *      Kind of the last update, PA_CLKSYNC_CLOCK_ADJUST_NONE if none yet
+ */
+//--------------------------------------------------------------------------------------------------
+pa_clkSync_ClockAdjust_t clkSyncAdjust_GetLast
+(
+    int64_t* offsetNsPtr            ///< [OUT] Offset corrected, 0 if unknown; may be NULL
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the state of the kernel's discipline of the system clock, as run by a time daemon such as
+ * ntpd, chronyd or systemd-timesyncd
+ *
+ * @return
+ *      - LE_OK             The clock is synchronized; the offset the kernel has yet to correct is
+ *                          returned
+ *      - LE_UNAVAILABLE    No daemon keeps the clock synchronized
+ *      - LE_FAULT          Failed to read the state
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncAdjust_GetKernelSync
+(
+    int64_t* offsetNsPtr            ///< [OUT] Offset of the true time from the system clock
+);
+
+#endif // CLKSYNC_ADJUST_H_INCLUDE_GUARD
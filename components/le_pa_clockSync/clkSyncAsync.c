@@ -0,0 +1,291 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file clkSyncAsync.c
+ *
+ * Running of native client races from the Legato event loop. The sockets of the race's attempts
+ * are registered with le_fdMonitor and a timer fires at the next stagger start or deadline, each
+ * of which advances the race with clkSyncRace_Process() instead of blocking in poll().
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "clkSyncLocal.h"
+#include "clkSyncRace.h"
+#include "clkSyncAsync.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Number of races expected to run at the same time
+ */
+//--------------------------------------------------------------------------------------------------
+#define ASYNC_RACE_POOL_SIZE        2
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Race run from the event loop
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct clkSyncAsync_Race
+{
+    clkSync_Race_t race;                                ///< State of the race
+    le_fdMonitor_Ref_t monitorRefs[CLKSYNC_MAX_ADDRS];  ///< Monitor of each attempt's socket
+    int monitoredFds[CLKSYNC_MAX_ADDRS];                ///< Socket watched by each monitor
+    short monitoredEvents[CLKSYNC_MAX_ADDRS];           ///< Events watched by each monitor
+    le_timer_Ref_t timerRef;                            ///< Timer of the next start or deadline
+    clkSyncAsync_RaceHandlerFunc_t handlerFunc;         ///< Completion handler
+    void* contextPtr;                                   ///< Context given to the handler
+}
+AsyncRace_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Pool of races run from the event loop
+ */
+//--------------------------------------------------------------------------------------------------
+static le_mem_PoolRef_t AsyncRacePool;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Delete the monitor of an attempt's socket right before the race closes it, as the socket's
+ * number may be reused as soon as it is closed
+ */
+//--------------------------------------------------------------------------------------------------
+static void CloseHandler
+(
+    size_t index,                       ///< [IN] Index of the attempt
+    void* contextPtr                    ///< [IN] Race
+)
+{
+    AsyncRace_t* racePtr = contextPtr;
+
+    if (racePtr->monitorRefs[index])
+    {
+        le_fdMonitor_Delete(racePtr->monitorRefs[index]);
+        racePtr->monitorRefs[index] = NULL;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Delete the monitors and the timer of a race and release it
+ */
+//--------------------------------------------------------------------------------------------------
+static void DeleteRace
+(
+    AsyncRace_t* racePtr                ///< [IN] Race to delete
+)
+{
+    // The monitors are deleted as the sockets are closed
+    clkSyncRace_Abort(&racePtr->race);
+    le_timer_Delete(racePtr->timerRef);
+    le_mem_Release(racePtr);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Update the monitors and the timer of a race to its present attempts
+ */
+//--------------------------------------------------------------------------------------------------
+static void WatchRace
+(
+    AsyncRace_t* racePtr                ///< [IN] Race in progress
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Advance a race and complete it when done
+ */
+//--------------------------------------------------------------------------------------------------
+static void AdvanceRace
+(
+    AsyncRace_t* racePtr,               ///< [IN] Race in progress
+    const struct pollfd* pfdPtr         ///< [IN] Event received, NULL on timer expiry
+)
+{
+    clkSyncAsync_RaceHandlerFunc_t handlerFunc;
+    void* contextPtr;
+    clkSync_Sample_t sample;
+    le_result_t result;
+
+    result = clkSyncRace_Process(&racePtr->race, pfdPtr, pfdPtr ? 1 : 0, &sample);
+    if (LE_IN_PROGRESS == result)
+    {
+        WatchRace(racePtr);
+        return;
+    }
+
+    // The race is released before calling the handler, whose reference is then no longer valid
+    handlerFunc = racePtr->handlerFunc;
+    contextPtr = racePtr->contextPtr;
+    DeleteRace(racePtr);
+    handlerFunc(result, &sample, contextPtr);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handler of the events on the sockets of a race
+ */
+//--------------------------------------------------------------------------------------------------
+static void SocketHandler
+(
+    int fd,                             ///< [IN] Socket
+    short events                        ///< [IN] Events received
+)
+{
+    AsyncRace_t* racePtr = le_fdMonitor_GetContextPtr();
+    struct pollfd pfd = { .fd = fd, .events = events, .revents = events };
+
+    AdvanceRace(racePtr, &pfd);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handler of the timer of a race
+ */
+//--------------------------------------------------------------------------------------------------
+static void TimerHandler
+(
+    le_timer_Ref_t timerRef             ///< [IN] Timer expired
+)
+{
+    AdvanceRace(le_timer_GetContextPtr(timerRef), NULL);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Update the monitors and the timer of a race to its present attempts
+ */
+//--------------------------------------------------------------------------------------------------
+static void WatchRace
+(
+    AsyncRace_t* racePtr                ///< [IN] Race in progress
+)
+{
+    struct pollfd pfds[CLKSYNC_MAX_ADDRS];
+    int64_t wakeNs, waitNs;
+    size_t i;
+
+    for (i = 0; i < CLKSYNC_MAX_ADDRS; i++)
+    {
+        const clkSync_Attempt_t* attemptPtr = &racePtr->race.attempts[i];
+
+        if (racePtr->monitorRefs[i] && (racePtr->monitoredFds[i] != attemptPtr->fd))
+        {
+            le_fdMonitor_Delete(racePtr->monitorRefs[i]);
+            racePtr->monitorRefs[i] = NULL;
+        }
+
+        if (attemptPtr->fd < 0)
+        {
+            continue;
+        }
+
+        if (!racePtr->monitorRefs[i])
+        {
+            char name[32];
+
+            snprintf(name, sizeof(name), "%s%zu", racePtr->race.clientPtr->namePtr, i);
+            racePtr->monitorRefs[i] = le_fdMonitor_Create(name, attemptPtr->fd, SocketHandler,
+                                                          attemptPtr->events);
+            le_fdMonitor_SetContextPtr(racePtr->monitorRefs[i], racePtr);
+            racePtr->monitoredFds[i] = attemptPtr->fd;
+            racePtr->monitoredEvents[i] = attemptPtr->events;
+        }
+        else if (racePtr->monitoredEvents[i] != attemptPtr->events)
+        {
+            le_fdMonitor_Disable(racePtr->monitorRefs[i], racePtr->monitoredEvents[i]);
+            le_fdMonitor_Enable(racePtr->monitorRefs[i], attemptPtr->events);
+            racePtr->monitoredEvents[i] = attemptPtr->events;
+        }
+    }
+
+    clkSyncRace_GetPollFds(&racePtr->race, pfds, &wakeNs);
+    waitNs = wakeNs - clkSync_GetClockNs(CLOCK_MONOTONIC);
+    if (waitNs < 0)
+    {
+        waitNs = 0;
+    }
+
+    le_timer_Stop(racePtr->timerRef);
+    le_timer_SetMsInterval(racePtr->timerRef,
+                           (uint32_t)((waitNs + CLKSYNC_NS_PER_MSEC - 1) / CLKSYNC_NS_PER_MSEC));
+    le_timer_Start(racePtr->timerRef);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Initialize the pool of races run from the event loop
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncAsync_Init
+(
+    void
+)
+{
+    AsyncRacePool = le_mem_CreatePool("ClkSyncAsyncRacePool", sizeof(AsyncRace_t));
+    le_mem_ExpandPool(AsyncRacePool, ASYNC_RACE_POOL_SIZE);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start a race of the given client across the given addresses, driven by the event loop of the
+ * calling thread. The handler is always called from the event loop, never from within this
+ * function.
+ *
+ * @return
+ *      Reference to the race, valid until its handler is called or it is cancelled
+ */
+//--------------------------------------------------------------------------------------------------
+clkSyncAsync_RaceRef_t clkSyncAsync_StartRace
+(
+    const clkSync_Client_t* clientPtr,          ///< [IN] Client to run
+    const clkSync_AddrList_t* listPtr,          ///< [IN] Addresses to query
+    uint32_t timeoutMs,                         ///< [IN] Time given to each attempt
+    clkSyncAsync_RaceHandlerFunc_t handlerFunc, ///< [IN] Completion handler
+    void* contextPtr                            ///< [IN] Context given to the handler
+)
+{
+    AsyncRace_t* racePtr = le_mem_ForceAlloc(AsyncRacePool);
+
+    memset(racePtr, 0, sizeof(*racePtr));
+    clkSyncRace_Init(&racePtr->race, clientPtr, listPtr, timeoutMs);
+    clkSyncRace_SetCloseHandler(&racePtr->race, CloseHandler, racePtr);
+    racePtr->handlerFunc = handlerFunc;
+    racePtr->contextPtr = contextPtr;
+
+    // The first attempt is started from the timer, so that the handler can't be called before
+    // the caller gets the race's reference
+    racePtr->timerRef = le_timer_Create("ClkSyncAsyncRace");
+    le_timer_SetHandler(racePtr->timerRef, TimerHandler);
+    le_timer_SetContextPtr(racePtr->timerRef, racePtr);
+    le_timer_SetMsInterval(racePtr->timerRef, 0);
+    le_timer_Start(racePtr->timerRef);
+    return racePtr;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Cancel a race in progress; its handler is not called
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncAsync_CancelRace
+(
+    clkSyncAsync_RaceRef_t raceRef              ///< [IN] Race to cancel
+)
+{
+    if (raceRef)
+    {
+        DeleteRace(raceRef);
+    }
+}
@@ -0,0 +1,79 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file clkSyncAsync.h
+ *
+ * Running of native client races from the Legato event loop, for the Linux Clock Service Adapter
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef CLKSYNC_ASYNC_H_INCLUDE_GUARD
+#define CLKSYNC_ASYNC_H_INCLUDE_GUARD
+
+#include "legato.h"
+#include "clkSyncLocal.h"
+#include "clkSyncRace.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Reference to a race run from the event loop
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct clkSyncAsync_Race* clkSyncAsync_RaceRef_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handler called from the event loop when a race completes, with the same result as
+ * clkSyncRace_Run(); the sample is only valid on LE_OK and only during the call
+ */
+//--------------------------------------------------------------------------------------------------
+typedef void (*clkSyncAsync_RaceHandlerFunc_t)
+(
+    le_result_t result,                 ///< [IN] Result of the race
+    const clkSync_Sample_t* samplePtr,  ///< [IN] Winning sample
+    void* contextPtr                    ///< [IN] Context given at the start of the race
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Initialize the pool of races run from the event loop
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncAsync_Init
+(
+    void
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start a race of the given client across the given addresses, driven by the event loop of the
+ * calling thread. The handler is always called from the event loop, never from within this
+ * function.
+ *
+ * @return
+ *      Reference to the race, valid until its handler is called or it is cancelled
+ */
+//--------------------------------------------------------------------------------------------------
+clkSyncAsync_RaceRef_t clkSyncAsync_StartRace
+(
+    const clkSync_Client_t* clientPtr,          ///< [IN] Client to run
+    const clkSync_AddrList_t* listPtr,          ///< [IN] Addresses to query
+    uint32_t timeoutMs,                         ///< [IN] Time given to each attempt
+    clkSyncAsync_RaceHandlerFunc_t handlerFunc, ///< [IN] Completion handler
+    void* contextPtr                            ///< [IN] Context given to the handler
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Cancel a race in progress; its handler is not called
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncAsync_CancelRace
+(
+    clkSyncAsync_RaceRef_t raceRef              ///< [IN] Race to cancel
+);
+
+#endif // CLKSYNC_ASYNC_H_INCLUDE_GUARD
@@ -0,0 +1,161 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file clkSyncCache.c
+ *
+ * Cache of the last time retrieved from each protocol's server by the Linux Clock Service Adapter.
+ * The time retrieved is kept along with the CLOCK_BOOTTIME instant of its retrieval, so that a
+ * get only request made within the freshness window is answered by extrapolating it, without any
+ * exchange with the server. The extrapolation doesn't depend on the system clock, which may be
+ * stepped meanwhile, and also accounts for the time suspended; over a window of a few seconds the
+ * drift of the local oscillator is negligible.
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include <netdb.h>
+#include "pa_clkSync_linux.h"
+#include "clkSyncLocal.h"
+#include "clkSyncCache.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Last time retrieved with a protocol
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    char server[NI_MAXHOST + 1];            ///< Time server name or address, empty if none
+    int64_t timeNs;                         ///< Time retrieved, since the Unix epoch
+    int64_t bootNs;                         ///< CLOCK_BOOTTIME at the retrieval
+}
+CacheEntry_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Last time retrieved with each protocol
+ */
+//--------------------------------------------------------------------------------------------------
+static CacheEntry_t Entries[PA_CLKSYNC_PROTOCOL_MAX];
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Freshness window, 0 if disabled
+ */
+//--------------------------------------------------------------------------------------------------
+static uint32_t WindowMs = PA_CLKSYNC_RESULT_CACHE_MS_DEFAULT;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Mutex protecting the cache
+ */
+//--------------------------------------------------------------------------------------------------
+static le_mutex_Ref_t CacheMutex;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Initialize the cache of the times retrieved
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncCache_Init
+(
+    void
+)
+{
+    CacheMutex = le_mutex_CreateNonRecursive("ClkSyncCacheMutex");
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Remember the time just retrieved from a server with a protocol, replacing the one previously
+ * retrieved with this protocol
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncCache_Store
+(
+    pa_clkSync_Protocol_t protocol,             ///< [IN] Protocol
+    const char* serverStrPtr,                   ///< [IN] Time server name or address
+    int64_t timeNs,                             ///< [IN] Time retrieved, since the Unix epoch
+    int64_t bootNs                              ///< [IN] CLOCK_BOOTTIME at which it was the time
+)
+{
+    CacheEntry_t* entryPtr;
+
+    if ((protocol >= PA_CLKSYNC_PROTOCOL_MAX) || !serverStrPtr)
+    {
+        return;
+    }
+
+    entryPtr = &Entries[protocol];
+    le_mutex_Lock(CacheMutex);
+    if (LE_OK != le_utf8_Copy(entryPtr->server, serverStrPtr, sizeof(entryPtr->server), NULL))
+    {
+        entryPtr->server[0] = '\0';
+    }
+    entryPtr->timeNs = timeNs;
+    entryPtr->bootNs = bootNs;
+    le_mutex_Unlock(CacheMutex);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Estimate the current time of a server from the last time retrieved from it with a protocol, if
+ * retrieved within the freshness window
+ *
+ * @return
+ *      - LE_OK             Time estimated
+ *      - LE_NOT_FOUND      No time retrieved from this server within the freshness window
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncCache_Estimate
+(
+    pa_clkSync_Protocol_t protocol,             ///< [IN]  Protocol
+    const char* serverStrPtr,                   ///< [IN]  Time server name or address
+    int64_t* timeNsPtr,                         ///< [OUT] Time estimated, since the Unix epoch
+    uint32_t* ageMsPtr                          ///< [OUT] Time elapsed since the retrieval
+)
+{
+    const CacheEntry_t* entryPtr;
+    le_result_t result = LE_NOT_FOUND;
+    int64_t ageNs;
+
+    if ((protocol >= PA_CLKSYNC_PROTOCOL_MAX) || !serverStrPtr)
+    {
+        return LE_NOT_FOUND;
+    }
+
+    entryPtr = &Entries[protocol];
+    le_mutex_Lock(CacheMutex);
+    ageNs = clkSync_GetClockNs(CLOCK_BOOTTIME) - entryPtr->bootNs;
+    if ((WindowMs > 0) && ('\0' != entryPtr->server[0]) &&
+        (0 == strcmp(entryPtr->server, serverStrPtr)) &&
+        (ageNs >= 0) && (ageNs < (int64_t)WindowMs * CLKSYNC_NS_PER_MSEC))
+    {
+        *timeNsPtr = entryPtr->timeNs + ageNs;
+        *ageMsPtr = (uint32_t)(ageNs / CLKSYNC_NS_PER_MSEC);
+        result = LE_OK;
+    }
+    le_mutex_Unlock(CacheMutex);
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the freshness window within which a time retrieved is used for estimates; a window of 0
+ * disables the estimates
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncCache_SetWindow
+(
+    uint32_t windowMs                           ///< [IN] Freshness window
+)
+{
+    le_mutex_Lock(CacheMutex);
+    WindowMs = windowMs;
+    le_mutex_Unlock(CacheMutex);
+}
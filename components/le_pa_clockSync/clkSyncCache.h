@@ -0,0 +1,72 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file clkSyncCache.h
+ *
+ * Cache of the last time retrieved from each protocol's server by the Linux Clock Service Adapter
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef CLKSYNC_CACHE_H_INCLUDE_GUARD
+#define CLKSYNC_CACHE_H_INCLUDE_GUARD
+
+#include "legato.h"
+#include "pa_clkSync_linux.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Initialize the cache of the times retrieved
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncCache_Init
+(
+    void
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Remember the time just retrieved from a server with a protocol, replacing the one previously
+ * retrieved with this protocol
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncCache_Store
+(
+    pa_clkSync_Protocol_t protocol,             ///< [IN] Protocol
+    const char* serverStrPtr,                   ///< [IN] Time server name or address
+    int64_t timeNs,                             ///< [IN] Time retrieved, since the Unix epoch
+    int64_t bootNs                              ///< [IN] CLOCK_BOOTTIME at which it was the time
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Estimate the current time of a server from the last time retrieved from it with a protocol, if
+ * retrieved within the freshness window
+ *
+ * @return
+ *      - LE_OK             Time estimated
+ *      - LE_NOT_FOUND      No time retrieved from this server within the freshness window
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncCache_Estimate
+(
+    pa_clkSync_Protocol_t protocol,             ///< [IN]  Protocol
+    const char* serverStrPtr,                   ///< [IN]  Time server name or address
+    int64_t* timeNsPtr,                         ///< [OUT] Time estimated, since the Unix epoch
+    uint32_t* ageMsPtr                          ///< [OUT] Time elapsed since the retrieval
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the freshness window within which a time retrieved is used for estimates; a window of 0
+ * disables the estimates
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncCache_SetWindow
+(
+    uint32_t windowMs                           ///< [IN] Freshness window
+);
+
+#endif // CLKSYNC_CACHE_H_INCLUDE_GUARD
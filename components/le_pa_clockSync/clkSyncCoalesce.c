@@ -0,0 +1,243 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file clkSyncCoalesce.c
+ *
+ * Coalescing of the concurrent time retrievals of the Linux Clock Service Adapter. When several
+ * clients ask for the time at once, e.g. right after boot, the callers arriving while a retrieval
+ * from the same server with the same protocol is in progress wait for it and share its result,
+ * rather than each querying the server or spawning the same command again.
+ *
+ * A caller only joins a retrieval which serves what it needs: one only getting the time can share
+ * a retrieval also setting the clock, but one setting the clock can't rely on a get only one.
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include <netdb.h>
+#include "pa_clkSync_linux.h"
+#include "clkSyncLocal.h"
+#include "clkSyncCoalesce.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Maximum number of retrievals in progress which can be joined
+ */
+//--------------------------------------------------------------------------------------------------
+#define COALESCE_MAX_FLIGHTS        8
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Retrieval in progress, released once by its leader and by each of its waiters
+ */
+//--------------------------------------------------------------------------------------------------
+struct clkSyncCoalesce_Flight
+{
+    pa_clkSync_Protocol_t protocol;         ///< Protocol run
+    char server[NI_MAXHOST + 1];            ///< Time server name or address
+    bool getsTime;                          ///< Whether the time retrieved is returned
+    bool setsClock;                         ///< Whether the system clock is set
+    uint32_t waiterCount;                   ///< Number of callers waiting for the result
+    le_result_t result;                     ///< Result of the retrieval once completed
+    le_clkSync_ClockTime_t time;            ///< Time retrieved once completed
+    le_sem_Ref_t doneSem;                   ///< Posted once for each waiter on completion
+};
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Pool of retrievals
+ */
+//--------------------------------------------------------------------------------------------------
+static le_mem_PoolRef_t FlightPool;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Retrievals in progress which can still be joined, NULL for free slots
+ */
+//--------------------------------------------------------------------------------------------------
+static clkSyncCoalesce_Flight_t* Flights[COALESCE_MAX_FLIGHTS];
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Mutex protecting the retrievals in progress
+ */
+//--------------------------------------------------------------------------------------------------
+static le_mutex_Ref_t FlightMutex;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Destructor of a retrieval, run once its leader and all its waiters released it
+ */
+//--------------------------------------------------------------------------------------------------
+static void DestructFlight
+(
+    void* objPtr                                ///< [IN] Retrieval
+)
+{
+    le_sem_Delete(((clkSyncCoalesce_Flight_t*)objPtr)->doneSem);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Initialize the coalescing of the time retrievals
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncCoalesce_Init
+(
+    void
+)
+{
+    FlightPool = le_mem_CreatePool("ClkSyncFlight", sizeof(clkSyncCoalesce_Flight_t));
+    le_mem_SetDestructor(FlightPool, DestructFlight);
+    FlightMutex = le_mutex_CreateNonRecursive("ClkSyncFlightMutex");
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Join the time retrieval in progress from the given server with the given protocol which serves
+ * what the caller needs, or start a new one if there is none. The caller leading a new retrieval
+ * runs it and gives its result with clkSyncCoalesce_Complete(); the others wait for it with
+ * clkSyncCoalesce_Wait().
+ *
+ * @return
+ *      The retrieval joined or started, NULL if the retrieval can't be shared and is to be run on
+ *      its own
+ */
+//--------------------------------------------------------------------------------------------------
+clkSyncCoalesce_Flight_t* clkSyncCoalesce_Join
+(
+    pa_clkSync_Protocol_t protocol,             ///< [IN]  Protocol
+    const char* serverStrPtr,                   ///< [IN]  Time server name or address
+    bool getsTime,                              ///< [IN]  Whether the time retrieved is needed
+    bool setsClock,                             ///< [IN]  Whether the system clock is to be set
+    bool* isLeaderPtr                           ///< [OUT] Whether the caller is to run it
+)
+{
+    clkSyncCoalesce_Flight_t* flightPtr;
+    int freeSlot = -1;
+    int i;
+
+    if (!serverStrPtr || (strlen(serverStrPtr) > NI_MAXHOST))
+    {
+        return NULL;
+    }
+
+    le_mutex_Lock(FlightMutex);
+    for (i = 0; i < COALESCE_MAX_FLIGHTS; i++)
+    {
+        flightPtr = Flights[i];
+        if (!flightPtr)
+        {
+            if (freeSlot < 0)
+            {
+                freeSlot = i;
+            }
+            continue;
+        }
+
+        if ((flightPtr->protocol == protocol) && (0 == strcmp(flightPtr->server, serverStrPtr)) &&
+            (flightPtr->getsTime || !getsTime) && (flightPtr->setsClock || !setsClock))
+        {
+            flightPtr->waiterCount++;
+            le_mem_AddRef(flightPtr);
+            le_mutex_Unlock(FlightMutex);
+            LE_DEBUG("Joining the retrieval from %s in progress", serverStrPtr);
+            *isLeaderPtr = false;
+            return flightPtr;
+        }
+    }
+
+    if (freeSlot < 0)
+    {
+        le_mutex_Unlock(FlightMutex);
+        return NULL;
+    }
+
+    flightPtr = le_mem_ForceAlloc(FlightPool);
+    memset(flightPtr, 0, sizeof(*flightPtr));
+    flightPtr->protocol = protocol;
+    le_utf8_Copy(flightPtr->server, serverStrPtr, sizeof(flightPtr->server), NULL);
+    flightPtr->getsTime = getsTime;
+    flightPtr->setsClock = setsClock;
+    flightPtr->doneSem = le_sem_Create("ClkSyncFlightDone", 0);
+    Flights[freeSlot] = flightPtr;
+    le_mutex_Unlock(FlightMutex);
+
+    *isLeaderPtr = true;
+    return flightPtr;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Give the result of a time retrieval to the callers waiting for it, and release it
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncCoalesce_Complete
+(
+    clkSyncCoalesce_Flight_t* flightPtr,        ///< [IN] Retrieval led by the caller
+    le_result_t result,                         ///< [IN] Result of the retrieval
+    const le_clkSync_ClockTime_t* timePtr       ///< [IN] Time retrieved
+)
+{
+    uint32_t i;
+
+    le_mutex_Lock(FlightMutex);
+    for (i = 0; i < COALESCE_MAX_FLIGHTS; i++)
+    {
+        if (Flights[i] == flightPtr)
+        {
+            Flights[i] = NULL;
+        }
+    }
+
+    // No caller joins anymore, so the waiters counted so far are all those to wake up
+    flightPtr->result = result;
+    flightPtr->time = *timePtr;
+    if (flightPtr->waiterCount > 0)
+    {
+        LE_DEBUG("Retrieval from %s shared with %" PRIu32 " callers", flightPtr->server,
+                 flightPtr->waiterCount);
+    }
+    for (i = 0; i < flightPtr->waiterCount; i++)
+    {
+        le_sem_Post(flightPtr->doneSem);
+    }
+    le_mutex_Unlock(FlightMutex);
+
+    le_mem_Release(flightPtr);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Wait for the result of a time retrieval led by another caller, and release it
+ *
+ * @return
+ *      Result of the retrieval
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncCoalesce_Wait
+(
+    clkSyncCoalesce_Flight_t* flightPtr,        ///< [IN]  Retrieval joined
+    le_clkSync_ClockTime_t* timePtr             ///< [OUT] Time retrieved
+)
+{
+    le_result_t result;
+
+    // The leader's retrieval is itself bounded by the query deadline
+    le_sem_Wait(flightPtr->doneSem);
+
+    le_mutex_Lock(FlightMutex);
+    result = flightPtr->result;
+    *timePtr = flightPtr->time;
+    le_mutex_Unlock(FlightMutex);
+
+    le_mem_Release(flightPtr);
+    return result;
+}
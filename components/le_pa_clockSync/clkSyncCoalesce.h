@@ -0,0 +1,85 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file clkSyncCoalesce.h
+ *
+ * Coalescing of the concurrent time retrievals from the same server of the Linux Clock Service
+ * Adapter
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef CLKSYNC_COALESCE_H_INCLUDE_GUARD
+#define CLKSYNC_COALESCE_H_INCLUDE_GUARD
+
+#include "legato.h"
+#include "pa_clkSync_linux.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Time retrieval in progress, shared by the caller running it and those waiting for its result
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct clkSyncCoalesce_Flight clkSyncCoalesce_Flight_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Initialize the coalescing of the time retrievals
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncCoalesce_Init
+(
+    void
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Join the time retrieval in progress from the given server with the given protocol which serves
+ * what the caller needs, or start a new one if there is none. The caller leading a new retrieval
+ * runs it and gives its result with clkSyncCoalesce_Complete(); the others wait for it with
+ * clkSyncCoalesce_Wait().
+ *
+ * @return
+ *      The retrieval joined or started, NULL if the retrieval can't be shared and is to be run on
+ *      its own
+ */
+//--------------------------------------------------------------------------------------------------
+clkSyncCoalesce_Flight_t* clkSyncCoalesce_Join
+(
+    pa_clkSync_Protocol_t protocol,             ///< [IN]  Protocol
+    const char* serverStrPtr,                   ///< [IN]  Time server name or address
+    bool getsTime,                              ///< [IN]  Whether the time retrieved is needed
+    bool setsClock,                             ///< [IN]  Whether the system clock is to be set
+    bool* isLeaderPtr                           ///< [OUT] Whether the caller is to run it
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Give the result of a time retrieval to the callers waiting for it, and release it
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncCoalesce_Complete
+(
+    clkSyncCoalesce_Flight_t* flightPtr,        ///< [IN] Retrieval led by the caller
+    le_result_t result,                         ///< [IN] Result of the retrieval
+    const le_clkSync_ClockTime_t* timePtr       ///< [IN] Time retrieved
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Wait for the result of a time retrieval led by another caller, and release it
+ *
+ * @return
+ *      Result of the retrieval
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncCoalesce_Wait
+(
+    clkSyncCoalesce_Flight_t* flightPtr,        ///< [IN]  Retrieval joined
+    le_clkSync_ClockTime_t* timePtr             ///< [OUT] Time retrieved
+);
+
+#endif // CLKSYNC_COALESCE_H_INCLUDE_GUARD
@@ -0,0 +1,835 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file clkSyncDns.c
+ *
+ * Time server name resolution of the Linux Clock Service Adapter. Results of getaddrinfo(),
+ * successful or not, are kept in a small cache so that the repeated syncs against the same few
+ * servers don't pay for a blocking DNS lookup every time.
+ *
+ * getaddrinfo() doesn't report the TTL of the records it resolves, so entries expire after a
+ * configurable lifetime instead. The cache is flushed when the data connection changes, since the
+ * name servers and the reachable addresses may change with it.
+ *
+ * getaddrinfo() can't be interrupted either, so a lookup bounded by a deadline is run in a thread
+ * of its own which the caller stops waiting for when the deadline expires. The abandoned lookup
+ * still stores its result into the cache when it eventually completes. The lookups started from
+ * an event loop are run in a thread the same way, their result being then given back to the
+ * event loop of the calling thread. A caller resolving a name already being looked up waits for
+ * that lookup rather than starting another, and at most DNS_MAX_LOOKUP_THREADS lookups run at
+ * once, so that a dead name server doesn't pile up a blocked thread per retry.
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "interfaces.h"
+#include <arpa/inet.h>
+#include <netdb.h>
+#include "clkSyncLocal.h"
+#include "clkSyncDns.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Maximum number of host names kept in the cache
+ */
+//--------------------------------------------------------------------------------------------------
+#define DNS_CACHE_MAX_ENTRIES       8
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Maximum length of a host name, including the terminating null character
+ */
+//--------------------------------------------------------------------------------------------------
+#define DNS_NAME_MAX_BYTES          (NI_MAXHOST + 1)
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Maximum number of lookup threads running at once, abandoned ones included
+ */
+//--------------------------------------------------------------------------------------------------
+#define DNS_MAX_LOOKUP_THREADS      4
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Cached resolution of a host name
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    char name[DNS_NAME_MAX_BYTES];      ///< Host name, which is also the key in the cache
+    le_result_t result;                 ///< Result of the resolution
+    clkSync_AddrList_t list;            ///< Resolved addresses when result is LE_OK
+    int64_t expiryNs;                   ///< CLOCK_MONOTONIC time at which the entry expires
+}
+DnsEntry_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Lookup of a host name run in a thread of its own, the result of which is given to all the
+ * callers waiting for it
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    char name[DNS_NAME_MAX_BYTES];        ///< Host name to resolve, which is also the key in the
+                                          ///< lookups in flight
+    uint32_t generation;                  ///< Generation of the cache the lookup was started in
+    le_dls_List_t waiters;                ///< Callers waiting for the result
+}
+DnsFlight_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Wait of a caller for the result of a lookup, shared by the lookup's thread and the caller
+ * waiting for it or getting its result from its event loop
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct clkSyncDns_Lookup
+{
+    le_result_t result;                   ///< Result of the resolution
+    clkSync_AddrList_t list;              ///< Resolved addresses when result is LE_OK
+    DnsFlight_t* flightPtr;               ///< Lookup waited for, NULL once the result is given
+                                          ///< or the caller gave up; protected by the mutex
+    le_dls_Link_t link;                   ///< Link in the callers waiting for the lookup
+    le_sem_Ref_t doneSem;                 ///< Posted by the thread once the lookup is done, NULL
+                                          ///< if the result is given to the caller's event loop
+    le_thread_Ref_t callerRef;            ///< Thread whose event loop gets the result
+    clkSyncDns_HandlerFunc_t handlerFunc; ///< Handler of the result, called from the event loop
+    void* contextPtr;                     ///< Context given to the handler
+    bool isCancelled;                     ///< Whether the caller gave up the lookup; only accessed
+                                          ///< from the caller's thread
+}
+DnsLookup_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Pool of cache entries
+ */
+//--------------------------------------------------------------------------------------------------
+static le_mem_PoolRef_t DnsEntryPool;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Pools of the lookups run in threads and of the callers waiting for them
+ */
+//--------------------------------------------------------------------------------------------------
+static le_mem_PoolRef_t DnsFlightPool;
+static le_mem_PoolRef_t DnsLookupPool;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Lookups in flight started in the present generation of the cache, keyed by host name, which
+ * new callers join
+ */
+//--------------------------------------------------------------------------------------------------
+static le_hashmap_Ref_t DnsFlights;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Number of lookup threads running, those of the previous generations included
+ */
+//--------------------------------------------------------------------------------------------------
+static unsigned int DnsThreadCount;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Cache of resolutions, keyed by host name
+ */
+//--------------------------------------------------------------------------------------------------
+static le_hashmap_Ref_t DnsCache;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Mutex protecting the cache and the lookups in flight
+ */
+//--------------------------------------------------------------------------------------------------
+static le_mutex_Ref_t DnsMutex;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Generation of the cache, incremented on each flush so that the lookups started before it don't
+ * store their then outdated results
+ */
+//--------------------------------------------------------------------------------------------------
+static uint32_t DnsGeneration;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Lifetimes of successful and failed resolutions
+ */
+//--------------------------------------------------------------------------------------------------
+static uint32_t DnsTtlSecs = CLKSYNC_DNS_DEFAULT_TTL_SECS;
+static uint32_t DnsNegativeTtlSecs = CLKSYNC_DNS_DEFAULT_NEGATIVE_TTL_SECS;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Append the address of a getaddrinfo() result to an address list
+ *
+ * @return
+ *      - true      the address was added
+ *      - false     the address is of an unsupported family
+ */
+//--------------------------------------------------------------------------------------------------
+static bool AppendAddress
+(
+    const struct addrinfo* infoPtr,     ///< [IN]    getaddrinfo() result
+    clkSync_AddrList_t* listPtr         ///< [INOUT] Address list
+)
+{
+    const void* addrPtr;
+
+    // The resolved address is the one passed on to the protocol engines, so it has to be
+    // extracted according to its family
+    if (AF_INET == infoPtr->ai_family)
+    {
+        addrPtr = &((struct sockaddr_in*)infoPtr->ai_addr)->sin_addr;
+    }
+    else if (AF_INET6 == infoPtr->ai_family)
+    {
+        addrPtr = &((struct sockaddr_in6*)infoPtr->ai_addr)->sin6_addr;
+    }
+    else
+    {
+        return false;
+    }
+
+    if (!inet_ntop(infoPtr->ai_family, addrPtr, listPtr->addrs[listPtr->count],
+                   LE_DCS_IPADDR_MAX_LEN))
+    {
+        return false;
+    }
+    listPtr->count++;
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Resolve the given host name into its IP addresses with getaddrinfo(). The addresses are kept in
+ * the preference order given by getaddrinfo(), but with the address families interleaved as
+ * recommended by RFC 8305 so that the attempts made on them don't all fail together on a network
+ * where one family is broken.
+ *
+ * @return
+ *      - LE_OK         name resolution into IP addr succeeded
+ *      - LE_FAULT      name resolution execution failed or unable to resolve into an IP addr
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ResolveIpAddresses
+(
+    const char* namePtr,                ///< [IN]  Host name to resolve
+    clkSync_AddrList_t* listPtr         ///< [OUT] Resolved addresses
+)
+{
+    int rc;
+    struct addrinfo *resultPtr, *nextPtr;
+    struct addrinfo hints = {0};
+    const struct addrinfo* v4Ptrs[CLKSYNC_MAX_ADDRS];
+    const struct addrinfo* v6Ptrs[CLKSYNC_MAX_ADDRS];
+    size_t v4Count = 0, v6Count = 0, i;
+    bool v6First;
+
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    rc = getaddrinfo(namePtr, NULL, &hints, &resultPtr);
+    if (rc)
+    {
+        LE_ERROR("getaddrinfo() failed to resolve host name %s with error %s", namePtr,
+                 gai_strerror(rc));
+        return LE_FAULT;
+    }
+
+    for (nextPtr = resultPtr; nextPtr != NULL; nextPtr = nextPtr->ai_next)
+    {
+        if ((AF_INET == nextPtr->ai_family) && (v4Count < CLKSYNC_MAX_ADDRS))
+        {
+            v4Ptrs[v4Count++] = nextPtr;
+        }
+        else if ((AF_INET6 == nextPtr->ai_family) && (v6Count < CLKSYNC_MAX_ADDRS))
+        {
+            v6Ptrs[v6Count++] = nextPtr;
+        }
+    }
+
+    // Take alternately from each family, starting with the family of the most preferred address
+    listPtr->count = 0;
+    v6First = (AF_INET6 == resultPtr->ai_family);
+    for (i = 0; (i < CLKSYNC_MAX_ADDRS) && (listPtr->count < CLKSYNC_MAX_ADDRS); i++)
+    {
+        const struct addrinfo* firstPtr = v6First ? ((i < v6Count) ? v6Ptrs[i] : NULL)
+                                                  : ((i < v4Count) ? v4Ptrs[i] : NULL);
+        const struct addrinfo* secondPtr = v6First ? ((i < v4Count) ? v4Ptrs[i] : NULL)
+                                                   : ((i < v6Count) ? v6Ptrs[i] : NULL);
+        if (firstPtr)
+        {
+            AppendAddress(firstPtr, listPtr);
+        }
+        if (secondPtr && (listPtr->count < CLKSYNC_MAX_ADDRS))
+        {
+            AppendAddress(secondPtr, listPtr);
+        }
+    }
+    freeaddrinfo(resultPtr);
+
+    if (0 == listPtr->count)
+    {
+        LE_ERROR("Name %s not resolved to any valid IP address", namePtr);
+        return LE_FAULT;
+    }
+
+    for (i = 0; i < listPtr->count; i++)
+    {
+        LE_DEBUG("Name %s resolved to IP address %s", namePtr, listPtr->addrs[i]);
+    }
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Find the cache entry expiring first, to be evicted when the cache is full
+ *
+ * @return
+ *      The entry expiring first, or NULL if the cache is empty
+ */
+//--------------------------------------------------------------------------------------------------
+static DnsEntry_t* FindOldestEntry
+(
+    void
+)
+{
+    DnsEntry_t* oldestPtr = NULL;
+    le_hashmap_It_Ref_t iter = le_hashmap_GetIterator(DnsCache);
+
+    while (LE_OK == le_hashmap_NextNode(iter))
+    {
+        DnsEntry_t* entryPtr = le_hashmap_GetValue(iter);
+        if (!oldestPtr || (entryPtr->expiryNs < oldestPtr->expiryNs))
+        {
+            oldestPtr = entryPtr;
+        }
+    }
+    return oldestPtr;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the valid cache entry of a host name, dropping it if expired
+ *
+ * @return
+ *      - true      the name was found in the cache, with the result and addresses returned
+ *      - false     no valid entry for the name
+ */
+//--------------------------------------------------------------------------------------------------
+static bool FindEntry
+(
+    const char* namePtr,                ///< [IN]  Host name to resolve
+    le_result_t* resultPtr,             ///< [OUT] Result of the cached resolution
+    clkSync_AddrList_t* listPtr         ///< [OUT] Resolved addresses
+)
+{
+    DnsEntry_t* entryPtr;
+
+    le_mutex_Lock(DnsMutex);
+    entryPtr = le_hashmap_Get(DnsCache, namePtr);
+    if (entryPtr)
+    {
+        if (clkSync_GetClockNs(CLOCK_MONOTONIC) < entryPtr->expiryNs)
+        {
+            *resultPtr = entryPtr->result;
+            *listPtr = entryPtr->list;
+            le_mutex_Unlock(DnsMutex);
+            LE_DEBUG("Name %s found in cache with result %s", namePtr,
+                     LE_RESULT_TXT(*resultPtr));
+            return true;
+        }
+
+        le_hashmap_Remove(DnsCache, entryPtr->name);
+        le_mem_Release(entryPtr);
+    }
+    le_mutex_Unlock(DnsMutex);
+    return false;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Store a resolution result into the cache, replacing any previous entry for the same name
+ */
+//--------------------------------------------------------------------------------------------------
+static void StoreEntry
+(
+    const char* namePtr,                        ///< [IN] Host name resolved
+    le_result_t result,                         ///< [IN] Result of the resolution
+    const clkSync_AddrList_t* listPtr           ///< [IN] Resolved addresses
+)
+{
+    uint32_t ttlSecs = (LE_OK == result) ? DnsTtlSecs : DnsNegativeTtlSecs;
+    DnsEntry_t* entryPtr;
+
+    if ((0 == ttlSecs) || (strlen(namePtr) >= DNS_NAME_MAX_BYTES))
+    {
+        return;
+    }
+
+    entryPtr = le_hashmap_Get(DnsCache, namePtr);
+    if (!entryPtr)
+    {
+        if (le_hashmap_Size(DnsCache) >= DNS_CACHE_MAX_ENTRIES)
+        {
+            DnsEntry_t* oldestPtr = FindOldestEntry();
+            le_hashmap_Remove(DnsCache, oldestPtr->name);
+            le_mem_Release(oldestPtr);
+        }
+
+        entryPtr = le_mem_ForceAlloc(DnsEntryPool);
+        le_utf8_Copy(entryPtr->name, namePtr, sizeof(entryPtr->name), NULL);
+        le_hashmap_Put(DnsCache, entryPtr->name, entryPtr);
+    }
+
+    entryPtr->result = result;
+    entryPtr->list = *listPtr;
+    entryPtr->expiryNs = clkSync_GetClockNs(CLOCK_MONOTONIC) + (int64_t)ttlSecs * CLKSYNC_NS_PER_SEC;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Destructor of a caller's wait, run once both the lookup's thread and the caller released it
+ */
+//--------------------------------------------------------------------------------------------------
+static void DestructLookup
+(
+    void* objPtr                                ///< [IN] Lookup
+)
+{
+    DnsLookup_t* lookupPtr = objPtr;
+
+    if (lookupPtr->doneSem)
+    {
+        le_sem_Delete(lookupPtr->doneSem);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Give the result of a lookup to its handler, from the event loop of the thread which started it,
+ * unless the lookup was cancelled in the meantime
+ */
+//--------------------------------------------------------------------------------------------------
+static void DeliverLookup
+(
+    void* param1Ptr,                            ///< [IN] Lookup
+    void* param2Ptr                             ///< [IN] Unused
+)
+{
+    DnsLookup_t* lookupPtr = param1Ptr;
+
+    // The caller's reference is given up with the result, the handler ending the lookup
+    if (!lookupPtr->isCancelled)
+    {
+        lookupPtr->isCancelled = true;
+        le_mem_Release(lookupPtr);
+        lookupPtr->handlerFunc(lookupPtr->result, &lookupPtr->list, lookupPtr->contextPtr);
+    }
+
+    // Reference of the thread, handed over with the result
+    le_mem_Release(lookupPtr);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Main function of a lookup's thread, which gives the result to all the callers still waiting
+ *
+ * @return
+ *      NULL
+ */
+//--------------------------------------------------------------------------------------------------
+static void* LookupThread
+(
+    void* contextPtr                            ///< [IN] Lookup
+)
+{
+    DnsFlight_t* flightPtr = contextPtr;
+    clkSync_AddrList_t list = {0};
+    le_dls_Link_t* linkPtr;
+    le_result_t result;
+
+    result = ResolveIpAddresses(flightPtr->name, &list);
+
+    le_mutex_Lock(DnsMutex);
+    if (flightPtr->generation == DnsGeneration)
+    {
+        StoreEntry(flightPtr->name, result, &list);
+    }
+    if (le_hashmap_Get(DnsFlights, flightPtr->name) == flightPtr)
+    {
+        le_hashmap_Remove(DnsFlights, flightPtr->name);
+    }
+    DnsThreadCount--;
+
+    // The reference of the thread on each wait is handed over with the result
+    while (NULL != (linkPtr = le_dls_Pop(&flightPtr->waiters)))
+    {
+        DnsLookup_t* lookupPtr = CONTAINER_OF(linkPtr, DnsLookup_t, link);
+
+        lookupPtr->result = result;
+        lookupPtr->list = list;
+        lookupPtr->flightPtr = NULL;
+        if (!lookupPtr->doneSem)
+        {
+            le_event_QueueFunctionToThread(lookupPtr->callerRef, DeliverLookup, lookupPtr, NULL);
+        }
+        else
+        {
+            le_sem_Post(lookupPtr->doneSem);
+            le_mem_Release(lookupPtr);
+        }
+    }
+    le_mutex_Unlock(DnsMutex);
+
+    le_mem_Release(flightPtr);
+    return NULL;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Wait for the result of a lookup of the given host name: join the lookup in flight for it if
+ * any, or start one in a thread of its own. The wait has one reference for each of the lookup's
+ * thread and the caller, whichever is done last freeing it.
+ *
+ * @return
+ *      - LE_OK             Lookup started or joined
+ *      - LE_UNAVAILABLE    DNS_MAX_LOOKUP_THREADS lookups already running
+ *      - LE_FAULT          Name too long
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t StartLookup
+(
+    const char* namePtr,                        ///< [IN]  Host name to resolve
+    le_sem_Ref_t doneSem,                       ///< [IN]  Semaphore posted once the lookup is
+                                                ///<       done, NULL to give the result to the
+                                                ///<       handler from the caller's event loop
+    clkSyncDns_HandlerFunc_t handlerFunc,       ///< [IN]  Handler of the result, may be NULL
+    void* contextPtr,                           ///< [IN]  Context given to the handler
+    DnsLookup_t** lookupPtrPtr                  ///< [OUT] Wait for the lookup
+)
+{
+    DnsFlight_t* flightPtr;
+    DnsLookup_t* lookupPtr;
+    bool isNew = false;
+
+    if (strlen(namePtr) >= DNS_NAME_MAX_BYTES)
+    {
+        LE_ERROR("Name %s too long", namePtr);
+        return LE_FAULT;
+    }
+
+    le_mutex_Lock(DnsMutex);
+    flightPtr = le_hashmap_Get(DnsFlights, namePtr);
+    if (flightPtr)
+    {
+        LE_DEBUG("Name %s already being looked up", namePtr);
+    }
+    else
+    {
+        if (DnsThreadCount >= DNS_MAX_LOOKUP_THREADS)
+        {
+            le_mutex_Unlock(DnsMutex);
+            LE_WARN("Name %s not looked up, %u lookups already running", namePtr,
+                    DNS_MAX_LOOKUP_THREADS);
+            return LE_UNAVAILABLE;
+        }
+
+        flightPtr = le_mem_ForceAlloc(DnsFlightPool);
+        memset(flightPtr, 0, sizeof(*flightPtr));
+        le_utf8_Copy(flightPtr->name, namePtr, sizeof(flightPtr->name), NULL);
+        flightPtr->generation = DnsGeneration;
+        flightPtr->waiters = LE_DLS_LIST_INIT;
+        le_hashmap_Put(DnsFlights, flightPtr->name, flightPtr);
+        DnsThreadCount++;
+        isNew = true;
+    }
+
+    lookupPtr = le_mem_ForceAlloc(DnsLookupPool);
+    memset(lookupPtr, 0, sizeof(*lookupPtr));
+    lookupPtr->flightPtr = flightPtr;
+    lookupPtr->link = LE_DLS_LINK_INIT;
+    lookupPtr->doneSem = doneSem;
+    lookupPtr->callerRef = le_thread_GetCurrent();
+    lookupPtr->handlerFunc = handlerFunc;
+    lookupPtr->contextPtr = contextPtr;
+    le_mem_AddRef(lookupPtr);
+    le_dls_Queue(&flightPtr->waiters, &lookupPtr->link);
+    le_mutex_Unlock(DnsMutex);
+
+    if (isNew)
+    {
+        le_thread_Start(le_thread_Create("ClkSyncDns", LookupThread, flightPtr));
+    }
+    *lookupPtrPtr = lookupPtr;
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Stop waiting for a lookup still in flight, dropping its thread's reference on the wait; the
+ * lookup itself runs on for the cache and the other callers
+ */
+//--------------------------------------------------------------------------------------------------
+static void LeaveLookup
+(
+    DnsLookup_t* lookupPtr                      ///< [IN] Wait for the lookup
+)
+{
+    le_mutex_Lock(DnsMutex);
+    if (lookupPtr->flightPtr)
+    {
+        le_dls_Remove(&lookupPtr->flightPtr->waiters, &lookupPtr->link);
+        lookupPtr->flightPtr = NULL;
+        le_mem_Release(lookupPtr);
+    }
+    le_mutex_Unlock(DnsMutex);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Resolve a host name in a thread of its own, waiting for it until the deadline at most
+ *
+ * @return
+ *      - LE_OK             name resolution into IP addr succeeded
+ *      - LE_FAULT          name resolution execution failed or unable to resolve into an IP addr
+ *      - LE_TIMEOUT        name resolution not completed before the deadline
+ *      - LE_UNAVAILABLE    too many lookups already running
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ResolveInThread
+(
+    const char* namePtr,                        ///< [IN]  Host name to resolve
+    int64_t deadlineNs,                         ///< [IN]  CLOCK_MONOTONIC time to give up at
+    clkSync_AddrList_t* listPtr                 ///< [OUT] Resolved addresses
+)
+{
+    le_sem_Ref_t doneSem = le_sem_Create("ClkSyncDnsDone", 0);
+    DnsLookup_t* lookupPtr;
+    int64_t waitNs;
+    le_clk_Time_t timeout;
+    le_result_t result;
+
+    result = StartLookup(namePtr, doneSem, NULL, NULL, &lookupPtr);
+    if (LE_OK != result)
+    {
+        le_sem_Delete(doneSem);
+        return result;
+    }
+
+    waitNs = deadlineNs - clkSync_GetClockNs(CLOCK_MONOTONIC);
+    if (waitNs < 0)
+    {
+        waitNs = 0;
+    }
+    timeout.sec = (time_t)(waitNs / CLKSYNC_NS_PER_SEC);
+    timeout.usec = (long)((waitNs % CLKSYNC_NS_PER_SEC) / CLKSYNC_NS_PER_USEC);
+
+    if (LE_OK == le_sem_WaitWithTimeOut(lookupPtr->doneSem, timeout))
+    {
+        le_mutex_Lock(DnsMutex);
+        result = lookupPtr->result;
+        *listPtr = lookupPtr->list;
+        le_mutex_Unlock(DnsMutex);
+    }
+    else
+    {
+        LE_WARN("Name %s not resolved before the deadline", namePtr);
+        LeaveLookup(lookupPtr);
+        result = LE_TIMEOUT;
+    }
+
+    le_mem_Release(lookupPtr);
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Initialize the name resolution cache
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncDns_Init
+(
+    void
+)
+{
+    DnsEntryPool = le_mem_CreatePool("ClkSyncDnsEntry", sizeof(DnsEntry_t));
+    le_mem_ExpandPool(DnsEntryPool, DNS_CACHE_MAX_ENTRIES);
+    DnsCache = le_hashmap_Create("ClkSyncDnsCache", DNS_CACHE_MAX_ENTRIES,
+                                 le_hashmap_HashString, le_hashmap_EqualsString);
+    DnsMutex = le_mutex_CreateNonRecursive("ClkSyncDnsMutex");
+
+    DnsFlightPool = le_mem_CreatePool("ClkSyncDnsFlight", sizeof(DnsFlight_t));
+    DnsFlights = le_hashmap_Create("ClkSyncDnsFlights", DNS_MAX_LOOKUP_THREADS,
+                                   le_hashmap_HashString, le_hashmap_EqualsString);
+    DnsLookupPool = le_mem_CreatePool("ClkSyncDnsLookup", sizeof(DnsLookup_t));
+    le_mem_SetDestructor(DnsLookupPool, DestructLookup);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Resolve the given host name into its IP addresses, from the cache when still valid
+ *
+ * @return
+ *      - LE_OK             name resolution into IP addr succeeded
+ *      - LE_FAULT          name resolution execution failed or unable to resolve into an IP addr,
+ *                          now or within the negative caching lifetime
+ *      - LE_TIMEOUT        name resolution not completed before the deadline
+ *      - LE_UNAVAILABLE    too many lookups already running, with a deadline
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncDns_Resolve
+(
+    const char* namePtr,                ///< [IN]  Host name to resolve
+    int64_t deadlineNs,                 ///< [IN]  CLOCK_MONOTONIC time to give up at, INT64_MAX
+                                        ///<       to wait for the lookup to complete
+    clkSync_AddrList_t* listPtr         ///< [OUT] Resolved addresses
+)
+{
+    le_result_t result;
+
+    if (FindEntry(namePtr, &result, listPtr))
+    {
+        return result;
+    }
+
+    memset(listPtr, 0, sizeof(*listPtr));
+    if (INT64_MAX != deadlineNs)
+    {
+        return ResolveInThread(namePtr, deadlineNs, listPtr);
+    }
+
+    // The lookup itself is done without holding the mutex since it may block for seconds
+    result = ResolveIpAddresses(namePtr, listPtr);
+
+    le_mutex_Lock(DnsMutex);
+    StoreEntry(namePtr, result, listPtr);
+    le_mutex_Unlock(DnsMutex);
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start resolving the given host name into its IP addresses without blocking the calling thread.
+ * A name still valid in the cache is resolved right away, otherwise the lookup is run in a thread
+ * of its own, or the one in flight for the name joined, and its result given to the handler from
+ * the event loop of the calling thread.
+ *
+ * @return
+ *      - LE_OK             name found in the cache and resolved into IP addr, the handler isn't
+ *                          called
+ *      - LE_FAULT          name too long or found in the cache as not resolvable, the handler
+ *                          isn't called
+ *      - LE_UNAVAILABLE    too many lookups already running, the handler isn't called
+ *      - LE_IN_PROGRESS    lookup started, its result is given to the handler unless cancelled
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncDns_StartResolve
+(
+    const char* namePtr,                    ///< [IN]  Host name to resolve
+    clkSyncDns_HandlerFunc_t handlerFunc,   ///< [IN]  Handler of the lookup's result
+    void* contextPtr,                       ///< [IN]  Context given to the handler
+    clkSync_AddrList_t* listPtr,            ///< [OUT] Addresses resolved from the cache
+    clkSyncDns_LookupRef_t* lookupRefPtr    ///< [OUT] Lookup started, valid until its handler
+                                            ///<       is called or it is cancelled
+)
+{
+    le_result_t result;
+
+    if (FindEntry(namePtr, &result, listPtr))
+    {
+        return result;
+    }
+
+    memset(listPtr, 0, sizeof(*listPtr));
+    result = StartLookup(namePtr, NULL, handlerFunc, contextPtr, lookupRefPtr);
+    return (LE_OK == result) ? LE_IN_PROGRESS : result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Cancel a lookup started by clkSyncDns_StartResolve(), from the thread which started it. Its
+ * handler isn't called anymore, while the lookup still stores its result into the cache when it
+ * eventually completes.
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncDns_CancelResolve
+(
+    clkSyncDns_LookupRef_t lookupRef        ///< [IN] Lookup to cancel
+)
+{
+    lookupRef->isCancelled = true;
+    LeaveLookup(lookupRef);
+    le_mem_Release(lookupRef);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Drop all the cached resolutions, e.g. when the data connection changes
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncDns_Flush
+(
+    void
+)
+{
+    le_hashmap_It_Ref_t iter;
+
+    le_mutex_Lock(DnsMutex);
+    iter = le_hashmap_GetIterator(DnsCache);
+    while (LE_OK == le_hashmap_NextNode(iter))
+    {
+        le_mem_Release(le_hashmap_GetValue(iter));
+    }
+    le_hashmap_RemoveAll(DnsCache);
+
+    // The lookups in flight run on with the former name servers, but aren't joined anymore
+    le_hashmap_RemoveAll(DnsFlights);
+    DnsGeneration++;
+    le_mutex_Unlock(DnsMutex);
+    LE_DEBUG("Name resolution cache flushed");
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the lifetimes of resolutions in the cache; a lifetime of 0 disables the caching of the
+ * corresponding results
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncDns_SetTtl
+(
+    uint32_t ttlSecs,                   ///< [IN] Lifetime of successful resolutions
+    uint32_t negativeTtlSecs            ///< [IN] Lifetime of failed resolutions
+)
+{
+    le_mutex_Lock(DnsMutex);
+    DnsTtlSecs = ttlSecs;
+    DnsNegativeTtlSecs = negativeTtlSecs;
+    le_mutex_Unlock(DnsMutex);
+
+    // Entries stored with the previous lifetimes are dropped
+    clkSyncDns_Flush();
+}
@@ -0,0 +1,141 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file clkSyncDns.h
+ *
+ * Time server name resolution with caching, for the Linux Clock Service Adapter
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef CLKSYNC_DNS_H_INCLUDE_GUARD
+#define CLKSYNC_DNS_H_INCLUDE_GUARD
+
+#include "legato.h"
+#include "interfaces.h"
+#include "clkSyncLocal.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Default lifetimes of successful and failed resolutions in the cache
+ */
+//--------------------------------------------------------------------------------------------------
+#define CLKSYNC_DNS_DEFAULT_TTL_SECS            300
+#define CLKSYNC_DNS_DEFAULT_NEGATIVE_TTL_SECS   30
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Reference of a lookup started by clkSyncDns_StartResolve()
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct clkSyncDns_Lookup* clkSyncDns_LookupRef_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handler of the result of a lookup started by clkSyncDns_StartResolve()
+ */
+//--------------------------------------------------------------------------------------------------
+typedef void (*clkSyncDns_HandlerFunc_t)
+(
+    le_result_t result,                 ///< [IN] LE_OK if the name was resolved into IP addr,
+                                        ///<      LE_FAULT otherwise
+    const clkSync_AddrList_t* listPtr,  ///< [IN] Resolved addresses
+    void* contextPtr                    ///< [IN] Context given when the lookup was started
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Initialize the name resolution cache
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncDns_Init
+(
+    void
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Resolve the given host name into its IP addresses, from the cache when still valid
+ *
+ * @return
+ *      - LE_OK             name resolution into IP addr succeeded
+ *      - LE_FAULT          name resolution execution failed or unable to resolve into an IP addr,
+ *                          now or within the negative caching lifetime
+ *      - LE_TIMEOUT        name resolution not completed before the deadline
+ *      - LE_UNAVAILABLE    too many lookups already running, with a deadline
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncDns_Resolve
+(
+    const char* namePtr,                ///< [IN]  Host name to resolve
+    int64_t deadlineNs,                 ///< [IN]  CLOCK_MONOTONIC time to give up at, INT64_MAX
+                                        ///<       to wait for the lookup to complete
+    clkSync_AddrList_t* listPtr         ///< [OUT] Resolved addresses
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start resolving the given host name into its IP addresses without blocking the calling thread.
+ * A name still valid in the cache is resolved right away, otherwise the lookup is run in a thread
+ * of its own, or the one in flight for the name joined, and its result given to the handler from
+ * the event loop of the calling thread.
+ *
+ * @return
+ *      - LE_OK             name found in the cache and resolved into IP addr, the handler isn't
+ *                          called
+ *      - LE_FAULT          name too long or found in the cache as not resolvable, the handler
+ *                          isn't called
+ *      - LE_UNAVAILABLE    too many lookups already running, the handler isn't called
+ *      - LE_IN_PROGRESS    lookup started, its result is given to the handler unless cancelled
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncDns_StartResolve
+(
+    const char* namePtr,                    ///< [IN]  Host name to resolve
+    clkSyncDns_HandlerFunc_t handlerFunc,   ///< [IN]  Handler of the lookup's result
+    void* contextPtr,                       ///< [IN]  Context given to the handler
+    clkSync_AddrList_t* listPtr,            ///< [OUT] Addresses resolved from the cache
+    clkSyncDns_LookupRef_t* lookupRefPtr    ///< [OUT] Lookup started, valid until its handler
+                                            ///<       is called or it is cancelled
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Cancel a lookup started by clkSyncDns_StartResolve(), from the thread which started it. Its
+ * handler isn't called anymore, while the lookup still stores its result into the cache when it
+ * eventually completes.
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncDns_CancelResolve
+(
+    clkSyncDns_LookupRef_t lookupRef        ///< [IN] Lookup to cancel
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Drop all the cached resolutions, e.g. when the data connection changes
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncDns_Flush
+(
+    void
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the lifetimes of resolutions in the cache; a lifetime of 0 disables the caching of the
+ * corresponding results
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncDns_SetTtl
+(
+    uint32_t ttlSecs,                   ///< [IN] Lifetime of successful resolutions
+    uint32_t negativeTtlSecs            ///< [IN] Lifetime of failed resolutions
+);
+
+#endif // CLKSYNC_DNS_H_INCLUDE_GUARD
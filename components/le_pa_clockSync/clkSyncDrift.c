@@ -0,0 +1,392 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file clkSyncDrift.c
+ *
+ * Discipline of the system clock frequency by the Linux Clock Service Adapter. The offsets
+ * corrected by the successive synchronizations, less what the kernel was still to slew of each when
+ * the next one replaced it, are accumulated into the phase the clock lost or gained since the
+ * history started; the slope of a least squares line fitted on it is the
+ * frequency error of the local oscillator. It is corrected with adjtimex(ADJ_FREQUENCY), so that
+ * the clock then drifts far less between synchronizations, and saved into a drift file in the
+ * format of ntp.drift to be restored on the next start.
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include <limits.h>
+#include <sys/timex.h>
+#include "pa_clkSync_linux.h"
+#include "clkSyncLocal.h"
+#include "clkSyncDrift.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Number of samples kept in the history
+ */
+//--------------------------------------------------------------------------------------------------
+#define DRIFT_HISTORY_SIZE          8
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Number of samples and time span of the history needed to fit the frequency error
+ */
+//--------------------------------------------------------------------------------------------------
+#define DRIFT_MIN_SAMPLES           3
+#define DRIFT_MIN_SPAN_NS           (900 * CLKSYNC_NS_PER_SEC)
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Largest frequency correction of the kernel, in parts per billion; a larger error means the
+ * clock was changed by someone else, and the history is discarded
+ */
+//--------------------------------------------------------------------------------------------------
+#define DRIFT_MAX_PPB               500000
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Scale of the timex frequency: parts per million with a 16-bit fractional part
+ */
+//--------------------------------------------------------------------------------------------------
+#define DRIFT_PPB_TO_FREQ(ppb)      ((long)(((int64_t)(ppb) * 65536) / 1000))
+#define DRIFT_FREQ_TO_PPB(freq)     ((int32_t)(((int64_t)(freq) * 1000) / 65536))
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Sample of the history: phase accumulated at a given local time
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    int64_t timeNs;                 ///< CLOCK_MONOTONIC time of the correction
+    int64_t phaseNs;                ///< Sum of the offsets corrected since the history started
+}
+DriftSample_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * History of the corrections since the frequency was last updated, oldest first
+ */
+//--------------------------------------------------------------------------------------------------
+static DriftSample_t History[DRIFT_HISTORY_SIZE];
+static size_t HistoryCount;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Drift file
+ */
+//--------------------------------------------------------------------------------------------------
+static char DriftFile[PATH_MAX] = PA_CLKSYNC_DRIFT_FILE_DEFAULT;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the frequency correction of the system clock
+ *
+ * @return
+ *      - LE_OK             Frequency set
+ *      - LE_FAULT          Failed to set the frequency
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t SetFrequency
+(
+    int32_t ppb                     ///< [IN] Frequency correction in parts per billion
+)
+{
+    struct timex tx = {0};
+
+    tx.modes = ADJ_FREQUENCY;
+    tx.freq = DRIFT_PPB_TO_FREQ(ppb);
+    if (adjtimex(&tx) < 0)
+    {
+        LE_ERROR("Failed to set clock frequency (%m)");
+        return LE_FAULT;
+    }
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Save the frequency correction into the drift file, replacing it atomically
+ */
+//--------------------------------------------------------------------------------------------------
+static void SaveFrequency
+(
+    int32_t ppb                     ///< [IN] Frequency correction in parts per billion
+)
+{
+    char tmpPath[PATH_MAX + 4];
+    FILE* fp;
+
+    if ('\0' == DriftFile[0])
+    {
+        return;
+    }
+
+    snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", DriftFile);
+    fp = fopen(tmpPath, "w");
+    if (!fp)
+    {
+        LE_WARN("Failed to open drift file %s (%m)", tmpPath);
+        return;
+    }
+
+    // ntp.drift holds the frequency in parts per million
+    fprintf(fp, "%.3f\n", ppb / 1000.0);
+    if (fclose(fp) || rename(tmpPath, DriftFile))
+    {
+        LE_WARN("Failed to write drift file %s (%m)", DriftFile);
+        unlink(tmpPath);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Restore the frequency correction saved in the drift file, if any
+ */
+//--------------------------------------------------------------------------------------------------
+static void RestoreFrequency
+(
+    void
+)
+{
+    double ppm;
+    FILE* fp;
+    int rc;
+
+    if ('\0' == DriftFile[0])
+    {
+        return;
+    }
+
+    fp = fopen(DriftFile, "r");
+    if (!fp)
+    {
+        LE_DEBUG("No drift file %s (%m)", DriftFile);
+        return;
+    }
+    rc = fscanf(fp, "%lf", &ppm);
+    fclose(fp);
+
+    if ((1 != rc) || (ppm * 1000 > DRIFT_MAX_PPB) || (ppm * 1000 < -DRIFT_MAX_PPB))
+    {
+        LE_WARN("Invalid drift file %s", DriftFile);
+        return;
+    }
+
+    if (LE_OK == SetFrequency((int32_t)(ppm * 1000)))
+    {
+        LE_INFO("Clock frequency restored to %.3f ppm", ppm);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Fit the frequency error on the history, as the slope of the least squares line of the phase
+ * against the local time
+ *
+ * @return
+ *      Frequency error in parts per billion, positive when the local clock is slow
+ */
+//--------------------------------------------------------------------------------------------------
+static double FitFrequencyError
+(
+    void
+)
+{
+    double sumX = 0, sumY = 0, sumXX = 0, sumXY = 0, n = HistoryCount;
+    size_t i;
+
+    // Times in seconds from the first sample, phases in nanoseconds: the slope is in ns/s, i.e.
+    // parts per billion
+    for (i = 0; i < HistoryCount; i++)
+    {
+        double x = (double)(History[i].timeNs - History[0].timeNs) / CLKSYNC_NS_PER_SEC;
+        double y = (double)History[i].phaseNs;
+
+        sumX += x;
+        sumY += y;
+        sumXX += x * x;
+        sumXY += x * y;
+    }
+
+    return ((n * sumXY) - (sumX * sumY)) / ((n * sumXX) - (sumX * sumX));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Restart the history from the given local time
+ */
+//--------------------------------------------------------------------------------------------------
+static void RestartHistory
+(
+    int64_t timeNs                  ///< [IN] CLOCK_MONOTONIC time of the first sample
+)
+{
+    History[0].timeNs = timeNs;
+    History[0].phaseNs = 0;
+    HistoryCount = 1;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Initialize the drift estimation, restoring the frequency saved in the drift file if any
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncDrift_Init
+(
+    void
+)
+{
+    HistoryCount = 0;
+    RestoreFrequency();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Record the offset just corrected on the system clock. The part of the previous correction the
+ * kernel hadn't slewed yet when this one replaced it is measured again in this offset, and is
+ * taken out of the phase. Once the history spans long enough, the frequency error fitted on it is
+ * corrected and saved into the drift file.
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncDrift_AddSample
+(
+    int64_t offsetNs,               ///< [IN] Offset added to the system clock
+    int64_t unappliedNs             ///< [IN] Part of the previous correction left unapplied
+)
+{
+    int64_t nowNs = clkSync_GetClockNs(CLOCK_MONOTONIC);
+    int32_t freqPpb, newPpb;
+    double errorPpb;
+
+    // The first correction only sets the clock right: the drift is measured from there
+    if (0 == HistoryCount)
+    {
+        RestartHistory(nowNs);
+        return;
+    }
+
+    if (DRIFT_HISTORY_SIZE == HistoryCount)
+    {
+        memmove(&History[0], &History[1], sizeof(History[0]) * (DRIFT_HISTORY_SIZE - 1));
+        HistoryCount--;
+    }
+    History[HistoryCount].timeNs = nowNs;
+    History[HistoryCount].phaseNs = History[HistoryCount - 1].phaseNs - unappliedNs + offsetNs;
+    HistoryCount++;
+
+    if ((HistoryCount < DRIFT_MIN_SAMPLES) ||
+        ((nowNs - History[0].timeNs) < DRIFT_MIN_SPAN_NS))
+    {
+        return;
+    }
+
+    errorPpb = FitFrequencyError();
+    if ((errorPpb > DRIFT_MAX_PPB) || (errorPpb < -DRIFT_MAX_PPB))
+    {
+        LE_WARN("Frequency error %.0f ppb out of range, drift history discarded", errorPpb);
+        RestartHistory(nowNs);
+        return;
+    }
+    if (LE_OK != clkSyncDrift_GetFrequency(&freqPpb))
+    {
+        LE_WARN("Frequency error %.0f ppb not corrected, the clock frequency being unknown",
+                errorPpb);
+        RestartHistory(nowNs);
+        return;
+    }
+
+    newPpb = freqPpb + (int32_t)errorPpb;
+    if (newPpb > DRIFT_MAX_PPB)
+    {
+        newPpb = DRIFT_MAX_PPB;
+    }
+    else if (newPpb < -DRIFT_MAX_PPB)
+    {
+        newPpb = -DRIFT_MAX_PPB;
+    }
+
+    if (LE_OK == SetFrequency(newPpb))
+    {
+        LE_INFO("Clock frequency corrected by %.0f ppb to %.3f ppm", errorPpb, newPpb / 1000.0);
+        SaveFrequency(newPpb);
+    }
+
+    // The history was measured at the former frequency
+    RestartHistory(nowNs);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Discard the history, after the system clock was updated by an unknown offset
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncDrift_Reset
+(
+    void
+)
+{
+    HistoryCount = 0;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the file the frequency is saved into, and restore the frequency saved in it if any; an
+ * empty path disables the saving
+ *
+ * @return
+ *      - LE_OK             File set
+ *      - LE_BAD_PARAMETER  Incorrect parameter
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncDrift_SetFile
+(
+    const char* pathPtr             ///< [IN] Drift file
+)
+{
+    if ((!pathPtr) || (strlen(pathPtr) >= sizeof(DriftFile)))
+    {
+        LE_ERROR("Incorrect parameter");
+        return LE_BAD_PARAMETER;
+    }
+
+    le_utf8_Copy(DriftFile, pathPtr, sizeof(DriftFile), NULL);
+    RestoreFrequency();
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the frequency correction of the system clock
+ *
+ * @return
+ *      - LE_OK             Frequency returned
+ *      - LE_FAULT          Failed to read the frequency
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncDrift_GetFrequency
+(
+    int32_t* ppbPtr                 ///< [OUT] Frequency correction in parts per billion
+)
+{
+    struct timex tx = {0};
+
+    if (adjtimex(&tx) < 0)
+    {
+        LE_ERROR("Failed to read clock frequency (%m)");
+        return LE_FAULT;
+    }
+
+    *ppbPtr = DRIFT_FREQ_TO_PPB(tx.freq);
+    return LE_OK;
+}
@@ -0,0 +1,83 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file clkSyncDrift.h
+ *
+ * Estimation of the local clock drift and discipline of its frequency, for the Linux Clock Service
+ * Adapter
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef CLKSYNC_DRIFT_H_INCLUDE_GUARD
+#define CLKSYNC_DRIFT_H_INCLUDE_GUARD
+
+#include "legato.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Initialize the drift estimation, restoring the frequency saved in the drift file if any
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncDrift_Init
+(
+    void
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Record the offset just corrected on the system clock. The part of the previous correction the
+ * kernel hadn't slewed yet when this one replaced it is measured again in this offset, and is
+ * taken out of the phase. Once the history spans long enough, the frequency error fitted on it is
+ * corrected and saved into the drift file.
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncDrift_AddSample
+(
+    int64_t offsetNs,               ///< [IN] Offset added to the system clock
+    int64_t unappliedNs             ///< [IN] Part of the previous correction left unapplied
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Discard the history, after the system clock was updated by an unknown offset
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncDrift_Reset
+(
+    void
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the file the frequency is saved into, and restore the frequency saved in it if any; an
+ * empty path disables the saving
+ *
+ * @return
+ *      - LE_OK             File set
+ *      - LE_BAD_PARAMETER  Incorrect parameter
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncDrift_SetFile
+(
+    const char* pathPtr             ///< [IN] Drift file
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the frequency correction of the system clock
+ *
+ * @return
+ *      - LE_OK             Frequency returned
+ *      - LE_FAULT          Failed to read the frequency
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncDrift_GetFrequency
+(
+    int32_t* ppbPtr                 ///< [OUT] Frequency correction in parts per billion
+);
+
+#endif // CLKSYNC_DRIFT_H_INCLUDE_GUARD
@@ -0,0 +1,160 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file clkSyncLocal.h
+ *
+ * Definitions shared between the modules of the Linux Clock Service Adapter
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef CLKSYNC_LOCAL_H_INCLUDE_GUARD
+#define CLKSYNC_LOCAL_H_INCLUDE_GUARD
+
+#include "legato.h"
+#include "interfaces.h"
+#include <inttypes.h>
+#include <time.h>
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Number of nanoseconds in a second, millisecond and microsecond
+ */
+//--------------------------------------------------------------------------------------------------
+#define CLKSYNC_NS_PER_SEC      INT64_C(1000000000)
+#define CLKSYNC_NS_PER_MSEC     INT64_C(1000000)
+#define CLKSYNC_NS_PER_USEC     INT64_C(1000)
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Maximum number of addresses tried for a time server
+ */
+//--------------------------------------------------------------------------------------------------
+#define CLKSYNC_MAX_ADDRS       4
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Delay between the attempts on successive addresses of a time server, as recommended by
+ * RFC 8305 for connection attempts
+ */
+//--------------------------------------------------------------------------------------------------
+#define CLKSYNC_ADDR_STAGGER_MS 250
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Parts of the adapter compiled in, each of which can be left out at build time from the cflags
+ * of Component.cdef to shrink the adapter on constrained targets:
+ *  - PA_CLKSYNC_WITH_COMMANDS: the command engine and the command fallback of the native engine,
+ *    i.e. the launch of rdate, ntpdate, chronyd and chronyc and the parsers of their output; the
+ *    daemon engine then reads the tracking of any daemon from the kernel discipline state
+ *  - PA_CLKSYNC_WITH_TP: the Time Protocol, whose functions then return LE_UNSUPPORTED
+ *  - PA_CLKSYNC_WITH_REPLAY: the replay of scripted NTP server replies, a test aid left out by
+ *    default, whose functions then return LE_UNSUPPORTED
+ *
+ * e.g. -DPA_CLKSYNC_WITH_COMMANDS=0 -DPA_CLKSYNC_WITH_TP=0 only keeps the native NTP client.
+ */
+//--------------------------------------------------------------------------------------------------
+#ifndef PA_CLKSYNC_WITH_COMMANDS
+#define PA_CLKSYNC_WITH_COMMANDS    1
+#endif
+#ifndef PA_CLKSYNC_WITH_TP
+#define PA_CLKSYNC_WITH_TP          1
+#endif
+#ifndef PA_CLKSYNC_WITH_REPLAY
+#define PA_CLKSYNC_WITH_REPLAY      0
+#endif
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Addresses of a time server, in the order in which they are to be tried
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    size_t count;                                       ///< Number of addresses
+    char addrs[CLKSYNC_MAX_ADDRS][LE_DCS_IPADDR_MAX_LEN];   ///< Numeric IPv4/v6 addresses
+}
+clkSync_AddrList_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Result of one exchange with a time server
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    int64_t offsetNs;       ///< Offset of the server clock from the local clock
+    int64_t delayNs;        ///< Round-trip delay of the exchange
+    int64_t localTimeNs;    ///< Local CLOCK_REALTIME at which the reply was received
+    int64_t rootDistanceNs; ///< Bound of the error of the offset: half the delay plus the
+                            ///< server's own root delay and dispersion, as in RFC 5905
+    uint8_t stratum;        ///< Stratum of the server, 0 if unknown
+    size_t addrIndex;       ///< Index of the address which answered in the server's address list
+}
+clkSync_Sample_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Convert a timespec into a 64-bit count of nanoseconds
+ */
+//--------------------------------------------------------------------------------------------------
+static inline int64_t clkSync_TimespecToNs
+(
+    const struct timespec* tsPtr    ///< [IN] Time to convert
+)
+{
+    return ((int64_t)tsPtr->tv_sec * CLKSYNC_NS_PER_SEC) + tsPtr->tv_nsec;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Convert a 64-bit count of nanoseconds into a timespec, keeping tv_nsec in [0..1e9[
+ */
+//--------------------------------------------------------------------------------------------------
+static inline struct timespec clkSync_NsToTimespec
+(
+    int64_t timeNs                  ///< [IN] Time to convert
+)
+{
+    struct timespec ts;
+    int64_t nsec = timeNs % CLKSYNC_NS_PER_SEC;
+    int64_t sec = timeNs / CLKSYNC_NS_PER_SEC;
+
+    if (nsec < 0)
+    {
+        nsec += CLKSYNC_NS_PER_SEC;
+        sec--;
+    }
+    ts.tv_sec = (time_t)sec;
+    ts.tv_nsec = (long)nsec;
+    return ts;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read the given clock in nanoseconds
+ *
+ * @return
+ *      The clock's present time in nanoseconds, or 0 if the clock can't be read
+ */
+//--------------------------------------------------------------------------------------------------
+static inline int64_t clkSync_GetClockNs
+(
+    clockid_t clockId               ///< [IN] Clock to read, e.g. CLOCK_REALTIME
+)
+{
+    struct timespec ts;
+
+    if (clock_gettime(clockId, &ts))
+    {
+        return 0;
+    }
+    return clkSync_TimespecToNs(&ts);
+}
+
+#endif // CLKSYNC_LOCAL_H_INCLUDE_GUARD
@@ -0,0 +1,1556 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file clkSyncNts.c
+ *
+ * Native Network Time Security (RFC 8915) client of the Linux Clock Service Adapter. A TLS 1.3
+ * key exchange with the NTS-KE server negotiates the AEAD keys and a supply of cookies, which are
+ * then spent one per NTP request: each request is a single UDP round trip authenticated with
+ * AEAD_AES_SIV_CMAC_256, whose reply brings a fresh cookie back.
+ *
+ * The keys and cookies are kept in a small cache per NTS-KE server, so that the costly key
+ * exchange is only run again when the cookies run out, or when the server rejects them after
+ * rotating its own keys. They are dropped when the data connection changes, since cookies reused
+ * across networks would let the requests be linked to each other.
+ *
+ * The requests and replies are authenticated with the AEAD of clkSyncSiv.c.
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <signal.h>
+#include <openssl/err.h>
+#include <openssl/rand.h>
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+#include "clkSyncLocal.h"
+#include "clkSyncRace.h"
+#include "clkSyncDns.h"
+#include "clkSyncSntp.h"
+#include "clkSyncSocket.h"
+#include "clkSyncSiv.h"
+#include "clkSyncNts.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * NTS-KE port and TLS application protocol, see RFC 8915 section 4
+ */
+//--------------------------------------------------------------------------------------------------
+#define NTS_KE_PORT_STR             "4460"
+#define NTS_KE_ALPN                 "\x07ntske/1"
+#define NTS_KE_ALPN_NAME            "ntske/1"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * NTS-KE record types and their critical bit, see RFC 8915 section 4.1
+ */
+//--------------------------------------------------------------------------------------------------
+#define NTS_KE_RECORD_END           0
+#define NTS_KE_RECORD_NEXT_PROTOCOL 1
+#define NTS_KE_RECORD_ERROR         2
+#define NTS_KE_RECORD_WARNING       3
+#define NTS_KE_RECORD_AEAD          4
+#define NTS_KE_RECORD_NEW_COOKIE    5
+#define NTS_KE_RECORD_SERVER        6
+#define NTS_KE_RECORD_PORT          7
+#define NTS_KE_CRITICAL             0x8000
+#define NTS_KE_TYPE_MASK            0x7fff
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Identifiers of NTPv4 as next protocol and of AEAD_AES_SIV_CMAC_256 as AEAD algorithm
+ */
+//--------------------------------------------------------------------------------------------------
+#define NTS_PROTOCOL_NTPV4          0
+#define NTS_AEAD_AES_SIV_CMAC_256   15
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Label of the TLS exporter deriving the AEAD keys, see RFC 8915 section 5.1
+ */
+//--------------------------------------------------------------------------------------------------
+#define NTS_KE_EXPORTER_LABEL       "EXPORTER-network-time-security"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Largest NTS-KE response accepted
+ */
+//--------------------------------------------------------------------------------------------------
+#define NTS_KE_RESPONSE_MAX_BYTES   4096
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * NTS extension field types, see RFC 8915 section 5.7
+ */
+//--------------------------------------------------------------------------------------------------
+#define NTS_EF_UNIQUE_ID            0x0104
+#define NTS_EF_COOKIE               0x0204
+#define NTS_EF_COOKIE_PLACEHOLDER   0x0304
+#define NTS_EF_AUTHENTICATOR        0x0404
+#define NTS_EF_HEADER_BYTES         4
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Sizes of the AEAD_AES_SIV_CMAC_256 keys, nonces and synthetic IV, and of the unique identifier
+ * of a request
+ */
+//--------------------------------------------------------------------------------------------------
+#define NTS_KEY_BYTES               CLKSYNC_SIV_KEY_BYTES
+#define NTS_NONCE_BYTES             16
+#define NTS_SIV_BYTES               CLKSYNC_SIV_BYTES
+#define NTS_UNIQUE_ID_BYTES         32
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Number of cookies kept per server, as many as RFC 8915 section 4.1.6 has servers send, and
+ * largest cookie accepted
+ */
+//--------------------------------------------------------------------------------------------------
+#define NTS_MAX_COOKIES             8
+#define NTS_COOKIE_MAX_BYTES        256
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Largest NTP packet sent or received; requests are kept under the minimum IPv6 MTU
+ */
+//--------------------------------------------------------------------------------------------------
+#define NTS_PACKET_MAX_BYTES        1280
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Maximum number of NTS-KE servers kept in the cache
+ */
+//--------------------------------------------------------------------------------------------------
+#define NTS_CACHE_MAX_ENTRIES       4
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Maximum length of a host name, including the terminating null character
+ */
+//--------------------------------------------------------------------------------------------------
+#define NTS_NAME_MAX_BYTES          (NI_MAXHOST + 1)
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * NTP server port, used unless the NTS-KE server gives another one
+ */
+//--------------------------------------------------------------------------------------------------
+#define NTS_NTP_PORT_STR            "123"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Round a length up to the next multiple of 4, the alignment of the extension fields
+ */
+//--------------------------------------------------------------------------------------------------
+#define NTS_PAD4(len)               (((len) + 3) & ~(size_t)3)
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Cookie given by an NTS-KE or NTP server, spent on a single request
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    size_t len;                             ///< Length of the cookie
+    uint8_t data[NTS_COOKIE_MAX_BYTES];     ///< Opaque cookie
+}
+NtsCookie_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Keys and cookies negotiated with an NTS-KE server
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    char name[NTS_NAME_MAX_BYTES];          ///< NTS-KE server, which is also the key in the cache
+    char ntpServer[NTS_NAME_MAX_BYTES];     ///< NTP server to query, as given by the NTS-KE server
+    char ntpPort[NI_MAXSERV];               ///< Port of the NTP server
+    uint8_t c2sKey[NTS_KEY_BYTES];          ///< Key of the requests
+    uint8_t s2cKey[NTS_KEY_BYTES];          ///< Key of the replies
+    size_t cookieCount;                     ///< Number of cookies left
+    NtsCookie_t cookies[NTS_MAX_COOKIES];   ///< Cookies left, the last one spent first
+    int64_t lastUsedNs;                     ///< CLOCK_MONOTONIC time the entry was last used at
+}
+NtsEntry_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Pool of cache entries
+ */
+//--------------------------------------------------------------------------------------------------
+static le_mem_PoolRef_t NtsEntryPool;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Cache of the entries, keyed by NTS-KE server
+ */
+//--------------------------------------------------------------------------------------------------
+static le_hashmap_Ref_t NtsCache;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * TLS context of the key exchanges, created on the first one since loading the trusted
+ * certificates is costly
+ */
+//--------------------------------------------------------------------------------------------------
+static SSL_CTX* NtsSslCtxPtr;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read a big-endian 16-bit value
+ */
+//--------------------------------------------------------------------------------------------------
+static uint16_t GetUint16
+(
+    const uint8_t* bufPtr   ///< [IN] First octet of the value
+)
+{
+    return (uint16_t)(((uint16_t)bufPtr[0] << 8) | bufPtr[1]);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Write a big-endian 16-bit value
+ */
+//--------------------------------------------------------------------------------------------------
+static void PutUint16
+(
+    uint8_t* bufPtr,        ///< [OUT] First octet of the value
+    uint16_t value          ///< [IN]  Value to write
+)
+{
+    bufPtr[0] = (uint8_t)(value >> 8);
+    bufPtr[1] = (uint8_t)value;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Log the errors queued by OpenSSL, and clear them
+ */
+//--------------------------------------------------------------------------------------------------
+static void LogSslErrors
+(
+    const char* whatPtr     ///< [IN] Operation which failed
+)
+{
+    unsigned long err = ERR_get_error();
+
+    if (!err)
+    {
+        LE_ERROR("%s failed", whatPtr);
+        return;
+    }
+    for (; err; err = ERR_get_error())
+    {
+        char buf[256];
+
+        ERR_error_string_n(err, buf, sizeof(buf));
+        LE_ERROR("%s failed: %s", whatPtr, buf);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Wait for the given events on a socket, until the given time at the latest
+ *
+ * @return
+ *      - LE_OK             The socket is ready
+ *      - LE_TIMEOUT        The time was reached first
+ *      - LE_FAULT          Failed to wait
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t WaitSocket
+(
+    int fd,                     ///< [IN] Socket
+    short events,               ///< [IN] poll() events to wait for
+    int64_t endNs               ///< [IN] CLOCK_MONOTONIC time to stop waiting at
+)
+{
+    for (;;)
+    {
+        struct pollfd pfd = { .fd = fd, .events = events };
+        int64_t waitNs = endNs - clkSync_GetClockNs(CLOCK_MONOTONIC);
+        int rc;
+
+        if (waitNs <= 0)
+        {
+            return LE_TIMEOUT;
+        }
+
+        rc = poll(&pfd, 1, (int)((waitNs + CLKSYNC_NS_PER_MSEC - 1) / CLKSYNC_NS_PER_MSEC));
+        if (rc > 0)
+        {
+            return LE_OK;
+        }
+        if ((rc < 0) && (EINTR != errno))
+        {
+            LE_ERROR("Failed to wait on socket (%m)");
+            return LE_FAULT;
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the numeric addresses of a server given as a name or an address
+ *
+ * @return
+ *      - LE_OK             Addresses returned
+ *      - LE_NOT_FOUND      The name couldn't be resolved
+ *      - LE_TIMEOUT        The name wasn't resolved before the deadline
+ *      - LE_UNAVAILABLE    The name wasn't resolved, too many lookups already running
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ResolveServer
+(
+    const char* namePtr,                ///< [IN]  Server name or address
+    int64_t deadlineNs,                 ///< [IN]  CLOCK_MONOTONIC time to give up at
+    clkSync_AddrList_t* listPtr         ///< [OUT] Server addresses
+)
+{
+    struct in6_addr addr;
+    le_result_t result;
+
+    if (inet_pton(AF_INET, namePtr, &addr) || inet_pton(AF_INET6, namePtr, &addr))
+    {
+        listPtr->count = 1;
+        return (LE_OK == le_utf8_Copy(listPtr->addrs[0], namePtr, LE_DCS_IPADDR_MAX_LEN, NULL)) ?
+               LE_OK : LE_NOT_FOUND;
+    }
+
+    result = clkSyncDns_Resolve(namePtr, deadlineNs, listPtr);
+    if ((LE_TIMEOUT == result) || (LE_UNAVAILABLE == result))
+    {
+        return result;
+    }
+    if (LE_OK != result)
+    {
+        LE_ERROR("Failed to resolve %s", namePtr);
+        return LE_NOT_FOUND;
+    }
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the TLS context of the key exchanges, creating it on the first call. TLS 1.3 is required
+ * and the server's certificate is checked against the platform's trusted certificates, or those
+ * of PA_CLKSYNC_NTS_CA_FILE when it is set from the cflags of Component.cdef.
+ *
+ * @return
+ *      The TLS context, or NULL if it couldn't be created
+ */
+//--------------------------------------------------------------------------------------------------
+static SSL_CTX* GetSslContext
+(
+    void
+)
+{
+    SSL_CTX* ctxPtr;
+    int ok;
+
+    if (NtsSslCtxPtr)
+    {
+        return NtsSslCtxPtr;
+    }
+
+    ctxPtr = SSL_CTX_new(TLS_client_method());
+    if (!ctxPtr)
+    {
+        LogSslErrors("TLS context creation");
+        return NULL;
+    }
+
+#ifdef PA_CLKSYNC_NTS_CA_FILE
+    ok = SSL_CTX_load_verify_locations(ctxPtr, PA_CLKSYNC_NTS_CA_FILE, NULL);
+#else
+    ok = SSL_CTX_set_default_verify_paths(ctxPtr);
+#endif
+    ok = ok && SSL_CTX_set_min_proto_version(ctxPtr, TLS1_3_VERSION) &&
+         (0 == SSL_CTX_set_alpn_protos(ctxPtr, (const uint8_t*)NTS_KE_ALPN,
+                                       sizeof(NTS_KE_ALPN) - 1));
+    if (!ok)
+    {
+        LogSslErrors("TLS context setup");
+        SSL_CTX_free(ctxPtr);
+        return NULL;
+    }
+    SSL_CTX_set_verify(ctxPtr, SSL_VERIFY_PEER, NULL);
+
+    NtsSslCtxPtr = ctxPtr;
+    return NtsSslCtxPtr;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Wait for the socket of a TLS session to be ready for the operation which returned the given
+ * code
+ *
+ * @return
+ *      - LE_OK             The operation can be retried
+ *      - LE_TIMEOUT        The time was reached first
+ *      - LE_FAULT          The operation failed
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t WaitTls
+(
+    SSL* sslPtr,                ///< [IN] TLS session
+    int fd,                     ///< [IN] Its socket
+    int rc,                     ///< [IN] Code returned by the operation
+    const char* whatPtr,        ///< [IN] Operation, for the logs
+    int64_t endNs               ///< [IN] CLOCK_MONOTONIC time to stop waiting at
+)
+{
+    int err = SSL_get_error(sslPtr, rc);
+
+    if (SSL_ERROR_WANT_READ == err)
+    {
+        return WaitSocket(fd, POLLIN, endNs);
+    }
+    if (SSL_ERROR_WANT_WRITE == err)
+    {
+        return WaitSocket(fd, POLLOUT, endNs);
+    }
+
+    if (X509_V_OK != SSL_get_verify_result(sslPtr))
+    {
+        LE_ERROR("NTS-KE server certificate rejected: %s",
+                 X509_verify_cert_error_string(SSL_get_verify_result(sslPtr)));
+        ERR_clear_error();
+        return LE_FAULT;
+    }
+    LogSslErrors(whatPtr);
+    return LE_FAULT;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Run the TLS handshake with an NTS-KE server, checking its certificate against its name, or its
+ * address if given as one
+ *
+ * @return
+ *      - LE_OK             TLS session established with the server
+ *      - LE_TIMEOUT        The handshake wasn't completed in time
+ *      - LE_FAULT          The handshake failed
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t RunHandshake
+(
+    SSL* sslPtr,                ///< [IN] TLS session
+    int fd,                     ///< [IN] Its socket
+    const char* namePtr,        ///< [IN] NTS-KE server name or address
+    int64_t endNs               ///< [IN] CLOCK_MONOTONIC time to give up at
+)
+{
+    struct in6_addr addr;
+    const uint8_t* alpnPtr;
+    unsigned int alpnLen;
+    le_result_t result;
+
+    if (inet_pton(AF_INET, namePtr, &addr) || inet_pton(AF_INET6, namePtr, &addr))
+    {
+        if (!X509_VERIFY_PARAM_set1_ip_asc(SSL_get0_param(sslPtr), namePtr))
+        {
+            LogSslErrors("TLS address check setup");
+            return LE_FAULT;
+        }
+    }
+    else if (!SSL_set_tlsext_host_name(sslPtr, namePtr) || !SSL_set1_host(sslPtr, namePtr))
+    {
+        LogSslErrors("TLS name check setup");
+        return LE_FAULT;
+    }
+    SSL_set_fd(sslPtr, fd);
+
+    for (;;)
+    {
+        int rc = SSL_connect(sslPtr);
+
+        if (1 == rc)
+        {
+            break;
+        }
+        result = WaitTls(sslPtr, fd, rc, "TLS handshake", endNs);
+        if (LE_OK != result)
+        {
+            return result;
+        }
+    }
+
+    SSL_get0_alpn_selected(sslPtr, &alpnPtr, &alpnLen);
+    if ((sizeof(NTS_KE_ALPN_NAME) - 1 != alpnLen) ||
+        memcmp(alpnPtr, NTS_KE_ALPN_NAME, alpnLen))
+    {
+        LE_ERROR("Server %s doesn't speak NTS-KE", namePtr);
+        return LE_FAULT;
+    }
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Send the NTS-KE request, asking for NTPv4 authenticated with AEAD_AES_SIV_CMAC_256, see
+ * RFC 8915 section 4
+ *
+ * @return
+ *      - LE_OK             Request sent
+ *      - LE_TIMEOUT        The request couldn't be sent in time
+ *      - LE_FAULT          Failed to send the request
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t SendKeRequest
+(
+    SSL* sslPtr,                ///< [IN] TLS session
+    int fd,                     ///< [IN] Its socket
+    int64_t endNs               ///< [IN] CLOCK_MONOTONIC time to give up at
+)
+{
+    uint8_t request[16];
+    size_t len = 0;
+    le_result_t result;
+
+    PutUint16(request + len, NTS_KE_CRITICAL | NTS_KE_RECORD_NEXT_PROTOCOL);
+    PutUint16(request + len + 2, 2);
+    PutUint16(request + len + 4, NTS_PROTOCOL_NTPV4);
+    len += 6;
+    PutUint16(request + len, NTS_KE_RECORD_AEAD);
+    PutUint16(request + len + 2, 2);
+    PutUint16(request + len + 4, NTS_AEAD_AES_SIV_CMAC_256);
+    len += 6;
+    PutUint16(request + len, NTS_KE_CRITICAL | NTS_KE_RECORD_END);
+    PutUint16(request + len + 2, 0);
+    len += 4;
+
+    for (;;)
+    {
+        int rc = SSL_write(sslPtr, request, (int)len);
+
+        if (rc > 0)
+        {
+            return LE_OK;
+        }
+        result = WaitTls(sslPtr, fd, rc, "NTS-KE request", endNs);
+        if (LE_OK != result)
+        {
+            return result;
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Tell whether an NTS-KE response is complete, i.e. holds its End of Message record
+ *
+ * @return
+ *      true if the End of Message record was received
+ */
+//--------------------------------------------------------------------------------------------------
+static bool IsKeResponseComplete
+(
+    const uint8_t* bufPtr,      ///< [IN] Response received so far
+    size_t len                  ///< [IN] Its length
+)
+{
+    size_t pos = 0;
+
+    while (pos + 4 <= len)
+    {
+        size_t bodyLen = GetUint16(bufPtr + pos + 2);
+
+        if (pos + 4 + bodyLen > len)
+        {
+            return false;
+        }
+        if (NTS_KE_RECORD_END == (GetUint16(bufPtr + pos) & NTS_KE_TYPE_MASK))
+        {
+            return true;
+        }
+        pos += 4 + bodyLen;
+    }
+    return false;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Receive the NTS-KE response, up to its End of Message record
+ *
+ * @return
+ *      - LE_OK             Response received
+ *      - LE_TIMEOUT        The response wasn't received in time
+ *      - LE_FAULT          Failed to receive the response, or it is too long or truncated
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ReceiveKeResponse
+(
+    SSL* sslPtr,                ///< [IN]  TLS session
+    int fd,                     ///< [IN]  Its socket
+    int64_t endNs,              ///< [IN]  CLOCK_MONOTONIC time to give up at
+    uint8_t* bufPtr,            ///< [OUT] Response, of NTS_KE_RESPONSE_MAX_BYTES bytes
+    size_t* lenPtr              ///< [OUT] Its length
+)
+{
+    size_t len = 0;
+    le_result_t result;
+
+    while (!IsKeResponseComplete(bufPtr, len))
+    {
+        int rc;
+
+        if (len >= NTS_KE_RESPONSE_MAX_BYTES)
+        {
+            LE_ERROR("NTS-KE response too long");
+            return LE_FAULT;
+        }
+
+        rc = SSL_read(sslPtr, bufPtr + len, (int)(NTS_KE_RESPONSE_MAX_BYTES - len));
+        if (rc > 0)
+        {
+            len += rc;
+            continue;
+        }
+        if (SSL_ERROR_ZERO_RETURN == SSL_get_error(sslPtr, rc))
+        {
+            LE_ERROR("NTS-KE response truncated");
+            return LE_FAULT;
+        }
+        result = WaitTls(sslPtr, fd, rc, "NTS-KE response", endNs);
+        if (LE_OK != result)
+        {
+            return result;
+        }
+    }
+
+    *lenPtr = len;
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Add a cookie to an entry, when there is room for it
+ */
+//--------------------------------------------------------------------------------------------------
+static void AddCookie
+(
+    NtsEntry_t* entryPtr,       ///< [IN] Entry
+    const uint8_t* cookiePtr,   ///< [IN] Cookie
+    size_t len                  ///< [IN] Length of the cookie
+)
+{
+    NtsCookie_t* slotPtr;
+
+    if ((0 == len) || (len > NTS_COOKIE_MAX_BYTES) || (entryPtr->cookieCount >= NTS_MAX_COOKIES))
+    {
+        LE_DEBUG("Dropping cookie of %zu bytes", len);
+        return;
+    }
+
+    slotPtr = &entryPtr->cookies[entryPtr->cookieCount++];
+    slotPtr->len = len;
+    memcpy(slotPtr->data, cookiePtr, len);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Parse an NTS-KE response into an entry: the NTP server and port to query and the cookies
+ *
+ * @return
+ *      - LE_OK             Response parsed, the entry holds at least a cookie
+ *      - LE_UNAVAILABLE    The server reported an error or refused the protocol or algorithm
+ *      - LE_FAULT          The response is malformed
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ParseKeResponse
+(
+    const uint8_t* bufPtr,      ///< [IN]  Response checked by IsKeResponseComplete()
+    size_t len,                 ///< [IN]  Its length
+    NtsEntry_t* entryPtr        ///< [OUT] Entry
+)
+{
+    bool hasProtocol = false;
+    bool hasAead = false;
+    size_t pos = 0;
+
+    le_utf8_Copy(entryPtr->ntpServer, entryPtr->name, sizeof(entryPtr->ntpServer), NULL);
+    le_utf8_Copy(entryPtr->ntpPort, NTS_NTP_PORT_STR, sizeof(entryPtr->ntpPort), NULL);
+    entryPtr->cookieCount = 0;
+
+    for (;;)
+    {
+        uint16_t typeField = GetUint16(bufPtr + pos);
+        uint16_t type = typeField & NTS_KE_TYPE_MASK;
+        size_t bodyLen = GetUint16(bufPtr + pos + 2);
+        const uint8_t* bodyPtr = bufPtr + pos + 4;
+
+        pos += 4 + bodyLen;
+        if (NTS_KE_RECORD_END == type)
+        {
+            break;
+        }
+        else if (NTS_KE_RECORD_NEXT_PROTOCOL == type)
+        {
+            if ((2 != bodyLen) || (NTS_PROTOCOL_NTPV4 != GetUint16(bodyPtr)))
+            {
+                LE_ERROR("NTS-KE server doesn't offer NTPv4");
+                return LE_UNAVAILABLE;
+            }
+            hasProtocol = true;
+        }
+        else if (NTS_KE_RECORD_ERROR == type)
+        {
+            LE_ERROR("NTS-KE server error %d", (2 == bodyLen) ? GetUint16(bodyPtr) : -1);
+            return LE_UNAVAILABLE;
+        }
+        else if (NTS_KE_RECORD_WARNING == type)
+        {
+            LE_WARN("NTS-KE server warning %d", (2 == bodyLen) ? GetUint16(bodyPtr) : -1);
+        }
+        else if (NTS_KE_RECORD_AEAD == type)
+        {
+            if ((2 != bodyLen) || (NTS_AEAD_AES_SIV_CMAC_256 != GetUint16(bodyPtr)))
+            {
+                LE_ERROR("NTS-KE server doesn't offer AEAD_AES_SIV_CMAC_256");
+                return LE_UNAVAILABLE;
+            }
+            hasAead = true;
+        }
+        else if (NTS_KE_RECORD_NEW_COOKIE == type)
+        {
+            AddCookie(entryPtr, bodyPtr, bodyLen);
+        }
+        else if (NTS_KE_RECORD_SERVER == type)
+        {
+            if ((0 == bodyLen) || (bodyLen >= sizeof(entryPtr->ntpServer)))
+            {
+                LE_ERROR("Invalid NTP server in NTS-KE response");
+                return LE_FAULT;
+            }
+            memcpy(entryPtr->ntpServer, bodyPtr, bodyLen);
+            entryPtr->ntpServer[bodyLen] = '\0';
+        }
+        else if (NTS_KE_RECORD_PORT == type)
+        {
+            if (2 != bodyLen)
+            {
+                LE_ERROR("Invalid NTP port in NTS-KE response");
+                return LE_FAULT;
+            }
+            snprintf(entryPtr->ntpPort, sizeof(entryPtr->ntpPort), "%u", GetUint16(bodyPtr));
+        }
+        else if (typeField & NTS_KE_CRITICAL)
+        {
+            LE_ERROR("Unknown critical NTS-KE record %d", type);
+            return LE_UNAVAILABLE;
+        }
+    }
+
+    if (!hasProtocol || !hasAead || (0 == entryPtr->cookieCount))
+    {
+        LE_ERROR("Incomplete NTS-KE response");
+        return LE_UNAVAILABLE;
+    }
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Derive the AEAD keys of an entry from the TLS session, see RFC 8915 section 5.1
+ *
+ * @return
+ *      - LE_OK             Keys derived
+ *      - LE_FAULT          OpenSSL failed to derive them
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ExportKeys
+(
+    SSL* sslPtr,                ///< [IN]  TLS session
+    NtsEntry_t* entryPtr        ///< [OUT] Entry
+)
+{
+    uint8_t context[5];
+
+    PutUint16(context, NTS_PROTOCOL_NTPV4);
+    PutUint16(context + 2, NTS_AEAD_AES_SIV_CMAC_256);
+    context[4] = 0x00;
+    if (1 != SSL_export_keying_material(sslPtr, entryPtr->c2sKey, sizeof(entryPtr->c2sKey),
+                                        NTS_KE_EXPORTER_LABEL, sizeof(NTS_KE_EXPORTER_LABEL) - 1,
+                                        context, sizeof(context), 1))
+    {
+        LogSslErrors("Key export");
+        return LE_FAULT;
+    }
+    context[4] = 0x01;
+    if (1 != SSL_export_keying_material(sslPtr, entryPtr->s2cKey, sizeof(entryPtr->s2cKey),
+                                        NTS_KE_EXPORTER_LABEL, sizeof(NTS_KE_EXPORTER_LABEL) - 1,
+                                        context, sizeof(context), 1))
+    {
+        LogSslErrors("Key export");
+        return LE_FAULT;
+    }
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Run the key exchange over a TLS session on a connected socket
+ *
+ * @return
+ *      - LE_OK             Keys and cookies stored into the entry
+ *      - LE_UNAVAILABLE    The server refused the key exchange
+ *      - LE_TIMEOUT        The key exchange wasn't completed in time
+ *      - LE_FAULT          The key exchange failed
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t RunTlsSession
+(
+    int fd,                     ///< [IN]  Socket connected to the server
+    int64_t endNs,              ///< [IN]  CLOCK_MONOTONIC time to give up at
+    NtsEntry_t* entryPtr        ///< [OUT] Entry
+)
+{
+    uint8_t response[NTS_KE_RESPONSE_MAX_BYTES];
+    size_t len = 0;
+    SSL_CTX* ctxPtr = GetSslContext();
+    SSL* sslPtr;
+    le_result_t result;
+
+    if (!ctxPtr)
+    {
+        return LE_FAULT;
+    }
+    sslPtr = SSL_new(ctxPtr);
+    if (!sslPtr)
+    {
+        LogSslErrors("TLS session creation");
+        return LE_FAULT;
+    }
+
+    result = RunHandshake(sslPtr, fd, entryPtr->name, endNs);
+    if (LE_OK == result)
+    {
+        result = SendKeRequest(sslPtr, fd, endNs);
+    }
+    if (LE_OK == result)
+    {
+        result = ReceiveKeResponse(sslPtr, fd, endNs, response, &len);
+    }
+    if (LE_OK == result)
+    {
+        result = ParseKeResponse(response, len, entryPtr);
+    }
+    if (LE_OK == result)
+    {
+        result = ExportKeys(sslPtr, entryPtr);
+        SSL_shutdown(sslPtr);
+    }
+
+    SSL_free(sslPtr);
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Connect to an address of the NTS-KE server
+ *
+ * @return
+ *      - The connected socket on success
+ *      - -1 on failure
+ */
+//--------------------------------------------------------------------------------------------------
+static int ConnectKeServer
+(
+    const char* addrStr,        ///< [IN] Server address
+    int64_t endNs               ///< [IN] CLOCK_MONOTONIC time to give up at
+)
+{
+    int fd = clkSyncRace_OpenSocket(addrStr, NTS_KE_PORT_STR, SOCK_STREAM);
+    socklen_t errLen = sizeof(int);
+    int err = 0;
+
+    if (fd < 0)
+    {
+        return -1;
+    }
+
+    if ((LE_OK != WaitSocket(fd, POLLOUT, endNs)) ||
+        getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &errLen) || err)
+    {
+        LE_WARN("Failed to connect to NTS-KE server %s (%s)", addrStr,
+                err ? strerror(err) : "no answer");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Run the key exchange with an entry's NTS-KE server, trying its addresses in order, which
+ * replaces the entry's keys and cookies
+ *
+ * @return
+ *      - LE_OK             Keys and cookies stored into the entry
+ *      - LE_NOT_FOUND      The server couldn't be resolved
+ *      - LE_UNAVAILABLE    The server couldn't be reached in time or refused the key exchange
+ *      - LE_TIMEOUT        The key exchange wasn't completed before the deadline
+ *      - LE_FAULT          The key exchange failed
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t RunKeyExchange
+(
+    NtsEntry_t* entryPtr,       ///< [IN/OUT] Entry
+    int64_t deadlineNs          ///< [IN]     CLOCK_MONOTONIC time to give up at
+)
+{
+    clkSync_AddrList_t list = {0};
+    sigset_t pipeSet, oldSet;
+    int64_t endNs;
+    bool endsAtDeadline = false;
+    le_result_t result;
+    size_t i;
+    int fd = -1;
+
+    result = ResolveServer(entryPtr->name, deadlineNs, &list);
+    if (LE_OK != result)
+    {
+        return result;
+    }
+
+    endNs = clkSync_GetClockNs(CLOCK_MONOTONIC) +
+            (int64_t)CLKSYNC_NTS_KE_TIMEOUT_MS * CLKSYNC_NS_PER_MSEC;
+    if (deadlineNs < endNs)
+    {
+        endNs = deadlineNs;
+        endsAtDeadline = true;
+    }
+
+    for (i = 0; (i < list.count) && (fd < 0); i++)
+    {
+        fd = ConnectKeServer(list.addrs[i], endNs);
+    }
+    if (fd < 0)
+    {
+        return (endsAtDeadline && (clkSync_GetClockNs(CLOCK_MONOTONIC) >= endNs)) ?
+               LE_TIMEOUT : LE_UNAVAILABLE;
+    }
+    LE_DEBUG("Running NTS key exchange with %s", entryPtr->name);
+
+    // A server closing the connection mustn't kill the process with SIGPIPE while OpenSSL writes
+    sigemptyset(&pipeSet);
+    sigaddset(&pipeSet, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &pipeSet, &oldSet);
+
+    result = RunTlsSession(fd, endNs, entryPtr);
+    close(fd);
+
+    if (!sigismember(&oldSet, SIGPIPE))
+    {
+        struct timespec noWait = {0};
+
+        while (sigtimedwait(&pipeSet, NULL, &noWait) > 0)
+        {
+        }
+        pthread_sigmask(SIG_SETMASK, &oldSet, NULL);
+    }
+
+    if ((LE_TIMEOUT == result) && !endsAtDeadline)
+    {
+        result = LE_UNAVAILABLE;
+    }
+    if (LE_OK != result)
+    {
+        entryPtr->cookieCount = 0;
+        return result;
+    }
+    LE_DEBUG("NTS key exchange done, %zu cookies for NTP server %s port %s",
+             entryPtr->cookieCount, entryPtr->ntpServer, entryPtr->ntpPort);
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Append an extension field to a packet
+ *
+ * @return
+ *      Length of the field
+ */
+//--------------------------------------------------------------------------------------------------
+static size_t PutExtensionField
+(
+    uint8_t* fieldPtr,          ///< [OUT] Start of the field
+    uint16_t type,              ///< [IN]  Field type
+    const uint8_t* bodyPtr,     ///< [IN]  Field body, NULL for zeros
+    size_t bodyLen              ///< [IN]  Length of the body, before padding
+)
+{
+    size_t len = NTS_EF_HEADER_BYTES + NTS_PAD4(bodyLen);
+
+    memset(fieldPtr + NTS_EF_HEADER_BYTES, 0, len - NTS_EF_HEADER_BYTES);
+    if (bodyPtr)
+    {
+        memcpy(fieldPtr + NTS_EF_HEADER_BYTES, bodyPtr, bodyLen);
+    }
+    PutUint16(fieldPtr, type);
+    PutUint16(fieldPtr + 2, (uint16_t)len);
+    return len;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Build an authenticated request spending one of the entry's cookies, with as many cookie
+ * placeholders as cookies are missing, see RFC 8915 section 5.7
+ *
+ * @return
+ *      Length of the request, 0 on failure
+ */
+//--------------------------------------------------------------------------------------------------
+static size_t BuildRequest
+(
+    NtsEntry_t* entryPtr,       ///< [IN]  Entry, which has a cookie left
+    uint8_t* requestPtr,        ///< [OUT] Request of NTS_PACKET_MAX_BYTES bytes
+    uint8_t* uniqueIdPtr,       ///< [OUT] Unique identifier of the request
+    int64_t* t1Ptr              ///< [OUT] Transmit time of the request
+)
+{
+    const size_t authLen = NTS_EF_HEADER_BYTES + 4 + NTS_NONCE_BYTES + NTS_SIV_BYTES;
+    NtsCookie_t* cookiePtr = &entryPtr->cookies[--entryPtr->cookieCount];
+    size_t fieldLen = NTS_EF_HEADER_BYTES + NTS_PAD4(cookiePtr->len);
+    size_t placeholders = NTS_MAX_COOKIES - 1 - entryPtr->cookieCount;
+    clkSyncSiv_Data_t ad[2];
+    uint8_t* authPtr;
+    size_t len;
+
+    if (1 != RAND_bytes(uniqueIdPtr, NTS_UNIQUE_ID_BYTES))
+    {
+        LogSslErrors("Unique identifier generation");
+        return 0;
+    }
+
+    *t1Ptr = clkSyncSntp_BuildRequest(requestPtr);
+    len = CLKSYNC_SNTP_PACKET_LENGTH;
+    len += PutExtensionField(requestPtr + len, NTS_EF_UNIQUE_ID, uniqueIdPtr, NTS_UNIQUE_ID_BYTES);
+    len += PutExtensionField(requestPtr + len, NTS_EF_COOKIE, cookiePtr->data, cookiePtr->len);
+    while ((placeholders > 0) && (len + fieldLen + authLen <= NTS_PACKET_MAX_BYTES))
+    {
+        len += PutExtensionField(requestPtr + len, NTS_EF_COOKIE_PLACEHOLDER, NULL,
+                                 cookiePtr->len);
+        placeholders--;
+    }
+
+    // The authenticator covers the header and all the fields before it, with no plaintext
+    authPtr = requestPtr + len;
+    PutUint16(authPtr, NTS_EF_AUTHENTICATOR);
+    PutUint16(authPtr + 2, (uint16_t)authLen);
+    PutUint16(authPtr + 4, NTS_NONCE_BYTES);
+    PutUint16(authPtr + 6, NTS_SIV_BYTES);
+    ad[0].dataPtr = requestPtr;
+    ad[0].len = len;
+    ad[1].dataPtr = authPtr + 8;
+    ad[1].len = NTS_NONCE_BYTES;
+    if ((1 != RAND_bytes(authPtr + 8, NTS_NONCE_BYTES)) ||
+        (LE_OK != clkSyncSiv_Seal(entryPtr->c2sKey, ad, NUM_ARRAY_MEMBERS(ad), NULL, 0,
+                                  authPtr + 8 + NTS_NONCE_BYTES)))
+    {
+        LE_ERROR("Failed to authenticate the NTS request");
+        return 0;
+    }
+    return len + authLen;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Find the next extension field of a packet
+ *
+ * @return
+ *      - LE_OK             Field found
+ *      - LE_NOT_FOUND      No more fields
+ *      - LE_FORMAT_ERROR   The field is malformed
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t NextExtensionField
+(
+    const uint8_t* packetPtr,   ///< [IN]     Packet
+    size_t packetLen,           ///< [IN]     Its length
+    size_t* posPtr,             ///< [IN/OUT] Position of the field, moved past it
+    uint16_t* typePtr,          ///< [OUT]    Field type
+    const uint8_t** bodyPtrPtr, ///< [OUT]    Field body
+    size_t* bodyLenPtr          ///< [OUT]    Length of the body, padding included
+)
+{
+    size_t pos = *posPtr;
+    size_t len;
+
+    if (pos + NTS_EF_HEADER_BYTES > packetLen)
+    {
+        return LE_NOT_FOUND;
+    }
+    len = GetUint16(packetPtr + pos + 2);
+    if ((len < NTS_EF_HEADER_BYTES) || (len % 4) || (pos + len > packetLen))
+    {
+        return LE_FORMAT_ERROR;
+    }
+
+    *typePtr = GetUint16(packetPtr + pos);
+    *bodyPtrPtr = packetPtr + pos + NTS_EF_HEADER_BYTES;
+    *bodyLenPtr = len - NTS_EF_HEADER_BYTES;
+    *posPtr = pos + len;
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Tell whether a reply echoes the unique identifier of the request before its authenticator,
+ * which is enough to accept an NTS NAK, unauthenticated by design
+ *
+ * @return
+ *      true if the reply answers the request
+ */
+//--------------------------------------------------------------------------------------------------
+static bool MatchUniqueId
+(
+    const uint8_t* replyPtr,    ///< [IN] Reply
+    size_t replyLen,            ///< [IN] Its length
+    const uint8_t* uniqueIdPtr  ///< [IN] Unique identifier of the request
+)
+{
+    size_t pos = CLKSYNC_SNTP_PACKET_LENGTH;
+    const uint8_t* bodyPtr;
+    size_t bodyLen;
+    uint16_t type;
+
+    while (LE_OK == NextExtensionField(replyPtr, replyLen, &pos, &type, &bodyPtr, &bodyLen))
+    {
+        if (NTS_EF_AUTHENTICATOR == type)
+        {
+            return false;
+        }
+        if ((NTS_EF_UNIQUE_ID == type) && (NTS_UNIQUE_ID_BYTES == bodyLen) &&
+            (0 == memcmp(bodyPtr, uniqueIdPtr, NTS_UNIQUE_ID_BYTES)))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check the authenticator of a reply and take the cookies it encrypts into the entry. Fields
+ * after the authenticator aren't authenticated and are ignored.
+ *
+ * @return
+ *      - LE_OK             The reply is authentic
+ *      - LE_FAULT          The reply isn't authenticated
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t Authenticate
+(
+    NtsEntry_t* entryPtr,       ///< [IN/OUT] Entry
+    const uint8_t* replyPtr,    ///< [IN]     Reply
+    size_t replyLen             ///< [IN]     Its length
+)
+{
+    uint8_t plain[NTS_PACKET_MAX_BYTES];
+    size_t pos = CLKSYNC_SNTP_PACKET_LENGTH;
+    size_t authPos = pos;
+    const uint8_t* bodyPtr;
+    size_t bodyLen, nonceLen, sealedLen, plainLen;
+    clkSyncSiv_Data_t ad[2];
+    uint16_t type;
+
+    for (;;)
+    {
+        authPos = pos;
+        if (LE_OK != NextExtensionField(replyPtr, replyLen, &pos, &type, &bodyPtr, &bodyLen))
+        {
+            return LE_FAULT;
+        }
+        if (NTS_EF_AUTHENTICATOR == type)
+        {
+            break;
+        }
+    }
+
+    if (bodyLen < 4)
+    {
+        return LE_FAULT;
+    }
+    nonceLen = GetUint16(bodyPtr);
+    sealedLen = GetUint16(bodyPtr + 2);
+    ad[0].dataPtr = replyPtr;
+    ad[0].len = authPos;
+    ad[1].dataPtr = bodyPtr + 4;
+    ad[1].len = nonceLen;
+    if ((4 + NTS_PAD4(nonceLen) + NTS_PAD4(sealedLen) > bodyLen) || (sealedLen > sizeof(plain)) ||
+        (LE_OK != clkSyncSiv_Open(entryPtr->s2cKey, ad, NUM_ARRAY_MEMBERS(ad),
+                                  bodyPtr + 4 + NTS_PAD4(nonceLen), sealedLen, plain,
+                                  &plainLen)))
+    {
+        return LE_FAULT;
+    }
+
+    // The plaintext is itself a sequence of extension fields
+    pos = 0;
+    while (LE_OK == NextExtensionField(plain, plainLen, &pos, &type, &bodyPtr, &bodyLen))
+    {
+        if (NTS_EF_COOKIE == type)
+        {
+            AddCookie(entryPtr, bodyPtr, bodyLen);
+        }
+    }
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Send an authenticated request to an address of the entry's NTP server and wait for its reply
+ *
+ * @return
+ *      - LE_OK             An authenticated reply was received and decoded into the sample
+ *      - LE_NOT_PERMITTED  The server rejected the cookie with an NTS NAK
+ *      - LE_UNAVAILABLE    No authenticated reply received before the timeout, or the server is
+ *                          not synchronized
+ *      - LE_TIMEOUT        No authenticated reply received before the deadline
+ *      - LE_FAULT          The request couldn't be sent
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t Exchange
+(
+    NtsEntry_t* entryPtr,       ///< [IN/OUT] Entry, which has a cookie left
+    const char* addrStr,        ///< [IN]     NTP server address
+    uint32_t timeoutMs,         ///< [IN]     Time to wait for the reply
+    int64_t deadlineNs,         ///< [IN]     CLOCK_MONOTONIC time to give up at
+    clkSync_Sample_t* samplePtr ///< [OUT]    Decoded sample
+)
+{
+    uint8_t request[NTS_PACKET_MAX_BYTES];
+    uint8_t reply[NTS_PACKET_MAX_BYTES];
+    uint8_t uniqueId[NTS_UNIQUE_ID_BYTES];
+    size_t requestLen;
+    int64_t t1, endNs;
+    bool endsAtDeadline = false;
+    le_result_t result;
+    int fd;
+
+    fd = clkSyncSocket_Acquire(addrStr, entryPtr->ntpPort);
+    if (fd < 0)
+    {
+        return LE_FAULT;
+    }
+
+    requestLen = BuildRequest(entryPtr, request, uniqueId, &t1);
+    if ((0 == requestLen) || (send(fd, request, requestLen, 0) != (ssize_t)requestLen))
+    {
+        LE_ERROR("Failed to send NTS request to %s (%m)", addrStr);
+        clkSyncSocket_Release(fd);
+        return LE_FAULT;
+    }
+    LE_DEBUG("NTS request of %zu bytes sent to %s", requestLen, addrStr);
+
+    endNs = clkSync_GetClockNs(CLOCK_MONOTONIC) + (int64_t)timeoutMs * CLKSYNC_NS_PER_MSEC;
+    if (deadlineNs < endNs)
+    {
+        endNs = deadlineNs;
+        endsAtDeadline = true;
+    }
+
+    for (;;)
+    {
+        ssize_t len;
+        int64_t t4;
+
+        result = WaitSocket(fd, POLLIN, endNs);
+        if (LE_TIMEOUT == result)
+        {
+            LE_WARN("No NTS reply from %s within %u ms", addrStr, timeoutMs);
+            result = endsAtDeadline ? LE_TIMEOUT : LE_UNAVAILABLE;
+            break;
+        }
+        if (LE_OK != result)
+        {
+            result = LE_UNAVAILABLE;
+            break;
+        }
+
+        len = clkSyncSntp_ReceiveReply(fd, reply, sizeof(reply), NULL, NULL, &t4);
+        if (len < 0)
+        {
+            if ((EAGAIN == errno) || (EINTR == errno))
+            {
+                continue;
+            }
+            LE_WARN("Failed to receive reply (%m)");
+            result = LE_UNAVAILABLE;
+            break;
+        }
+
+        // Replies which don't answer this very request, or aren't authentic, are ignored as
+        // if never received
+        result = clkSyncSntp_CheckReply(request, reply, len);
+        if ((LE_NOT_FOUND == result) || !MatchUniqueId(reply, len, uniqueId))
+        {
+            continue;
+        }
+        if (clkSyncSntp_IsKissCode(reply, "NTSN"))
+        {
+            result = LE_NOT_PERMITTED;
+            break;
+        }
+        if (LE_OK != Authenticate(entryPtr, reply, len))
+        {
+            LE_DEBUG("Ignoring unauthenticated reply");
+            continue;
+        }
+        if (LE_OK == result)
+        {
+            clkSyncSntp_DecodeReply(reply, t1, t4, samplePtr);
+        }
+        break;
+    }
+
+    clkSyncSocket_Release(fd);
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Query the NTP server of an entry, trying its addresses in order as long as cookies are left
+ *
+ * @return
+ *      - LE_OK             An authenticated reply was received and decoded into the sample
+ *      - LE_NOT_FOUND      The NTP server couldn't be resolved
+ *      - LE_NOT_PERMITTED  The server rejected the cookies
+ *      - LE_UNAVAILABLE    No authenticated reply received
+ *      - LE_TIMEOUT        No authenticated reply received before the deadline
+ *      - LE_FAULT          No request could be sent
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t QueryNtpServer
+(
+    NtsEntry_t* entryPtr,       ///< [IN/OUT] Entry, which has a cookie left
+    uint32_t timeoutMs,         ///< [IN]     Time to wait for the reply on each address
+    int64_t deadlineNs,         ///< [IN]     CLOCK_MONOTONIC time to give up at
+    clkSync_Sample_t* samplePtr ///< [OUT]    Decoded sample
+)
+{
+    clkSync_AddrList_t list = {0};
+    le_result_t result;
+    size_t i;
+
+    result = ResolveServer(entryPtr->ntpServer, deadlineNs, &list);
+    if (LE_OK != result)
+    {
+        return result;
+    }
+
+    result = LE_UNAVAILABLE;
+    for (i = 0; (i < list.count) && (entryPtr->cookieCount > 0); i++)
+    {
+        result = Exchange(entryPtr, list.addrs[i], timeoutMs, deadlineNs, samplePtr);
+        if (LE_OK == result)
+        {
+            samplePtr->addrIndex = i;
+            LE_DEBUG("NTS time retrieved from %s, %zu cookies left", list.addrs[i],
+                     entryPtr->cookieCount);
+        }
+        if ((LE_OK == result) || (LE_NOT_PERMITTED == result) || (LE_TIMEOUT == result))
+        {
+            break;
+        }
+    }
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the cache entry of an NTS-KE server, creating it without cookies if none, in place of the
+ * least recently used entry when the cache is full
+ *
+ * @return
+ *      The entry
+ */
+//--------------------------------------------------------------------------------------------------
+static NtsEntry_t* GetEntry
+(
+    const char* namePtr         ///< [IN] NTS-KE server
+)
+{
+    NtsEntry_t* entryPtr = le_hashmap_Get(NtsCache, namePtr);
+
+    if (!entryPtr)
+    {
+        if (le_hashmap_Size(NtsCache) >= NTS_CACHE_MAX_ENTRIES)
+        {
+            le_hashmap_It_Ref_t iter = le_hashmap_GetIterator(NtsCache);
+            NtsEntry_t* oldestPtr = NULL;
+
+            while (LE_OK == le_hashmap_NextNode(iter))
+            {
+                NtsEntry_t* otherPtr = le_hashmap_GetValue(iter);
+                if (!oldestPtr || (otherPtr->lastUsedNs < oldestPtr->lastUsedNs))
+                {
+                    oldestPtr = otherPtr;
+                }
+            }
+            le_hashmap_Remove(NtsCache, oldestPtr->name);
+            le_mem_Release(oldestPtr);
+        }
+
+        entryPtr = le_mem_ForceAlloc(NtsEntryPool);
+        memset(entryPtr, 0, sizeof(*entryPtr));
+        le_utf8_Copy(entryPtr->name, namePtr, sizeof(entryPtr->name), NULL);
+        le_hashmap_Put(NtsCache, entryPtr->name, entryPtr);
+    }
+
+    entryPtr->lastUsedNs = clkSync_GetClockNs(CLOCK_MONOTONIC);
+    return entryPtr;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Destructor of a cache entry, which wipes its keys and cookies
+ */
+//--------------------------------------------------------------------------------------------------
+static void DestructEntry
+(
+    void* objPtr                ///< [IN] Entry
+)
+{
+    OPENSSL_cleanse(objPtr, sizeof(NtsEntry_t));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Initialize the cache of the keys and cookies negotiated with NTS-KE servers
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncNts_Init
+(
+    void
+)
+{
+    NtsEntryPool = le_mem_CreatePool("ClkSyncNtsEntry", sizeof(NtsEntry_t));
+    le_mem_ExpandPool(NtsEntryPool, NTS_CACHE_MAX_ENTRIES);
+    le_mem_SetDestructor(NtsEntryPool, DestructEntry);
+    NtsCache = le_hashmap_Create("ClkSyncNtsCache", NTS_CACHE_MAX_ENTRIES,
+                                 le_hashmap_HashString, le_hashmap_EqualsString);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Query the NTP server associated with the given NTS-KE server with an authenticated request.
+ * The TLS key exchange is only run when no cookie is left from the previous exchanges with the
+ * server, or when the server rejected them.
+ *
+ * @return
+ *      - LE_OK             An authenticated reply was received and decoded into the sample
+ *      - LE_BAD_PARAMETER  Invalid inputs
+ *      - LE_NOT_FOUND      The NTS-KE or the NTP server couldn't be resolved
+ *      - LE_UNAVAILABLE    No authenticated reply received before the timeout, the server is not
+ *                          synchronized, or the key exchange was refused
+ *      - LE_TIMEOUT        No authenticated reply received before the deadline
+ *      - LE_FAULT          The key exchange failed, e.g. the server's certificate isn't trusted
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncNts_Query
+(
+    const char* serverPtr,              ///< [IN]  NTS-KE server name or address
+    uint32_t timeoutMs,                 ///< [IN]  Time to wait for the reply on each address
+    int64_t deadlineNs,                 ///< [IN]  CLOCK_MONOTONIC time to give up at, INT64_MAX
+                                        ///<       if none
+    clkSync_Sample_t* samplePtr         ///< [OUT] Decoded sample
+)
+{
+    NtsEntry_t* entryPtr;
+    bool exchangedKeys = false;
+    le_result_t result;
+
+    if (!serverPtr || !samplePtr || ('\0' == serverPtr[0]) ||
+        (strlen(serverPtr) >= NTS_NAME_MAX_BYTES))
+    {
+        LE_ERROR("Input error");
+        return LE_BAD_PARAMETER;
+    }
+
+    entryPtr = GetEntry(serverPtr);
+    for (;;)
+    {
+        if (0 == entryPtr->cookieCount)
+        {
+            result = RunKeyExchange(entryPtr, deadlineNs);
+            if (LE_OK != result)
+            {
+                return result;
+            }
+            exchangedKeys = true;
+        }
+
+        result = QueryNtpServer(entryPtr, timeoutMs, deadlineNs, samplePtr);
+        if (LE_NOT_PERMITTED != result)
+        {
+            return result;
+        }
+
+        // The server rotated its keys; the cookies are renegotiated once
+        LE_INFO("NTS cookies of %s rejected", serverPtr);
+        entryPtr->cookieCount = 0;
+        if (exchangedKeys)
+        {
+            return LE_UNAVAILABLE;
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Drop all the keys and cookies negotiated, e.g. when the data connection changes, so that the
+ * requests sent over the new connection can't be linked to the previous ones
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncNts_Flush
+(
+    void
+)
+{
+    le_hashmap_It_Ref_t iter = le_hashmap_GetIterator(NtsCache);
+
+    while (LE_OK == le_hashmap_NextNode(iter))
+    {
+        le_mem_Release(le_hashmap_GetValue(iter));
+    }
+    le_hashmap_RemoveAll(NtsCache);
+    LE_DEBUG("NTS keys and cookies flushed");
+}
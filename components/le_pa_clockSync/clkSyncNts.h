@@ -0,0 +1,72 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file clkSyncNts.h
+ *
+ * Native Network Time Security (RFC 8915) client of the Linux Clock Service Adapter
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef CLKSYNC_NTS_H_INCLUDE_GUARD
+#define CLKSYNC_NTS_H_INCLUDE_GUARD
+
+#include "legato.h"
+#include "clkSyncLocal.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Default time given to the TLS key exchange with an NTS-KE server
+ */
+//--------------------------------------------------------------------------------------------------
+#define CLKSYNC_NTS_KE_TIMEOUT_MS   5000
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Initialize the cache of the keys and cookies negotiated with NTS-KE servers
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncNts_Init
+(
+    void
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Query the NTP server associated with the given NTS-KE server with an authenticated request.
+ * The TLS key exchange is only run when no cookie is left from the previous exchanges with the
+ * server, or when the server rejected them.
+ *
+ * @return
+ *      - LE_OK             An authenticated reply was received and decoded into the sample
+ *      - LE_BAD_PARAMETER  Invalid inputs
+ *      - LE_NOT_FOUND      The NTS-KE or the NTP server couldn't be resolved
+ *      - LE_UNAVAILABLE    No authenticated reply received before the timeout, the server is not
+ *                          synchronized, or the key exchange was refused
+ *      - LE_TIMEOUT        No authenticated reply received before the deadline
+ *      - LE_FAULT          The key exchange failed, e.g. the server's certificate isn't trusted
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncNts_Query
+(
+    const char* serverPtr,              ///< [IN]  NTS-KE server name or address
+    uint32_t timeoutMs,                 ///< [IN]  Time to wait for the reply on each address
+    int64_t deadlineNs,                 ///< [IN]  CLOCK_MONOTONIC time to give up at, INT64_MAX
+                                        ///<       if none
+    clkSync_Sample_t* samplePtr         ///< [OUT] Decoded sample
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Drop all the keys and cookies negotiated, e.g. when the data connection changes, so that the
+ * requests sent over the new connection can't be linked to the previous ones
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncNts_Flush
+(
+    void
+);
+
+#endif // CLKSYNC_NTS_H_INCLUDE_GUARD
@@ -0,0 +1,705 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file clkSyncParse.c
+ *
+ * Streaming parser of the output of the time commands run by the Linux Clock Service Adapter. The
+ * output is fed as it is read; a state machine splits it into whitespace separated fields, or
+ * fields separated by the format's separator, and hands each completed field to the format's
+ * handler, which keeps the state of the line. Nothing is buffered beyond the field in progress, so
+ * lines of any length are parsed with a fixed memory footprint, and the first field which fails to
+ * parse is reported.
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "clkSyncLocal.h"
+#include "clkSyncParse.h"
+
+// Parsers of the command outputs only compiled in when PA_CLKSYNC_WITH_COMMANDS is set
+#if PA_CLKSYNC_WITH_COMMANDS
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Output format of a command
+ */
+//--------------------------------------------------------------------------------------------------
+struct clkSyncParse_Format
+{
+    const char* namePtr;                        ///< Command name used in errors
+    char separator;                             ///< Separator of the fields, which may then hold
+                                                ///< whitespace; '\0' to split on whitespace
+
+    /// Handle a completed field of the line in progress; isValid is false if it was too long
+    void (*fieldFunc)(clkSyncParse_Parser_t* parserPtr, const char* fieldPtr, bool isValid);
+
+    /// Handle the end of the line in progress
+    void (*lineEndFunc)(clkSyncParse_Parser_t* parserPtr);
+};
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Line state of the ntpdate format
+ */
+//--------------------------------------------------------------------------------------------------
+#define NTPDATE_FROM_NTPDATE        0x01    ///< The line was printed by ntpdate
+#define NTPDATE_EXPECT_OFFSET       0x02    ///< The next field is the offset
+#define NTPDATE_EXPECT_UNIT         0x04    ///< The next field is the offset's unit
+#define NTPDATE_HAS_OFFSET          0x08    ///< The offset in lineValue is complete
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Line state of the chronyd format
+ */
+//--------------------------------------------------------------------------------------------------
+#define CHRONYD_EXPECT_BY           0x01    ///< The next field is "by"
+#define CHRONYD_EXPECT_OFFSET       0x02    ///< The next field is the offset
+#define CHRONYD_EXPECT_UNIT         0x04    ///< The next field is the offset's unit
+#define CHRONYD_HAS_OFFSET          0x08    ///< The offset in lineValue is complete
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Line state of the chronyc tracking format
+ */
+//--------------------------------------------------------------------------------------------------
+#define CHRONYC_INVALID             0x01    ///< A field of the line failed to parse
+#define CHRONYC_UNSYNCHRONIZED      0x02    ///< chronyd doesn't synchronize the system clock
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Fields of "chronyc -c tracking" looked at, and number of fields of its line
+ */
+//--------------------------------------------------------------------------------------------------
+#define CHRONYC_FIELD_CORRECTION    4
+#define CHRONYC_FIELD_LEAP_STATUS   13
+#define CHRONYC_FIELD_COUNT         14
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Line state of the rdate format
+ */
+//--------------------------------------------------------------------------------------------------
+#define RDATE_INVALID               0x01    ///< A field of the line isn't part of a date
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Fields of the date printed by rdate, with the strptime() format of each
+ */
+//--------------------------------------------------------------------------------------------------
+#define RDATE_FIELD_COUNT           5
+static const char* const RdateFieldNames[RDATE_FIELD_COUNT] =
+{
+    "weekday", "month", "day", "time", "year"
+};
+static const char* const RdateFieldFormats[RDATE_FIELD_COUNT] =
+{
+    "%a", "%b", "%d", "%H:%M:%S", "%Y"
+};
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Record a field which failed to parse, unless an earlier failure is already recorded
+ */
+//--------------------------------------------------------------------------------------------------
+static void SetError
+(
+    clkSyncParse_Parser_t* parserPtr,           ///< [IN] Parser in progress
+    const char* fieldNamePtr,                   ///< [IN] Name of the field expected
+    const char* fieldPtr                        ///< [IN] Field found
+)
+{
+    if ('\0' != parserPtr->error[0])
+    {
+        return;
+    }
+
+    snprintf(parserPtr->error, sizeof(parserPtr->error), "%s output line %zu: invalid %s '%s%s'",
+             parserPtr->formatPtr->namePtr, parserPtr->lineNum, fieldNamePtr, fieldPtr,
+             (parserPtr->fieldLen >= CLKSYNC_PARSE_FIELD_BYTES) ? "..." : "");
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Parse a field made of a decimal number of seconds such as "-0.202418" into nanoseconds, without
+ * the rounding errors of a conversion through a double. Digits beyond the nanosecond are ignored.
+ *
+ * @return
+ *     - LE_FORMAT_ERROR: the field isn't a valid number
+ *     - LE_OVERFLOW: number out of range
+ *     - LE_OK: number successfully parsed
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ParseSecondsToNs
+(
+    const char* str,        ///< [IN]  field to parse
+    int64_t* nsPtr          ///< [OUT] parsed value in nanoseconds
+)
+{
+    int64_t secs = 0, fracNs = 0, scale = CLKSYNC_NS_PER_SEC / 10;
+    bool isNegative = false, hasDigits = false;
+
+    if (('-' == *str) || ('+' == *str))
+    {
+        isNegative = ('-' == *str);
+        str++;
+    }
+
+    for (; (*str >= '0') && (*str <= '9'); str++)
+    {
+        if (secs > (INT64_MAX / CLKSYNC_NS_PER_SEC) / 10)
+        {
+            return LE_OVERFLOW;
+        }
+        secs = (secs * 10) + (*str - '0');
+        hasDigits = true;
+    }
+
+    if ('.' == *str)
+    {
+        for (str++; (*str >= '0') && (*str <= '9'); str++)
+        {
+            fracNs += (*str - '0') * scale;
+            scale /= 10;
+            hasDigits = true;
+        }
+    }
+
+    if ((!hasDigits) || ('\0' != *str))
+    {
+        return LE_FORMAT_ERROR;
+    }
+
+    *nsPtr = (secs * CLKSYNC_NS_PER_SEC) + fracNs;
+    if (isNegative)
+    {
+        *nsPtr = -*nsPtr;
+    }
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle a field of "ntpdate -q" output. The offset is taken from the field following "offset" on
+ * a line printed by ntpdate, which has to be followed by "sec"; the server lines printed before,
+ * such as "server 10.1.1.1, stratum 2, offset -0.000292, delay 0.02585", are ignored.
+ */
+//--------------------------------------------------------------------------------------------------
+static void NtpdateField
+(
+    clkSyncParse_Parser_t* parserPtr,           ///< [IN] Parser in progress
+    const char* fieldPtr,                       ///< [IN] Field completed
+    bool isValid                                ///< [IN] Whether the field fit in the buffer
+)
+{
+    uint32_t* flagsPtr = &parserPtr->lineFlags;
+
+    if (*flagsPtr & NTPDATE_EXPECT_OFFSET)
+    {
+        *flagsPtr &= ~NTPDATE_EXPECT_OFFSET;
+        if (isValid && (LE_OK == ParseSecondsToNs(fieldPtr, &parserPtr->lineValue)))
+        {
+            *flagsPtr |= NTPDATE_EXPECT_UNIT;
+        }
+        else
+        {
+            SetError(parserPtr, "offset", fieldPtr);
+        }
+        return;
+    }
+
+    if (*flagsPtr & NTPDATE_EXPECT_UNIT)
+    {
+        *flagsPtr &= ~NTPDATE_EXPECT_UNIT;
+        if (0 == strcmp(fieldPtr, "sec"))
+        {
+            *flagsPtr |= NTPDATE_HAS_OFFSET;
+        }
+        else
+        {
+            SetError(parserPtr, "offset unit", fieldPtr);
+        }
+        return;
+    }
+
+    if (isValid && strstr(fieldPtr, "ntpdate"))
+    {
+        *flagsPtr |= NTPDATE_FROM_NTPDATE;
+    }
+    else if ((*flagsPtr & NTPDATE_FROM_NTPDATE) && (0 == strcmp(fieldPtr, "offset")))
+    {
+        *flagsPtr |= NTPDATE_EXPECT_OFFSET;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle the end of a line of "ntpdate -q" output
+ */
+//--------------------------------------------------------------------------------------------------
+static void NtpdateLineEnd
+(
+    clkSyncParse_Parser_t* parserPtr            ///< [IN] Parser in progress
+)
+{
+    uint32_t flags = parserPtr->lineFlags;
+
+    if (flags & (NTPDATE_EXPECT_OFFSET | NTPDATE_EXPECT_UNIT))
+    {
+        SetError(parserPtr, "offset", "");
+    }
+    else if (flags & NTPDATE_HAS_OFFSET)
+    {
+        LE_DEBUG("NTP offset time retrieved: %" PRId64 " ns", parserPtr->lineValue);
+        parserPtr->offsetNs = parserPtr->lineValue;
+        parserPtr->hasOffset = true;
+        parserPtr->isDone = true;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle a field of "chronyd -Q" output, printed on its standard error. The offset is taken from
+ * the line "2026-10-14T04:42:30Z System clock wrong by 0.000292 seconds (ignored)", the other log
+ * lines being ignored.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ChronydField
+(
+    clkSyncParse_Parser_t* parserPtr,           ///< [IN] Parser in progress
+    const char* fieldPtr,                       ///< [IN] Field completed
+    bool isValid                                ///< [IN] Whether the field fit in the buffer
+)
+{
+    uint32_t* flagsPtr = &parserPtr->lineFlags;
+
+    if (*flagsPtr & CHRONYD_EXPECT_BY)
+    {
+        *flagsPtr &= ~CHRONYD_EXPECT_BY;
+        if (0 == strcmp(fieldPtr, "by"))
+        {
+            *flagsPtr |= CHRONYD_EXPECT_OFFSET;
+        }
+        return;
+    }
+
+    if (*flagsPtr & CHRONYD_EXPECT_OFFSET)
+    {
+        *flagsPtr &= ~CHRONYD_EXPECT_OFFSET;
+        if (isValid && (LE_OK == ParseSecondsToNs(fieldPtr, &parserPtr->lineValue)))
+        {
+            *flagsPtr |= CHRONYD_EXPECT_UNIT;
+        }
+        else
+        {
+            SetError(parserPtr, "offset", fieldPtr);
+        }
+        return;
+    }
+
+    if (*flagsPtr & CHRONYD_EXPECT_UNIT)
+    {
+        *flagsPtr &= ~CHRONYD_EXPECT_UNIT;
+        if (0 == strcmp(fieldPtr, "seconds"))
+        {
+            *flagsPtr |= CHRONYD_HAS_OFFSET;
+        }
+        else
+        {
+            SetError(parserPtr, "offset unit", fieldPtr);
+        }
+        return;
+    }
+
+    if (0 == strcmp(fieldPtr, "wrong"))
+    {
+        *flagsPtr |= CHRONYD_EXPECT_BY;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle the end of a line of "chronyd -Q" output
+ */
+//--------------------------------------------------------------------------------------------------
+static void ChronydLineEnd
+(
+    clkSyncParse_Parser_t* parserPtr            ///< [IN] Parser in progress
+)
+{
+    uint32_t flags = parserPtr->lineFlags;
+
+    if (flags & (CHRONYD_EXPECT_OFFSET | CHRONYD_EXPECT_UNIT))
+    {
+        SetError(parserPtr, "offset", "");
+    }
+    else if (flags & CHRONYD_HAS_OFFSET)
+    {
+        LE_DEBUG("NTP offset time retrieved: %" PRId64 " ns", parserPtr->lineValue);
+        parserPtr->offsetNs = parserPtr->lineValue;
+        parserPtr->hasOffset = true;
+        parserPtr->isDone = true;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle a field of "chronyc -c tracking" output, a single comma separated line such as
+ * "C0A80001,192.168.0.1,3,1791953649.203277577,-0.000012345,...,Normal". The system time field
+ * is the offset by which chronyd is still slewing the clock, positive when the clock is slow; the
+ * leap status is "Not synchronised" when chronyd doesn't synchronize the clock.
+ */
+//--------------------------------------------------------------------------------------------------
+static void ChronycField
+(
+    clkSyncParse_Parser_t* parserPtr,           ///< [IN] Parser in progress
+    const char* fieldPtr,                       ///< [IN] Field completed
+    bool isValid                                ///< [IN] Whether the field fit in the buffer
+)
+{
+    switch (parserPtr->fieldIndex)
+    {
+        case CHRONYC_FIELD_CORRECTION:
+            if ((!isValid) || (LE_OK != ParseSecondsToNs(fieldPtr, &parserPtr->lineValue)))
+            {
+                SetError(parserPtr, "system time", fieldPtr);
+                parserPtr->lineFlags |= CHRONYC_INVALID;
+            }
+            break;
+
+        case CHRONYC_FIELD_LEAP_STATUS:
+            if (0 == strcmp(fieldPtr, "Not synchronised"))
+            {
+                parserPtr->lineFlags |= CHRONYC_UNSYNCHRONIZED;
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle the end of a line of "chronyc -c tracking" output
+ */
+//--------------------------------------------------------------------------------------------------
+static void ChronycLineEnd
+(
+    clkSyncParse_Parser_t* parserPtr            ///< [IN] Parser in progress
+)
+{
+    if (parserPtr->lineFlags & CHRONYC_INVALID)
+    {
+        return;
+    }
+    if (parserPtr->fieldIndex < CHRONYC_FIELD_COUNT)
+    {
+        SetError(parserPtr, "tracking", "");
+        return;
+    }
+    if (parserPtr->lineFlags & CHRONYC_UNSYNCHRONIZED)
+    {
+        SetError(parserPtr, "leap status", "Not synchronised");
+        return;
+    }
+
+    LE_DEBUG("chronyd correction retrieved: %" PRId64 " ns", parserPtr->lineValue);
+    parserPtr->offsetNs = parserPtr->lineValue;
+    parserPtr->hasOffset = true;
+    parserPtr->isDone = true;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle a field of "rdate -p" output, which has to be the next field of a date in the format of
+ * ctime(); any field past the date is ignored
+ */
+//--------------------------------------------------------------------------------------------------
+static void RdateField
+(
+    clkSyncParse_Parser_t* parserPtr,           ///< [IN] Parser in progress
+    const char* fieldPtr,                       ///< [IN] Field completed
+    bool isValid                                ///< [IN] Whether the field fit in the buffer
+)
+{
+    size_t index = parserPtr->fieldIndex;
+    const char* endPtr;
+
+    if ((parserPtr->lineFlags & RDATE_INVALID) || (index >= RDATE_FIELD_COUNT))
+    {
+        return;
+    }
+
+    endPtr = isValid ? strptime(fieldPtr, RdateFieldFormats[index], &parserPtr->tm) : NULL;
+    if ((!endPtr) || ('\0' != *endPtr))
+    {
+        SetError(parserPtr, RdateFieldNames[index], fieldPtr);
+        parserPtr->lineFlags |= RDATE_INVALID;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handle the end of a line of "rdate -p" output
+ */
+//--------------------------------------------------------------------------------------------------
+static void RdateLineEnd
+(
+    clkSyncParse_Parser_t* parserPtr            ///< [IN] Parser in progress
+)
+{
+    struct tm* tmPtr = &parserPtr->tm;
+    time_t timeSecs;
+
+    if (parserPtr->lineFlags & RDATE_INVALID)
+    {
+        return;
+    }
+    if (parserPtr->fieldIndex < RDATE_FIELD_COUNT)
+    {
+        SetError(parserPtr, RdateFieldNames[parserPtr->fieldIndex], "");
+        return;
+    }
+
+    LE_DEBUG("TP present time retrieved: %d/%d/%d %d:%d:%d",
+             tmPtr->tm_year + 1900, tmPtr->tm_mon + 1, tmPtr->tm_mday,
+             tmPtr->tm_hour, tmPtr->tm_min, tmPtr->tm_sec);
+
+    // rdate prints the local time with a resolution of one second
+    tmPtr->tm_isdst = -1;
+    timeSecs = mktime(tmPtr);
+    if ((time_t)-1 == timeSecs)
+    {
+        SetError(parserPtr, "date", "");
+        return;
+    }
+
+    parserPtr->offsetNs = (int64_t)timeSecs * CLKSYNC_NS_PER_SEC -
+                          clkSync_GetClockNs(CLOCK_REALTIME);
+    parserPtr->hasOffset = true;
+    parserPtr->isDone = true;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Output formats
+ */
+//--------------------------------------------------------------------------------------------------
+const clkSyncParse_Format_t clkSyncParse_Rdate =
+{
+    .namePtr = "rdate",
+    .fieldFunc = RdateField,
+    .lineEndFunc = RdateLineEnd,
+};
+
+const clkSyncParse_Format_t clkSyncParse_Ntpdate =
+{
+    .namePtr = "ntpdate",
+    .fieldFunc = NtpdateField,
+    .lineEndFunc = NtpdateLineEnd,
+};
+
+const clkSyncParse_Format_t clkSyncParse_Chronyd =
+{
+    .namePtr = "chronyd",
+    .fieldFunc = ChronydField,
+    .lineEndFunc = ChronydLineEnd,
+};
+
+const clkSyncParse_Format_t clkSyncParse_ChronycTracking =
+{
+    .namePtr = "chronyc",
+    .separator = ',',
+    .fieldFunc = ChronycField,
+    .lineEndFunc = ChronycLineEnd,
+};
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Hand the field in progress, if any, to the format
+ */
+//--------------------------------------------------------------------------------------------------
+static void EndField
+(
+    clkSyncParse_Parser_t* parserPtr            ///< [IN] Parser in progress
+)
+{
+    bool isValid = (parserPtr->fieldLen < CLKSYNC_PARSE_FIELD_BYTES);
+
+    // Only separated fields may be empty, e.g. "a,,b"
+    if ((0 == parserPtr->fieldLen) && ('\0' == parserPtr->formatPtr->separator))
+    {
+        return;
+    }
+
+    parserPtr->field[isValid ? parserPtr->fieldLen : CLKSYNC_PARSE_FIELD_BYTES - 1] = '\0';
+    parserPtr->formatPtr->fieldFunc(parserPtr, parserPtr->field, isValid);
+    parserPtr->fieldIndex++;
+    parserPtr->fieldLen = 0;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check whether a character separates the fields of a format
+ *
+ * @return
+ *      - true    The character ends the field in progress
+ *      - false   The character is part of the field, or ends the line
+ */
+//--------------------------------------------------------------------------------------------------
+static bool IsSeparator
+(
+    const clkSyncParse_Format_t* formatPtr,     ///< [IN] Format parsed
+    char c                                      ///< [IN] Character read
+)
+{
+    if ('\0' != formatPtr->separator)
+    {
+        return (c == formatPtr->separator);
+    }
+    return ((' ' == c) || ('\t' == c) || ('\r' == c));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Add a character to the field in progress; past the buffer only the length is counted, and the
+ * field is rejected
+ */
+//--------------------------------------------------------------------------------------------------
+static void AddToField
+(
+    clkSyncParse_Parser_t* parserPtr,           ///< [IN] Parser in progress
+    char c                                      ///< [IN] Character of the field
+)
+{
+    if (parserPtr->fieldLen < CLKSYNC_PARSE_FIELD_BYTES - 1)
+    {
+        parserPtr->field[parserPtr->fieldLen] = c;
+    }
+    if (parserPtr->fieldLen < SIZE_MAX)
+    {
+        parserPtr->fieldLen++;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Hand the end of the line in progress to the format, and start the next one
+ */
+//--------------------------------------------------------------------------------------------------
+static void EndLine
+(
+    clkSyncParse_Parser_t* parserPtr            ///< [IN] Parser in progress
+)
+{
+    if (parserPtr->fieldIndex > 0)
+    {
+        parserPtr->formatPtr->lineEndFunc(parserPtr);
+    }
+
+    parserPtr->lineNum++;
+    parserPtr->fieldIndex = 0;
+    parserPtr->lineFlags = 0;
+    parserPtr->lineValue = 0;
+    memset(&parserPtr->tm, 0, sizeof(parserPtr->tm));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Initialize the parsing of a command's output of the given format
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncParse_Init
+(
+    clkSyncParse_Parser_t* parserPtr,           ///< [OUT] Parser to initialize
+    const clkSyncParse_Format_t* formatPtr      ///< [IN]  Format of the output
+)
+{
+    memset(parserPtr, 0, sizeof(*parserPtr));
+    parserPtr->formatPtr = formatPtr;
+    parserPtr->lineNum = 1;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Parse the next bytes of a command's output, as read from it in any number of chunks. Bytes fed
+ * once the value was found are ignored.
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncParse_Feed
+(
+    clkSyncParse_Parser_t* parserPtr,           ///< [IN] Parser in progress
+    const char* dataPtr,                        ///< [IN] Bytes read
+    size_t len                                  ///< [IN] Number of bytes read
+)
+{
+    size_t i;
+
+    // Without a format the output is only drained
+    if (!parserPtr->formatPtr)
+    {
+        return;
+    }
+
+    for (i = 0; (i < len) && (!parserPtr->isDone); i++)
+    {
+        char c = dataPtr[i];
+
+        if ('\n' == c)
+        {
+            EndField(parserPtr);
+            EndLine(parserPtr);
+        }
+        else if (IsSeparator(parserPtr->formatPtr, c))
+        {
+            EndField(parserPtr);
+        }
+        else if ('\r' != c)
+        {
+            AddToField(parserPtr, c);
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Complete the parsing at the end of the output, the last line possibly not terminated
+ *
+ * @return
+ *      - LE_OK             The value of the format was found
+ *      - LE_NOT_FOUND      The value wasn't found; the first field which failed to parse, if any,
+ *                          is described in the parser's error
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncParse_Finish
+(
+    clkSyncParse_Parser_t* parserPtr            ///< [IN] Parser in progress
+)
+{
+    if (parserPtr->formatPtr && (!parserPtr->isDone))
+    {
+        EndField(parserPtr);
+        EndLine(parserPtr);
+    }
+    return parserPtr->isDone ? LE_OK : LE_NOT_FOUND;
+}
+
+#endif // PA_CLKSYNC_WITH_COMMANDS
@@ -0,0 +1,140 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file clkSyncParse.h
+ *
+ * Streaming parser of the output of the time commands run by the Linux Clock Service Adapter
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef CLKSYNC_PARSE_H_INCLUDE_GUARD
+#define CLKSYNC_PARSE_H_INCLUDE_GUARD
+
+#include "legato.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Size of the field being parsed; longer fields are rejected rather than truncated
+ */
+//--------------------------------------------------------------------------------------------------
+#define CLKSYNC_PARSE_FIELD_BYTES   64
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Size of the description of the first parse failure
+ */
+//--------------------------------------------------------------------------------------------------
+#define CLKSYNC_PARSE_ERROR_BYTES   128
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Output format of a command, defined by the parser
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct clkSyncParse_Format clkSyncParse_Format_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Output format of "rdate -p": the server time as "Wed Oct 14 04:42:30 2026" in local time
+ */
+//--------------------------------------------------------------------------------------------------
+extern const clkSyncParse_Format_t clkSyncParse_Rdate;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Output format of "ntpdate -q": the offset of the system clock from the server as
+ * "14 Oct 04:42:30 ntpdate[293]: adjust time server 10.1.1.1 offset -0.000292 sec"
+ */
+//--------------------------------------------------------------------------------------------------
+extern const clkSyncParse_Format_t clkSyncParse_Ntpdate;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Output format of "chronyd -Q": the offset of the system clock from the servers as
+ * "2026-10-14T04:42:30Z System clock wrong by 0.000292 seconds (ignored)"
+ */
+//--------------------------------------------------------------------------------------------------
+extern const clkSyncParse_Format_t clkSyncParse_Chronyd;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Output format of "chronyc -c tracking": the tracking of the running chronyd, whose system time
+ * field is the offset it is still correcting; the output is rejected if chronyd doesn't keep the
+ * system clock synchronized
+ */
+//--------------------------------------------------------------------------------------------------
+extern const clkSyncParse_Format_t clkSyncParse_ChronycTracking;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * State of the parsing of a command's output. The output is split into whitespace separated
+ * fields, or fields separated by the format's separator, as it is fed, and only the field in
+ * progress is kept, so that the memory used doesn't depend on the length of the lines or of the
+ * output.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    const clkSyncParse_Format_t* formatPtr;     ///< Format parsed, NULL if none
+    size_t lineNum;                             ///< Number of the line in progress, from 1
+    size_t fieldIndex;                          ///< Index of the field in progress in its line
+    size_t fieldLen;                            ///< Length of the field in progress, even if
+                                                ///< longer than the buffer
+    char field[CLKSYNC_PARSE_FIELD_BYTES];      ///< Field in progress
+    uint32_t lineFlags;                         ///< Format specific state of the line
+    int64_t lineValue;                          ///< Format specific value found on the line
+    struct tm tm;                               ///< Broken down time found on the line
+    bool isDone;                                ///< Whether the value was found
+    bool hasOffset;                             ///< Whether offsetNs was found
+    int64_t offsetNs;                           ///< Offset of the system clock from the server
+    char error[CLKSYNC_PARSE_ERROR_BYTES];      ///< First parse failure, empty if none
+}
+clkSyncParse_Parser_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Initialize the parsing of a command's output of the given format
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncParse_Init
+(
+    clkSyncParse_Parser_t* parserPtr,           ///< [OUT] Parser to initialize
+    const clkSyncParse_Format_t* formatPtr      ///< [IN]  Format of the output, NULL to only drain
+                                                ///<       an output which isn't looked at
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Parse the next bytes of a command's output, as read from it in any number of chunks. Bytes fed
+ * once the value was found are ignored.
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncParse_Feed
+(
+    clkSyncParse_Parser_t* parserPtr,           ///< [IN] Parser in progress
+    const char* dataPtr,                        ///< [IN] Bytes read
+    size_t len                                  ///< [IN] Number of bytes read
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Complete the parsing at the end of the output, the last line possibly not terminated
+ *
+ * @return
+ *      - LE_OK             The value of the format was found
+ *      - LE_NOT_FOUND      The value wasn't found; the first field which failed to parse, if any,
+ *                          is described in the parser's error
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncParse_Finish
+(
+    clkSyncParse_Parser_t* parserPtr            ///< [IN] Parser in progress
+);
+
+#endif // CLKSYNC_PARSE_H_INCLUDE_GUARD
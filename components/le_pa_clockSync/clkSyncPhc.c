@@ -0,0 +1,328 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file clkSyncPhc.c
+ *
+ * Reader of the local reference clocks of the Linux Clock Service Adapter, for the gateways whose
+ * time comes from the LAN rather than from a time server: the PTP hardware clock of a network
+ * interface synchronized by a PTP (IEEE 1588) daemon such as ptp4l, or a PPS source such as a
+ * GNSS receiver's pulse. Either is read locally, without any network exchange per query.
+ *
+ * The offset of a hardware clock is measured with the most precise method its driver supports: a
+ * cross timestamp taken by the hardware, else the system clock read right before and after the
+ * hardware clock several times, the tightest reading being kept, else the same done from user
+ * space through the dynamic POSIX clock of the device.
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include <sys/ioctl.h>
+#include <linux/ptp_clock.h>
+#include <linux/pps.h>
+#include "pa_clkSync_linux.h"
+#include "clkSyncLocal.h"
+#include "clkSyncPhc.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Number of readings of a hardware clock the tightest one is kept of
+ */
+//--------------------------------------------------------------------------------------------------
+#define PHC_SAMPLE_COUNT            5
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Longest wait for a pulse of a PPS source, slightly over the period of its pulses
+ */
+//--------------------------------------------------------------------------------------------------
+#define PPS_WAIT_MS                 1500
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Dynamic POSIX clock of an open PTP hardware clock device
+ */
+//--------------------------------------------------------------------------------------------------
+#define FD_TO_CLOCKID(fd)           ((~(clockid_t)(fd) << 3) | 3)
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Offset of the timescale of the PTP hardware clocks from UTC
+ */
+//--------------------------------------------------------------------------------------------------
+static int32_t UtcOffsetSec = PA_CLKSYNC_PTP_UTC_OFFSET_DEFAULT;
+
+
+#if defined(PTP_SYS_OFFSET_PRECISE) || defined(PTP_SYS_OFFSET_EXTENDED)
+//--------------------------------------------------------------------------------------------------
+/**
+ * Convert a PTP clock time to nanoseconds
+ *
+ * @return
+ *      The time in nanoseconds
+ */
+//--------------------------------------------------------------------------------------------------
+static int64_t PtpTimeToNs
+(
+    const struct ptp_clock_time* timePtr        ///< [IN] PTP clock time
+)
+{
+    return ((int64_t)timePtr->sec * CLKSYNC_NS_PER_SEC) + timePtr->nsec;
+}
+#endif
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Record a reading of a hardware clock between two readings of the system clock into a sample,
+ * unless a tighter one is already recorded
+ */
+//--------------------------------------------------------------------------------------------------
+static void KeepTightestReading
+(
+    int64_t beforeNs,                           ///< [IN]     System clock before the reading
+    int64_t phcNs,                              ///< [IN]     Hardware clock
+    int64_t afterNs,                            ///< [IN]     System clock after the reading
+    clkSync_Sample_t* samplePtr                 ///< [IN/OUT] Tightest reading so far, delayNs
+                                                ///<          being -1 if none
+)
+{
+    int64_t windowNs = afterNs - beforeNs;
+
+    if ((windowNs < 0) || ((samplePtr->delayNs >= 0) && (windowNs >= samplePtr->delayNs)))
+    {
+        return;
+    }
+
+    samplePtr->localTimeNs = beforeNs + windowNs / 2;
+    samplePtr->offsetNs = phcNs - samplePtr->localTimeNs;
+    samplePtr->delayNs = windowNs;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Measure the offset of a PTP hardware clock from the system clock, in the timescale of the
+ * hardware clock
+ *
+ * @return
+ *      - LE_OK             Offset measured
+ *      - LE_FAULT          Failed to read the hardware clock
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ReadPhc
+(
+    int fd,                                     ///< [IN]  PTP hardware clock device
+    clkSync_Sample_t* samplePtr                 ///< [OUT] Offset measured
+)
+{
+#ifdef PTP_SYS_OFFSET_PRECISE
+    struct ptp_sys_offset_precise precise;
+#endif
+#ifdef PTP_SYS_OFFSET_EXTENDED
+    struct ptp_sys_offset_extended extended;
+#endif
+    struct timespec before, phc, after;
+    unsigned int i;
+
+    samplePtr->delayNs = -1;
+
+    // Both ioctls are missing from older kernel headers, the readings then made from user space
+#ifdef PTP_SYS_OFFSET_PRECISE
+    memset(&precise, 0, sizeof(precise));
+    if (0 == ioctl(fd, PTP_SYS_OFFSET_PRECISE, &precise))
+    {
+        samplePtr->localTimeNs = PtpTimeToNs(&precise.sys_realtime);
+        samplePtr->offsetNs = PtpTimeToNs(&precise.device) - samplePtr->localTimeNs;
+        samplePtr->delayNs = 0;
+        return LE_OK;
+    }
+#endif
+
+#ifdef PTP_SYS_OFFSET_EXTENDED
+    memset(&extended, 0, sizeof(extended));
+    extended.n_samples = PHC_SAMPLE_COUNT;
+    if (0 == ioctl(fd, PTP_SYS_OFFSET_EXTENDED, &extended))
+    {
+        for (i = 0; i < extended.n_samples; i++)
+        {
+            KeepTightestReading(PtpTimeToNs(&extended.ts[i][0]), PtpTimeToNs(&extended.ts[i][1]),
+                                PtpTimeToNs(&extended.ts[i][2]), samplePtr);
+        }
+        return (samplePtr->delayNs >= 0) ? LE_OK : LE_FAULT;
+    }
+#endif
+
+    // Drivers without system timestamps are read from user space, with the context switches
+    for (i = 0; i < PHC_SAMPLE_COUNT; i++)
+    {
+        if ((0 != clock_gettime(CLOCK_REALTIME, &before)) ||
+            (0 != clock_gettime(FD_TO_CLOCKID(fd), &phc)) ||
+            (0 != clock_gettime(CLOCK_REALTIME, &after)))
+        {
+            LE_ERROR("Failed to read PTP hardware clock (%m)");
+            return LE_FAULT;
+        }
+        KeepTightestReading(clkSync_TimespecToNs(&before), clkSync_TimespecToNs(&phc),
+                            clkSync_TimespecToNs(&after), samplePtr);
+    }
+    return (samplePtr->delayNs >= 0) ? LE_OK : LE_FAULT;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Wait for the next pulse of a PPS source and measure the offset of the system clock from the
+ * start of the second it marks
+ *
+ * @return
+ *      - LE_OK             Offset measured
+ *      - LE_UNSUPPORTED    The source captures no edge of its pulses
+ *      - LE_TIMEOUT        No pulse received before the deadline
+ *      - LE_FAULT          Failed to read the source
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ReadPps
+(
+    int fd,                                     ///< [IN]  PPS source device
+    int64_t deadlineNs,                         ///< [IN]  CLOCK_MONOTONIC time to give up at,
+                                                ///<       INT64_MAX if none
+    clkSync_Sample_t* samplePtr                 ///< [OUT] Offset measured
+)
+{
+    struct pps_kparams params;
+    struct pps_fdata fdata;
+    const struct pps_ktime* pulsePtr;
+    int64_t waitNs = (int64_t)PPS_WAIT_MS * CLKSYNC_NS_PER_MSEC;
+    int64_t remainingNs;
+    int64_t fractionNs;
+
+    memset(&params, 0, sizeof(params));
+    if (0 != ioctl(fd, PPS_GETPARAMS, &params))
+    {
+        LE_ERROR("Failed to get PPS source parameters (%m)");
+        return LE_FAULT;
+    }
+    if (!(params.mode & PPS_CAPTUREBOTH))
+    {
+        LE_ERROR("PPS source captures no edge");
+        return LE_UNSUPPORTED;
+    }
+
+    if (INT64_MAX != deadlineNs)
+    {
+        remainingNs = deadlineNs - clkSync_GetClockNs(CLOCK_MONOTONIC);
+        if (remainingNs <= 0)
+        {
+            return LE_TIMEOUT;
+        }
+        if (remainingNs < waitNs)
+        {
+            waitNs = remainingNs;
+        }
+    }
+
+    // The kernel returns on the next pulse, so that the time of the pulse is always fresh
+    memset(&fdata, 0, sizeof(fdata));
+    fdata.timeout.sec = waitNs / CLKSYNC_NS_PER_SEC;
+    fdata.timeout.nsec = (int32_t)(waitNs % CLKSYNC_NS_PER_SEC);
+    if (0 != ioctl(fd, PPS_FETCH, &fdata))
+    {
+        if (ETIMEDOUT == errno)
+        {
+            LE_WARN("No pulse from PPS source");
+            return LE_TIMEOUT;
+        }
+        LE_ERROR("Failed to fetch PPS pulse (%m)");
+        return LE_FAULT;
+    }
+
+    pulsePtr = (params.mode & PPS_CAPTUREASSERT) ? &fdata.info.assert_tu : &fdata.info.clear_tu;
+    samplePtr->localTimeNs = (pulsePtr->sec * CLKSYNC_NS_PER_SEC) + pulsePtr->nsec;
+
+    // The pulse is taken as the start of the second nearest to the system clock
+    fractionNs = pulsePtr->nsec;
+    samplePtr->offsetNs = (fractionNs < CLKSYNC_NS_PER_SEC / 2) ?
+                          -fractionNs : (CLKSYNC_NS_PER_SEC - fractionNs);
+    samplePtr->delayNs = 0;
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Measure the offset of the given PTP hardware clock or PPS source from the system clock. A PPS
+ * source only marks the start of each second, so it only corrects a system clock already within
+ * half a second of the time.
+ *
+ * @return
+ *      - LE_OK             Offset measured
+ *      - LE_NOT_FOUND      No such device
+ *      - LE_UNSUPPORTED    The device is neither a PTP hardware clock nor a PPS source
+ *      - LE_TIMEOUT        No pulse received from the PPS source before the deadline
+ *      - LE_FAULT          Failed to read the device
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncPhc_Query
+(
+    const char* devicePtr,                      ///< [IN]  Device, e.g. /dev/ptp0 or /dev/pps0
+    int64_t deadlineNs,                         ///< [IN]  CLOCK_MONOTONIC time to give up at,
+                                                ///<       INT64_MAX if none
+    clkSync_Sample_t* samplePtr                 ///< [OUT] Offset measured
+)
+{
+    struct ptp_clock_caps caps;
+    le_result_t result;
+    int ppsCaps;
+    int fd;
+
+    memset(samplePtr, 0, sizeof(clkSync_Sample_t));
+
+    // Read access is enough for the hardware clock, as it is only read
+    fd = open(devicePtr, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        LE_ERROR("Failed to open %s (%m)", devicePtr);
+        return (ENOENT == errno) ? LE_NOT_FOUND : LE_FAULT;
+    }
+
+    memset(&caps, 0, sizeof(caps));
+    if (0 == ioctl(fd, PTP_CLOCK_GETCAPS, &caps))
+    {
+        result = ReadPhc(fd, samplePtr);
+        samplePtr->offsetNs -= (int64_t)UtcOffsetSec * CLKSYNC_NS_PER_SEC;
+    }
+    else if (0 == ioctl(fd, PPS_GETCAP, &ppsCaps))
+    {
+        result = ReadPps(fd, deadlineNs, samplePtr);
+    }
+    else
+    {
+        LE_ERROR("%s is neither a PTP hardware clock nor a PPS source", devicePtr);
+        result = LE_UNSUPPORTED;
+    }
+    close(fd);
+
+    samplePtr->rootDistanceNs = samplePtr->delayNs / 2;
+    if (LE_OK == result)
+    {
+        LE_DEBUG("Offset of %s: %" PRId64 " ns, read within %" PRId64 " ns", devicePtr,
+                 samplePtr->offsetNs, samplePtr->delayNs);
+    }
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the offset of the timescale of the PTP hardware clocks from UTC, e.g. 37 s for the TAI
+ * timescale of PTP, or 0 for a hardware clock kept at UTC
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncPhc_SetUtcOffset
+(
+    int32_t offsetSec                           ///< [IN] Offset of the hardware clocks from UTC
+)
+{
+    UtcOffsetSec = offsetSec;
+}
@@ -0,0 +1,51 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file clkSyncPhc.h
+ *
+ * Reader of the local reference clocks of the Linux Clock Service Adapter: PTP hardware clocks
+ * and PPS sources
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef CLKSYNC_PHC_H_INCLUDE_GUARD
+#define CLKSYNC_PHC_H_INCLUDE_GUARD
+
+#include "legato.h"
+#include "clkSyncLocal.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Measure the offset of the given PTP hardware clock or PPS source from the system clock. A PPS
+ * source only marks the start of each second, so it only corrects a system clock already within
+ * half a second of the time.
+ *
+ * @return
+ *      - LE_OK             Offset measured
+ *      - LE_NOT_FOUND      No such device
+ *      - LE_UNSUPPORTED    The device is neither a PTP hardware clock nor a PPS source
+ *      - LE_TIMEOUT        No pulse received from the PPS source before the deadline
+ *      - LE_FAULT          Failed to read the device
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncPhc_Query
+(
+    const char* devicePtr,                      ///< [IN]  Device, e.g. /dev/ptp0 or /dev/pps0
+    int64_t deadlineNs,                         ///< [IN]  CLOCK_MONOTONIC time to give up at,
+                                                ///<       INT64_MAX if none
+    clkSync_Sample_t* samplePtr                 ///< [OUT] Offset measured
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the offset of the timescale of the PTP hardware clocks from UTC, e.g. 37 s for the TAI
+ * timescale of PTP, or 0 for a hardware clock kept at UTC
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncPhc_SetUtcOffset
+(
+    int32_t offsetSec                           ///< [IN] Offset of the hardware clocks from UTC
+);
+
+#endif // CLKSYNC_PHC_H_INCLUDE_GUARD
@@ -0,0 +1,460 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file clkSyncRace.c
+ *
+ * Racing of a native client's queries across all the addresses of a time server, in the manner
+ * of RFC 8305 "happy eyeballs": rather than failing after a full timeout when the first address
+ * is unreachable, the next address is tried after a short delay while the previous attempts are
+ * still waited for, and the first valid reply wins.
+ *
+ * The race is a state machine advanced by clkSyncRace_Process(), so that it can be driven either
+ * by the blocking poll() loop in clkSyncRace_Run() or by an event loop.
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include <netdb.h>
+#include "clkSyncLocal.h"
+#include "clkSyncRace.h"
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Close an attempt's socket, once whoever watches it is told
+ */
+//--------------------------------------------------------------------------------------------------
+static void CloseAttempt
+(
+    const clkSync_Race_t* racePtr,      ///< [IN] Race of the attempt
+    clkSync_Attempt_t* attemptPtr       ///< [IN] Attempt to close
+)
+{
+    const clkSync_Client_t* clientPtr = racePtr->clientPtr;
+
+    if (attemptPtr->fd >= 0)
+    {
+        if (racePtr->closeHandlerFunc)
+        {
+            racePtr->closeHandlerFunc((size_t)(attemptPtr - racePtr->attempts),
+                                      racePtr->closeContextPtr);
+        }
+        if (clientPtr->closeFunc)
+        {
+            clientPtr->closeFunc(attemptPtr->fd);
+        }
+        else
+        {
+            close(attemptPtr->fd);
+        }
+        attemptPtr->fd = -1;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Find the attempt owning the given socket
+ *
+ * @return
+ *      The attempt's index, or CLKSYNC_MAX_ADDRS if not found
+ */
+//--------------------------------------------------------------------------------------------------
+static size_t FindAttempt
+(
+    const clkSync_Race_t* racePtr,      ///< [IN] Race in progress
+    int fd                              ///< [IN] Socket
+)
+{
+    size_t i;
+
+    for (i = 0; i < racePtr->nextIndex; i++)
+    {
+        if (racePtr->attempts[i].fd == fd)
+        {
+            return i;
+        }
+    }
+    return CLKSYNC_MAX_ADDRS;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Take the best sample of the attempt which received any, for a client sending several queries
+ * per attempt when the race is abandoned before the attempt completes
+ *
+ * @return
+ *      true if a sample was taken
+ */
+//--------------------------------------------------------------------------------------------------
+static bool TakeBestSample
+(
+    clkSync_Race_t* racePtr,            ///< [IN]  Race in progress
+    clkSync_Attempt_t* attemptPtr,      ///< [IN]  Attempt to take the sample of, NULL for any
+    clkSync_Sample_t* samplePtr         ///< [OUT] Sample taken
+)
+{
+    size_t i;
+
+    for (i = 0; i < racePtr->nextIndex; i++)
+    {
+        const clkSync_Attempt_t* candidatePtr = &racePtr->attempts[i];
+
+        if ((candidatePtr->sampleCount > 0) && (!attemptPtr || (attemptPtr == candidatePtr)))
+        {
+            LE_DEBUG("%s attempt on %s abandoned after %" PRIu32 " samples",
+                     racePtr->clientPtr->namePtr, racePtr->list.addrs[i],
+                     candidatePtr->sampleCount);
+            *samplePtr = candidatePtr->bestSample;
+            samplePtr->addrIndex = i;
+            clkSyncRace_Abort(racePtr);
+            return true;
+        }
+    }
+    return false;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Open a non-blocking socket of the given type toward a numeric address and port. Datagram
+ * sockets are connected so that the kernel drops datagrams from any other peer; stream sockets
+ * have their connection started.
+ *
+ * @return
+ *      - The socket on success
+ *      - -1 on failure
+ */
+//--------------------------------------------------------------------------------------------------
+int clkSyncRace_OpenSocket
+(
+    const char* addrStr,                        ///< [IN] Numeric IPv4/v6 address
+    const char* portStr,                        ///< [IN] Numeric port
+    int sockType                                ///< [IN] SOCK_DGRAM or SOCK_STREAM
+)
+{
+    int rc, sockFd;
+    struct addrinfo *resultPtr;
+    struct addrinfo hints = {0};
+
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = sockType;
+    hints.ai_flags = AI_NUMERICHOST | AI_NUMERICSERV;
+    rc = getaddrinfo(addrStr, portStr, &hints, &resultPtr);
+    if (rc)
+    {
+        LE_ERROR("Invalid server address %s: %s", addrStr, gai_strerror(rc));
+        return -1;
+    }
+
+    sockFd = socket(resultPtr->ai_family, sockType | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (sockFd < 0)
+    {
+        LE_ERROR("Failed to create socket (%m)");
+        freeaddrinfo(resultPtr);
+        return -1;
+    }
+
+    rc = connect(sockFd, resultPtr->ai_addr, resultPtr->ai_addrlen);
+    freeaddrinfo(resultPtr);
+    if (rc && (EINPROGRESS != errno))
+    {
+        LE_WARN("Failed to connect socket to %s (%m)", addrStr);
+        close(sockFd);
+        return -1;
+    }
+    return sockFd;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Initialize a race of the given client across the given addresses
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncRace_Init
+(
+    clkSync_Race_t* racePtr,                    ///< [OUT] Race to initialize
+    const clkSync_Client_t* clientPtr,          ///< [IN]  Client to run
+    const clkSync_AddrList_t* listPtr,          ///< [IN]  Addresses to query
+    uint32_t timeoutMs                          ///< [IN]  Time given to each attempt
+)
+{
+    size_t i;
+
+    memset(racePtr, 0, sizeof(*racePtr));
+    racePtr->clientPtr = clientPtr;
+    racePtr->list = *listPtr;
+    racePtr->timeoutMs = timeoutMs;
+    racePtr->nextStartNs = clkSync_GetClockNs(CLOCK_MONOTONIC);
+    racePtr->deadlineNs = INT64_MAX;
+    for (i = 0; i < CLKSYNC_MAX_ADDRS; i++)
+    {
+        racePtr->attempts[i].fd = -1;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Bound the whole duration of a race, whatever the number of addresses left to try
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncRace_SetDeadline
+(
+    clkSync_Race_t* racePtr,                    ///< [IN] Race to bound
+    int64_t deadlineNs                          ///< [IN] CLOCK_MONOTONIC time to abandon it at
+)
+{
+    racePtr->deadlineNs = deadlineNs;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the handler called right before the socket of any of the race's attempts is closed
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncRace_SetCloseHandler
+(
+    clkSync_Race_t* racePtr,                    ///< [IN] Race
+    clkSync_CloseHandlerFunc_t handlerFunc,     ///< [IN] Handler, NULL for none
+    void* contextPtr                            ///< [IN] Context given to the handler
+)
+{
+    racePtr->closeHandlerFunc = handlerFunc;
+    racePtr->closeContextPtr = contextPtr;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Advance the race: handle the events returned by poll() on the descriptors previously given by
+ * clkSyncRace_GetPollFds(), abandon the attempts past their deadline and start the attempts due.
+ *
+ * @return
+ *      - LE_IN_PROGRESS    The race goes on
+ *      - LE_OK             A valid sample was received
+ *      - LE_UNAVAILABLE    All the attempts failed or timed out
+ *      - LE_TIMEOUT        The deadline of the race expired
+ *      - LE_FAULT          No attempt could be started
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncRace_Process
+(
+    clkSync_Race_t* racePtr,                    ///< [IN]  Race to advance
+    const struct pollfd* pfdsPtr,               ///< [IN]  Descriptors polled, may be NULL
+    size_t pfdCount,                            ///< [IN]  Number of descriptors polled
+    clkSync_Sample_t* samplePtr                 ///< [OUT] Winning sample
+)
+{
+    const clkSync_Client_t* clientPtr = racePtr->clientPtr;
+    int64_t nowNs = clkSync_GetClockNs(CLOCK_MONOTONIC);
+    bool anyOpen = false;
+    size_t i;
+
+    for (i = 0; i < pfdCount; i++)
+    {
+        size_t index;
+        le_result_t result;
+
+        if (!pfdsPtr[i].revents)
+        {
+            continue;
+        }
+
+        index = FindAttempt(racePtr, pfdsPtr[i].fd);
+        if (index >= CLKSYNC_MAX_ADDRS)
+        {
+            continue;
+        }
+
+        result = clientPtr->handleFunc(&racePtr->attempts[index], pfdsPtr[i].revents,
+                                       racePtr->timeoutMs, samplePtr);
+        if (LE_OK == result)
+        {
+            samplePtr->addrIndex = index;
+            clkSyncRace_Abort(racePtr);
+            return LE_OK;
+        }
+        if (LE_IN_PROGRESS != result)
+        {
+            // Move on to the next address without waiting for the stagger delay
+            LE_DEBUG("%s attempt on %s failed: %s", clientPtr->namePtr,
+                     racePtr->list.addrs[index], LE_RESULT_TXT(result));
+            CloseAttempt(racePtr, &racePtr->attempts[index]);
+            racePtr->nextStartNs = nowNs;
+        }
+    }
+
+    if (nowNs >= racePtr->deadlineNs)
+    {
+        if (TakeBestSample(racePtr, NULL, samplePtr))
+        {
+            return LE_OK;
+        }
+        LE_WARN("No reply from %s server %s before the deadline", clientPtr->namePtr,
+                racePtr->list.addrs[0]);
+        clkSyncRace_Abort(racePtr);
+        return LE_TIMEOUT;
+    }
+
+    for (i = 0; i < racePtr->nextIndex; i++)
+    {
+        clkSync_Attempt_t* attemptPtr = &racePtr->attempts[i];
+
+        if ((attemptPtr->fd >= 0) && (nowNs >= attemptPtr->deadlineNs))
+        {
+            if (TakeBestSample(racePtr, attemptPtr, samplePtr))
+            {
+                return LE_OK;
+            }
+            LE_WARN("No reply from %s server %s within %u ms", clientPtr->namePtr,
+                    racePtr->list.addrs[i], racePtr->timeoutMs);
+            CloseAttempt(racePtr, attemptPtr);
+        }
+        anyOpen = anyOpen || (attemptPtr->fd >= 0);
+    }
+
+    while ((racePtr->nextIndex < racePtr->list.count) && (nowNs >= racePtr->nextStartNs))
+    {
+        clkSync_Attempt_t* attemptPtr = &racePtr->attempts[racePtr->nextIndex];
+        const char* addrStr = racePtr->list.addrs[racePtr->nextIndex];
+
+        racePtr->nextIndex++;
+        attemptPtr->deadlineNs = nowNs + (int64_t)racePtr->timeoutMs * CLKSYNC_NS_PER_MSEC;
+        if (LE_OK == clientPtr->openFunc(addrStr, attemptPtr))
+        {
+            LE_DEBUG("%s query sent to %s", clientPtr->namePtr, addrStr);
+            racePtr->anyStarted = true;
+            racePtr->nextStartNs = nowNs + (int64_t)CLKSYNC_ADDR_STAGGER_MS * CLKSYNC_NS_PER_MSEC;
+            anyOpen = true;
+        }
+        else
+        {
+            CloseAttempt(racePtr, attemptPtr);
+        }
+    }
+
+    if (anyOpen || (racePtr->nextIndex < racePtr->list.count))
+    {
+        return LE_IN_PROGRESS;
+    }
+    return racePtr->anyStarted ? LE_UNAVAILABLE : LE_FAULT;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the descriptors to poll for the race to go on, and the time at which it has to be advanced
+ * even if no event is received
+ *
+ * @return
+ *      Number of descriptors returned, at most CLKSYNC_MAX_ADDRS
+ */
+//--------------------------------------------------------------------------------------------------
+size_t clkSyncRace_GetPollFds
+(
+    const clkSync_Race_t* racePtr,              ///< [IN]  Race in progress
+    struct pollfd* pfdsPtr,                     ///< [OUT] Descriptors to poll
+    int64_t* wakeNsPtr                          ///< [OUT] CLOCK_MONOTONIC time to advance at
+)
+{
+    size_t i, count = 0;
+    int64_t wakeNs = INT64_MAX;
+
+    if (racePtr->nextIndex < racePtr->list.count)
+    {
+        wakeNs = racePtr->nextStartNs;
+    }
+
+    for (i = 0; i < racePtr->nextIndex; i++)
+    {
+        const clkSync_Attempt_t* attemptPtr = &racePtr->attempts[i];
+
+        if (attemptPtr->fd < 0)
+        {
+            continue;
+        }
+        pfdsPtr[count].fd = attemptPtr->fd;
+        pfdsPtr[count].events = attemptPtr->events;
+        pfdsPtr[count].revents = 0;
+        count++;
+        if (attemptPtr->deadlineNs < wakeNs)
+        {
+            wakeNs = attemptPtr->deadlineNs;
+        }
+    }
+
+    *wakeNsPtr = (racePtr->deadlineNs < wakeNs) ? racePtr->deadlineNs : wakeNs;
+    return count;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Close all the attempts of a race
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncRace_Abort
+(
+    clkSync_Race_t* racePtr                     ///< [IN] Race to abort
+)
+{
+    size_t i;
+
+    for (i = 0; i < CLKSYNC_MAX_ADDRS; i++)
+    {
+        CloseAttempt(racePtr, &racePtr->attempts[i]);
+    }
+    racePtr->nextIndex = racePtr->list.count;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Run a race to completion, blocking the calling thread
+ *
+ * @return
+ *      - LE_OK             A valid sample was received
+ *      - LE_UNAVAILABLE    All the attempts failed or timed out
+ *      - LE_TIMEOUT        The deadline of the race expired
+ *      - LE_FAULT          No attempt could be started
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncRace_Run
+(
+    clkSync_Race_t* racePtr,                    ///< [IN]  Race to run
+    clkSync_Sample_t* samplePtr                 ///< [OUT] Winning sample
+)
+{
+    struct pollfd pfds[CLKSYNC_MAX_ADDRS];
+    size_t count = 0;
+    le_result_t result;
+
+    result = clkSyncRace_Process(racePtr, NULL, 0, samplePtr);
+    while (LE_IN_PROGRESS == result)
+    {
+        int64_t wakeNs, waitNs;
+        int rc;
+
+        count = clkSyncRace_GetPollFds(racePtr, pfds, &wakeNs);
+        waitNs = wakeNs - clkSync_GetClockNs(CLOCK_MONOTONIC);
+        if (waitNs < 0)
+        {
+            waitNs = 0;
+        }
+
+        rc = poll(pfds, count, (int)((waitNs + CLKSYNC_NS_PER_MSEC - 1) / CLKSYNC_NS_PER_MSEC));
+        if ((rc < 0) && (EINTR != errno))
+        {
+            LE_ERROR("Failed to wait for %s replies (%m)", racePtr->clientPtr->namePtr);
+            clkSyncRace_Abort(racePtr);
+            return LE_FAULT;
+        }
+
+        result = clkSyncRace_Process(racePtr, pfds, (rc > 0) ? count : 0, samplePtr);
+    }
+    return result;
+}
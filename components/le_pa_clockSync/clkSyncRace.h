@@ -0,0 +1,233 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file clkSyncRace.h
+ *
+ * Racing of a native client's queries across all the addresses of a time server, for the Linux
+ * Clock Service Adapter
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef CLKSYNC_RACE_H_INCLUDE_GUARD
+#define CLKSYNC_RACE_H_INCLUDE_GUARD
+
+#include "legato.h"
+#include <poll.h>
+#include "clkSyncLocal.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Size of the protocol specific buffer of an attempt
+ */
+//--------------------------------------------------------------------------------------------------
+#define CLKSYNC_ATTEMPT_BUF_BYTES   48
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Query of one address of a time server
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    int fd;                                 ///< Socket of the attempt, -1 when not open
+    short events;                           ///< poll() events waited for on the socket
+    int64_t deadlineNs;                     ///< CLOCK_MONOTONIC time at which it is abandoned
+    int64_t t1;                             ///< CLOCK_REALTIME at which the query was sent
+    size_t len;                             ///< Number of bytes used in buf
+    uint8_t buf[CLKSYNC_ATTEMPT_BUF_BYTES]; ///< Protocol specific data, e.g. the request sent
+    uint32_t sampleCount;                   ///< Number of valid samples received so far by a
+                                            ///< client sending several queries in the attempt
+    clkSync_Sample_t bestSample;            ///< Best of those samples, winning if the attempt
+                                            ///< is abandoned before it completes
+}
+clkSync_Attempt_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Native client of a time protocol, as run by the race
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    const char* namePtr;                    ///< Protocol name used in logs
+
+    /// Open the attempt's socket toward the given address and send the query, setting the events
+    /// to wait for. Returns LE_OK when the attempt is started.
+    le_result_t (*openFunc)(const char* addrStr, clkSync_Attempt_t* attemptPtr);
+
+    /// Handle the events received on the attempt's socket. Returns LE_OK when a valid sample is
+    /// decoded, LE_IN_PROGRESS when more events are awaited, or the reason the attempt failed.
+    le_result_t (*handleFunc)(clkSync_Attempt_t* attemptPtr, short revents, uint32_t timeoutMs,
+                              clkSync_Sample_t* samplePtr);
+
+    /// Close the socket of an attempt, e.g. giving it back to a pool; NULL if close() is enough
+    void (*closeFunc)(int fd);
+}
+clkSync_Client_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handler called right before the socket of a race's attempt is closed, for whoever watches the
+ * socket to stop watching it before its number can be reused
+ */
+//--------------------------------------------------------------------------------------------------
+typedef void (*clkSync_CloseHandlerFunc_t)
+(
+    size_t index,                           ///< [IN] Index of the attempt
+    void* contextPtr                        ///< [IN] Context given with the handler
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * State of a race across the addresses of a time server. Attempts are started in the order of
+ * the address list, one every CLKSYNC_ADDR_STAGGER_MS or as soon as the previous one fails, and
+ * the first valid sample received wins.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    const clkSync_Client_t* clientPtr;          ///< Client run on each address
+    clkSync_AddrList_t list;                    ///< Addresses to query
+    uint32_t timeoutMs;                         ///< Time given to each attempt
+    size_t nextIndex;                           ///< Index of the next address to start
+    int64_t nextStartNs;                        ///< CLOCK_MONOTONIC time of the next start
+    bool anyStarted;                            ///< Whether any attempt could be started
+    int64_t deadlineNs;                         ///< CLOCK_MONOTONIC time at which the whole race
+                                                ///< is abandoned, INT64_MAX if never
+    clkSync_Attempt_t attempts[CLKSYNC_MAX_ADDRS]; ///< Attempt on each address
+    clkSync_CloseHandlerFunc_t closeHandlerFunc; ///< Called before closing a socket, may be NULL
+    void* closeContextPtr;                      ///< Context given to the close handler
+}
+clkSync_Race_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Open a non-blocking socket of the given type toward a numeric address and port. Datagram
+ * sockets are connected so that the kernel drops datagrams from any other peer; stream sockets
+ * have their connection started.
+ *
+ * @return
+ *      - The socket on success
+ *      - -1 on failure
+ */
+//--------------------------------------------------------------------------------------------------
+int clkSyncRace_OpenSocket
+(
+    const char* addrStr,                        ///< [IN] Numeric IPv4/v6 address
+    const char* portStr,                        ///< [IN] Numeric port
+    int sockType                                ///< [IN] SOCK_DGRAM or SOCK_STREAM
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Initialize a race of the given client across the given addresses
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncRace_Init
+(
+    clkSync_Race_t* racePtr,                    ///< [OUT] Race to initialize
+    const clkSync_Client_t* clientPtr,          ///< [IN]  Client to run
+    const clkSync_AddrList_t* listPtr,          ///< [IN]  Addresses to query
+    uint32_t timeoutMs                          ///< [IN]  Time given to each attempt
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Bound the whole duration of a race, whatever the number of addresses left to try
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncRace_SetDeadline
+(
+    clkSync_Race_t* racePtr,                    ///< [IN] Race to bound
+    int64_t deadlineNs                          ///< [IN] CLOCK_MONOTONIC time to abandon it at
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the handler called right before the socket of any of the race's attempts is closed
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncRace_SetCloseHandler
+(
+    clkSync_Race_t* racePtr,                    ///< [IN] Race
+    clkSync_CloseHandlerFunc_t handlerFunc,     ///< [IN] Handler, NULL for none
+    void* contextPtr                            ///< [IN] Context given to the handler
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Advance the race: handle the events returned by poll() on the descriptors previously given by
+ * clkSyncRace_GetPollFds(), abandon the attempts past their deadline and start the attempts due.
+ *
+ * @return
+ *      - LE_IN_PROGRESS    The race goes on
+ *      - LE_OK             A valid sample was received
+ *      - LE_UNAVAILABLE    All the attempts failed or timed out
+ *      - LE_TIMEOUT        The deadline of the race expired
+ *      - LE_FAULT          No attempt could be started
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncRace_Process
+(
+    clkSync_Race_t* racePtr,                    ///< [IN]  Race to advance
+    const struct pollfd* pfdsPtr,               ///< [IN]  Descriptors polled, may be NULL
+    size_t pfdCount,                            ///< [IN]  Number of descriptors polled
+    clkSync_Sample_t* samplePtr                 ///< [OUT] Winning sample
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the descriptors to poll for the race to go on, and the time at which it has to be advanced
+ * even if no event is received
+ *
+ * @return
+ *      Number of descriptors returned, at most CLKSYNC_MAX_ADDRS
+ */
+//--------------------------------------------------------------------------------------------------
+size_t clkSyncRace_GetPollFds
+(
+    const clkSync_Race_t* racePtr,              ///< [IN]  Race in progress
+    struct pollfd* pfdsPtr,                     ///< [OUT] Descriptors to poll
+    int64_t* wakeNsPtr                          ///< [OUT] CLOCK_MONOTONIC time to advance at
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Close all the attempts of a race
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncRace_Abort
+(
+    clkSync_Race_t* racePtr                     ///< [IN] Race to abort
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Run a race to completion, blocking the calling thread
+ *
+ * @return
+ *      - LE_OK             A valid sample was received
+ *      - LE_UNAVAILABLE    All the attempts failed or timed out
+ *      - LE_TIMEOUT        The deadline of the race expired
+ *      - LE_FAULT          No attempt could be started
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncRace_Run
+(
+    clkSync_Race_t* racePtr,                    ///< [IN]  Race to run
+    clkSync_Sample_t* samplePtr                 ///< [OUT] Winning sample
+);
+
+#endif // CLKSYNC_RACE_H_INCLUDE_GUARD
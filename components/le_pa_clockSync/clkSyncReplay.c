@@ -0,0 +1,545 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file clkSyncReplay.c
+ *
+ * Replay of scripted NTP server replies for the native NTP clients of the Linux Clock Service
+ * Adapter, so that the retrievals, the scheduler, the caches and the burst mode can be load and
+ * regression tested deterministically without any time server.
+ *
+ * The replay is set as the transport of the socket pool: each socket it lends is one end of a
+ * local datagram socket pair, whose other end is read by a thread of the replay. Each request
+ * received takes the next step of the script, which either loses the request or answers it after
+ * the step's delay as a server of the step's offset and stratum would. The clients exchange on
+ * these sockets just as with a server, so everything above the sockets runs unchanged.
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include <sys/eventfd.h>
+#include "pa_clkSync_linux.h"
+#include "clkSyncLocal.h"
+#include "clkSyncSntp.h"
+#include "clkSyncSocket.h"
+#include "clkSyncReplay.h"
+
+// Replay only compiled in when PA_CLKSYNC_WITH_REPLAY is set
+#if PA_CLKSYNC_WITH_REPLAY
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Maximum number of sockets lent at once by the replay
+ */
+//--------------------------------------------------------------------------------------------------
+#define REPLAY_MAX_PEERS            16
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Maximum number of replies waiting for their delay to elapse
+ */
+//--------------------------------------------------------------------------------------------------
+#define REPLAY_MAX_PENDING          32
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Socket pair of a socket lent
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    int clientFd;                           ///< End lent to the client, -1 once given back
+    int serverFd;                           ///< End read by the replay, -1 if the pair is free
+}
+ReplayPeer_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Reply waiting for its delay to elapse
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    bool isUsed;                            ///< Whether a reply is waiting
+    size_t peer;                            ///< Index of the socket pair to send it on
+    int64_t dueNs;                          ///< CLOCK_MONOTONIC time to send it at
+    uint8_t reply[CLKSYNC_SNTP_PACKET_LENGTH];  ///< Reply
+}
+PendingReply_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Script replayed, its number of steps and the step taken by the next request
+ */
+//--------------------------------------------------------------------------------------------------
+static pa_clkSync_ReplayStep_t Script[PA_CLKSYNC_REPLAY_MAX_STEPS];
+static size_t ScriptLength;
+static size_t NextStep;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Socket pairs of the sockets lent, and replies waiting
+ */
+//--------------------------------------------------------------------------------------------------
+static ReplayPeer_t Peers[REPLAY_MAX_PEERS];
+static PendingReply_t Pending[REPLAY_MAX_PENDING];
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Whether the replay runs, and the event waking its thread up when the sockets lent change
+ */
+//--------------------------------------------------------------------------------------------------
+static bool IsRunning;
+static int WakeFd = -1;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Mutex protecting the script, the socket pairs and the replies waiting
+ */
+//--------------------------------------------------------------------------------------------------
+static le_mutex_Ref_t ReplayMutex;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Semaphore posted by the replay's thread once stopped
+ */
+//--------------------------------------------------------------------------------------------------
+static le_sem_Ref_t StoppedSem;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Wake the replay's thread up, the replay's mutex being held
+ */
+//--------------------------------------------------------------------------------------------------
+static void WakeThread
+(
+    void
+)
+{
+    uint64_t count = 1;
+
+    if ((WakeFd >= 0) && (write(WakeFd, &count, sizeof(count)) != sizeof(count)))
+    {
+        LE_DEBUG("Failed to wake replay up (%m)");
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Close the server end of the socket pairs given back, or of all of them, along with their
+ * replies waiting, the replay's mutex being held
+ */
+//--------------------------------------------------------------------------------------------------
+static void ClosePeers
+(
+    bool closeAll                           ///< [IN] Whether to close those still lent too
+)
+{
+    size_t i, j;
+
+    for (i = 0; i < REPLAY_MAX_PEERS; i++)
+    {
+        if ((Peers[i].serverFd < 0) || (!closeAll && (Peers[i].clientFd >= 0)))
+        {
+            continue;
+        }
+
+        // The client end is closed by the client, when it gives it back
+        close(Peers[i].serverFd);
+        Peers[i].serverFd = -1;
+        Peers[i].clientFd = -1;
+        for (j = 0; j < REPLAY_MAX_PENDING; j++)
+        {
+            if (Pending[j].peer == i)
+            {
+                Pending[j].isUsed = false;
+            }
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Send the replies whose delay elapsed, the replay's mutex being held
+ *
+ * @return
+ *      CLOCK_MONOTONIC time the next reply is due at, INT64_MAX if none
+ */
+//--------------------------------------------------------------------------------------------------
+static int64_t SendDueReplies
+(
+    int64_t nowNs                           ///< [IN] Present CLOCK_MONOTONIC time
+)
+{
+    int64_t nextDueNs = INT64_MAX;
+    size_t i;
+
+    for (i = 0; i < REPLAY_MAX_PENDING; i++)
+    {
+        PendingReply_t* pendingPtr = &Pending[i];
+
+        if (!pendingPtr->isUsed)
+        {
+            continue;
+        }
+        if (pendingPtr->dueNs > nowNs)
+        {
+            if (pendingPtr->dueNs < nextDueNs)
+            {
+                nextDueNs = pendingPtr->dueNs;
+            }
+            continue;
+        }
+
+        // A client which gave up on the reply already may have closed its end
+        if (send(Peers[pendingPtr->peer].serverFd, pendingPtr->reply, sizeof(pendingPtr->reply),
+                 MSG_DONTWAIT) < 0)
+        {
+            LE_DEBUG("Failed to send replayed reply (%m)");
+        }
+        pendingPtr->isUsed = false;
+    }
+    return nextDueNs;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Answer the requests received on a socket pair with the next steps of the script, the replay's
+ * mutex being held
+ */
+//--------------------------------------------------------------------------------------------------
+static void AnswerRequests
+(
+    size_t peer                             ///< [IN] Index of the socket pair
+)
+{
+    uint8_t request[CLKSYNC_SNTP_PACKET_LENGTH * 2];
+    const pa_clkSync_ReplayStep_t* stepPtr;
+    PendingReply_t* pendingPtr;
+    int64_t delayNs;
+    ssize_t len;
+    size_t i;
+
+    while ((len = recv(Peers[peer].serverFd, request, sizeof(request), MSG_DONTWAIT)) >= 0)
+    {
+        if (len < CLKSYNC_SNTP_PACKET_LENGTH)
+        {
+            continue;
+        }
+
+        stepPtr = &Script[NextStep];
+        NextStep = (NextStep + 1) % ScriptLength;
+        if (stepPtr->isLost)
+        {
+            LE_DEBUG("Replayed request lost");
+            continue;
+        }
+
+        pendingPtr = NULL;
+        for (i = 0; (i < REPLAY_MAX_PENDING) && !pendingPtr; i++)
+        {
+            if (!Pending[i].isUsed)
+            {
+                pendingPtr = &Pending[i];
+            }
+        }
+        if (!pendingPtr)
+        {
+            LE_WARN("Too many replayed replies waiting, request lost");
+            continue;
+        }
+
+        delayNs = (int64_t)stepPtr->delayMs * CLKSYNC_NS_PER_MSEC;
+        clkSyncSntp_BuildReply(request, stepPtr->offsetNs, delayNs, stepPtr->stratum,
+                               pendingPtr->reply);
+        pendingPtr->peer = peer;
+        pendingPtr->dueNs = clkSync_GetClockNs(CLOCK_MONOTONIC) + delayNs;
+        pendingPtr->isUsed = true;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Main function of the replay's thread: answer the requests and send the replies as they are due,
+ * until the replay is stopped
+ *
+ * @return
+ *      NULL
+ */
+//--------------------------------------------------------------------------------------------------
+static void* ReplayThread
+(
+    void* contextPtr                        ///< [IN] Unused
+)
+{
+    struct pollfd pfds[REPLAY_MAX_PEERS + 1];
+    size_t peers[REPLAY_MAX_PEERS + 1];
+    uint64_t count;
+    int64_t nowNs, nextDueNs;
+    size_t pfdCount, i;
+    int waitMs;
+
+    for (;;)
+    {
+        // Only this thread closes the server ends, so they stay valid while polled
+        le_mutex_Lock(ReplayMutex);
+        if (!IsRunning)
+        {
+            ClosePeers(true);
+            le_mutex_Unlock(ReplayMutex);
+            break;
+        }
+        ClosePeers(false);
+        nowNs = clkSync_GetClockNs(CLOCK_MONOTONIC);
+        nextDueNs = SendDueReplies(nowNs);
+
+        pfds[0].fd = WakeFd;
+        pfds[0].events = POLLIN;
+        pfdCount = 1;
+        for (i = 0; i < REPLAY_MAX_PEERS; i++)
+        {
+            if (Peers[i].serverFd >= 0)
+            {
+                pfds[pfdCount].fd = Peers[i].serverFd;
+                pfds[pfdCount].events = POLLIN;
+                peers[pfdCount] = i;
+                pfdCount++;
+            }
+        }
+        le_mutex_Unlock(ReplayMutex);
+
+        waitMs = (INT64_MAX == nextDueNs) ? -1 :
+                 (int)((nextDueNs - nowNs + CLKSYNC_NS_PER_MSEC - 1) / CLKSYNC_NS_PER_MSEC);
+        if (poll(pfds, pfdCount, waitMs) <= 0)
+        {
+            continue;
+        }
+
+        if ((pfds[0].revents & POLLIN) && (read(WakeFd, &count, sizeof(count)) < 0))
+        {
+            LE_DEBUG("Failed to read replay wake up (%m)");
+        }
+        le_mutex_Lock(ReplayMutex);
+        for (i = 1; i < pfdCount; i++)
+        {
+            if (pfds[i].revents & POLLIN)
+            {
+                AnswerRequests(peers[i]);
+            }
+        }
+        le_mutex_Unlock(ReplayMutex);
+    }
+
+    le_sem_Post(StoppedSem);
+    return NULL;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Lend one end of a new socket pair whose other end the replay answers, whatever the server
+ *
+ * @return
+ *      - The socket on success
+ *      - -1 on failure
+ */
+//--------------------------------------------------------------------------------------------------
+static int AcquireSocket
+(
+    const char* addrStr,                        ///< [IN] Numeric IPv4/v6 address
+    const char* portStr                         ///< [IN] Numeric port
+)
+{
+    ReplayPeer_t* peerPtr = NULL;
+    int fds[2];
+    size_t i;
+
+    le_mutex_Lock(ReplayMutex);
+    for (i = 0; IsRunning && (i < REPLAY_MAX_PEERS) && !peerPtr; i++)
+    {
+        if (Peers[i].serverFd < 0)
+        {
+            peerPtr = &Peers[i];
+        }
+    }
+    if (!peerPtr)
+    {
+        le_mutex_Unlock(ReplayMutex);
+        LE_ERROR("No replay socket available");
+        return -1;
+    }
+    if (socketpair(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds))
+    {
+        le_mutex_Unlock(ReplayMutex);
+        LE_ERROR("Failed to create replay socket pair (%m)");
+        return -1;
+    }
+    peerPtr->clientFd = fds[0];
+    peerPtr->serverFd = fds[1];
+    WakeThread();
+    le_mutex_Unlock(ReplayMutex);
+
+    clkSyncSntp_EnableReceiveTimestamps(fds[0]);
+    LE_DEBUG("Replaying server %s port %s", addrStr, portStr);
+    return fds[0];
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Close a socket lent by the replay, its other end being closed by the replay's thread
+ */
+//--------------------------------------------------------------------------------------------------
+static void ReleaseSocket
+(
+    int fd                                      ///< [IN] Socket
+)
+{
+    size_t i;
+
+    le_mutex_Lock(ReplayMutex);
+    for (i = 0; i < REPLAY_MAX_PEERS; i++)
+    {
+        if ((Peers[i].serverFd >= 0) && (Peers[i].clientFd == fd))
+        {
+            Peers[i].clientFd = -1;
+            WakeThread();
+            break;
+        }
+    }
+    le_mutex_Unlock(ReplayMutex);
+
+    close(fd);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Replay as a transport of the socket pool
+ */
+//--------------------------------------------------------------------------------------------------
+static const clkSyncSocket_Transport_t ReplayTransport =
+{
+    .namePtr = "replay",
+    .acquireFunc = AcquireSocket,
+    .releaseFunc = ReleaseSocket,
+};
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Initialize the replay, stopped
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncReplay_Init
+(
+    void
+)
+{
+    size_t i;
+
+    ReplayMutex = le_mutex_CreateNonRecursive("ClkSyncReplayMutex");
+    StoppedSem = le_sem_Create("ClkSyncReplayStopped", 0);
+    for (i = 0; i < REPLAY_MAX_PEERS; i++)
+    {
+        Peers[i].clientFd = -1;
+        Peers[i].serverFd = -1;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Answer the requests of the native NTP clients from the given script instead of the network, one
+ * step per request, going back to the first step after the last. A replay already running goes on
+ * with the new script from its first step.
+ *
+ * @return
+ *      - LE_OK             Replay started
+ *      - LE_BAD_PARAMETER  No step or more than PA_CLKSYNC_REPLAY_MAX_STEPS
+ *      - LE_FAULT          The replay couldn't be started
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncReplay_Start
+(
+    const pa_clkSync_ReplayStep_t* stepsPtr,    ///< [IN] Steps of the script
+    size_t count                                ///< [IN] Number of steps
+)
+{
+    le_thread_Ref_t threadRef;
+    bool wasRunning;
+
+    if (!stepsPtr || (0 == count) || (count > PA_CLKSYNC_REPLAY_MAX_STEPS))
+    {
+        return LE_BAD_PARAMETER;
+    }
+
+    le_mutex_Lock(ReplayMutex);
+    wasRunning = IsRunning;
+    if (!wasRunning)
+    {
+        WakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (WakeFd < 0)
+        {
+            le_mutex_Unlock(ReplayMutex);
+            LE_ERROR("Failed to create replay event (%m)");
+            return LE_FAULT;
+        }
+        IsRunning = true;
+    }
+    memcpy(Script, stepsPtr, count * sizeof(pa_clkSync_ReplayStep_t));
+    ScriptLength = count;
+    NextStep = 0;
+    le_mutex_Unlock(ReplayMutex);
+
+    if (!wasRunning)
+    {
+        threadRef = le_thread_Create("ClkSyncReplay", ReplayThread, NULL);
+        le_thread_Start(threadRef);
+    }
+
+    clkSyncSocket_SetTransport(&ReplayTransport);
+    LE_INFO("Replaying a script of %zu steps", count);
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Stop the replay, the next queries exchanging with the servers again
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncReplay_Stop
+(
+    void
+)
+{
+    bool wasRunning;
+
+    // The sockets still lent are closed when given back, their exchanges left unanswered
+    clkSyncSocket_SetTransport(NULL);
+
+    le_mutex_Lock(ReplayMutex);
+    wasRunning = IsRunning;
+    IsRunning = false;
+    WakeThread();
+    le_mutex_Unlock(ReplayMutex);
+    if (!wasRunning)
+    {
+        return;
+    }
+
+    le_sem_Wait(StoppedSem);
+    le_mutex_Lock(ReplayMutex);
+    close(WakeFd);
+    WakeFd = -1;
+    le_mutex_Unlock(ReplayMutex);
+}
+
+#endif // PA_CLKSYNC_WITH_REPLAY
@@ -0,0 +1,57 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file clkSyncReplay.h
+ *
+ * Replay of scripted NTP server replies in place of the network for the native NTP clients of the
+ * Linux Clock Service Adapter
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef CLKSYNC_REPLAY_H_INCLUDE_GUARD
+#define CLKSYNC_REPLAY_H_INCLUDE_GUARD
+
+#include "legato.h"
+#include "pa_clkSync_linux.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Initialize the replay, stopped
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncReplay_Init
+(
+    void
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Answer the requests of the native NTP clients from the given script instead of the network, one
+ * step per request, going back to the first step after the last. A replay already running goes on
+ * with the new script from its first step.
+ *
+ * @return
+ *      - LE_OK             Replay started
+ *      - LE_BAD_PARAMETER  No step or more than PA_CLKSYNC_REPLAY_MAX_STEPS
+ *      - LE_FAULT          The replay couldn't be started
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncReplay_Start
+(
+    const pa_clkSync_ReplayStep_t* stepsPtr,    ///< [IN] Steps of the script
+    size_t count                                ///< [IN] Number of steps
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Stop the replay, the next queries exchanging with the servers again
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncReplay_Stop
+(
+    void
+);
+
+#endif // CLKSYNC_REPLAY_H_INCLUDE_GUARD
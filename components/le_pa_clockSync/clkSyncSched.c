@@ -0,0 +1,287 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file clkSyncSched.c
+ *
+ * Periodic synchronization of the system clock by the Linux Clock Service Adapter. As ntpd does
+ * between its minpoll and maxpoll, the poll interval is a power of two seconds which doubles while
+ * the offsets measured show that the clock drift stays within budget at the longer interval, and
+ * which is shortened when the offset exceeds the budget, back to minpoll when the clock had to be
+ * stepped by that much or after a network change. A stable clock is then polled rarely, sparing
+ * the network wake-ups. The corrections of unknown offset made by the commands leave the interval
+ * as it is.
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include <netdb.h>
+#include "pa_clkSync_linux.h"
+#include "clkSyncLocal.h"
+#include "clkSyncAdjust.h"
+#include "clkSyncSched.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Largest offset allowed to build up between two polls; the interval is shortened above it
+ */
+//--------------------------------------------------------------------------------------------------
+#define SCHED_OFFSET_BUDGET_NS      (128 * CLKSYNC_NS_PER_MSEC)
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Number of consecutive polls whose offset would still be within budget at twice the interval,
+ * after which the interval is doubled
+ */
+//--------------------------------------------------------------------------------------------------
+#define SCHED_STABLE_COUNT          2
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Size of the server name or address
+ */
+//--------------------------------------------------------------------------------------------------
+#define SCHED_SERVER_MAX_BYTES      (NI_MAXHOST + 1)
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Scheduler state
+ */
+//--------------------------------------------------------------------------------------------------
+static clkSyncSched_SyncFunc_t SyncFunc;
+static le_timer_Ref_t TimerRef;
+static pa_clkSync_GetTimeRequestRef_t SyncRef;
+static bool IsStarted;
+static char Server[SCHED_SERVER_MAX_BYTES];
+static uint8_t MinPoll;
+static uint8_t MaxPoll;
+static uint8_t Poll;
+static uint32_t StableCount;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Arm the timer of the next synchronization
+ */
+//--------------------------------------------------------------------------------------------------
+static void ScheduleNext
+(
+    uint32_t delaySecs              ///< [IN] Delay before the next synchronization
+)
+{
+    le_clk_Time_t interval = { .sec = delaySecs, .usec = 0 };
+
+    le_timer_Stop(TimerRef);
+    le_timer_SetInterval(TimerRef, interval);
+    le_timer_Start(TimerRef);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Adapt the poll interval to the offset corrected by the last synchronization
+ */
+//--------------------------------------------------------------------------------------------------
+static void AdaptPoll
+(
+    int64_t offsetNs                    ///< [IN] Offset corrected
+)
+{
+    int64_t absOffsetNs = (offsetNs < 0) ? -offsetNs : offsetNs;
+
+    if ((absOffsetNs > SCHED_OFFSET_BUDGET_NS) && clkSyncAdjust_IsStep(offsetNs))
+    {
+        // The clock was far off, whether from a large drift or from an outside change: start
+        // learning again from the shortest interval
+        Poll = MinPoll;
+        StableCount = 0;
+    }
+    else if (absOffsetNs > SCHED_OFFSET_BUDGET_NS)
+    {
+        if (Poll > MinPoll)
+        {
+            Poll--;
+        }
+        StableCount = 0;
+    }
+    else if ((2 * absOffsetNs) <= SCHED_OFFSET_BUDGET_NS)
+    {
+        // With the same drift, twice the interval keeps the offset within budget
+        StableCount++;
+        if ((StableCount >= SCHED_STABLE_COUNT) && (Poll < MaxPoll))
+        {
+            Poll++;
+            StableCount = 0;
+        }
+    }
+    else
+    {
+        StableCount = 0;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handler of the completion of a synchronization
+ */
+//--------------------------------------------------------------------------------------------------
+static void SyncHandler
+(
+    le_result_t result,                     ///< [IN] Result of the synchronization
+    pa_clkSync_ClockAdjust_t adjust,        ///< [IN] Kind of the update of the system clock,
+                                            ///<      PA_CLKSYNC_CLOCK_ADJUST_NONE if none
+    int64_t offsetNs,                       ///< [IN] Offset corrected, 0 if unknown
+    void* contextPtr                        ///< [IN] Unused
+)
+{
+    SyncRef = NULL;
+
+    if (LE_OK == result)
+    {
+        // A command doesn't report the offset it corrected, nor does a daemon left to correct the
+        // clock itself, which tells nothing of the drift
+        if ((PA_CLKSYNC_CLOCK_ADJUST_COMMAND == adjust) || (PA_CLKSYNC_CLOCK_ADJUST_NONE == adjust))
+        {
+            StableCount = 0;
+        }
+        else
+        {
+            AdaptPoll(offsetNs);
+        }
+    }
+    else
+    {
+        // The interval is kept, so that an unreachable server doesn't add wake-ups
+        LE_WARN("Periodic synchronization with %s failed: %s", Server, LE_RESULT_TXT(result));
+        StableCount = 0;
+    }
+
+    LE_DEBUG("Next synchronization with %s in %u s", Server, 1U << Poll);
+    ScheduleNext(1U << Poll);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handler of the timer of the next synchronization
+ */
+//--------------------------------------------------------------------------------------------------
+static void TimerHandler
+(
+    le_timer_Ref_t timerRef             ///< [IN] Timer expired
+)
+{
+    le_result_t result;
+
+    result = SyncFunc(Server, SyncHandler, NULL, &SyncRef);
+    if (LE_OK != result)
+    {
+        LE_WARN("Failed to start synchronization with %s: %s", Server, LE_RESULT_TXT(result));
+        SyncRef = NULL;
+        ScheduleNext(1U << Poll);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Initialize the scheduler with the function run on each poll
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncSched_Init
+(
+    clkSyncSched_SyncFunc_t syncFunc            ///< [IN] Synchronization function
+)
+{
+    SyncFunc = syncFunc;
+    TimerRef = le_timer_Create("ClkSyncSched");
+    le_timer_SetHandler(TimerRef, TimerHandler);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start synchronizing the system clock periodically with the given server, replacing any
+ * schedule in progress. The first synchronization is run right away, and the interval then
+ * starts at 2^minPoll seconds.
+ *
+ * @return
+ *      - LE_OK             Synchronization scheduled
+ *      - LE_BAD_PARAMETER  Incorrect parameter
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncSched_Start
+(
+    const char* serverStrPtr,                   ///< [IN] Time server
+    uint8_t minPoll,                            ///< [IN] Log2 of the shortest interval in seconds
+    uint8_t maxPoll                             ///< [IN] Log2 of the longest interval in seconds
+)
+{
+    if ((!serverStrPtr) || ('\0' == serverStrPtr[0]) || (minPoll < PA_CLKSYNC_POLL_MIN) ||
+        (maxPoll > PA_CLKSYNC_POLL_MAX) || (minPoll > maxPoll))
+    {
+        LE_ERROR("Incorrect parameter");
+        return LE_BAD_PARAMETER;
+    }
+
+    clkSyncSched_Stop();
+    if (LE_OK != le_utf8_Copy(Server, serverStrPtr, sizeof(Server), NULL))
+    {
+        LE_ERROR("Server %s too long", serverStrPtr);
+        return LE_BAD_PARAMETER;
+    }
+
+    MinPoll = minPoll;
+    MaxPoll = maxPoll;
+    IsStarted = true;
+    LE_INFO("Synchronizing with %s every %u to %u s", Server, 1U << minPoll, 1U << maxPoll);
+    clkSyncSched_Reset();
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Stop the periodic synchronization, cancelling any synchronization in progress
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncSched_Stop
+(
+    void
+)
+{
+    le_timer_Stop(TimerRef);
+    if (SyncRef)
+    {
+        pa_clkSync_CancelGetTime(SyncRef);
+        SyncRef = NULL;
+    }
+    IsStarted = false;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Shorten the interval back to its minimum and synchronize right away, e.g. after a network
+ * change. Nothing is done if no synchronization is scheduled.
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncSched_Reset
+(
+    void
+)
+{
+    if (!IsStarted)
+    {
+        return;
+    }
+
+    Poll = MinPoll;
+    StableCount = 0;
+
+    // A synchronization in progress completes and schedules the next one
+    if (!SyncRef)
+    {
+        ScheduleNext(0);
+    }
+}
@@ -0,0 +1,100 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file clkSyncSched.h
+ *
+ * Periodic synchronization of the system clock with an adaptive poll interval, for the Linux
+ * Clock Service Adapter
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef CLKSYNC_SCHED_H_INCLUDE_GUARD
+#define CLKSYNC_SCHED_H_INCLUDE_GUARD
+
+#include "legato.h"
+#include "pa_clkSync_linux.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handler of the completion of a synchronization, given the update of the system clock made by
+ * this very synchronization
+ */
+//--------------------------------------------------------------------------------------------------
+typedef void (*clkSyncSched_SyncHandlerFunc_t)
+(
+    le_result_t result,                     ///< [IN] Result of the synchronization
+    pa_clkSync_ClockAdjust_t adjust,        ///< [IN] Kind of the update of the system clock,
+                                            ///<      PA_CLKSYNC_CLOCK_ADJUST_NONE if none
+    int64_t offsetNs,                       ///< [IN] Offset corrected, 0 if unknown
+    void* contextPtr                        ///< [IN] Context given to the handler
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Function starting the synchronization of the system clock with the given server, whose result
+ * is given to the handler from the event loop
+ */
+//--------------------------------------------------------------------------------------------------
+typedef le_result_t (*clkSyncSched_SyncFunc_t)
+(
+    const char* serverStrPtr,                    ///< [IN]  Time server
+    clkSyncSched_SyncHandlerFunc_t handlerFunc,  ///< [IN]  Completion handler
+    void* contextPtr,                            ///< [IN]  Context given to the handler
+    pa_clkSync_GetTimeRequestRef_t* refPtr       ///< [OUT] Reference of the synchronization
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Initialize the scheduler with the function run on each poll
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncSched_Init
+(
+    clkSyncSched_SyncFunc_t syncFunc            ///< [IN] Synchronization function
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start synchronizing the system clock periodically with the given server, replacing any
+ * schedule in progress. The first synchronization is run right away, and the interval then
+ * starts at 2^minPoll seconds.
+ *
+ * @return
+ *      - LE_OK             Synchronization scheduled
+ *      - LE_BAD_PARAMETER  Incorrect parameter
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncSched_Start
+(
+    const char* serverStrPtr,                   ///< [IN] Time server
+    uint8_t minPoll,                            ///< [IN] Log2 of the shortest interval in seconds
+    uint8_t maxPoll                             ///< [IN] Log2 of the longest interval in seconds
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Stop the periodic synchronization, cancelling any synchronization in progress
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncSched_Stop
+(
+    void
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Shorten the interval back to its minimum and synchronize right away, e.g. after a network
+ * change. Nothing is done if no synchronization is scheduled.
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncSched_Reset
+(
+    void
+);
+
+#endif // CLKSYNC_SCHED_H_INCLUDE_GUARD
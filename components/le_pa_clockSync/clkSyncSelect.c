@@ -0,0 +1,136 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file clkSyncSelect.c
+ *
+ * Selection of the best sample among the replies of several time servers, after the clock select
+ * algorithm of RFC 5905 section 11.2.1. Each sample defines a correctness interval, its offset
+ * plus or minus its root distance, in which the true time lies if the server is correct. The
+ * intersection shared by the largest number of intervals is found with Marzullo's algorithm; the
+ * samples not containing it are falsetickers and are discarded. Among the remaining truechimers,
+ * the sample with the lowest root distance, i.e. the most accurate one, is selected.
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "clkSyncLocal.h"
+#include "clkSyncSelect.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Edge of a correctness interval
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    int64_t valueNs;        ///< Offset of the edge
+    int type;               ///< +1 for a lower edge, -1 for an upper edge
+}
+SelectEdge_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Order edges by offset, lower edges first on ties so that touching intervals intersect
+ */
+//--------------------------------------------------------------------------------------------------
+static int CompareEdges
+(
+    const void* aPtr,       ///< [IN] First edge
+    const void* bPtr        ///< [IN] Second edge
+)
+{
+    const SelectEdge_t* edgeAPtr = aPtr;
+    const SelectEdge_t* edgeBPtr = bPtr;
+
+    if (edgeAPtr->valueNs != edgeBPtr->valueNs)
+    {
+        return (edgeAPtr->valueNs < edgeBPtr->valueNs) ? -1 : 1;
+    }
+    return edgeBPtr->type - edgeAPtr->type;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Select the best of the given samples: the falsetickers are discarded by intersecting the
+ * correctness intervals of the samples, and the survivor with the lowest root distance is kept.
+ * Without a majority of the samples agreeing, no falseticker can be told apart and the sample
+ * with the lowest root distance among all is kept.
+ *
+ * @return
+ *      - LE_OK             A sample was selected
+ *      - LE_BAD_PARAMETER  No sample given
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncSelect_Best
+(
+    const clkSync_Sample_t* samplesPtr, ///< [IN]  Samples to select from
+    size_t count,                       ///< [IN]  Number of samples
+    clkSync_Sample_t* bestPtr           ///< [OUT] Selected sample
+)
+{
+    SelectEdge_t edges[CLKSYNC_MAX_ADDRS * 2];
+    int64_t lowNs = 0, highNs = 0;
+    size_t i, depth = 0, maxDepth = 0, bestIndex = count;
+
+    if (!samplesPtr || !bestPtr || (0 == count) || (count > CLKSYNC_MAX_ADDRS))
+    {
+        LE_ERROR("Input error");
+        return LE_BAD_PARAMETER;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        edges[2 * i].valueNs = samplesPtr[i].offsetNs - samplesPtr[i].rootDistanceNs;
+        edges[2 * i].type = 1;
+        edges[2 * i + 1].valueNs = samplesPtr[i].offsetNs + samplesPtr[i].rootDistanceNs;
+        edges[2 * i + 1].type = -1;
+    }
+    qsort(edges, count * 2, sizeof(edges[0]), CompareEdges);
+
+    // The upper edge following the lower edge at which the depth is the largest closes the
+    // intersection shared by the most intervals
+    for (i = 0; i < count * 2; i++)
+    {
+        depth += edges[i].type;
+        if ((edges[i].type > 0) && (depth > maxDepth))
+        {
+            maxDepth = depth;
+            lowNs = edges[i].valueNs;
+            highNs = edges[i + 1].valueNs;
+        }
+    }
+
+    if (maxDepth * 2 <= count)
+    {
+        LE_WARN("No majority among %zu servers, keeping the most accurate one", count);
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        const clkSync_Sample_t* samplePtr = &samplesPtr[i];
+
+        if ((maxDepth * 2 > count) &&
+            ((samplePtr->offsetNs - samplePtr->rootDistanceNs > lowNs) ||
+             (samplePtr->offsetNs + samplePtr->rootDistanceNs < highNs)))
+        {
+            LE_INFO("Discarding falseticker sample offset %" PRId64 " ns", samplePtr->offsetNs);
+            continue;
+        }
+
+        // Ties, e.g. at the minimum distance on a local network, go to the lowest delay
+        if ((bestIndex == count) ||
+            (samplePtr->rootDistanceNs < samplesPtr[bestIndex].rootDistanceNs) ||
+            ((samplePtr->rootDistanceNs == samplesPtr[bestIndex].rootDistanceNs) &&
+             (samplePtr->delayNs < samplesPtr[bestIndex].delayNs)))
+        {
+            bestIndex = i;
+        }
+    }
+
+    *bestPtr = samplesPtr[bestIndex];
+    LE_DEBUG("Selected sample offset %" PRId64 " ns, root distance %" PRId64 " ns among %zu",
+             bestPtr->offsetNs, bestPtr->rootDistanceNs, count);
+    return LE_OK;
+}
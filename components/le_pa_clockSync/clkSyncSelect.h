@@ -0,0 +1,34 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file clkSyncSelect.h
+ *
+ * Selection of the best sample among the replies of several time servers, for the Linux Clock
+ * Service Adapter
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef CLKSYNC_SELECT_H_INCLUDE_GUARD
+#define CLKSYNC_SELECT_H_INCLUDE_GUARD
+
+#include "legato.h"
+#include "clkSyncLocal.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Select the best of the given samples: the falsetickers are discarded by intersecting the
+ * correctness intervals of the samples, and the survivor with the lowest root distance is kept.
+ *
+ * @return
+ *      - LE_OK             A sample was selected
+ *      - LE_BAD_PARAMETER  No sample given
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncSelect_Best
+(
+    const clkSync_Sample_t* samplesPtr, ///< [IN]  Samples to select from
+    size_t count,                       ///< [IN]  Number of samples
+    clkSync_Sample_t* bestPtr           ///< [OUT] Selected sample
+);
+
+#endif // CLKSYNC_SELECT_H_INCLUDE_GUARD
@@ -0,0 +1,307 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file clkSyncSiv.c
+ *
+ * AEAD_AES_SIV_CMAC_256 authenticated encryption of the Linux Clock Service Adapter, which
+ * authenticates the Network Time Security requests and replies. OpenSSL 3.0 can't seal an empty
+ * plaintext with its AES-SIV cipher, which is what every request does, so SIV is built here from
+ * the AES-CMAC and AES-CTR primitives as described in RFC 5297: the synthetic IV is the S2V of the
+ * associated data components and the plaintext, and the counter of AES-CTR starts from it.
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include <openssl/core_names.h>
+#include <openssl/crypto.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include "clkSyncSiv.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * AES-CMAC implementation, fetched on the first use
+ */
+//--------------------------------------------------------------------------------------------------
+static EVP_MAC* SivCmacPtr;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Log the first error queued by OpenSSL, and clear them
+ */
+//--------------------------------------------------------------------------------------------------
+static void LogSslError
+(
+    const char* whatPtr     ///< [IN] Operation which failed
+)
+{
+    char buf[256];
+
+    ERR_error_string_n(ERR_get_error(), buf, sizeof(buf));
+    ERR_clear_error();
+    LE_ERROR("%s failed: %s", whatPtr, buf);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Compute the AES-CMAC of the concatenation of two buffers
+ *
+ * @return
+ *      - LE_OK             MAC computed
+ *      - LE_FAULT          OpenSSL failed to compute it
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t Cmac
+(
+    const uint8_t* keyPtr,  ///< [IN]  Key of CLKSYNC_SIV_HALF_KEY_BYTES bytes
+    const uint8_t* aPtr,    ///< [IN]  First buffer, may be NULL if empty
+    size_t aLen,            ///< [IN]  Length of the first buffer
+    const uint8_t* bPtr,    ///< [IN]  Second buffer, may be NULL if empty
+    size_t bLen,            ///< [IN]  Length of the second buffer
+    uint8_t* macPtr         ///< [OUT] MAC of CLKSYNC_SIV_BYTES bytes
+)
+{
+    OSSL_PARAM params[] =
+    {
+        OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_CIPHER, "AES-128-CBC", 0),
+        OSSL_PARAM_construct_end()
+    };
+    EVP_MAC_CTX* ctxPtr;
+    size_t macLen;
+    int ok;
+
+    if (!SivCmacPtr)
+    {
+        SivCmacPtr = EVP_MAC_fetch(NULL, "CMAC", NULL);
+        if (!SivCmacPtr)
+        {
+            LogSslError("CMAC fetch");
+            return LE_FAULT;
+        }
+    }
+
+    ctxPtr = EVP_MAC_CTX_new(SivCmacPtr);
+    ok = ctxPtr && EVP_MAC_init(ctxPtr, keyPtr, CLKSYNC_SIV_HALF_KEY_BYTES, params) &&
+         ((0 == aLen) || EVP_MAC_update(ctxPtr, aPtr, aLen)) &&
+         ((0 == bLen) || EVP_MAC_update(ctxPtr, bPtr, bLen)) &&
+         EVP_MAC_final(ctxPtr, macPtr, &macLen, CLKSYNC_SIV_BYTES);
+    EVP_MAC_CTX_free(ctxPtr);
+    if (!ok)
+    {
+        LogSslError("CMAC");
+        return LE_FAULT;
+    }
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Double a 128-bit block in GF(2^128), as defined by RFC 5297 section 2.3
+ */
+//--------------------------------------------------------------------------------------------------
+static void DoubleBlock
+(
+    uint8_t* blockPtr       ///< [IN/OUT] Block of CLKSYNC_SIV_BYTES bytes
+)
+{
+    uint8_t carry = (blockPtr[0] & 0x80) ? 0x87 : 0;
+    size_t i;
+
+    for (i = 0; i < CLKSYNC_SIV_BYTES - 1; i++)
+    {
+        blockPtr[i] = (uint8_t)((blockPtr[i] << 1) | (blockPtr[i + 1] >> 7));
+    }
+    blockPtr[CLKSYNC_SIV_BYTES - 1] = (uint8_t)((blockPtr[CLKSYNC_SIV_BYTES - 1] << 1) ^ carry);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Compute the synthetic IV of a message, S2V in RFC 5297 section 2.4, over the components of the
+ * associated data and the plaintext, in this order
+ *
+ * @return
+ *      - LE_OK             IV computed
+ *      - LE_FAULT          OpenSSL failed to compute it
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ComputeSiv
+(
+    const uint8_t* keyPtr,              ///< [IN]  MAC half of the key
+    const clkSyncSiv_Data_t* adPtr,     ///< [IN]  Components of the associated data
+    size_t adCount,                     ///< [IN]  Number of components
+    const uint8_t* plainPtr,            ///< [IN]  Plaintext
+    size_t plainLen,                    ///< [IN]  Length of the plaintext
+    uint8_t* sivPtr                     ///< [OUT] Synthetic IV of CLKSYNC_SIV_BYTES bytes
+)
+{
+    static const uint8_t zero[CLKSYNC_SIV_BYTES] = {0};
+    uint8_t d[CLKSYNC_SIV_BYTES];
+    uint8_t t[CLKSYNC_SIV_BYTES];
+    size_t i, component;
+
+    if (LE_OK != Cmac(keyPtr, zero, sizeof(zero), NULL, 0, d))
+    {
+        return LE_FAULT;
+    }
+
+    for (component = 0; component < adCount; component++)
+    {
+        DoubleBlock(d);
+        if (LE_OK != Cmac(keyPtr, adPtr[component].dataPtr, adPtr[component].len, NULL, 0, t))
+        {
+            return LE_FAULT;
+        }
+        for (i = 0; i < CLKSYNC_SIV_BYTES; i++)
+        {
+            d[i] ^= t[i];
+        }
+    }
+
+    // The last component is either xored at its end with the running value, or padded
+    if (plainLen >= CLKSYNC_SIV_BYTES)
+    {
+        for (i = 0; i < CLKSYNC_SIV_BYTES; i++)
+        {
+            t[i] = plainPtr[plainLen - CLKSYNC_SIV_BYTES + i] ^ d[i];
+        }
+        return Cmac(keyPtr, plainPtr, plainLen - CLKSYNC_SIV_BYTES, t, CLKSYNC_SIV_BYTES,
+                    sivPtr);
+    }
+
+    DoubleBlock(d);
+    memset(t, 0, sizeof(t));
+    if (plainLen)
+    {
+        memcpy(t, plainPtr, plainLen);
+    }
+    t[plainLen] = 0x80;
+    for (i = 0; i < CLKSYNC_SIV_BYTES; i++)
+    {
+        t[i] ^= d[i];
+    }
+    return Cmac(keyPtr, t, CLKSYNC_SIV_BYTES, NULL, 0, sivPtr);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Run AES-CTR over a buffer, the counter starting from the synthetic IV with its bits 31 and 63
+ * cleared as RFC 5297 section 2.5 requires
+ *
+ * @return
+ *      - LE_OK             Buffer ciphered
+ *      - LE_FAULT          OpenSSL failed to cipher it
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t RunCtr
+(
+    const uint8_t* keyPtr,      ///< [IN]  Cipher half of the key
+    const uint8_t* sivPtr,      ///< [IN]  Synthetic IV
+    const uint8_t* inPtr,       ///< [IN]  Input
+    size_t len,                 ///< [IN]  Length of the input
+    uint8_t* outPtr             ///< [OUT] Output, of the same length
+)
+{
+    uint8_t counter[CLKSYNC_SIV_BYTES];
+    EVP_CIPHER_CTX* ctxPtr;
+    int outLen;
+    int ok;
+
+    if (0 == len)
+    {
+        return LE_OK;
+    }
+
+    memcpy(counter, sivPtr, sizeof(counter));
+    counter[8] &= 0x7f;
+    counter[12] &= 0x7f;
+
+    ctxPtr = EVP_CIPHER_CTX_new();
+    ok = ctxPtr && EVP_EncryptInit_ex(ctxPtr, EVP_aes_128_ctr(), NULL, keyPtr, counter) &&
+         EVP_EncryptUpdate(ctxPtr, outPtr, &outLen, inPtr, (int)len);
+    EVP_CIPHER_CTX_free(ctxPtr);
+    if (!ok)
+    {
+        LogSslError("AES-CTR");
+        return LE_FAULT;
+    }
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Seal a plaintext; the synthetic IV is followed by the ciphertext
+ *
+ * @return
+ *      - LE_OK             Plaintext sealed into CLKSYNC_SIV_BYTES + plainLen bytes
+ *      - LE_FAULT          OpenSSL failed to seal it
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncSiv_Seal
+(
+    const uint8_t* keyPtr,              ///< [IN]  Key of CLKSYNC_SIV_KEY_BYTES bytes
+    const clkSyncSiv_Data_t* adPtr,     ///< [IN]  Components of the associated data, in order
+    size_t adCount,                     ///< [IN]  Number of components
+    const uint8_t* plainPtr,            ///< [IN]  Plaintext, may be NULL if empty
+    size_t plainLen,                    ///< [IN]  Length of the plaintext
+    uint8_t* sealedPtr                  ///< [OUT] Synthetic IV and ciphertext
+)
+{
+    if (LE_OK != ComputeSiv(keyPtr, adPtr, adCount, plainPtr, plainLen, sealedPtr))
+    {
+        return LE_FAULT;
+    }
+    return RunCtr(keyPtr + CLKSYNC_SIV_HALF_KEY_BYTES, sealedPtr, plainPtr, plainLen,
+                  sealedPtr + CLKSYNC_SIV_BYTES);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Open a sealed message, checking its synthetic IV
+ *
+ * @return
+ *      - LE_OK             Message authenticated, its plaintext is returned
+ *      - LE_FAULT          The message isn't authentic, or OpenSSL failed to open it
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncSiv_Open
+(
+    const uint8_t* keyPtr,              ///< [IN]  Key of CLKSYNC_SIV_KEY_BYTES bytes
+    const clkSyncSiv_Data_t* adPtr,     ///< [IN]  Components of the associated data, in order
+    size_t adCount,                     ///< [IN]  Number of components
+    const uint8_t* sealedPtr,           ///< [IN]  Synthetic IV and ciphertext
+    size_t sealedLen,                   ///< [IN]  Length of the sealed message
+    uint8_t* plainPtr,                  ///< [OUT] Plaintext, of sealedLen - CLKSYNC_SIV_BYTES
+                                        ///<       bytes
+    size_t* plainLenPtr                 ///< [OUT] Length of the plaintext
+)
+{
+    uint8_t siv[CLKSYNC_SIV_BYTES];
+    size_t plainLen;
+
+    if (sealedLen < CLKSYNC_SIV_BYTES)
+    {
+        return LE_FAULT;
+    }
+    plainLen = sealedLen - CLKSYNC_SIV_BYTES;
+
+    if ((LE_OK != RunCtr(keyPtr + CLKSYNC_SIV_HALF_KEY_BYTES, sealedPtr,
+                         sealedPtr + CLKSYNC_SIV_BYTES, plainLen, plainPtr)) ||
+        (LE_OK != ComputeSiv(keyPtr, adPtr, adCount, plainPtr, plainLen, siv)))
+    {
+        return LE_FAULT;
+    }
+    if (CRYPTO_memcmp(siv, sealedPtr, CLKSYNC_SIV_BYTES))
+    {
+        return LE_FAULT;
+    }
+
+    *plainLenPtr = plainLen;
+    return LE_OK;
+}
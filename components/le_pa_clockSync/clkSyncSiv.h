@@ -0,0 +1,79 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file clkSyncSiv.h
+ *
+ * AEAD_AES_SIV_CMAC_256 (RFC 5297) authenticated encryption of the Network Time Security client
+ * of the Linux Clock Service Adapter
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef CLKSYNC_SIV_H_INCLUDE_GUARD
+#define CLKSYNC_SIV_H_INCLUDE_GUARD
+
+#include "legato.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Sizes of the key, of each of its halves and of the synthetic IV
+ */
+//--------------------------------------------------------------------------------------------------
+#define CLKSYNC_SIV_KEY_BYTES       32
+#define CLKSYNC_SIV_HALF_KEY_BYTES  16
+#define CLKSYNC_SIV_BYTES           16
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Component of the associated data, e.g. the header authenticated or the nonce
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    const uint8_t* dataPtr;         ///< Data, may be NULL if empty
+    size_t len;                     ///< Length of the data
+}
+clkSyncSiv_Data_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Seal a plaintext; the synthetic IV is followed by the ciphertext
+ *
+ * @return
+ *      - LE_OK             Plaintext sealed into CLKSYNC_SIV_BYTES + plainLen bytes
+ *      - LE_FAULT          OpenSSL failed to seal it
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncSiv_Seal
+(
+    const uint8_t* keyPtr,              ///< [IN]  Key of CLKSYNC_SIV_KEY_BYTES bytes
+    const clkSyncSiv_Data_t* adPtr,     ///< [IN]  Components of the associated data, in order
+    size_t adCount,                     ///< [IN]  Number of components
+    const uint8_t* plainPtr,            ///< [IN]  Plaintext, may be NULL if empty
+    size_t plainLen,                    ///< [IN]  Length of the plaintext
+    uint8_t* sealedPtr                  ///< [OUT] Synthetic IV and ciphertext
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Open a sealed message, checking its synthetic IV
+ *
+ * @return
+ *      - LE_OK             Message authenticated, its plaintext is returned
+ *      - LE_FAULT          The message isn't authentic, or OpenSSL failed to open it
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncSiv_Open
+(
+    const uint8_t* keyPtr,              ///< [IN]  Key of CLKSYNC_SIV_KEY_BYTES bytes
+    const clkSyncSiv_Data_t* adPtr,     ///< [IN]  Components of the associated data, in order
+    size_t adCount,                     ///< [IN]  Number of components
+    const uint8_t* sealedPtr,           ///< [IN]  Synthetic IV and ciphertext
+    size_t sealedLen,                   ///< [IN]  Length of the sealed message
+    uint8_t* plainPtr,                  ///< [OUT] Plaintext, of sealedLen - CLKSYNC_SIV_BYTES
+                                        ///<       bytes
+    size_t* plainLenPtr                 ///< [OUT] Length of the plaintext
+);
+
+#endif // CLKSYNC_SIV_H_INCLUDE_GUARD
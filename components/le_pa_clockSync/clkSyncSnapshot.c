@@ -0,0 +1,234 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file clkSyncSnapshot.c
+ *
+ * Snapshot of the last synchronized time for the Linux Clock Service Adapter. On modules without
+ * an RTC the system clock starts from the epoch on each boot, and no time can be given until the
+ * first synchronization succeeds. The time of the last synchronization is therefore saved into a
+ * small file, and on start the system clock is stepped to it plus the time elapsed since boot:
+ * this estimate is behind the true time by the time spent powered off, but is available within
+ * milliseconds, and the next synchronization refines it. The frequency is restored from the drift
+ * file beside it.
+ *
+ * The snapshot records the boot it was taken in, so that a restart of the service within the same
+ * boot, whose system clock kept running, doesn't push the clock by the time since boot.
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include <limits.h>
+#include "pa_clkSync_linux.h"
+#include "clkSyncLocal.h"
+#include "clkSyncAdjust.h"
+#include "clkSyncSnapshot.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Shortest interval between two saves of the snapshot, sparing the flash from a write on each
+ * synchronization
+ */
+//--------------------------------------------------------------------------------------------------
+#define SNAPSHOT_SAVE_INTERVAL_NS   (3600 * CLKSYNC_NS_PER_SEC)
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * File giving the identifier of the present boot, and size of the identifier including the
+ * terminating null character
+ */
+//--------------------------------------------------------------------------------------------------
+#define SNAPSHOT_BOOT_ID_FILE       "/proc/sys/kernel/random/boot_id"
+#define SNAPSHOT_BOOT_ID_BYTES      40
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Snapshot file
+ */
+//--------------------------------------------------------------------------------------------------
+static char SnapshotFile[PATH_MAX] = PA_CLKSYNC_SNAPSHOT_FILE_DEFAULT;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * CLOCK_MONOTONIC time of the last save, and whether any was done
+ */
+//--------------------------------------------------------------------------------------------------
+static int64_t LastSaveNs;
+static bool IsSaved;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read the identifier of the present boot
+ *
+ * @return
+ *      - true    Identifier read
+ *      - false   The kernel doesn't give it
+ */
+//--------------------------------------------------------------------------------------------------
+static bool ReadBootId
+(
+    char bootId[SNAPSHOT_BOOT_ID_BYTES]     ///< [OUT] Boot identifier
+)
+{
+    FILE* fp = fopen(SNAPSHOT_BOOT_ID_FILE, "r");
+    int rc;
+
+    if (!fp)
+    {
+        return false;
+    }
+    rc = fscanf(fp, "%39s", bootId);
+    fclose(fp);
+    return (1 == rc);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Restore the system clock from the snapshot file, if the clock is behind the time saved and the
+ * snapshot was taken in a previous boot
+ */
+//--------------------------------------------------------------------------------------------------
+static void Restore
+(
+    void
+)
+{
+    char savedBootId[SNAPSHOT_BOOT_ID_BYTES] = "";
+    char bootId[SNAPSHOT_BOOT_ID_BYTES];
+    long long secs;
+    long nsecs;
+    int64_t estimateNs, offsetNs;
+    FILE* fp;
+    int rc;
+
+    if ('\0' == SnapshotFile[0])
+    {
+        return;
+    }
+
+    fp = fopen(SnapshotFile, "r");
+    if (!fp)
+    {
+        LE_DEBUG("No time snapshot %s (%m)", SnapshotFile);
+        return;
+    }
+    // Snapshots saved before the boot was recorded have no identifier
+    rc = fscanf(fp, "%lld.%ld %39s", &secs, &nsecs, savedBootId);
+    fclose(fp);
+
+    if ((rc < 2) || (secs < 0) || (nsecs < 0) || (nsecs >= CLKSYNC_NS_PER_SEC))
+    {
+        LE_WARN("Invalid time snapshot %s", SnapshotFile);
+        return;
+    }
+
+    if (ReadBootId(bootId) && (0 == strcmp(bootId, savedBootId)))
+    {
+        LE_DEBUG("Time snapshot taken in this boot, system clock not restored");
+        return;
+    }
+
+    // The system booted after the snapshot was taken, so at least the time since boot elapsed
+    estimateNs = (int64_t)secs * CLKSYNC_NS_PER_SEC + nsecs + clkSync_GetClockNs(CLOCK_BOOTTIME);
+    offsetNs = estimateNs - clkSync_GetClockNs(CLOCK_REALTIME);
+    if (offsetNs <= 0)
+    {
+        LE_DEBUG("System clock ahead of time snapshot, not restored");
+        return;
+    }
+
+    if (LE_OK == clkSyncAdjust_Restore(offsetNs))
+    {
+        LE_INFO("System clock restored from time snapshot %s", SnapshotFile);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Initialize the snapshot, restoring the system clock from the snapshot file if it is behind
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncSnapshot_Init
+(
+    void
+)
+{
+    IsSaved = false;
+    Restore();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Record that the system clock was just synchronized, saving it into the snapshot file unless it
+ * was saved recently
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncSnapshot_Save
+(
+    void
+)
+{
+    char tmpPath[PATH_MAX + 4];
+    char bootId[SNAPSHOT_BOOT_ID_BYTES] = "";
+    int64_t nowNs = clkSync_GetClockNs(CLOCK_MONOTONIC);
+    struct timespec ts;
+    FILE* fp;
+
+    if (('\0' == SnapshotFile[0]) ||
+        (IsSaved && ((nowNs - LastSaveNs) < SNAPSHOT_SAVE_INTERVAL_NS)))
+    {
+        return;
+    }
+
+    snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", SnapshotFile);
+    fp = fopen(tmpPath, "w");
+    if (!fp)
+    {
+        LE_WARN("Failed to open time snapshot %s (%m)", tmpPath);
+        return;
+    }
+
+    ReadBootId(bootId);
+    clock_gettime(CLOCK_REALTIME, &ts);
+    fprintf(fp, "%lld.%09ld %s\n", (long long)ts.tv_sec, ts.tv_nsec, bootId);
+    if (fclose(fp) || rename(tmpPath, SnapshotFile))
+    {
+        LE_WARN("Failed to write time snapshot %s (%m)", SnapshotFile);
+        unlink(tmpPath);
+        return;
+    }
+
+    LastSaveNs = nowNs;
+    IsSaved = true;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the snapshot file, and restore the system clock from it if it is behind; an empty path
+ * disables the snapshot
+ *
+ * @return
+ *      - LE_OK             File set
+ *      - LE_BAD_PARAMETER  Incorrect parameter
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncSnapshot_SetFile
+(
+    const char* pathPtr             ///< [IN] Snapshot file
+)
+{
+    if ((!pathPtr) || (strlen(pathPtr) >= sizeof(SnapshotFile)))
+    {
+        LE_ERROR("Incorrect parameter");
+        return LE_BAD_PARAMETER;
+    }
+
+    le_utf8_Copy(SnapshotFile, pathPtr, sizeof(SnapshotFile), NULL);
+    IsSaved = false;
+    Restore();
+    return LE_OK;
+}
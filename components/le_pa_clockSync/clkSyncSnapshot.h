@@ -0,0 +1,54 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file clkSyncSnapshot.h
+ *
+ * Snapshot of the last synchronized time, restored into the system clock on start, for the Linux
+ * Clock Service Adapter
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef CLKSYNC_SNAPSHOT_H_INCLUDE_GUARD
+#define CLKSYNC_SNAPSHOT_H_INCLUDE_GUARD
+
+#include "legato.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Initialize the snapshot, restoring the system clock from the snapshot file if it is behind
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncSnapshot_Init
+(
+    void
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Record that the system clock was just synchronized, saving it into the snapshot file unless it
+ * was saved recently
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncSnapshot_Save
+(
+    void
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the snapshot file, and restore the system clock from it if it is behind; an empty path
+ * disables the snapshot
+ *
+ * @return
+ *      - LE_OK             File set
+ *      - LE_BAD_PARAMETER  Incorrect parameter
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncSnapshot_SetFile
+(
+    const char* pathPtr             ///< [IN] Snapshot file
+);
+
+#endif // CLKSYNC_SNAPSHOT_H_INCLUDE_GUARD
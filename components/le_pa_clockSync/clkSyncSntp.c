@@ -0,0 +1,939 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file clkSyncSntp.c
+ *
+ * Native SNTPv4 (RFC 4330) client of the Linux Clock Service Adapter. A single client mode request
+ * is sent over UDP to each address of the server and the 48-byte server reply is decoded in place,
+ * without spawning ntpdate.
+ *
+ * Replies are time stamped by the kernel on reception (SO_TIMESTAMPNS) rather than when they are
+ * read, so that the scheduling latency of the reading thread doesn't add to the offset error.
+ *
+ * In burst mode, several requests are sent in a row over the same socket, each as soon as the
+ * previous reply is received, and the sample of the least round-trip delay is kept, as the NTP
+ * clock filter algorithm of RFC 5905 does: the delay bounds the error of the offset, and the
+ * replies delayed by queuing are the ones skewed the most.
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include <netdb.h>
+#include "pa_clkSync_linux.h"
+#include "clkSyncLocal.h"
+#include "clkSyncRace.h"
+#include "clkSyncSntp.h"
+#include "clkSyncSocket.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * NTP packet layout, see RFC 4330 section 4
+ */
+//--------------------------------------------------------------------------------------------------
+#define SNTP_PACKET_LENGTH          CLKSYNC_SNTP_PACKET_LENGTH
+#define SNTP_OFFSET_LI_VN_MODE      0
+#define SNTP_OFFSET_STRATUM         1
+#define SNTP_OFFSET_ROOT_DELAY      4
+#define SNTP_OFFSET_ROOT_DISPERSION 8
+#define SNTP_OFFSET_REFERENCE_ID    12
+#define SNTP_OFFSET_ORIGINATE_TS    24
+#define SNTP_OFFSET_RECEIVE_TS      32
+#define SNTP_OFFSET_TRANSMIT_TS     40
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Field values of the first octet: leap indicator, version number and mode
+ */
+//--------------------------------------------------------------------------------------------------
+#define SNTP_LI_ALARM               3
+#define SNTP_VERSION                4
+#define SNTP_MODE_CLIENT            3
+#define SNTP_MODE_SERVER            4
+#define SNTP_LI(octet)              (((octet) >> 6) & 0x03)
+#define SNTP_VN(octet)              (((octet) >> 3) & 0x07)
+#define SNTP_MODE(octet)            ((octet) & 0x07)
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Highest valid stratum; stratum 0 is a Kiss-o'-Death reply
+ */
+//--------------------------------------------------------------------------------------------------
+#define SNTP_STRATUM_MAX            15
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * NTP server port
+ */
+//--------------------------------------------------------------------------------------------------
+#define SNTP_PORT_STR               "123"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Minimum dispersion increment, the floor of the round-trip delays in the root distance, see
+ * RFC 5905 section 7.2
+ */
+//--------------------------------------------------------------------------------------------------
+#define SNTP_MINDISP_NS             (10 * CLKSYNC_NS_PER_MSEC)
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Time to keep waiting for the remaining servers once a majority of the servers queried together
+ * answered
+ */
+//--------------------------------------------------------------------------------------------------
+#define SNTP_MAJORITY_GRACE_MS      CLKSYNC_ADDR_STAGGER_MS
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Seconds from the NTP epoch (1 Jan 1900) to the Unix epoch (1 Jan 1970)
+ */
+//--------------------------------------------------------------------------------------------------
+#define SNTP_UNIX_EPOCH_DELTA       2208988800ULL
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Size of the ancillary data received with each reply, enough for its receive timestamp
+ */
+//--------------------------------------------------------------------------------------------------
+#define SNTP_CONTROL_BYTES          CMSG_SPACE(sizeof(struct timespec))
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Number of requests sent to an address per query
+ */
+//--------------------------------------------------------------------------------------------------
+static uint32_t BurstCount = PA_CLKSYNC_NTP_BURST_DEFAULT;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read a big-endian 32-bit value from a packet
+ */
+//--------------------------------------------------------------------------------------------------
+static uint32_t GetUint32
+(
+    const uint8_t* bufPtr   ///< [IN] First octet of the value
+)
+{
+    return ((uint32_t)bufPtr[0] << 24) | ((uint32_t)bufPtr[1] << 16) |
+           ((uint32_t)bufPtr[2] << 8) | (uint32_t)bufPtr[3];
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Write a big-endian 32-bit value into a packet
+ */
+//--------------------------------------------------------------------------------------------------
+static void PutUint32
+(
+    uint8_t* bufPtr,        ///< [OUT] First octet of the value
+    uint32_t value          ///< [IN]  Value to write
+)
+{
+    bufPtr[0] = (uint8_t)(value >> 24);
+    bufPtr[1] = (uint8_t)(value >> 16);
+    bufPtr[2] = (uint8_t)(value >> 8);
+    bufPtr[3] = (uint8_t)value;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Convert a 64-bit NTP timestamp read from a packet into nanoseconds since the Unix epoch.
+ * Timestamps with the most significant bit cleared are taken to be in era 1, i.e. after 2036, as
+ * described in RFC 4330 section 3.
+ */
+//--------------------------------------------------------------------------------------------------
+static int64_t NtpTimestampToNs
+(
+    const uint8_t* bufPtr   ///< [IN] First octet of the timestamp
+)
+{
+    uint64_t secs = GetUint32(bufPtr);
+    uint64_t frac = GetUint32(bufPtr + 4);
+
+    if (!(secs & 0x80000000ULL))
+    {
+        secs += 0x100000000ULL;
+    }
+    secs -= SNTP_UNIX_EPOCH_DELTA;
+
+    return ((int64_t)secs * CLKSYNC_NS_PER_SEC) +
+           (int64_t)((frac * CLKSYNC_NS_PER_SEC) >> 32);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Write a time in nanoseconds since the Unix epoch into a packet as a 64-bit NTP timestamp
+ */
+//--------------------------------------------------------------------------------------------------
+static void NsToNtpTimestamp
+(
+    int64_t timeNs,         ///< [IN]  Time to convert
+    uint8_t* bufPtr         ///< [OUT] First octet of the timestamp
+)
+{
+    struct timespec ts = clkSync_NsToTimespec(timeNs);
+    uint64_t frac = ((uint64_t)ts.tv_nsec << 32) / CLKSYNC_NS_PER_SEC;
+
+    PutUint32(bufPtr, (uint32_t)((uint64_t)ts.tv_sec + SNTP_UNIX_EPOCH_DELTA));
+    PutUint32(bufPtr + 4, (uint32_t)frac);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check a received packet against the request it should answer, as described in RFC 4330
+ * section 5. Only the header is looked at; extension fields are left to the caller.
+ *
+ * @return
+ *      - LE_OK             The packet is a valid reply
+ *      - LE_NOT_FOUND      The packet doesn't answer the request sent and has to be ignored
+ *      - LE_UNAVAILABLE    The server answered but its time can't be used
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncSntp_CheckReply
+(
+    const uint8_t* requestPtr,  ///< [IN] Request sent
+    const uint8_t* replyPtr,    ///< [IN] Reply received
+    ssize_t replyLen            ///< [IN] Length of the reply received
+)
+{
+    uint8_t octet;
+    uint8_t stratum;
+
+    if (replyLen < SNTP_PACKET_LENGTH)
+    {
+        LE_DEBUG("Ignoring short packet of %zd bytes", replyLen);
+        return LE_NOT_FOUND;
+    }
+
+    octet = replyPtr[SNTP_OFFSET_LI_VN_MODE];
+    if ((SNTP_MODE(octet) != SNTP_MODE_SERVER) || (SNTP_VN(octet) < 3) ||
+        (SNTP_VN(octet) > SNTP_VERSION))
+    {
+        LE_DEBUG("Ignoring packet with version %d mode %d", SNTP_VN(octet), SNTP_MODE(octet));
+        return LE_NOT_FOUND;
+    }
+
+    if (memcmp(replyPtr + SNTP_OFFSET_ORIGINATE_TS, requestPtr + SNTP_OFFSET_TRANSMIT_TS, 8))
+    {
+        LE_DEBUG("Ignoring packet not originated by the present request");
+        return LE_NOT_FOUND;
+    }
+
+    stratum = replyPtr[SNTP_OFFSET_STRATUM];
+    if (0 == stratum)
+    {
+        LE_WARN("Kiss-o'-Death received from server: %.4s",
+                (const char*)(replyPtr + SNTP_OFFSET_REFERENCE_ID));
+        return LE_UNAVAILABLE;
+    }
+
+    if ((SNTP_LI(octet) == SNTP_LI_ALARM) || (stratum > SNTP_STRATUM_MAX))
+    {
+        LE_WARN("Server not synchronized: leap indicator %d, stratum %d",
+                SNTP_LI(octet), stratum);
+        return LE_UNAVAILABLE;
+    }
+
+    if (!GetUint32(replyPtr + SNTP_OFFSET_TRANSMIT_TS) &&
+        !GetUint32(replyPtr + SNTP_OFFSET_TRANSMIT_TS + 4))
+    {
+        LE_WARN("Server reply with null transmit timestamp");
+        return LE_UNAVAILABLE;
+    }
+
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Tell whether a reply is a Kiss-o'-Death with the given code, e.g. "NTSN"
+ *
+ * @return
+ *      true if the reply is such a Kiss-o'-Death
+ */
+//--------------------------------------------------------------------------------------------------
+bool clkSyncSntp_IsKissCode
+(
+    const uint8_t* replyPtr,    ///< [IN] Reply of at least SNTP_PACKET_LENGTH bytes
+    const char* codePtr         ///< [IN] Four character kiss code
+)
+{
+    return (0 == replyPtr[SNTP_OFFSET_STRATUM]) &&
+           (0 == memcmp(replyPtr + SNTP_OFFSET_REFERENCE_ID, codePtr, 4));
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Fill a client mode request, time stamped with the present time
+ *
+ * @return
+ *      The transmit time of the request, in nanoseconds since the Unix epoch
+ */
+//--------------------------------------------------------------------------------------------------
+int64_t clkSyncSntp_BuildRequest
+(
+    uint8_t* requestPtr                 ///< [OUT] Request of SNTP_PACKET_LENGTH bytes
+)
+{
+    int64_t t1;
+
+    // The transmit timestamp is echoed back by the server in the originate timestamp, which is
+    // how its reply is matched to this request
+    memset(requestPtr, 0, SNTP_PACKET_LENGTH);
+    requestPtr[SNTP_OFFSET_LI_VN_MODE] = (SNTP_VERSION << 3) | SNTP_MODE_CLIENT;
+    t1 = clkSync_GetClockNs(CLOCK_REALTIME);
+    NsToNtpTimestamp(t1, requestPtr + SNTP_OFFSET_TRANSMIT_TS);
+    return t1;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Ask the kernel to time stamp the datagrams received on a socket. Failing that, replies are time
+ * stamped when they are read.
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncSntp_EnableReceiveTimestamps
+(
+    int sockFd                          ///< [IN] Socket
+)
+{
+    int enable = 1;
+
+    if (setsockopt(sockFd, SOL_SOCKET, SO_TIMESTAMPNS, &enable, sizeof(enable)))
+    {
+        LE_DEBUG("Kernel receive timestamps not available (%m)");
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Receive a reply with the CLOCK_REALTIME at which the kernel received it, or the present time if
+ * the kernel gave no timestamp
+ *
+ * @return
+ *      Number of bytes received, or -1 on error with errno set
+ */
+//--------------------------------------------------------------------------------------------------
+ssize_t clkSyncSntp_ReceiveReply
+(
+    int sockFd,                         ///< [IN]     Socket to read
+    uint8_t* replyPtr,                  ///< [OUT]    Reply received
+    size_t replySize,                   ///< [IN]     Size of the reply buffer
+    struct sockaddr_storage* fromPtr,   ///< [OUT]    Source of the reply, may be NULL
+    socklen_t* fromLenPtr,              ///< [IN/OUT] Size of the source address, may be NULL
+    int64_t* t4Ptr                      ///< [OUT]    Receive time of the reply
+)
+{
+    union
+    {
+        struct cmsghdr align;
+        uint8_t buf[SNTP_CONTROL_BYTES];
+    } control;
+    struct iovec iov = { .iov_base = replyPtr, .iov_len = replySize };
+    struct msghdr msg = {0};
+    struct cmsghdr* cmsgPtr;
+    ssize_t len;
+
+    msg.msg_name = fromPtr;
+    msg.msg_namelen = fromLenPtr ? *fromLenPtr : 0;
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    len = recvmsg(sockFd, &msg, 0);
+    *t4Ptr = clkSync_GetClockNs(CLOCK_REALTIME);
+    if (len < 0)
+    {
+        return len;
+    }
+    if (fromLenPtr)
+    {
+        *fromLenPtr = msg.msg_namelen;
+    }
+
+    for (cmsgPtr = CMSG_FIRSTHDR(&msg); cmsgPtr; cmsgPtr = CMSG_NXTHDR(&msg, cmsgPtr))
+    {
+        if ((SOL_SOCKET == cmsgPtr->cmsg_level) && (SCM_TIMESTAMPNS == cmsgPtr->cmsg_type))
+        {
+            struct timespec ts;
+
+            memcpy(&ts, CMSG_DATA(cmsgPtr), sizeof(ts));
+            *t4Ptr = clkSync_TimespecToNs(&ts);
+            break;
+        }
+    }
+    return len;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Decode a valid reply into a sample, as described in RFC 4330 section 5
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncSntp_DecodeReply
+(
+    const uint8_t* replyPtr,            ///< [IN]  Reply checked by clkSyncSntp_CheckReply()
+    int64_t t1,                         ///< [IN]  Transmit time of the request
+    int64_t t4,                         ///< [IN]  Receive time of the reply
+    clkSync_Sample_t* samplePtr         ///< [OUT] Decoded sample
+)
+{
+    int64_t t2 = NtpTimestampToNs(replyPtr + SNTP_OFFSET_RECEIVE_TS);
+    int64_t t3 = NtpTimestampToNs(replyPtr + SNTP_OFFSET_TRANSMIT_TS);
+
+    // Root delay and dispersion are in the 16.16 NTP short format
+    int64_t rootDelayNs = ((int64_t)GetUint32(replyPtr + SNTP_OFFSET_ROOT_DELAY) *
+                           CLKSYNC_NS_PER_SEC) >> 16;
+    int64_t rootDispNs = ((int64_t)GetUint32(replyPtr + SNTP_OFFSET_ROOT_DISPERSION) *
+                          CLKSYNC_NS_PER_SEC) >> 16;
+
+    samplePtr->offsetNs = ((t2 - t1) + (t3 - t4)) / 2;
+    samplePtr->delayNs = (t4 - t1) - (t3 - t2);
+    samplePtr->rootDistanceNs = rootDelayNs + samplePtr->delayNs;
+    if (samplePtr->rootDistanceNs < SNTP_MINDISP_NS)
+    {
+        samplePtr->rootDistanceNs = SNTP_MINDISP_NS;
+    }
+    samplePtr->rootDistanceNs = samplePtr->rootDistanceNs / 2 + rootDispNs;
+    samplePtr->localTimeNs = t4;
+    samplePtr->stratum = replyPtr[SNTP_OFFSET_STRATUM];
+    LE_DEBUG("SNTP reply: offset %" PRId64 " ns, delay %" PRId64 " ns, stratum %d",
+             samplePtr->offsetNs, samplePtr->delayNs, samplePtr->stratum);
+}
+
+
+#if PA_CLKSYNC_WITH_REPLAY
+//--------------------------------------------------------------------------------------------------
+/**
+ * Fill the server mode reply a server would send to a request, as seen from the client: the
+ * server's clock being offsetNs ahead of the client's and the request taking half of delayNs to
+ * reach the server. The reply is sent right as the request is received.
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncSntp_BuildReply
+(
+    const uint8_t* requestPtr,          ///< [IN]  Request answered
+    int64_t offsetNs,                   ///< [IN]  Offset of the server's clock from the client's
+    int64_t delayNs,                    ///< [IN]  Round-trip delay between client and server
+    uint8_t stratum,                    ///< [IN]  Stratum of the server, 0 for a RATE
+                                        ///<       Kiss-o'-Death
+    uint8_t* replyPtr                   ///< [OUT] Reply of SNTP_PACKET_LENGTH bytes
+)
+{
+    int64_t t2 = NtpTimestampToNs(requestPtr + SNTP_OFFSET_TRANSMIT_TS) + delayNs / 2 + offsetNs;
+
+    memset(replyPtr, 0, SNTP_PACKET_LENGTH);
+    replyPtr[SNTP_OFFSET_LI_VN_MODE] = (SNTP_VN(requestPtr[SNTP_OFFSET_LI_VN_MODE]) << 3) |
+                                       SNTP_MODE_SERVER;
+    replyPtr[SNTP_OFFSET_STRATUM] = stratum;
+    memcpy(replyPtr + SNTP_OFFSET_REFERENCE_ID, stratum ? "LOCL" : "RATE", 4);
+    memcpy(replyPtr + SNTP_OFFSET_ORIGINATE_TS, requestPtr + SNTP_OFFSET_TRANSMIT_TS, 8);
+    NsToNtpTimestamp(t2, replyPtr + SNTP_OFFSET_RECEIVE_TS);
+    NsToNtpTimestamp(t2, replyPtr + SNTP_OFFSET_TRANSMIT_TS);
+}
+#endif
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Send a new client mode request on an attempt's socket
+ *
+ * @return
+ *      - LE_OK             Request sent
+ *      - LE_FAULT          The request couldn't be sent
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t SendRequest
+(
+    clkSync_Attempt_t* attemptPtr       ///< [IN] Attempt in progress
+)
+{
+    uint8_t* requestPtr = attemptPtr->buf;
+
+    attemptPtr->t1 = clkSyncSntp_BuildRequest(requestPtr);
+    attemptPtr->len = SNTP_PACKET_LENGTH;
+
+    if (send(attemptPtr->fd, requestPtr, SNTP_PACKET_LENGTH, 0) != SNTP_PACKET_LENGTH)
+    {
+        LE_ERROR("Failed to send request (%m)");
+        return LE_FAULT;
+    }
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Open a socket toward the given address and send it a client mode request
+ *
+ * @return
+ *      - LE_OK             Request sent
+ *      - LE_FAULT          The request couldn't be sent
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t OpenAttempt
+(
+    const char* addrStr,                ///< [IN]  Server address
+    clkSync_Attempt_t* attemptPtr       ///< [OUT] Attempt started
+)
+{
+    attemptPtr->fd = clkSyncSocket_Acquire(addrStr, SNTP_PORT_STR);
+    if (attemptPtr->fd < 0)
+    {
+        return LE_FAULT;
+    }
+
+    if (LE_OK != SendRequest(attemptPtr))
+    {
+        return LE_FAULT;
+    }
+
+    attemptPtr->events = POLLIN;
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Receive and decode the reply to an attempt's request. In burst mode, the next request is then
+ * sent until the burst is complete, and the sample of the least delay is kept.
+ *
+ * @return
+ *      - LE_OK             A valid reply was received and decoded into the sample
+ *      - LE_IN_PROGRESS    No reply to the request received yet
+ *      - LE_UNAVAILABLE    The server can't be used
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t HandleAttempt
+(
+    clkSync_Attempt_t* attemptPtr,      ///< [IN]  Attempt in progress
+    short revents,                      ///< [IN]  Events received on its socket
+    uint32_t timeoutMs,                 ///< [IN]  Time given to the attempt
+    clkSync_Sample_t* samplePtr         ///< [OUT] Decoded sample
+)
+{
+    uint8_t reply[SNTP_PACKET_LENGTH * 2];
+    clkSync_Sample_t sample;
+    int64_t t4;
+    ssize_t len;
+    le_result_t result;
+
+    len = clkSyncSntp_ReceiveReply(attemptPtr->fd, reply, sizeof(reply), NULL, NULL, &t4);
+    if (len < 0)
+    {
+        if ((EAGAIN == errno) || (EINTR == errno))
+        {
+            return LE_IN_PROGRESS;
+        }
+
+        // ICMP errors such as port unreachable are reported on connected sockets
+        LE_WARN("Failed to receive reply (%m)");
+        result = LE_UNAVAILABLE;
+    }
+    else
+    {
+        result = clkSyncSntp_CheckReply(attemptPtr->buf, reply, len);
+        if (LE_NOT_FOUND == result)
+        {
+            return LE_IN_PROGRESS;
+        }
+    }
+
+    if (LE_OK != result)
+    {
+        // The rest of a burst may be refused, e.g. with a RATE kiss code
+        if (attemptPtr->sampleCount > 0)
+        {
+            *samplePtr = attemptPtr->bestSample;
+            return LE_OK;
+        }
+        return result;
+    }
+
+    clkSyncSntp_DecodeReply(reply, attemptPtr->t1, t4, &sample);
+    if ((0 == attemptPtr->sampleCount) || (sample.delayNs < attemptPtr->bestSample.delayNs))
+    {
+        attemptPtr->bestSample = sample;
+    }
+
+    // The offset holds for the whole burst, so the time is given as of the last reply
+    attemptPtr->bestSample.localTimeNs = sample.localTimeNs;
+    attemptPtr->sampleCount++;
+
+    if ((attemptPtr->sampleCount < BurstCount) && (LE_OK == SendRequest(attemptPtr)))
+    {
+        return LE_IN_PROGRESS;
+    }
+    if (attemptPtr->sampleCount > 1)
+    {
+        LE_DEBUG("SNTP burst of %" PRIu32 " samples: least delay %" PRId64 " ns",
+                 attemptPtr->sampleCount, attemptPtr->bestSample.delayNs);
+    }
+    *samplePtr = attemptPtr->bestSample;
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * SNTP client as run by a race across the addresses of a server
+ */
+//--------------------------------------------------------------------------------------------------
+const clkSync_Client_t clkSyncSntp_Client =
+{
+    .namePtr = "SNTP",
+    .openFunc = OpenAttempt,
+    .handleFunc = HandleAttempt,
+    .closeFunc = clkSyncSocket_Release,
+};
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Query the given NTP server in SNTP client mode, racing its addresses
+ *
+ * @return
+ *      - LE_OK             A valid reply was received and decoded into the sample
+ *      - LE_BAD_PARAMETER  Invalid inputs
+ *      - LE_UNAVAILABLE    No valid reply received before the timeout, or the server is not
+ *                          synchronized or refused the request
+ *      - LE_TIMEOUT        No valid reply received before the deadline
+ *      - LE_FAULT          No request could be sent
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncSntp_Query
+(
+    const clkSync_AddrList_t* listPtr,  ///< [IN]  Server addresses, tried in order
+    uint32_t timeoutMs,                 ///< [IN]  Time to wait for the reply on each address
+    int64_t deadlineNs,                 ///< [IN]  CLOCK_MONOTONIC time to give up at, whatever
+                                        ///<       the addresses left to try; INT64_MAX if none
+    clkSync_Sample_t* samplePtr         ///< [OUT] Decoded sample
+)
+{
+    clkSync_Race_t race;
+
+    if (!listPtr || !samplePtr || (0 == listPtr->count))
+    {
+        LE_ERROR("Input error");
+        return LE_BAD_PARAMETER;
+    }
+
+    clkSyncRace_Init(&race, &clkSyncSntp_Client, listPtr, timeoutMs);
+    clkSyncRace_SetDeadline(&race, deadlineNs);
+    return clkSyncRace_Run(&race, samplePtr);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * State of a server queried by clkSyncSntp_QueryServers()
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    struct sockaddr_storage addr;               ///< Address the request was sent to
+    socklen_t addrLen;                          ///< Length of addr
+    uint8_t request[SNTP_PACKET_LENGTH];        ///< Request sent
+    int64_t t1;                                 ///< Transmit time of the request
+    bool pending;                               ///< Whether a reply is still awaited
+}
+SntpServer_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Find the pending server a datagram was received from
+ *
+ * @return
+ *      The server's index, or count if not found
+ */
+//--------------------------------------------------------------------------------------------------
+static size_t FindServer
+(
+    const SntpServer_t* serversPtr,             ///< [IN] Servers queried
+    size_t count,                               ///< [IN] Number of servers queried
+    const struct sockaddr_storage* fromPtr,     ///< [IN] Source of the datagram
+    socklen_t fromLen                           ///< [IN] Length of the source address
+)
+{
+    size_t i;
+
+    for (i = 0; i < count; i++)
+    {
+        if (serversPtr[i].pending && (serversPtr[i].addrLen == fromLen) &&
+            (0 == memcmp(&serversPtr[i].addr, fromPtr, fromLen)))
+        {
+            return i;
+        }
+    }
+    return count;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Receive all the datagrams queued on a socket and match them to the servers queried
+ */
+//--------------------------------------------------------------------------------------------------
+static void ReceiveReplies
+(
+    int sockFd,                         ///< [IN]     Socket to read
+    SntpServer_t* serversPtr,           ///< [IN/OUT] Servers queried
+    size_t count,                       ///< [IN]     Number of servers queried
+    clkSync_Sample_t* samplesPtr,       ///< [OUT]    Samples received
+    size_t* sampleCountPtr,             ///< [IN/OUT] Number of samples received
+    size_t* pendingCountPtr             ///< [IN/OUT] Number of servers still awaited
+)
+{
+    for (;;)
+    {
+        uint8_t reply[SNTP_PACKET_LENGTH * 2];
+        struct sockaddr_storage from;
+        socklen_t fromLen = sizeof(from);
+        ssize_t len;
+        int64_t t4;
+        size_t index;
+        le_result_t result;
+
+        len = clkSyncSntp_ReceiveReply(sockFd, reply, sizeof(reply), &from, &fromLen, &t4);
+        if (len < 0)
+        {
+            if ((EAGAIN != errno) && (EINTR != errno))
+            {
+                LE_WARN("Failed to receive reply (%m)");
+            }
+            return;
+        }
+
+        // Datagrams from any other source than the servers queried are dropped here, as a
+        // connected socket would do
+        index = FindServer(serversPtr, count, &from, fromLen);
+        if (index >= count)
+        {
+            continue;
+        }
+
+        result = clkSyncSntp_CheckReply(serversPtr[index].request, reply, len);
+        if (LE_NOT_FOUND == result)
+        {
+            continue;
+        }
+
+        serversPtr[index].pending = false;
+        (*pendingCountPtr)--;
+        if (LE_OK == result)
+        {
+            clkSync_Sample_t* samplePtr = &samplesPtr[*sampleCountPtr];
+
+            clkSyncSntp_DecodeReply(reply, serversPtr[index].t1, t4, samplePtr);
+            samplePtr->addrIndex = index;
+            (*sampleCountPtr)++;
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Query several NTP servers together in SNTP client mode. All the requests are sent at once over
+ * a single unconnected socket per address family, and the replies are collected until every
+ * server answered, the timeout expired, or SNTP_MAJORITY_GRACE_MS after a majority of the servers
+ * answered, so that a dead server doesn't hold the others' result for the whole timeout.
+ *
+ * @return
+ *      - LE_OK             At least one valid reply was received; the samples are returned in the
+ *                          order of reception with addrIndex set to the server's index in the list
+ *      - LE_BAD_PARAMETER  Invalid inputs
+ *      - LE_UNAVAILABLE    No valid reply received before the timeout
+ *      - LE_TIMEOUT        No valid reply received before the deadline
+ *      - LE_FAULT          No request could be sent
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncSntp_QueryServers
+(
+    const clkSync_AddrList_t* listPtr,  ///< [IN]  Numeric address of each server
+    uint32_t timeoutMs,                 ///< [IN]  Time to wait for the replies
+    int64_t deadlineNs,                 ///< [IN]  CLOCK_MONOTONIC time to give up at, if before
+                                        ///<       the timeout; INT64_MAX if none
+    clkSync_Sample_t* samplesPtr,       ///< [OUT] Samples, room for CLKSYNC_MAX_ADDRS
+    size_t* sampleCountPtr              ///< [OUT] Number of samples returned
+)
+{
+    SntpServer_t servers[CLKSYNC_MAX_ADDRS];
+    int sockFds[2] = {-1, -1};
+    size_t i, pendingCount = 0;
+    int64_t nowNs, endNs;
+    bool endsAtDeadline = false;
+    bool inGrace = false;
+
+    if (!listPtr || !samplesPtr || !sampleCountPtr || (0 == listPtr->count) ||
+        (listPtr->count > CLKSYNC_MAX_ADDRS))
+    {
+        LE_ERROR("Input error");
+        return LE_BAD_PARAMETER;
+    }
+    *sampleCountPtr = 0;
+
+    memset(servers, 0, sizeof(servers));
+    for (i = 0; i < listPtr->count; i++)
+    {
+        SntpServer_t* serverPtr = &servers[i];
+        struct addrinfo hints = {0};
+        struct addrinfo* resultPtr;
+        int* sockFdPtr;
+        int rc;
+
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_DGRAM;
+        hints.ai_flags = AI_NUMERICHOST | AI_NUMERICSERV;
+        rc = getaddrinfo(listPtr->addrs[i], SNTP_PORT_STR, &hints, &resultPtr);
+        if (rc)
+        {
+            LE_ERROR("Invalid server address %s: %s", listPtr->addrs[i], gai_strerror(rc));
+            continue;
+        }
+        memcpy(&serverPtr->addr, resultPtr->ai_addr, resultPtr->ai_addrlen);
+        serverPtr->addrLen = resultPtr->ai_addrlen;
+        freeaddrinfo(resultPtr);
+
+        sockFdPtr = &sockFds[(AF_INET6 == serverPtr->addr.ss_family) ? 1 : 0];
+        if (*sockFdPtr < 0)
+        {
+            *sockFdPtr = socket(serverPtr->addr.ss_family, SOCK_DGRAM | SOCK_NONBLOCK |
+                                SOCK_CLOEXEC, 0);
+            if (*sockFdPtr < 0)
+            {
+                LE_ERROR("Failed to create socket (%m)");
+                continue;
+            }
+            clkSyncSntp_EnableReceiveTimestamps(*sockFdPtr);
+        }
+
+        serverPtr->t1 = clkSyncSntp_BuildRequest(serverPtr->request);
+        if (sendto(*sockFdPtr, serverPtr->request, SNTP_PACKET_LENGTH, 0,
+                   (struct sockaddr*)&serverPtr->addr, serverPtr->addrLen) != SNTP_PACKET_LENGTH)
+        {
+            LE_WARN("Failed to send request to %s (%m)", listPtr->addrs[i]);
+            continue;
+        }
+        serverPtr->pending = true;
+        pendingCount++;
+    }
+
+    if (0 == pendingCount)
+    {
+        for (i = 0; i < 2; i++)
+        {
+            if (sockFds[i] >= 0)
+            {
+                close(sockFds[i]);
+            }
+        }
+        return LE_FAULT;
+    }
+    LE_DEBUG("SNTP requests sent to %zu servers", pendingCount);
+
+    endNs = clkSync_GetClockNs(CLOCK_MONOTONIC) + (int64_t)timeoutMs * CLKSYNC_NS_PER_MSEC;
+    if (deadlineNs < endNs)
+    {
+        endNs = deadlineNs;
+        endsAtDeadline = true;
+    }
+    nowNs = clkSync_GetClockNs(CLOCK_MONOTONIC);
+    while ((pendingCount > 0) && (nowNs < endNs))
+    {
+        struct pollfd pfds[2];
+        nfds_t pfdCount = 0;
+        int rc;
+
+        for (i = 0; i < 2; i++)
+        {
+            if (sockFds[i] >= 0)
+            {
+                pfds[pfdCount].fd = sockFds[i];
+                pfds[pfdCount].events = POLLIN;
+                pfds[pfdCount].revents = 0;
+                pfdCount++;
+            }
+        }
+
+        rc = poll(pfds, pfdCount,
+                  (int)((endNs - nowNs + CLKSYNC_NS_PER_MSEC - 1) / CLKSYNC_NS_PER_MSEC));
+        if ((rc < 0) && (EINTR != errno))
+        {
+            LE_ERROR("Failed to wait for SNTP replies (%m)");
+            break;
+        }
+
+        for (i = 0; (rc > 0) && (i < pfdCount); i++)
+        {
+            if (pfds[i].revents)
+            {
+                ReceiveReplies(pfds[i].fd, servers, listPtr->count, samplesPtr,
+                               sampleCountPtr, &pendingCount);
+            }
+        }
+
+        nowNs = clkSync_GetClockNs(CLOCK_MONOTONIC);
+        if (!inGrace && (*sampleCountPtr * 2 > listPtr->count) && (pendingCount > 0))
+        {
+            int64_t graceNs = nowNs + (int64_t)SNTP_MAJORITY_GRACE_MS * CLKSYNC_NS_PER_MSEC;
+
+            inGrace = true;
+            if (graceNs < endNs)
+            {
+                endNs = graceNs;
+                endsAtDeadline = false;
+            }
+        }
+    }
+
+    for (i = 0; i < 2; i++)
+    {
+        if (sockFds[i] >= 0)
+        {
+            close(sockFds[i]);
+        }
+    }
+
+    for (i = 0; i < listPtr->count; i++)
+    {
+        if (servers[i].pending)
+        {
+            LE_WARN("No reply from NTP server %s within %u ms", listPtr->addrs[i], timeoutMs);
+        }
+    }
+
+    if (*sampleCountPtr > 0)
+    {
+        return LE_OK;
+    }
+    return endsAtDeadline ? LE_TIMEOUT : LE_UNAVAILABLE;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the number of requests sent in a row to an address per query, the sample of the least delay
+ * being kept; 1 disables the burst mode
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncSntp_SetBurst
+(
+    uint32_t count                      ///< [IN] Number of requests, at least 1
+)
+{
+    BurstCount = (count > 0) ? count : 1;
+}
@@ -0,0 +1,214 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file clkSyncSntp.h
+ *
+ * Native SNTPv4 (RFC 4330) client of the Linux Clock Service Adapter
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef CLKSYNC_SNTP_H_INCLUDE_GUARD
+#define CLKSYNC_SNTP_H_INCLUDE_GUARD
+
+#include "legato.h"
+#include "clkSyncLocal.h"
+#include "clkSyncRace.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Default time to wait for a server reply, the same as given to ntpdate with "-t 1.0"
+ */
+//--------------------------------------------------------------------------------------------------
+#define CLKSYNC_SNTP_TIMEOUT_MS     1000
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Length of an NTP packet without extension fields
+ */
+//--------------------------------------------------------------------------------------------------
+#define CLKSYNC_SNTP_PACKET_LENGTH  48
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * SNTP client as run by a race across the addresses of a server
+ */
+//--------------------------------------------------------------------------------------------------
+extern const clkSync_Client_t clkSyncSntp_Client;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Query the given NTP server in SNTP client mode, racing its addresses
+ *
+ * @return
+ *      - LE_OK             A valid reply was received and decoded into the sample
+ *      - LE_BAD_PARAMETER  Invalid inputs
+ *      - LE_UNAVAILABLE    No valid reply received before the timeout, or the server is not
+ *                          synchronized or refused the request
+ *      - LE_TIMEOUT        No valid reply received before the deadline
+ *      - LE_FAULT          No request could be sent
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncSntp_Query
+(
+    const clkSync_AddrList_t* listPtr,  ///< [IN]  Server addresses, tried in order
+    uint32_t timeoutMs,                 ///< [IN]  Time to wait for the reply on each address
+    int64_t deadlineNs,                 ///< [IN]  CLOCK_MONOTONIC time to give up at, whatever
+                                        ///<       the addresses left to try; INT64_MAX if none
+    clkSync_Sample_t* samplePtr         ///< [OUT] Decoded sample
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Query several NTP servers together in SNTP client mode, over a single socket per address family
+ *
+ * @return
+ *      - LE_OK             At least one valid reply was received; the samples are returned in the
+ *                          order of reception with addrIndex set to the server's index in the list
+ *      - LE_BAD_PARAMETER  Invalid inputs
+ *      - LE_UNAVAILABLE    No valid reply received before the timeout
+ *      - LE_TIMEOUT        No valid reply received before the deadline
+ *      - LE_FAULT          No request could be sent
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncSntp_QueryServers
+(
+    const clkSync_AddrList_t* listPtr,  ///< [IN]  Numeric address of each server
+    uint32_t timeoutMs,                 ///< [IN]  Time to wait for the replies
+    int64_t deadlineNs,                 ///< [IN]  CLOCK_MONOTONIC time to give up at, if before
+                                        ///<       the timeout; INT64_MAX if none
+    clkSync_Sample_t* samplesPtr,       ///< [OUT] Samples, room for CLKSYNC_MAX_ADDRS
+    size_t* sampleCountPtr              ///< [OUT] Number of samples returned
+);
+
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Fill a client mode request, time stamped with the present time. Protocols extending SNTP, such
+ * as NTS, append their extension fields to it.
+ *
+ * @return
+ *      The transmit time of the request, in nanoseconds since the Unix epoch
+ */
+//--------------------------------------------------------------------------------------------------
+int64_t clkSyncSntp_BuildRequest
+(
+    uint8_t* requestPtr                 ///< [OUT] Request of CLKSYNC_SNTP_PACKET_LENGTH bytes
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Ask the kernel to time stamp the datagrams received on a socket. Failing that, replies are time
+ * stamped when they are read.
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncSntp_EnableReceiveTimestamps
+(
+    int sockFd                          ///< [IN] Socket
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Receive a reply with the CLOCK_REALTIME at which the kernel received it, or the present time if
+ * the kernel gave no timestamp
+ *
+ * @return
+ *      Number of bytes received, or -1 on error with errno set
+ */
+//--------------------------------------------------------------------------------------------------
+ssize_t clkSyncSntp_ReceiveReply
+(
+    int sockFd,                         ///< [IN]     Socket to read
+    uint8_t* replyPtr,                  ///< [OUT]    Reply received
+    size_t replySize,                   ///< [IN]     Size of the reply buffer
+    struct sockaddr_storage* fromPtr,   ///< [OUT]    Source of the reply, may be NULL
+    socklen_t* fromLenPtr,              ///< [IN/OUT] Size of the source address, may be NULL
+    int64_t* t4Ptr                      ///< [OUT]    Receive time of the reply
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Check a received packet against the request it should answer, as described in RFC 4330
+ * section 5. Only the header is looked at; extension fields are left to the caller.
+ *
+ * @return
+ *      - LE_OK             The packet is a valid reply
+ *      - LE_NOT_FOUND      The packet doesn't answer the request sent and has to be ignored
+ *      - LE_UNAVAILABLE    The server answered but its time can't be used
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncSntp_CheckReply
+(
+    const uint8_t* requestPtr,          ///< [IN] Request sent
+    const uint8_t* replyPtr,            ///< [IN] Reply received
+    ssize_t replyLen                    ///< [IN] Length of the reply received
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Tell whether a reply is a Kiss-o'-Death with the given code, e.g. "NTSN"
+ *
+ * @return
+ *      true if the reply is such a Kiss-o'-Death
+ */
+//--------------------------------------------------------------------------------------------------
+bool clkSyncSntp_IsKissCode
+(
+    const uint8_t* replyPtr,            ///< [IN] Reply of at least CLKSYNC_SNTP_PACKET_LENGTH bytes
+    const char* codePtr                 ///< [IN] Four character kiss code
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Decode a valid reply into a sample, as described in RFC 4330 section 5
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncSntp_DecodeReply
+(
+    const uint8_t* replyPtr,            ///< [IN]  Reply checked by clkSyncSntp_CheckReply()
+    int64_t t1,                         ///< [IN]  Transmit time of the request
+    int64_t t4,                         ///< [IN]  Receive time of the reply
+    clkSync_Sample_t* samplePtr         ///< [OUT] Decoded sample
+);
+
+
+#if PA_CLKSYNC_WITH_REPLAY
+//--------------------------------------------------------------------------------------------------
+/**
+ * Fill the server mode reply a server would send to a request, as seen from the client: the
+ * server's clock being offsetNs ahead of the client's and the request taking half of delayNs to
+ * reach the server. The reply is sent right as the request is received.
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncSntp_BuildReply
+(
+    const uint8_t* requestPtr,          ///< [IN]  Request answered
+    int64_t offsetNs,                   ///< [IN]  Offset of the server's clock from the client's
+    int64_t delayNs,                    ///< [IN]  Round-trip delay between client and server
+    uint8_t stratum,                    ///< [IN]  Stratum of the server, 0 for a RATE
+                                        ///<       Kiss-o'-Death
+    uint8_t* replyPtr                   ///< [OUT] Reply of CLKSYNC_SNTP_PACKET_LENGTH bytes
+);
+#endif
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the number of requests sent in a row to an address per query, the sample of the least delay
+ * being kept; 1 disables the burst mode
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncSntp_SetBurst
+(
+    uint32_t count                      ///< [IN] Number of requests, at least 1
+);
+
+#endif // CLKSYNC_SNTP_H_INCLUDE_GUARD
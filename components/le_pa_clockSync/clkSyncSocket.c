@@ -0,0 +1,463 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file clkSyncSocket.c
+ *
+ * Pool of the UDP sockets of the native NTP clients of the Linux Clock Service Adapter. Rather than
+ * creating, configuring and closing a socket for each query, a few sockets of each address family
+ * are opened ahead and kept across the queries, each connected to the server it is lent for so
+ * that the kernel still drops the datagrams of any other peer. A socket lent again to the same
+ * server is not even connected again.
+ *
+ * The sockets are opened again when the data connection changes, since the local address chosen
+ * for a connected socket is the one of the connection it was connected over.
+ *
+ * A transport set in place of the pool, such as the replay of recorded server replies, lends the
+ * sockets of the queries instead; the clients exchange on them just as on the pooled ones.
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include <netdb.h>
+#include "clkSyncLocal.h"
+#include "clkSyncSntp.h"
+#include "clkSyncSocket.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Number of sockets kept per address family
+ */
+//--------------------------------------------------------------------------------------------------
+#define SOCKET_POOL_SIZE            4
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Number of sockets opened per address family ahead of the first query and after each flush
+ */
+//--------------------------------------------------------------------------------------------------
+#define SOCKET_PREWARM_COUNT        1
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Largest number of stale datagrams or errors discarded from a socket lent again
+ */
+//--------------------------------------------------------------------------------------------------
+#define SOCKET_MAX_DRAIN            8
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Socket of the pool
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    int fd;                                 ///< Socket, -1 if none
+    bool inUse;                             ///< Whether the socket is lent
+    bool isStale;                           ///< Whether to close the socket once given back
+    struct sockaddr_storage peer;           ///< Address the socket is connected to
+    socklen_t peerLen;                      ///< Length of peer, 0 if not connected
+}
+PooledSocket_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Address families pooled
+ */
+//--------------------------------------------------------------------------------------------------
+static const int Families[] = { AF_INET, AF_INET6 };
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Sockets of each address family
+ */
+//--------------------------------------------------------------------------------------------------
+static PooledSocket_t Pool[NUM_ARRAY_MEMBERS(Families)][SOCKET_POOL_SIZE];
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Mutex protecting the pool
+ */
+//--------------------------------------------------------------------------------------------------
+static le_mutex_Ref_t PoolMutex;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Transport lending the sockets instead of the pool, NULL if none; protected by the pool's mutex
+ */
+//--------------------------------------------------------------------------------------------------
+static const clkSyncSocket_Transport_t* TransportPtr;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the index of an address family in the pool
+ *
+ * @return
+ *      The family's index, or the number of families if not pooled
+ */
+//--------------------------------------------------------------------------------------------------
+static size_t GetFamilyIndex
+(
+    int family                              ///< [IN] Address family
+)
+{
+    size_t i;
+
+    for (i = 0; i < NUM_ARRAY_MEMBERS(Families); i++)
+    {
+        if (Families[i] == family)
+        {
+            break;
+        }
+    }
+    return i;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Open a non-blocking UDP socket of the given address family with the receive timestamps enabled
+ *
+ * @return
+ *      - The socket on success
+ *      - -1 on failure
+ */
+//--------------------------------------------------------------------------------------------------
+static int OpenSocket
+(
+    int family                              ///< [IN] Address family
+)
+{
+    int fd = socket(family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+
+    if (fd < 0)
+    {
+        LE_DEBUG("Failed to create socket of family %d (%m)", family);
+        return -1;
+    }
+    clkSyncSntp_EnableReceiveTimestamps(fd);
+    return fd;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Open the sockets of each address family ahead of the queries, the pool's mutex being held
+ */
+//--------------------------------------------------------------------------------------------------
+static void PrewarmPool
+(
+    void
+)
+{
+    size_t family, i;
+    size_t count;
+
+    for (family = 0; family < NUM_ARRAY_MEMBERS(Families); family++)
+    {
+        count = 0;
+        for (i = 0; (i < SOCKET_POOL_SIZE) && (count < SOCKET_PREWARM_COUNT); i++)
+        {
+            PooledSocket_t* socketPtr = &Pool[family][i];
+
+            if (socketPtr->fd < 0)
+            {
+                // Without IPv6 support, its sockets are simply left to be opened on demand
+                socketPtr->fd = OpenSocket(Families[family]);
+                socketPtr->peerLen = 0;
+            }
+            if (socketPtr->fd >= 0)
+            {
+                count++;
+            }
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Discard what was left on a socket by its previous use: replies received too late, or an error
+ * reported by ICMP
+ */
+//--------------------------------------------------------------------------------------------------
+static void DrainSocket
+(
+    int fd                                  ///< [IN] Socket
+)
+{
+    uint8_t buf[CLKSYNC_SNTP_PACKET_LENGTH];
+    int i;
+
+    for (i = 0; i < SOCKET_MAX_DRAIN; i++)
+    {
+        if ((recv(fd, buf, sizeof(buf), MSG_DONTWAIT) < 0) &&
+            ((EAGAIN == errno) || (EWOULDBLOCK == errno)))
+        {
+            break;
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Initialize the pool and open its sockets ahead of the first query
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncSocket_Init
+(
+    void
+)
+{
+    size_t family, i;
+
+    PoolMutex = le_mutex_CreateNonRecursive("ClkSyncSocketMutex");
+    for (family = 0; family < NUM_ARRAY_MEMBERS(Families); family++)
+    {
+        for (i = 0; i < SOCKET_POOL_SIZE; i++)
+        {
+            Pool[family][i].fd = -1;
+        }
+    }
+
+    le_mutex_Lock(PoolMutex);
+    PrewarmPool();
+    le_mutex_Unlock(PoolMutex);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get a non-blocking UDP socket connected to the given numeric address and port, with the receive
+ * timestamps enabled, from the pool when one of the address family is idle. The socket is given
+ * back with clkSyncSocket_Release().
+ *
+ * @return
+ *      - The socket on success
+ *      - -1 on failure
+ */
+//--------------------------------------------------------------------------------------------------
+int clkSyncSocket_Acquire
+(
+    const char* addrStr,                        ///< [IN] Numeric IPv4/v6 address
+    const char* portStr                         ///< [IN] Numeric port
+)
+{
+    const clkSyncSocket_Transport_t* transportPtr;
+    struct addrinfo hints = {0};
+    struct addrinfo* resultPtr;
+    PooledSocket_t* socketPtr = NULL;
+    size_t family, i;
+    int rc, fd;
+
+    le_mutex_Lock(PoolMutex);
+    transportPtr = TransportPtr;
+    le_mutex_Unlock(PoolMutex);
+    if (transportPtr)
+    {
+        return transportPtr->acquireFunc(addrStr, portStr);
+    }
+
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    hints.ai_flags = AI_NUMERICHOST | AI_NUMERICSERV;
+    rc = getaddrinfo(addrStr, portStr, &hints, &resultPtr);
+    if (rc)
+    {
+        LE_ERROR("Invalid server address %s: %s", addrStr, gai_strerror(rc));
+        return -1;
+    }
+
+    // An idle socket already connected to the server is preferred, then any idle or free one
+    family = GetFamilyIndex(resultPtr->ai_family);
+    le_mutex_Lock(PoolMutex);
+    for (i = 0; (family < NUM_ARRAY_MEMBERS(Families)) && (i < SOCKET_POOL_SIZE); i++)
+    {
+        PooledSocket_t* candidatePtr = &Pool[family][i];
+
+        if (candidatePtr->inUse)
+        {
+            continue;
+        }
+        if ((candidatePtr->fd >= 0) && (candidatePtr->peerLen == resultPtr->ai_addrlen) &&
+            (0 == memcmp(&candidatePtr->peer, resultPtr->ai_addr, resultPtr->ai_addrlen)))
+        {
+            socketPtr = candidatePtr;
+            break;
+        }
+        if (!socketPtr || ((socketPtr->fd < 0) && (candidatePtr->fd >= 0)))
+        {
+            socketPtr = candidatePtr;
+        }
+    }
+    if (socketPtr)
+    {
+        socketPtr->inUse = true;
+        if (socketPtr->fd < 0)
+        {
+            socketPtr->fd = OpenSocket(resultPtr->ai_family);
+            socketPtr->peerLen = 0;
+        }
+        fd = socketPtr->fd;
+    }
+    else
+    {
+        // All the sockets of the family are lent, this one is closed once given back
+        fd = OpenSocket(resultPtr->ai_family);
+    }
+    le_mutex_Unlock(PoolMutex);
+
+    if (fd < 0)
+    {
+        if (socketPtr)
+        {
+            le_mutex_Lock(PoolMutex);
+            socketPtr->inUse = false;
+            le_mutex_Unlock(PoolMutex);
+        }
+        freeaddrinfo(resultPtr);
+        return -1;
+    }
+
+    if (socketPtr && (0 != socketPtr->peerLen))
+    {
+        DrainSocket(fd);
+    }
+    if (!socketPtr || (socketPtr->peerLen != resultPtr->ai_addrlen) ||
+        (0 != memcmp(&socketPtr->peer, resultPtr->ai_addr, resultPtr->ai_addrlen)))
+    {
+        // A UDP socket connected again just changes its peer; the socket being lent, only this
+        // caller looks at its peer
+        rc = connect(fd, resultPtr->ai_addr, resultPtr->ai_addrlen);
+        if (socketPtr)
+        {
+            socketPtr->peerLen = 0;
+            if (0 == rc)
+            {
+                memcpy(&socketPtr->peer, resultPtr->ai_addr, resultPtr->ai_addrlen);
+                socketPtr->peerLen = resultPtr->ai_addrlen;
+            }
+        }
+        if (rc)
+        {
+            LE_WARN("Failed to connect socket to %s (%m)", addrStr);
+            freeaddrinfo(resultPtr);
+            clkSyncSocket_Release(fd);
+            return -1;
+        }
+    }
+
+    freeaddrinfo(resultPtr);
+    return fd;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Give back a socket got from clkSyncSocket_Acquire(), keeping it open for the next queries
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncSocket_Release
+(
+    int fd                                      ///< [IN] Socket
+)
+{
+    const clkSyncSocket_Transport_t* transportPtr;
+    size_t family, i;
+
+    le_mutex_Lock(PoolMutex);
+    for (family = 0; family < NUM_ARRAY_MEMBERS(Families); family++)
+    {
+        for (i = 0; i < SOCKET_POOL_SIZE; i++)
+        {
+            PooledSocket_t* socketPtr = &Pool[family][i];
+
+            if (!socketPtr->inUse || (socketPtr->fd != fd))
+            {
+                continue;
+            }
+
+            socketPtr->inUse = false;
+            if (socketPtr->isStale)
+            {
+                close(fd);
+                socketPtr->fd = -1;
+                socketPtr->peerLen = 0;
+                socketPtr->isStale = false;
+            }
+            le_mutex_Unlock(PoolMutex);
+            return;
+        }
+    }
+    transportPtr = TransportPtr;
+    le_mutex_Unlock(PoolMutex);
+
+    // A socket lent by a transport is given back to it, which closes any other
+    if (transportPtr)
+    {
+        transportPtr->releaseFunc(fd);
+    }
+    else
+    {
+        close(fd);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Close the sockets of the pool and open new ones, e.g. when the data connection changes; those in
+ * use are closed once given back
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncSocket_Flush
+(
+    void
+)
+{
+    size_t family, i;
+
+    le_mutex_Lock(PoolMutex);
+    for (family = 0; family < NUM_ARRAY_MEMBERS(Families); family++)
+    {
+        for (i = 0; i < SOCKET_POOL_SIZE; i++)
+        {
+            PooledSocket_t* socketPtr = &Pool[family][i];
+
+            if (socketPtr->inUse)
+            {
+                socketPtr->isStale = true;
+            }
+            else if (socketPtr->fd >= 0)
+            {
+                close(socketPtr->fd);
+                socketPtr->fd = -1;
+                socketPtr->peerLen = 0;
+            }
+        }
+    }
+    PrewarmPool();
+    le_mutex_Unlock(PoolMutex);
+    LE_DEBUG("Socket pool flushed");
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Lend the sockets of the next queries from the given transport instead of the pool; NULL goes back
+ * to the pool. A socket still lent by a transport no longer set is simply closed once given back.
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncSocket_SetTransport
+(
+    const clkSyncSocket_Transport_t* transportPtr   ///< [IN] Transport, NULL for the pool
+)
+{
+    le_mutex_Lock(PoolMutex);
+    TransportPtr = transportPtr;
+    le_mutex_Unlock(PoolMutex);
+    LE_INFO("Sockets lent by %s", transportPtr ? transportPtr->namePtr : "the pool");
+}
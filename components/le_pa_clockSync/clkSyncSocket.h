@@ -0,0 +1,99 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file clkSyncSocket.h
+ *
+ * Pool of the UDP sockets of the native NTP clients of the Linux Clock Service Adapter, and the
+ * transport replacing it, e.g. to replay recorded server replies
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef CLKSYNC_SOCKET_H_INCLUDE_GUARD
+#define CLKSYNC_SOCKET_H_INCLUDE_GUARD
+
+#include "legato.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Transport lending the sockets of the native NTP clients in place of the pool
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    const char* namePtr;                    ///< Transport name used in logs
+
+    /// Get a non-blocking datagram socket exchanging with the given numeric address and port.
+    /// Returns the socket, or -1 on failure.
+    int (*acquireFunc)(const char* addrStr, const char* portStr);
+
+    /// Give back a socket got from acquireFunc; it may also be given one it didn't lend, which it
+    /// then closes
+    void (*releaseFunc)(int fd);
+}
+clkSyncSocket_Transport_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Initialize the pool and open its sockets ahead of the first query
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncSocket_Init
+(
+    void
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get a non-blocking UDP socket connected to the given numeric address and port, with the receive
+ * timestamps enabled, from the pool when one of the address family is idle. The socket is given
+ * back with clkSyncSocket_Release().
+ *
+ * @return
+ *      - The socket on success
+ *      - -1 on failure
+ */
+//--------------------------------------------------------------------------------------------------
+int clkSyncSocket_Acquire
+(
+    const char* addrStr,                        ///< [IN] Numeric IPv4/v6 address
+    const char* portStr                         ///< [IN] Numeric port
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Give back a socket got from clkSyncSocket_Acquire(), keeping it open for the next queries
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncSocket_Release
+(
+    int fd                                      ///< [IN] Socket
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Close the sockets of the pool and open new ones, e.g. when the data connection changes; those in
+ * use are closed once given back
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncSocket_Flush
+(
+    void
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Lend the sockets of the next queries from the given transport instead of the pool; NULL goes back
+ * to the pool. A socket still lent by a transport no longer set is simply closed once given back.
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncSocket_SetTransport
+(
+    const clkSyncSocket_Transport_t* transportPtr   ///< [IN] Transport, NULL for the pool
+);
+
+#endif // CLKSYNC_SOCKET_H_INCLUDE_GUARD
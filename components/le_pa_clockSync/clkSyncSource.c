@@ -0,0 +1,241 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file clkSyncSource.c
+ *
+ * Chain of the time sources of the Linux Clock Service Adapter. The sources are tried from the
+ * cheapest: the times the modem already got from GNSS or from the network (NITZ), which the Clock
+ * Service reports to the adapter as it receives them, then the last time retrieved from a server,
+ * and only then NTP and TP, each of which wakes the radio up for an exchange with a server.
+ *
+ * A time reported is kept along with the CLOCK_BOOTTIME instant of its report, so that it is
+ * extrapolated to the current time independently of the system clock. The bound of the error of
+ * the estimate grows from the accuracy reported with the drift the local oscillator may have
+ * meanwhile, and the source is passed over once this bound exceeds the accuracy asked for.
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "pa_clkSync_linux.h"
+#include "clkSyncLocal.h"
+#include "clkSyncSource.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Last time reported by a local source
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    bool isReported;                        ///< Whether any time was reported
+    int64_t timeNs;                         ///< Time reported, since the Unix epoch
+    int64_t accuracyNs;                     ///< Bound of the error of the time reported
+    int64_t bootNs;                         ///< CLOCK_BOOTTIME at the report
+}
+ReportedTime_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Default order the sources are tried in, from the cheapest
+ */
+//--------------------------------------------------------------------------------------------------
+static const pa_clkSync_Source_t DefaultChain[] =
+{
+    PA_CLKSYNC_SOURCE_GNSS,
+    PA_CLKSYNC_SOURCE_NITZ,
+    PA_CLKSYNC_SOURCE_CACHE,
+    PA_CLKSYNC_SOURCE_NTP,
+    PA_CLKSYNC_SOURCE_TP
+};
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Order the sources are tried in, and number of sources tried
+ */
+//--------------------------------------------------------------------------------------------------
+static pa_clkSync_Source_t Chain[PA_CLKSYNC_SOURCE_MAX];
+static size_t ChainLength;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Last time reported by each local source, only GNSS and NITZ being reported
+ */
+//--------------------------------------------------------------------------------------------------
+static ReportedTime_t ReportedTimes[PA_CLKSYNC_SOURCE_NITZ + 1];
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Mutex protecting the chain and the times reported
+ */
+//--------------------------------------------------------------------------------------------------
+static le_mutex_Ref_t SourceMutex;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Initialize the times reported by the local sources
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncSource_Init
+(
+    void
+)
+{
+    SourceMutex = le_mutex_CreateNonRecursive("ClkSyncSourceMutex");
+    memcpy(Chain, DefaultChain, sizeof(DefaultChain));
+    ChainLength = NUM_ARRAY_MEMBERS(DefaultChain);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Remember the time just reported by a local source, replacing the one it previously reported
+ *
+ * @return
+ *      - LE_OK             Time remembered
+ *      - LE_BAD_PARAMETER  The source doesn't report its time
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncSource_Report
+(
+    pa_clkSync_Source_t source,                 ///< [IN] GNSS or NITZ
+    int64_t timeNs,                             ///< [IN] Time reported, since the Unix epoch
+    int64_t accuracyNs                          ///< [IN] Bound of the error of the time reported
+)
+{
+    ReportedTime_t* reportPtr;
+
+    if ((PA_CLKSYNC_SOURCE_GNSS != source) && (PA_CLKSYNC_SOURCE_NITZ != source))
+    {
+        return LE_BAD_PARAMETER;
+    }
+
+    reportPtr = &ReportedTimes[source];
+    le_mutex_Lock(SourceMutex);
+    reportPtr->timeNs = timeNs;
+    reportPtr->accuracyNs = accuracyNs;
+    reportPtr->bootNs = clkSync_GetClockNs(CLOCK_BOOTTIME);
+    reportPtr->isReported = true;
+    le_mutex_Unlock(SourceMutex);
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Estimate the current time from the last time reported by a local source
+ *
+ * @return
+ *      - LE_OK             Time estimated
+ *      - LE_NOT_FOUND      No time reported by the source
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncSource_Estimate
+(
+    pa_clkSync_Source_t source,                 ///< [IN]  GNSS or NITZ
+    int64_t* timeNsPtr,                         ///< [OUT] Time estimated, since the Unix epoch
+    int64_t* errorNsPtr                         ///< [OUT] Bound of the error of the estimate
+)
+{
+    const ReportedTime_t* reportPtr;
+    le_result_t result = LE_NOT_FOUND;
+    int64_t ageNs;
+
+    if ((PA_CLKSYNC_SOURCE_GNSS != source) && (PA_CLKSYNC_SOURCE_NITZ != source))
+    {
+        return LE_NOT_FOUND;
+    }
+
+    reportPtr = &ReportedTimes[source];
+    le_mutex_Lock(SourceMutex);
+    ageNs = clkSync_GetClockNs(CLOCK_BOOTTIME) - reportPtr->bootNs;
+    if (reportPtr->isReported && (ageNs >= 0))
+    {
+        *timeNsPtr = reportPtr->timeNs + ageNs;
+        *errorNsPtr = reportPtr->accuracyNs + clkSyncSource_GetHoldoverError(ageNs);
+        result = LE_OK;
+    }
+    le_mutex_Unlock(SourceMutex);
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the bound of the error a time extrapolated over the given time gathers from the drift of
+ * the local oscillator
+ *
+ * @return
+ *      Bound of the error gathered
+ */
+//--------------------------------------------------------------------------------------------------
+int64_t clkSyncSource_GetHoldoverError
+(
+    int64_t ageNs                               ///< [IN] Time elapsed since the time was known
+)
+{
+    return (ageNs / CLKSYNC_NS_PER_USEC) * PA_CLKSYNC_HOLDOVER_PPM_DEFAULT / 1000;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the order the sources are tried in
+ *
+ * @return
+ *      - LE_OK             Order set
+ *      - LE_BAD_PARAMETER  No source, unknown source or source given twice
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncSource_SetChain
+(
+    const pa_clkSync_Source_t* sourcesPtr,      ///< [IN] Sources, from the first tried
+    size_t count                                ///< [IN] Number of sources
+)
+{
+    bool isListed[PA_CLKSYNC_SOURCE_MAX] = {false};
+    size_t i;
+
+    if (!sourcesPtr || (0 == count) || (count > PA_CLKSYNC_SOURCE_MAX))
+    {
+        return LE_BAD_PARAMETER;
+    }
+    for (i = 0; i < count; i++)
+    {
+        if ((sourcesPtr[i] >= PA_CLKSYNC_SOURCE_MAX) || isListed[sourcesPtr[i]])
+        {
+            return LE_BAD_PARAMETER;
+        }
+        isListed[sourcesPtr[i]] = true;
+    }
+
+    le_mutex_Lock(SourceMutex);
+    memcpy(Chain, sourcesPtr, count * sizeof(pa_clkSync_Source_t));
+    ChainLength = count;
+    le_mutex_Unlock(SourceMutex);
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the order the sources are tried in
+ *
+ * @return
+ *      Number of sources
+ */
+//--------------------------------------------------------------------------------------------------
+size_t clkSyncSource_GetChain
+(
+    pa_clkSync_Source_t sources[PA_CLKSYNC_SOURCE_MAX]  ///< [OUT] Sources, from the first tried
+)
+{
+    size_t count;
+
+    le_mutex_Lock(SourceMutex);
+    memcpy(sources, Chain, ChainLength * sizeof(pa_clkSync_Source_t));
+    count = ChainLength;
+    le_mutex_Unlock(SourceMutex);
+    return count;
+}
@@ -0,0 +1,106 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file clkSyncSource.h
+ *
+ * Chain of the time sources of the Linux Clock Service Adapter, and times reported by the local
+ * sources not read by the adapter itself, i.e. GNSS and NITZ
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef CLKSYNC_SOURCE_H_INCLUDE_GUARD
+#define CLKSYNC_SOURCE_H_INCLUDE_GUARD
+
+#include "legato.h"
+#include "pa_clkSync_linux.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Initialize the times reported by the local sources
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncSource_Init
+(
+    void
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Remember the time just reported by a local source, replacing the one it previously reported
+ *
+ * @return
+ *      - LE_OK             Time remembered
+ *      - LE_BAD_PARAMETER  The source doesn't report its time
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncSource_Report
+(
+    pa_clkSync_Source_t source,                 ///< [IN] GNSS or NITZ
+    int64_t timeNs,                             ///< [IN] Time reported, since the Unix epoch
+    int64_t accuracyNs                          ///< [IN] Bound of the error of the time reported
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Estimate the current time from the last time reported by a local source
+ *
+ * @return
+ *      - LE_OK             Time estimated
+ *      - LE_NOT_FOUND      No time reported by the source
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncSource_Estimate
+(
+    pa_clkSync_Source_t source,                 ///< [IN]  GNSS or NITZ
+    int64_t* timeNsPtr,                         ///< [OUT] Time estimated, since the Unix epoch
+    int64_t* errorNsPtr                         ///< [OUT] Bound of the error of the estimate
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the bound of the error a time extrapolated over the given time gathers from the drift of
+ * the local oscillator
+ *
+ * @return
+ *      Bound of the error gathered
+ */
+//--------------------------------------------------------------------------------------------------
+int64_t clkSyncSource_GetHoldoverError
+(
+    int64_t ageNs                               ///< [IN] Time elapsed since the time was known
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the order the sources are tried in
+ *
+ * @return
+ *      - LE_OK             Order set
+ *      - LE_BAD_PARAMETER  No source, unknown source or source given twice
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncSource_SetChain
+(
+    const pa_clkSync_Source_t* sourcesPtr,      ///< [IN] Sources, from the first tried
+    size_t count                                ///< [IN] Number of sources
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the order the sources are tried in
+ *
+ * @return
+ *      Number of sources
+ */
+//--------------------------------------------------------------------------------------------------
+size_t clkSyncSource_GetChain
+(
+    pa_clkSync_Source_t sources[PA_CLKSYNC_SOURCE_MAX]  ///< [OUT] Sources, from the first tried
+);
+
+#endif // CLKSYNC_SOURCE_H_INCLUDE_GUARD
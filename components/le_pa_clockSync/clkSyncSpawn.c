@@ -0,0 +1,159 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file clkSyncSpawn.c
+ *
+ * Direct launch of the time commands run by the Linux Clock Service Adapter. The command binary
+ * is started with posix_spawn(), which the C library implements with vfork() semantics, from an
+ * argument array: no shell is forked in between, no shell syntax has to be parsed, and nothing
+ * given to the command can be interpreted by a shell. The exit code is read with waitpid().
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include <fcntl.h>
+#include <spawn.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include "clkSyncLocal.h"
+#include "clkSyncSpawn.h"
+
+// Commands only compiled in when PA_CLKSYNC_WITH_COMMANDS is set
+#if PA_CLKSYNC_WITH_COMMANDS
+
+extern char** environ;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Launch a command directly, without a shell, its standard output being captured through a pipe
+ *
+ * @return
+ *      - LE_OK             Command launched
+ *      - LE_FAULT          The command couldn't be launched
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncSpawn_Start
+(
+    const char* const* argv,        ///< [IN]  Path of the command and its arguments, NULL ended
+    clkSyncSpawn_Errors_t errors,   ///< [IN]  Handling of the standard error
+    clkSyncSpawn_Process_t* procPtr ///< [OUT] Command launched
+)
+{
+    posix_spawn_file_actions_t actions;
+    int pipeFds[2];
+    int rc;
+
+    procPtr->pid = -1;
+    procPtr->outputFd = -1;
+
+    if (pipe2(pipeFds, O_CLOEXEC))
+    {
+        LE_ERROR("Failed to create pipe (%m)");
+        return LE_FAULT;
+    }
+
+    // The write end is duplicated onto the standard output, which clears its close-on-exec flag.
+    // No other descriptor is closed here: the command is kept from those of this process by their
+    // close-on-exec flag, as set on the pipe and on the sockets of this component, and inherits
+    // any opened without it
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, pipeFds[1], STDOUT_FILENO);
+    if (CLKSYNC_SPAWN_ERRORS_DISCARD == errors)
+    {
+        posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+    }
+    else if (CLKSYNC_SPAWN_ERRORS_CAPTURE == errors)
+    {
+        posix_spawn_file_actions_adddup2(&actions, pipeFds[1], STDERR_FILENO);
+    }
+
+    rc = posix_spawn(&procPtr->pid, argv[0], &actions, NULL, (char* const*)argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(pipeFds[1]);
+    if (rc)
+    {
+        LE_ERROR("Failed to run command %s (%s)", argv[0], strerror(rc));
+        close(pipeFds[0]);
+        procPtr->pid = -1;
+        return LE_FAULT;
+    }
+
+    procPtr->outputFd = pipeFds[0];
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Wait for a command to exit, closing its output
+ *
+ * @return
+ *      The exit code of the command, or -1 if it didn't exit normally
+ */
+//--------------------------------------------------------------------------------------------------
+int clkSyncSpawn_Wait
+(
+    clkSyncSpawn_Process_t* procPtr ///< [IN] Command launched
+)
+{
+    int status = 0;
+    pid_t rc;
+
+    if (procPtr->outputFd >= 0)
+    {
+        close(procPtr->outputFd);
+        procPtr->outputFd = -1;
+    }
+    if (procPtr->pid < 0)
+    {
+        return -1;
+    }
+
+    do
+    {
+        rc = waitpid(procPtr->pid, &status, 0);
+    }
+    while ((rc < 0) && (EINTR == errno));
+    procPtr->pid = -1;
+
+    if (rc < 0)
+    {
+        LE_ERROR("Failed to wait for command (%m)");
+        return -1;
+    }
+    if (!WIFEXITED(status))
+    {
+        LE_WARN("Command terminated abnormally, status %d", status);
+        return -1;
+    }
+    return WEXITSTATUS(status);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Kill a command and wait for it, closing its output
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncSpawn_Kill
+(
+    clkSyncSpawn_Process_t* procPtr ///< [IN] Command launched
+)
+{
+    if (procPtr->outputFd >= 0)
+    {
+        close(procPtr->outputFd);
+        procPtr->outputFd = -1;
+    }
+    if (procPtr->pid > 0)
+    {
+        kill(procPtr->pid, SIGKILL);
+        while ((waitpid(procPtr->pid, NULL, 0) < 0) && (EINTR == errno))
+        {
+        }
+        procPtr->pid = -1;
+    }
+}
+
+#endif // PA_CLKSYNC_WITH_COMMANDS
@@ -0,0 +1,91 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file clkSyncSpawn.h
+ *
+ * Direct launch of the time commands run by the Linux Clock Service Adapter
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef CLKSYNC_SPAWN_H_INCLUDE_GUARD
+#define CLKSYNC_SPAWN_H_INCLUDE_GUARD
+
+#include "legato.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Largest number of arguments of a command, its path and the terminating NULL included
+ */
+//--------------------------------------------------------------------------------------------------
+#define CLKSYNC_SPAWN_MAX_ARGS      16
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Command launched
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    pid_t pid;                      ///< Process of the command, -1 once waited for
+    int outputFd;                   ///< Read end of the pipe of its standard output, -1 if closed
+}
+clkSyncSpawn_Process_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handling of the standard error of a command
+ */
+//--------------------------------------------------------------------------------------------------
+typedef enum
+{
+    CLKSYNC_SPAWN_ERRORS_KEEP = 0,  ///< Inherited from this process
+    CLKSYNC_SPAWN_ERRORS_DISCARD,   ///< Sent to /dev/null
+    CLKSYNC_SPAWN_ERRORS_CAPTURE    ///< Captured through the pipe with the standard output
+}
+clkSyncSpawn_Errors_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Launch a command directly, without a shell, its standard output being captured through a pipe
+ *
+ * @return
+ *      - LE_OK             Command launched
+ *      - LE_FAULT          The command couldn't be launched
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncSpawn_Start
+(
+    const char* const* argv,        ///< [IN]  Path of the command and its arguments, NULL ended
+    clkSyncSpawn_Errors_t errors,   ///< [IN]  Handling of the standard error
+    clkSyncSpawn_Process_t* procPtr ///< [OUT] Command launched
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Wait for a command to exit, closing its output
+ *
+ * @return
+ *      The exit code of the command, or -1 if it didn't exit normally
+ */
+//--------------------------------------------------------------------------------------------------
+int clkSyncSpawn_Wait
+(
+    clkSyncSpawn_Process_t* procPtr ///< [IN] Command launched
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Kill a command and wait for it, closing its output
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncSpawn_Kill
+(
+    clkSyncSpawn_Process_t* procPtr ///< [IN] Command launched
+);
+
+#endif // CLKSYNC_SPAWN_H_INCLUDE_GUARD
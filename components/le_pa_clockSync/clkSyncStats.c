@@ -0,0 +1,443 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file clkSyncStats.c
+ *
+ * Statistics of the Linux Clock Service Adapter: counters of the time retrievals by result and
+ * histograms of their name resolution time and round-trip delay, per protocol and per server,
+ * and histograms of the offsets corrected on the system clock. They are updated with relaxed
+ * atomic increments and read the same way, without any lock, so that they can be read from
+ * another thread while retrievals are in progress. A reading taken during an update may thus
+ * lag by the retrieval being counted.
+ *
+ * The servers are followed in the order they are first queried, up to
+ * PA_CLKSYNC_STATS_MAX_SERVERS; a slot once claimed keeps its server until the process exits.
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include <netdb.h>
+#include "pa_clkSync_linux.h"
+#include "clkSyncLocal.h"
+#include "clkSyncStats.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Maximum length of a server name, including the terminating null character
+ */
+//--------------------------------------------------------------------------------------------------
+#define STATS_NAME_MAX_BYTES        (NI_MAXHOST + 1)
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Number of kinds of clock update
+ */
+//--------------------------------------------------------------------------------------------------
+#define STATS_ADJUST_COUNT          (PA_CLKSYNC_CLOCK_ADJUST_RESTORE + 1)
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * States of a server slot
+ */
+//--------------------------------------------------------------------------------------------------
+#define STATS_SLOT_FREE             0
+#define STATS_SLOT_CLAIMED          1
+#define STATS_SLOT_READY            2
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Increment and read a counter atomically
+ */
+//--------------------------------------------------------------------------------------------------
+#define STATS_INCREMENT(counter)    __atomic_fetch_add(&(counter), 1, __ATOMIC_RELAXED)
+#define STATS_LOAD(counter)         __atomic_load_n(&(counter), __ATOMIC_RELAXED)
+#define STATS_CLEAR(counter)        __atomic_store_n(&(counter), 0, __ATOMIC_RELAXED)
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Statistics of a server
+ */
+//--------------------------------------------------------------------------------------------------
+struct clkSyncStats_Server
+{
+    int state;                              ///< STATS_SLOT_FREE, _CLAIMED or _READY
+    char name[STATS_NAME_MAX_BYTES];        ///< Server name or address, set once ready
+    pa_clkSync_QueryStats_t stats;          ///< Statistics of the retrievals
+};
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Statistics of each protocol
+ */
+//--------------------------------------------------------------------------------------------------
+static pa_clkSync_QueryStats_t ProtocolStats[PA_CLKSYNC_PROTOCOL_MAX];
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Statistics of the servers followed
+ */
+//--------------------------------------------------------------------------------------------------
+static clkSyncStats_Server_t Servers[PA_CLKSYNC_STATS_MAX_SERVERS];
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Statistics of the clock updates
+ */
+//--------------------------------------------------------------------------------------------------
+static pa_clkSync_AdjustStats_t AdjustStats;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Count a value into a histogram
+ */
+//--------------------------------------------------------------------------------------------------
+static void AddToHistogram
+(
+    pa_clkSync_Histogram_t* histogramPtr,   ///< [IN] Histogram
+    int64_t valueNs                         ///< [IN] Value, whose magnitude is counted
+)
+{
+    uint64_t us = (uint64_t)((valueNs < 0) ? -(valueNs / 1000) : (valueNs / 1000));
+    size_t bucket = 0;
+
+    if (us >= 2)
+    {
+        bucket = 63 - __builtin_clzll(us);
+        if (bucket >= PA_CLKSYNC_HISTOGRAM_BUCKETS)
+        {
+            bucket = PA_CLKSYNC_HISTOGRAM_BUCKETS - 1;
+        }
+    }
+    STATS_INCREMENT(histogramPtr->counts[bucket]);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Count a time retrieval into statistics
+ */
+//--------------------------------------------------------------------------------------------------
+static void AddToStats
+(
+    pa_clkSync_QueryStats_t* statsPtr,      ///< [IN] Statistics
+    le_result_t result,                     ///< [IN] Result of the retrieval
+    int64_t dnsNs,                          ///< [IN] Time of the name resolution, -1 if none
+    int64_t rttNs                           ///< [IN] Round-trip delay, -1 if not measured
+)
+{
+    size_t code = (result <= 0) ? (size_t)-result : 0;
+
+    if (code >= PA_CLKSYNC_RESULT_CODES)
+    {
+        code = PA_CLKSYNC_RESULT_CODES - 1;
+    }
+
+    STATS_INCREMENT(statsPtr->queries);
+    STATS_INCREMENT(statsPtr->results[code]);
+    if (dnsNs >= 0)
+    {
+        AddToHistogram(&statsPtr->dnsTime, dnsNs);
+    }
+    if (rttNs >= 0)
+    {
+        AddToHistogram(&statsPtr->rtt, rttNs);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read a histogram
+ */
+//--------------------------------------------------------------------------------------------------
+static void ReadHistogram
+(
+    pa_clkSync_Histogram_t* histogramPtr,   ///< [IN]  Histogram
+    pa_clkSync_Histogram_t* copyPtr         ///< [OUT] Copy of the histogram
+)
+{
+    size_t i;
+
+    for (i = 0; i < PA_CLKSYNC_HISTOGRAM_BUCKETS; i++)
+    {
+        copyPtr->counts[i] = STATS_LOAD(histogramPtr->counts[i]);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read statistics
+ */
+//--------------------------------------------------------------------------------------------------
+static void ReadStats
+(
+    pa_clkSync_QueryStats_t* statsPtr,      ///< [IN]  Statistics
+    pa_clkSync_QueryStats_t* copyPtr        ///< [OUT] Copy of the statistics
+)
+{
+    size_t i;
+
+    copyPtr->queries = STATS_LOAD(statsPtr->queries);
+    for (i = 0; i < PA_CLKSYNC_RESULT_CODES; i++)
+    {
+        copyPtr->results[i] = STATS_LOAD(statsPtr->results[i]);
+    }
+    ReadHistogram(&statsPtr->dnsTime, &copyPtr->dnsTime);
+    ReadHistogram(&statsPtr->rtt, &copyPtr->rtt);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Zero a histogram
+ */
+//--------------------------------------------------------------------------------------------------
+static void ClearHistogram
+(
+    pa_clkSync_Histogram_t* histogramPtr    ///< [IN] Histogram
+)
+{
+    size_t i;
+
+    for (i = 0; i < PA_CLKSYNC_HISTOGRAM_BUCKETS; i++)
+    {
+        STATS_CLEAR(histogramPtr->counts[i]);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Zero statistics
+ */
+//--------------------------------------------------------------------------------------------------
+static void ClearStats
+(
+    pa_clkSync_QueryStats_t* statsPtr       ///< [IN] Statistics
+)
+{
+    size_t i;
+
+    STATS_CLEAR(statsPtr->queries);
+    for (i = 0; i < PA_CLKSYNC_RESULT_CODES; i++)
+    {
+        STATS_CLEAR(statsPtr->results[i]);
+    }
+    ClearHistogram(&statsPtr->dnsTime);
+    ClearHistogram(&statsPtr->rtt);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the statistics of a server, starting to follow it if there is room for it
+ *
+ * @return
+ *      The server's statistics, NULL if the server isn't followed
+ */
+//--------------------------------------------------------------------------------------------------
+clkSyncStats_Server_t* clkSyncStats_GetServer
+(
+    const char* namePtr                         ///< [IN] Server name or address, may be NULL
+)
+{
+    size_t i;
+
+    if (!namePtr || ('\0' == namePtr[0]) || (strlen(namePtr) >= STATS_NAME_MAX_BYTES))
+    {
+        return NULL;
+    }
+
+    for (i = 0; i < PA_CLKSYNC_STATS_MAX_SERVERS; i++)
+    {
+        clkSyncStats_Server_t* serverPtr = &Servers[i];
+        int state = __atomic_load_n(&serverPtr->state, __ATOMIC_ACQUIRE);
+
+        // A slot being claimed by another thread is skipped, at worst following a server twice
+        if ((STATS_SLOT_READY == state) && (0 == strcmp(serverPtr->name, namePtr)))
+        {
+            return serverPtr;
+        }
+        if ((STATS_SLOT_FREE == state) &&
+            __atomic_compare_exchange_n(&serverPtr->state, &state, STATS_SLOT_CLAIMED, false,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+        {
+            le_utf8_Copy(serverPtr->name, namePtr, sizeof(serverPtr->name), NULL);
+            __atomic_store_n(&serverPtr->state, STATS_SLOT_READY, __ATOMIC_RELEASE);
+            return serverPtr;
+        }
+    }
+    return NULL;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Count a time retrieval with a protocol, from a server if it is followed
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncStats_AddQuery
+(
+    pa_clkSync_Protocol_t protocol,             ///< [IN] Protocol
+    clkSyncStats_Server_t* serverPtr,           ///< [IN] Statistics of the server, may be NULL
+    le_result_t result,                         ///< [IN] Result of the retrieval
+    int64_t dnsNs,                              ///< [IN] Time of the name resolution, -1 if none
+    int64_t rttNs                               ///< [IN] Round-trip delay, -1 if not measured
+)
+{
+    if (protocol < PA_CLKSYNC_PROTOCOL_MAX)
+    {
+        AddToStats(&ProtocolStats[protocol], result, dnsNs, rttNs);
+    }
+    if (serverPtr)
+    {
+        AddToStats(&serverPtr->stats, result, dnsNs, rttNs);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Count an update of the system clock
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncStats_AddAdjust
+(
+    pa_clkSync_ClockAdjust_t adjust,            ///< [IN] Kind of update
+    int64_t offsetNs                            ///< [IN] Offset corrected, 0 if unknown
+)
+{
+    if (adjust < STATS_ADJUST_COUNT)
+    {
+        AddToHistogram(&AdjustStats.offsets[adjust], offsetNs);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the statistics of the time retrievals with a protocol
+ *
+ * @return
+ *      - LE_OK             Statistics returned
+ *      - LE_BAD_PARAMETER  Incorrect parameter
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncStats_GetProtocol
+(
+    pa_clkSync_Protocol_t protocol,             ///< [IN]  Protocol
+    pa_clkSync_QueryStats_t* statsPtr           ///< [OUT] Statistics
+)
+{
+    if (!statsPtr || (protocol >= PA_CLKSYNC_PROTOCOL_MAX))
+    {
+        LE_ERROR("Incorrect parameter");
+        return LE_BAD_PARAMETER;
+    }
+
+    ReadStats(&ProtocolStats[protocol], statsPtr);
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the statistics of the time retrievals from the followed server of the given index
+ *
+ * @return
+ *      - LE_OK             Statistics returned
+ *      - LE_BAD_PARAMETER  Incorrect parameter
+ *      - LE_NOT_FOUND      No server of this index
+ *      - LE_OVERFLOW       Server name too long for the buffer, the statistics are returned
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncStats_GetServerByIndex
+(
+    uint32_t index,                             ///< [IN]  Index of the server
+    char* namePtr,                              ///< [OUT] Server name or address
+    size_t nameSize,                            ///< [IN]  Size of the name buffer
+    pa_clkSync_QueryStats_t* statsPtr           ///< [OUT] Statistics
+)
+{
+    clkSyncStats_Server_t* serverPtr;
+
+    if (!namePtr || (0 == nameSize) || !statsPtr)
+    {
+        LE_ERROR("Incorrect parameter");
+        return LE_BAD_PARAMETER;
+    }
+
+    if (index >= PA_CLKSYNC_STATS_MAX_SERVERS)
+    {
+        return LE_NOT_FOUND;
+    }
+    serverPtr = &Servers[index];
+    if (STATS_SLOT_READY != __atomic_load_n(&serverPtr->state, __ATOMIC_ACQUIRE))
+    {
+        return LE_NOT_FOUND;
+    }
+
+    ReadStats(&serverPtr->stats, statsPtr);
+    return le_utf8_Copy(namePtr, serverPtr->name, nameSize, NULL);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the statistics of the updates of the system clock
+ *
+ * @return
+ *      - LE_OK             Statistics returned
+ *      - LE_BAD_PARAMETER  Incorrect parameter
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncStats_GetAdjust
+(
+    pa_clkSync_AdjustStats_t* statsPtr          ///< [OUT] Statistics
+)
+{
+    size_t i;
+
+    if (!statsPtr)
+    {
+        LE_ERROR("Incorrect parameter");
+        return LE_BAD_PARAMETER;
+    }
+
+    for (i = 0; i < STATS_ADJUST_COUNT; i++)
+    {
+        ReadHistogram(&AdjustStats.offsets[i], &statsPtr->offsets[i]);
+    }
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Zero all the statistics, keeping the servers followed
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncStats_Reset
+(
+    void
+)
+{
+    size_t i;
+
+    for (i = 0; i < PA_CLKSYNC_PROTOCOL_MAX; i++)
+    {
+        ClearStats(&ProtocolStats[i]);
+    }
+    for (i = 0; i < PA_CLKSYNC_STATS_MAX_SERVERS; i++)
+    {
+        ClearStats(&Servers[i].stats);
+    }
+    for (i = 0; i < STATS_ADJUST_COUNT; i++)
+    {
+        ClearHistogram(&AdjustStats.offsets[i]);
+    }
+}
@@ -0,0 +1,127 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file clkSyncStats.h
+ *
+ * Counters and histograms of the time retrievals and clock updates of the Linux Clock Service
+ * Adapter
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef CLKSYNC_STATS_H_INCLUDE_GUARD
+#define CLKSYNC_STATS_H_INCLUDE_GUARD
+
+#include "legato.h"
+#include "pa_clkSync_linux.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Statistics of a server
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct clkSyncStats_Server clkSyncStats_Server_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the statistics of a server, starting to follow it if there is room for it
+ *
+ * @return
+ *      The server's statistics, NULL if the server isn't followed
+ */
+//--------------------------------------------------------------------------------------------------
+clkSyncStats_Server_t* clkSyncStats_GetServer
+(
+    const char* namePtr                         ///< [IN] Server name or address, may be NULL
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Count a time retrieval with a protocol, from a server if it is followed
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncStats_AddQuery
+(
+    pa_clkSync_Protocol_t protocol,             ///< [IN] Protocol
+    clkSyncStats_Server_t* serverPtr,           ///< [IN] Statistics of the server, may be NULL
+    le_result_t result,                         ///< [IN] Result of the retrieval
+    int64_t dnsNs,                              ///< [IN] Time of the name resolution, -1 if none
+    int64_t rttNs                               ///< [IN] Round-trip delay, -1 if not measured
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Count an update of the system clock
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncStats_AddAdjust
+(
+    pa_clkSync_ClockAdjust_t adjust,            ///< [IN] Kind of update
+    int64_t offsetNs                            ///< [IN] Offset corrected, 0 if unknown
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the statistics of the time retrievals with a protocol
+ *
+ * @return
+ *      - LE_OK             Statistics returned
+ *      - LE_BAD_PARAMETER  Incorrect parameter
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncStats_GetProtocol
+(
+    pa_clkSync_Protocol_t protocol,             ///< [IN]  Protocol
+    pa_clkSync_QueryStats_t* statsPtr           ///< [OUT] Statistics
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the statistics of the time retrievals from the followed server of the given index
+ *
+ * @return
+ *      - LE_OK             Statistics returned
+ *      - LE_BAD_PARAMETER  Incorrect parameter
+ *      - LE_NOT_FOUND      No server of this index
+ *      - LE_OVERFLOW       Server name too long for the buffer, the statistics are returned
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncStats_GetServerByIndex
+(
+    uint32_t index,                             ///< [IN]  Index of the server
+    char* namePtr,                              ///< [OUT] Server name or address
+    size_t nameSize,                            ///< [IN]  Size of the name buffer
+    pa_clkSync_QueryStats_t* statsPtr           ///< [OUT] Statistics
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the statistics of the updates of the system clock
+ *
+ * @return
+ *      - LE_OK             Statistics returned
+ *      - LE_BAD_PARAMETER  Incorrect parameter
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncStats_GetAdjust
+(
+    pa_clkSync_AdjustStats_t* statsPtr          ///< [OUT] Statistics
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Zero all the statistics, keeping the servers followed
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncStats_Reset
+(
+    void
+);
+
+#endif // CLKSYNC_STATS_H_INCLUDE_GUARD
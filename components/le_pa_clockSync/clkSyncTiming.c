@@ -0,0 +1,319 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file clkSyncTiming.c
+ *
+ * Measurement of the time retrievals of the Linux Clock Service Adapter. Each retrieval from a
+ * single server is timed by phase, from the name resolution to the parsing of a command's output,
+ * and its CPU time taken from the clock of the thread running it and from getrusage() for the
+ * commands waited for, so that the other threads of the process don't weigh on it. The last
+ * measurements of each protocol's engine are kept in a ring, from which the percentiles are
+ * computed on request, so that the engines can be compared against the same server.
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include <sys/resource.h>
+#include "pa_clkSync_linux.h"
+#include "clkSyncLocal.h"
+#include "clkSyncTiming.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Number of retrievals kept per engine
+ */
+//--------------------------------------------------------------------------------------------------
+#define TIMING_HISTORY_SIZE         64
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Number of engines
+ */
+//--------------------------------------------------------------------------------------------------
+#define TIMING_ENGINE_COUNT         (PA_CLKSYNC_ENGINE_DAEMON + 1)
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Measured retrieval
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    int64_t phaseNs[PA_CLKSYNC_PHASE_MAX];  ///< Time spent in each phase
+    int64_t totalNs;                        ///< Time of the whole retrieval
+    int64_t cpuNs;                          ///< CPU time of the retrieval
+}
+TimingSample_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Last retrievals of an engine, the oldest overwritten first
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    TimingSample_t samples[TIMING_HISTORY_SIZE];    ///< Retrievals
+    uint32_t count;                                 ///< Number of retrievals measured so far
+}
+TimingHistory_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Retrievals of each engine of each protocol
+ */
+//--------------------------------------------------------------------------------------------------
+static TimingHistory_t Histories[PA_CLKSYNC_PROTOCOL_MAX][TIMING_ENGINE_COUNT];
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Mutex protecting the retrievals, measured from any thread calling the adapter
+ */
+//--------------------------------------------------------------------------------------------------
+static le_mutex_Ref_t TimingMutex;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the CPU time used so far by the calling thread and by the commands the process waited for
+ *
+ * @return
+ *      CPU time, user and system
+ */
+//--------------------------------------------------------------------------------------------------
+static int64_t GetCpuNs
+(
+    void
+)
+{
+    struct rusage children = {0};
+
+    getrusage(RUSAGE_CHILDREN, &children);
+    return clkSync_GetClockNs(CLOCK_THREAD_CPUTIME_ID) +
+           ((int64_t)(children.ru_utime.tv_sec + children.ru_stime.tv_sec) * CLKSYNC_NS_PER_SEC) +
+           ((int64_t)(children.ru_utime.tv_usec + children.ru_stime.tv_usec) * 1000);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Compare two durations, for qsort()
+ */
+//--------------------------------------------------------------------------------------------------
+static int CompareNs
+(
+    const void* aPtr,
+    const void* bPtr
+)
+{
+    int64_t a = *(const int64_t*)aPtr;
+    int64_t b = *(const int64_t*)bPtr;
+
+    return (a > b) - (a < b);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Sort durations and get their given percentile, by the nearest rank
+ *
+ * @return
+ *      Percentile
+ */
+//--------------------------------------------------------------------------------------------------
+static int64_t GetPercentile
+(
+    int64_t* valuesPtr,             ///< [IN/OUT] Durations, sorted on return
+    size_t count,                   ///< [IN]     Number of durations, not 0
+    uint32_t percent                ///< [IN]     Percentile to get
+)
+{
+    size_t rank = (count * percent + 99) / 100;
+
+    qsort(valuesPtr, count, sizeof(int64_t), CompareNs);
+    return valuesPtr[(rank > 0) ? rank - 1 : 0];
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Initialize the measurements
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncTiming_Init
+(
+    void
+)
+{
+    TimingMutex = le_mutex_CreateNonRecursive("ClkSyncTimingMutex");
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start measuring a time retrieval
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncTiming_Start
+(
+    clkSyncTiming_Record_t* recordPtr       ///< [OUT] Measurement
+)
+{
+    memset(recordPtr, 0, sizeof(clkSyncTiming_Record_t));
+    recordPtr->startNs = clkSync_GetClockNs(CLOCK_MONOTONIC);
+    recordPtr->lapNs = recordPtr->startNs;
+    recordPtr->cpuStartNs = GetCpuNs();
+    recordPtr->dnsNs = -1;
+    recordPtr->rttNs = -1;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Account the time elapsed since the previous lap to the given phase, and start the next lap
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncTiming_Lap
+(
+    clkSyncTiming_Record_t* recordPtr,      ///< [IN/OUT] Measurement, may be NULL
+    pa_clkSync_Phase_t phase                ///< [IN]     Phase the lap was spent in
+)
+{
+    int64_t nowNs;
+
+    if (!recordPtr)
+    {
+        return;
+    }
+
+    nowNs = clkSync_GetClockNs(CLOCK_MONOTONIC);
+    recordPtr->phaseNs[phase] += nowNs - recordPtr->lapNs;
+    recordPtr->lapNs = nowNs;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Stop measuring a time retrieval, and add it to those of the engine it was run with
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncTiming_Stop
+(
+    const clkSyncTiming_Record_t* recordPtr,    ///< [IN] Measurement
+    pa_clkSync_Protocol_t protocol,             ///< [IN] Protocol retrieved
+    pa_clkSync_Engine_t engine                  ///< [IN] Engine selected for the retrieval
+)
+{
+    TimingHistory_t* historyPtr;
+    TimingSample_t sample;
+
+    if ((protocol >= PA_CLKSYNC_PROTOCOL_MAX) || (engine >= TIMING_ENGINE_COUNT))
+    {
+        return;
+    }
+
+    memcpy(sample.phaseNs, recordPtr->phaseNs, sizeof(sample.phaseNs));
+    sample.totalNs = clkSync_GetClockNs(CLOCK_MONOTONIC) - recordPtr->startNs;
+    sample.cpuNs = GetCpuNs() - recordPtr->cpuStartNs;
+
+    le_mutex_Lock(TimingMutex);
+    historyPtr = &Histories[protocol][engine];
+    historyPtr->samples[historyPtr->count % TIMING_HISTORY_SIZE] = sample;
+    if (historyPtr->count < UINT32_MAX)
+    {
+        historyPtr->count++;
+    }
+    le_mutex_Unlock(TimingMutex);
+
+    LE_DEBUG("Retrieval took %" PRId64 " ns: DNS %" PRId64 ", spawn %" PRId64 ", network %" PRId64
+             ", parse %" PRId64 ", CPU %" PRId64, sample.totalNs,
+             sample.phaseNs[PA_CLKSYNC_PHASE_DNS], sample.phaseNs[PA_CLKSYNC_PHASE_SPAWN],
+             sample.phaseNs[PA_CLKSYNC_PHASE_NETWORK], sample.phaseNs[PA_CLKSYNC_PHASE_PARSE],
+             sample.cpuNs);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the latency and cost of the last time retrievals of an engine
+ *
+ * @return
+ *      - LE_OK             Report returned
+ *      - LE_BAD_PARAMETER  Incorrect parameter
+ *      - LE_NOT_FOUND      No retrieval measured for this engine
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncTiming_GetReport
+(
+    pa_clkSync_Protocol_t protocol,         ///< [IN]  Protocol
+    pa_clkSync_Engine_t engine,             ///< [IN]  Engine
+    pa_clkSync_LatencyReport_t* reportPtr   ///< [OUT] Report
+)
+{
+    int64_t values[TIMING_HISTORY_SIZE];
+    TimingHistory_t history;
+    struct rusage usage = {0};
+    int64_t cpuNs = 0;
+    size_t i, phase, count;
+
+    if (!reportPtr || (protocol >= PA_CLKSYNC_PROTOCOL_MAX) || (engine >= TIMING_ENGINE_COUNT))
+    {
+        LE_ERROR("Incorrect parameter");
+        return LE_BAD_PARAMETER;
+    }
+
+    // The percentiles are computed on a copy, without holding the mutex
+    le_mutex_Lock(TimingMutex);
+    history = Histories[protocol][engine];
+    le_mutex_Unlock(TimingMutex);
+    if (0 == history.count)
+    {
+        return LE_NOT_FOUND;
+    }
+    count = (history.count < TIMING_HISTORY_SIZE) ? history.count : TIMING_HISTORY_SIZE;
+
+    memset(reportPtr, 0, sizeof(pa_clkSync_LatencyReport_t));
+    reportPtr->count = history.count;
+    for (phase = 0; phase < PA_CLKSYNC_PHASE_MAX; phase++)
+    {
+        for (i = 0; i < count; i++)
+        {
+            values[i] = history.samples[i].phaseNs[phase];
+        }
+        reportPtr->p50Ns[phase] = GetPercentile(values, count, 50);
+        reportPtr->p99Ns[phase] = GetPercentile(values, count, 99);
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        values[i] = history.samples[i].totalNs;
+        cpuNs += history.samples[i].cpuNs;
+    }
+    reportPtr->totalP50Ns = GetPercentile(values, count, 50);
+    reportPtr->totalP99Ns = GetPercentile(values, count, 99);
+    reportPtr->cpuNs = cpuNs / (int64_t)count;
+
+    // ru_maxrss is given in kilobytes on Linux; the memory being shared by the threads, the peak is
+    // the process's whichever thread asks
+    getrusage(RUSAGE_SELF, &usage);
+    reportPtr->peakRssKb = (uint32_t)usage.ru_maxrss;
+    getrusage(RUSAGE_CHILDREN, &usage);
+    reportPtr->childPeakRssKb = (uint32_t)usage.ru_maxrss;
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Discard all the measurements
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncTiming_Reset
+(
+    void
+)
+{
+    le_mutex_Lock(TimingMutex);
+    memset(Histories, 0, sizeof(Histories));
+    le_mutex_Unlock(TimingMutex);
+}
@@ -0,0 +1,109 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file clkSyncTiming.h
+ *
+ * Measurement of the latency and cost of the time retrievals of the Linux Clock Service Adapter
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef CLKSYNC_TIMING_H_INCLUDE_GUARD
+#define CLKSYNC_TIMING_H_INCLUDE_GUARD
+
+#include "legato.h"
+#include "pa_clkSync_linux.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Measurement of a time retrieval in progress
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    int64_t startNs;                        ///< CLOCK_MONOTONIC time the retrieval started at
+    int64_t lapNs;                          ///< CLOCK_MONOTONIC time the current phase started at
+    int64_t cpuStartNs;                     ///< CPU time of the thread and the commands at start
+    int64_t phaseNs[PA_CLKSYNC_PHASE_MAX];  ///< Time spent in each phase so far
+    int64_t dnsNs;                          ///< Time of the name resolution, -1 if none
+    int64_t rttNs;                          ///< Round-trip delay measured by the native client,
+                                            ///< -1 if none
+}
+clkSyncTiming_Record_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Initialize the measurements
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncTiming_Init
+(
+    void
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start measuring a time retrieval
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncTiming_Start
+(
+    clkSyncTiming_Record_t* recordPtr       ///< [OUT] Measurement
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Account the time elapsed since the previous lap to the given phase, and start the next lap
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncTiming_Lap
+(
+    clkSyncTiming_Record_t* recordPtr,      ///< [IN/OUT] Measurement, may be NULL
+    pa_clkSync_Phase_t phase                ///< [IN]     Phase the lap was spent in
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Stop measuring a time retrieval, and add it to those of the engine it was run with
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncTiming_Stop
+(
+    const clkSyncTiming_Record_t* recordPtr,    ///< [IN] Measurement
+    pa_clkSync_Protocol_t protocol,             ///< [IN] Protocol retrieved
+    pa_clkSync_Engine_t engine                  ///< [IN] Engine selected for the retrieval
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the latency and cost of the last time retrievals of an engine
+ *
+ * @return
+ *      - LE_OK             Report returned
+ *      - LE_BAD_PARAMETER  Incorrect parameter
+ *      - LE_NOT_FOUND      No retrieval measured for this engine
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncTiming_GetReport
+(
+    pa_clkSync_Protocol_t protocol,         ///< [IN]  Protocol
+    pa_clkSync_Engine_t engine,             ///< [IN]  Engine
+    pa_clkSync_LatencyReport_t* reportPtr   ///< [OUT] Report
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Discard all the measurements
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncTiming_Reset
+(
+    void
+);
+
+#endif // CLKSYNC_TIMING_H_INCLUDE_GUARD
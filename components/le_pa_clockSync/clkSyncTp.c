@@ -0,0 +1,206 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file clkSyncTp.c
+ *
+ * Native Time Protocol (RFC 868) client of the Linux Clock Service Adapter. The server sends the
+ * present time as 32-bit big-endian seconds since 1 Jan 1900 and closes the TCP connection, so
+ * neither rdate nor the parsing of its human-readable output is needed. The addresses of the server
+ * are raced, so that an unreachable one delays the query by the stagger delay only.
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "clkSyncLocal.h"
+#include "clkSyncRace.h"
+#include "clkSyncTp.h"
+
+// Time Protocol client only compiled in when PA_CLKSYNC_WITH_TP is set
+#if PA_CLKSYNC_WITH_TP
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Time Protocol server port
+ */
+//--------------------------------------------------------------------------------------------------
+#define TP_PORT_STR                 "37"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Length of the Time Protocol reply
+ */
+//--------------------------------------------------------------------------------------------------
+#define TP_REPLY_LENGTH             4
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Seconds from the Time Protocol epoch (1 Jan 1900) to the Unix epoch (1 Jan 1970)
+ */
+//--------------------------------------------------------------------------------------------------
+#define TP_UNIX_EPOCH_DELTA         2208988800ULL
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start connecting to the given address
+ *
+ * @return
+ *      - LE_OK             Connection started
+ *      - LE_FAULT          The connection couldn't be attempted
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t OpenAttempt
+(
+    const char* addrStr,                ///< [IN]  Server address
+    clkSync_Attempt_t* attemptPtr       ///< [OUT] Attempt started
+)
+{
+    // Connect without blocking so that the connection attempt is bounded by the timeout rather
+    // than by the kernel's SYN retries
+    attemptPtr->t1 = clkSync_GetClockNs(CLOCK_REALTIME);
+    attemptPtr->fd = clkSyncRace_OpenSocket(addrStr, TP_PORT_STR, SOCK_STREAM);
+    if (attemptPtr->fd < 0)
+    {
+        return LE_FAULT;
+    }
+
+    attemptPtr->len = 0;
+    attemptPtr->events = POLLOUT;
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Complete the connection of an attempt then collect and decode the server reply
+ *
+ * @return
+ *      - LE_OK             A valid reply was received and decoded into the sample
+ *      - LE_IN_PROGRESS    Connected or reply incomplete, more events are awaited
+ *      - LE_UNAVAILABLE    Connection refused or closed before the full reply
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t HandleAttempt
+(
+    clkSync_Attempt_t* attemptPtr,      ///< [IN]  Attempt in progress
+    short revents,                      ///< [IN]  Events received on its socket
+    uint32_t timeoutMs,                 ///< [IN]  Time allowed for the reply once connected
+    clkSync_Sample_t* samplePtr         ///< [OUT] Decoded sample
+)
+{
+    uint64_t secs;
+    int64_t t4;
+    ssize_t len;
+
+    if (POLLOUT == attemptPtr->events)
+    {
+        int sockErr = 0;
+        socklen_t sockErrLen = sizeof(sockErr);
+
+        if (getsockopt(attemptPtr->fd, SOL_SOCKET, SO_ERROR, &sockErr, &sockErrLen) || sockErr)
+        {
+            LE_WARN("Failed to connect (%s)", strerror(sockErr));
+            return LE_UNAVAILABLE;
+        }
+
+        // The server sends its reply as soon as the connection is accepted
+        attemptPtr->events = POLLIN;
+        attemptPtr->deadlineNs = clkSync_GetClockNs(CLOCK_MONOTONIC) +
+                                 (int64_t)timeoutMs * CLKSYNC_NS_PER_MSEC;
+        return LE_IN_PROGRESS;
+    }
+
+    len = recv(attemptPtr->fd, attemptPtr->buf + attemptPtr->len,
+               TP_REPLY_LENGTH - attemptPtr->len, 0);
+    if (len < 0)
+    {
+        if ((EAGAIN == errno) || (EINTR == errno))
+        {
+            return LE_IN_PROGRESS;
+        }
+        LE_WARN("Failed to receive reply (%m)");
+        return LE_UNAVAILABLE;
+    }
+    if (0 == len)
+    {
+        LE_WARN("Connection closed by server after %zu bytes", attemptPtr->len);
+        return LE_UNAVAILABLE;
+    }
+
+    attemptPtr->len += len;
+    if (attemptPtr->len < TP_REPLY_LENGTH)
+    {
+        return LE_IN_PROGRESS;
+    }
+    t4 = clkSync_GetClockNs(CLOCK_REALTIME);
+
+    // As for NTP timestamps, values with the most significant bit cleared are taken to be past
+    // the 32-bit wrap around of 2036
+    secs = ((uint64_t)attemptPtr->buf[0] << 24) | ((uint64_t)attemptPtr->buf[1] << 16) |
+           ((uint64_t)attemptPtr->buf[2] << 8) | (uint64_t)attemptPtr->buf[3];
+    if (!(secs & 0x80000000ULL))
+    {
+        secs += 0x100000000ULL;
+    }
+    secs -= TP_UNIX_EPOCH_DELTA;
+
+    // The protocol has a resolution of one second, so the reply is simply taken as the time at
+    // which it was received, as rdate does
+    samplePtr->offsetNs = (int64_t)secs * CLKSYNC_NS_PER_SEC - t4;
+    samplePtr->delayNs = t4 - attemptPtr->t1;
+    samplePtr->rootDistanceNs = samplePtr->delayNs / 2 + CLKSYNC_NS_PER_SEC / 2;
+    samplePtr->localTimeNs = t4;
+    samplePtr->stratum = 0;
+    LE_DEBUG("TP reply: %" PRIu64 " secs, offset %" PRId64 " ns", secs, samplePtr->offsetNs);
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Time Protocol client as run by a race across the addresses of a server
+ */
+//--------------------------------------------------------------------------------------------------
+const clkSync_Client_t clkSyncTp_Client =
+{
+    .namePtr = "TP",
+    .openFunc = OpenAttempt,
+    .handleFunc = HandleAttempt,
+};
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Query the given Time Protocol server over TCP, racing its addresses
+ *
+ * @return
+ *      - LE_OK             A valid reply was received and decoded into the sample
+ *      - LE_BAD_PARAMETER  Invalid inputs
+ *      - LE_UNAVAILABLE    Connection refused or no valid reply received before the timeout
+ *      - LE_TIMEOUT        No valid reply received before the deadline
+ *      - LE_FAULT          No connection could be attempted
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncTp_Query
+(
+    const clkSync_AddrList_t* listPtr,  ///< [IN]  Server addresses, tried in order
+    uint32_t timeoutMs,                 ///< [IN]  Time allowed for each of connection and reply
+    int64_t deadlineNs,                 ///< [IN]  CLOCK_MONOTONIC time to give up at, whatever
+                                        ///<       the addresses left to try; INT64_MAX if none
+    clkSync_Sample_t* samplePtr         ///< [OUT] Decoded sample
+)
+{
+    clkSync_Race_t race;
+
+    if (!listPtr || !samplePtr || (0 == listPtr->count))
+    {
+        LE_ERROR("Input error");
+        return LE_BAD_PARAMETER;
+    }
+
+    clkSyncRace_Init(&race, &clkSyncTp_Client, listPtr, timeoutMs);
+    clkSyncRace_SetDeadline(&race, deadlineNs);
+    return clkSyncRace_Run(&race, samplePtr);
+}
+
+#endif // PA_CLKSYNC_WITH_TP
@@ -0,0 +1,54 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file clkSyncTp.h
+ *
+ * Native Time Protocol (RFC 868) client of the Linux Clock Service Adapter
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef CLKSYNC_TP_H_INCLUDE_GUARD
+#define CLKSYNC_TP_H_INCLUDE_GUARD
+
+#include "legato.h"
+#include "clkSyncLocal.h"
+#include "clkSyncRace.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Default time allowed for each of the connection and the reply
+ */
+//--------------------------------------------------------------------------------------------------
+#define CLKSYNC_TP_TIMEOUT_MS       1000
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Time Protocol client as run by a race across the addresses of a server
+ */
+//--------------------------------------------------------------------------------------------------
+extern const clkSync_Client_t clkSyncTp_Client;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Query the given Time Protocol server over TCP, racing its addresses
+ *
+ * @return
+ *      - LE_OK             A valid reply was received and decoded into the sample
+ *      - LE_BAD_PARAMETER  Invalid inputs
+ *      - LE_UNAVAILABLE    Connection refused or no valid reply received before the timeout
+ *      - LE_TIMEOUT        No valid reply received before the deadline
+ *      - LE_FAULT          No connection could be attempted
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t clkSyncTp_Query
+(
+    const clkSync_AddrList_t* listPtr,  ///< [IN]  Server addresses, tried in order
+    uint32_t timeoutMs,                 ///< [IN]  Time allowed for each of connection and reply
+    int64_t deadlineNs,                 ///< [IN]  CLOCK_MONOTONIC time to give up at, whatever
+                                        ///<       the addresses left to try; INT64_MAX if none
+    clkSync_Sample_t* samplePtr         ///< [OUT] Decoded sample
+);
+
+#endif // CLKSYNC_TP_H_INCLUDE_GUARD
@@ -10,405 +10,3214 @@
 #include "legato.h"
 #include "interfaces.h"
 #include <stdlib.h>
+#include <fcntl.h>
+#include <poll.h>
 #include <arpa/inet.h>
 #include <netdb.h>
 #include <time.h>
 #include "pa_clkSync.h"
+#include "pa_clkSync_linux.h"
+#include "clkSyncLocal.h"
+#include "clkSyncSntp.h"
+#include "clkSyncTp.h"
+#include "clkSyncDns.h"
+#include "clkSyncAsync.h"
+#include "clkSyncAdjust.h"
+#include "clkSyncDrift.h"
+#include "clkSyncSnapshot.h"
+#include "clkSyncSched.h"
+#include "clkSyncSelect.h"
+#include "clkSyncParse.h"
+#include "clkSyncSpawn.h"
+#include "clkSyncNts.h"
+#include "clkSyncTiming.h"
+#include "clkSyncStats.h"
+#include "clkSyncCoalesce.h"
+#include "clkSyncCache.h"
+#include "clkSyncSocket.h"
+#include "clkSyncPhc.h"
+#include "clkSyncSource.h"
+#include "clkSyncReplay.h"
 
-#define MAX_SYSTEM_CMD_LENGTH 512
-#define MAX_SYSTEM_CMD_OUTPUT_LENGTH 1024
+#define SYSTEM_CMD_READ_LENGTH 256
 
+//--------------------------------------------------------------------------------------------------
+/**
+ * Engine used by default for NTP, which can be overridden at build time with
+ * -DPA_CLKSYNC_NTP_ENGINE_DEFAULT=PA_CLKSYNC_ENGINE_COMMAND
+ */
+//--------------------------------------------------------------------------------------------------
+#ifndef PA_CLKSYNC_NTP_ENGINE_DEFAULT
+#define PA_CLKSYNC_NTP_ENGINE_DEFAULT PA_CLKSYNC_ENGINE_NATIVE
+#endif
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Engine used by default for TP, which can be overridden at build time with
+ * -DPA_CLKSYNC_TP_ENGINE_DEFAULT=PA_CLKSYNC_ENGINE_COMMAND
+ */
+//--------------------------------------------------------------------------------------------------
+#ifndef PA_CLKSYNC_TP_ENGINE_DEFAULT
+#define PA_CLKSYNC_TP_ENGINE_DEFAULT PA_CLKSYNC_ENGINE_NATIVE
+#endif
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Backend used by default for NTP, which can be overridden at build time from the cflags of
+ * Component.cdef, e.g. with -DPA_CLKSYNC_NTP_BACKEND_DEFAULT=PA_CLKSYNC_BACKEND_CHRONY on images
+ * shipping chrony instead of ntpdate
+ */
+//--------------------------------------------------------------------------------------------------
+#ifndef PA_CLKSYNC_NTP_BACKEND_DEFAULT
+#define PA_CLKSYNC_NTP_BACKEND_DEFAULT PA_CLKSYNC_BACKEND_NTPDATE
+#endif
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Size of a command argument built from a server address
+ */
+//--------------------------------------------------------------------------------------------------
+#define CLKSYNC_COMMAND_ARG_BYTES   (LE_DCS_IPADDR_MAX_LEN + 32)
+
+
+//--------------------------------------------------------------------------------------------------
+// Data structures
+//--------------------------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Operations run against a time server
+ */
+//--------------------------------------------------------------------------------------------------
+typedef enum
+{
+    CLKSYNC_OP_GET = 0,     ///< Get the time without updating the system clock
+    CLKSYNC_OP_SET,         ///< Update the system clock
+    CLKSYNC_OP_GET_AND_SET  ///< Update the system clock from the time retrieved, and return it
+}
+ClkSync_Operation_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Operation of the getOnly argument of the pa_clkSync.h interface
+ */
+//--------------------------------------------------------------------------------------------------
+#define CLKSYNC_OPERATION(getOnly)  ((getOnly) ? CLKSYNC_OP_GET : CLKSYNC_OP_SET)
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Typedef of the protocol-specific function vector for querying a time server with a native
+ * client
+ *
+ * @return
+ *     - LE_OK: valid reply received and decoded into the sample
+ *     - LE_BAD_PARAMETER: invalid inputs
+ *     - LE_UNAVAILABLE: no valid reply received from the server
+ *     - LE_TIMEOUT: no valid reply received before the deadline
+ *     - LE_FAULT: failure to run the query
+ */
+//--------------------------------------------------------------------------------------------------
+typedef le_result_t (*ClkSync_ProtocolQueryFunc_t)
+(
+    const clkSync_AddrList_t* listPtr, ///< [IN] numeric IP addresses of the server
+    uint32_t timeoutMs,             ///< [IN] time to wait for the server on each address
+    int64_t deadlineNs,             ///< [IN] CLOCK_MONOTONIC time to give up at, INT64_MAX if none
+    clkSync_Sample_t* samplePtr     ///< [OUT] decoded sample
+);
+
+
+#if PA_CLKSYNC_MAX_SERVERS > CLKSYNC_MAX_ADDRS
+#error "PA_CLKSYNC_MAX_SERVERS can't exceed CLKSYNC_MAX_ADDRS"
+#endif
+
+
+//--------------------------------------------------------------------------------------------------
+// Static declarations
+//--------------------------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Engine presently selected for NTP
+ */
+//--------------------------------------------------------------------------------------------------
+static pa_clkSync_Engine_t NtpEngine = PA_CLKSYNC_NTP_ENGINE_DEFAULT;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Engine presently selected for TP
+ */
+//--------------------------------------------------------------------------------------------------
+static pa_clkSync_Engine_t TpEngine = PA_CLKSYNC_TP_ENGINE_DEFAULT;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Time allowed for a whole time retrieval, from the name resolution to the server's reply; 0 if
+ * unbounded
+ */
+//--------------------------------------------------------------------------------------------------
+static uint32_t QueryDeadlineMs = PA_CLKSYNC_QUERY_DEADLINE_MS_DEFAULT;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Pool and safe references of the time retrievals in progress from the event loop
+ */
+//--------------------------------------------------------------------------------------------------
+static le_mem_PoolRef_t RequestPool;
+static le_ref_MapRef_t RequestRefMap;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Whether the data connection is up, as last reported; it is assumed up until reported otherwise
+ */
+//--------------------------------------------------------------------------------------------------
+static bool IsConnected = true;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Whether a time retrieval started from the event loop while the data connection is down is
+ * queued until it is up, rather than refused
+ */
+//--------------------------------------------------------------------------------------------------
+static bool QueueUntilConnected;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the deadline of a time retrieval starting now
+ *
+ * @return
+ *      CLOCK_MONOTONIC time at which the retrieval is abandoned, INT64_MAX if never
+ */
+//--------------------------------------------------------------------------------------------------
+static int64_t GetQueryDeadline
+(
+    void
+)
+{
+    if (0 == QueryDeadlineMs)
+    {
+        return INT64_MAX;
+    }
+    return clkSync_GetClockNs(CLOCK_MONOTONIC) + (int64_t)QueryDeadlineMs * CLKSYNC_NS_PER_MSEC;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Validate a char string as an IPv4/v6 address or not
+ *
+ * @return
+ *      - true    the input char string contains an IPv4/v6 address valid in format
+ *      - false   otherwise
+ */
+//--------------------------------------------------------------------------------------------------
+static bool IsIpAddress
+(
+    const char* addStr  ///< [IN] IP address to classify
+)
+{
+    struct sockaddr_in6 sa;
+    if (inet_pton(AF_INET, addStr, &(sa.sin6_addr)) ||
+        inet_pton(AF_INET6, addStr, &(sa.sin6_addr)))
+    {
+        return true;
+    }
+    return false;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Validate the given time server and get its IP addresses, resolving it if given as a name. The
+ * resolution is served from the cache when a valid entry exists for the name.
+ *
+ * @return
+ *      - LE_OK             The server is valid and its IP addresses are returned
+ *      - LE_BAD_PARAMETER  Incorrect parameter
+ *      - LE_NOT_FOUND      Given server name not resolvable into an IP addr
+ *      - LE_TIMEOUT        Given server name not resolved before the deadline
+ *      - LE_UNAVAILABLE    Given server name not resolved, too many lookups already running
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ValidateServer
+(
+    const char* serverStrPtr,   ///< [IN]  Time server name or address
+    int64_t deadlineNs,         ///< [IN]  CLOCK_MONOTONIC time to give up at, INT64_MAX if none
+    clkSync_AddrList_t* listPtr,///< [OUT] IP addresses of the server
+    int64_t* dnsNsPtr           ///< [OUT] Time of the name resolution, -1 if the server is given
+                                ///<       as an address; may be NULL
+)
+{
+    le_result_t result;
+    int64_t startNs;
+
+    if (dnsNsPtr)
+    {
+        *dnsNsPtr = -1;
+    }
+
+    if ((!serverStrPtr) || ('\0' == serverStrPtr[0]))
+    {
+        LE_ERROR("Incorrect parameter");
+        return LE_BAD_PARAMETER;
+    }
+
+    if (IsIpAddress(serverStrPtr))
+    {
+        if (LE_OK != le_utf8_Copy(listPtr->addrs[0], serverStrPtr, LE_DCS_IPADDR_MAX_LEN, NULL))
+        {
+            LE_ERROR("Server address %s too long", serverStrPtr);
+            return LE_BAD_PARAMETER;
+        }
+        listPtr->count = 1;
+        return LE_OK;
+    }
+
+    startNs = clkSync_GetClockNs(CLOCK_MONOTONIC);
+    result = clkSyncDns_Resolve(serverStrPtr, deadlineNs, listPtr);
+    if (dnsNsPtr)
+    {
+        *dnsNsPtr = clkSync_GetClockNs(CLOCK_MONOTONIC) - startNs;
+    }
+    if ((LE_TIMEOUT == result) || (LE_UNAVAILABLE == result))
+    {
+        return result;
+    }
+    if (LE_OK != result)
+    {
+        LE_WARN("Failed to resolve server %s into IP address to get clock time",
+                serverStrPtr);
+        return LE_NOT_FOUND;
+    }
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Convert a time given in nanoseconds since the Unix epoch into a clock time structure
+ */
+//--------------------------------------------------------------------------------------------------
+static void ConvertNsToClockTime
+(
+    int64_t timeNs,                  ///< [IN]  Time to convert
+    le_clkSync_ClockTime_t* timePtr  ///< [OUT] Time structure
+)
+{
+    struct timespec ts = clkSync_NsToTimespec(timeNs);
+    struct tm tm = {0};
+
+    localtime_r(&ts.tv_sec, &tm);
+    timePtr->msec = (uint16_t)(ts.tv_nsec / CLKSYNC_NS_PER_MSEC);
+    timePtr->sec  = tm.tm_sec;
+    timePtr->min  = tm.tm_min;
+    timePtr->hour = tm.tm_hour;
+    timePtr->day  = tm.tm_mday;
+    timePtr->mon  = 1 + tm.tm_mon; // Convert month range to [1..12]
+    timePtr->year = 1900 + tm.tm_year;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Time retrieved from a server, with the CLOCK_BOOTTIME instant at which it was the server's time
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    int64_t timeNs;                         ///< Time retrieved, since the Unix epoch
+    int64_t bootNs;                         ///< CLOCK_BOOTTIME at which it was the time
+    bool isValid;                           ///< Whether a time was retrieved
+}
+ClkSync_Stamp_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Stamp the time retrieved at the given local CLOCK_REALTIME instant, to be called before the
+ * system clock is updated
+ */
+//--------------------------------------------------------------------------------------------------
+static void StampTime
+(
+    int64_t timeNs,                         ///< [IN]  Time retrieved, since the Unix epoch
+    int64_t localTimeNs,                    ///< [IN]  Local CLOCK_REALTIME at which it was the time
+    ClkSync_Stamp_t* stampPtr               ///< [OUT] Stamp, may be NULL
+)
+{
+    int64_t realNs, bootNs;
+
+    if (!stampPtr)
+    {
+        return;
+    }
+
+    realNs = clkSync_GetClockNs(CLOCK_REALTIME);
+    bootNs = clkSync_GetClockNs(CLOCK_BOOTTIME);
+    stampPtr->timeNs = timeNs;
+    stampPtr->bootNs = bootNs - (realNs - localTimeNs);
+    stampPtr->isValid = true;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Remember the time retrieved from a server with a protocol for the following estimates, if a time
+ * was retrieved
+ */
+//--------------------------------------------------------------------------------------------------
+static void CacheTime
+(
+    pa_clkSync_Protocol_t protocol,         ///< [IN] Protocol run
+    const char* serverStrPtr,               ///< [IN] Time server name or address
+    const ClkSync_Stamp_t* stampPtr         ///< [IN] Time retrieved and when
+)
+{
+    if (stampPtr->isValid)
+    {
+        clkSyncCache_Store(protocol, serverStrPtr, stampPtr->timeNs, stampPtr->bootNs);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Command line tool run by a backend
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    const char* namePtr;                    ///< Command name used in logs
+    const char* path;                       ///< Path of the command binary
+    size_t maxAddrs;                        ///< Number of server addresses the command accepts
+    const char* addrFormatPtr;              ///< printf() format of the argument giving a server
+                                            ///< address, NULL to give the address as is
+    const char* const* getArgs;             ///< Options of the command printing the time, NULL
+                                            ///< ended; the server addresses follow them
+    const char* const* setArgs;             ///< Options of the command setting the system clock
+    const clkSyncParse_Format_t* getFormatPtr; ///< Format of the output printing the time
+    bool printsOnStderr;                    ///< Whether the time is printed on standard error
+}
+ClkSync_Command_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Backend of a time protocol: the tools of a time package installed on the target, which the
+ * engines other than the native client run
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    const char* namePtr;                    ///< Backend name used in logs
+    const ClkSync_Command_t* commandPtr;    ///< Command querying the given servers once, NULL if
+                                            ///< the package has none
+    const ClkSync_Command_t* trackingPtr;   ///< Command reporting the tracking of the package's
+                                            ///< daemon, NULL to read the kernel discipline state
+                                            ///< the daemon maintains instead
+}
+ClkSync_Backend_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Time protocol as run by any of its engines
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    const char* namePtr;                    ///< Protocol name used in logs
+    pa_clkSync_Protocol_t id;               ///< Protocol identifier
+    pa_clkSync_Engine_t* enginePtr;         ///< Engine presently selected for the protocol
+    ClkSync_ProtocolQueryFunc_t queryFunc;  ///< Native client's query function
+    const clkSync_Client_t* clientPtr;      ///< Native client, as run from the event loop
+    uint32_t timeoutMs;                     ///< Time given to the native client on each address
+    const ClkSync_Backend_t* const* backendPtr; ///< Backend presently selected for the protocol
+}
+ClkSync_Protocol_t;
+
+#if PA_CLKSYNC_WITH_COMMANDS
+//--------------------------------------------------------------------------------------------------
+/**
+ * Command line tools: rdate and ntpdate, and chrony's daemon run once to query the given servers,
+ * "chronyd -Q" printing the offset on its standard error, and its client reporting the tracking
+ * of the running daemon through its control socket
+ */
+//--------------------------------------------------------------------------------------------------
+#if PA_CLKSYNC_WITH_TP
+static const ClkSync_Command_t RdateCommand =
+{
+    .namePtr = "rdate",
+    .path = "/usr/sbin/rdate",
+    .maxAddrs = 1,
+    .getArgs = (const char* const[]){ "-p", NULL },
+    .setArgs = (const char* const[]){ NULL },
+    .getFormatPtr = &clkSyncParse_Rdate,
+};
+#endif
+
+static const ClkSync_Command_t NtpdateCommand =
+{
+    .namePtr = "ntpdate",
+    .path = "/usr/sbin/ntpdate",
+    .maxAddrs = CLKSYNC_MAX_ADDRS,
+    .getArgs = (const char* const[]){ "-t", "1.0", "-p", "1", "-q", NULL },
+    .setArgs = (const char* const[]){ "-t", "1.0", "-p", "1", NULL },
+    .getFormatPtr = &clkSyncParse_Ntpdate,
+};
+
+static const ClkSync_Command_t ChronydCommand =
+{
+    .namePtr = "chronyd",
+    .path = "/usr/sbin/chronyd",
+    .maxAddrs = CLKSYNC_MAX_ADDRS,
+    .addrFormatPtr = "server %s iburst maxsamples 1",
+    .getArgs = (const char* const[]){ "-Q", "-t", "3", NULL },
+    .setArgs = (const char* const[]){ "-q", "-t", "3", NULL },
+    .getFormatPtr = &clkSyncParse_Chronyd,
+    .printsOnStderr = true,
+};
+
+static const ClkSync_Command_t ChronycTrackingCommand =
+{
+    .namePtr = "chronyc",
+    .path = "/usr/bin/chronyc",
+    .maxAddrs = 0,
+    .getArgs = (const char* const[]){ "-n", "-c", "tracking", NULL },
+    .setArgs = (const char* const[]){ NULL },
+    .getFormatPtr = &clkSyncParse_ChronycTracking,
+};
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Command of a backend, NULL when the commands are left out
+ */
+//--------------------------------------------------------------------------------------------------
+#define CLKSYNC_COMMAND(commandPtr)     (commandPtr)
+#else
+#define CLKSYNC_COMMAND(commandPtr)     NULL
+#endif
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Backends of TP and NTP. systemd-timesyncd has no command to query a server once, and its
+ * tracking is read from the kernel discipline state, as is that of ntpd beside ntpdate.
+ */
+//--------------------------------------------------------------------------------------------------
+#if PA_CLKSYNC_WITH_TP
+static const ClkSync_Backend_t RdateBackend =
+{
+    .namePtr = "rdate",
+    .commandPtr = CLKSYNC_COMMAND(&RdateCommand),
+};
+#endif
+
+static const ClkSync_Backend_t NtpBackends[] =
+{
+    [PA_CLKSYNC_BACKEND_NTPDATE] =
+    {
+        .namePtr = "ntpdate",
+        .commandPtr = CLKSYNC_COMMAND(&NtpdateCommand),
+    },
+    [PA_CLKSYNC_BACKEND_CHRONY] =
+    {
+        .namePtr = "chrony",
+        .commandPtr = CLKSYNC_COMMAND(&ChronydCommand),
+        .trackingPtr = CLKSYNC_COMMAND(&ChronycTrackingCommand),
+    },
+    [PA_CLKSYNC_BACKEND_TIMESYNCD] =
+    {
+        .namePtr = "systemd-timesyncd",
+    },
+};
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Backends presently selected for TP and NTP
+ */
+//--------------------------------------------------------------------------------------------------
+#if PA_CLKSYNC_WITH_TP
+static const ClkSync_Backend_t* TpBackendPtr = &RdateBackend;
+#endif
+static const ClkSync_Backend_t* NtpBackendPtr = &NtpBackends[PA_CLKSYNC_NTP_BACKEND_DEFAULT];
+
+#if PA_CLKSYNC_WITH_TP
+//--------------------------------------------------------------------------------------------------
+/**
+ * Time Protocol (TP)
+ */
+//--------------------------------------------------------------------------------------------------
+static const ClkSync_Protocol_t TpProtocol =
+{
+    .namePtr = "TP",
+    .id = PA_CLKSYNC_PROTOCOL_TP,
+    .enginePtr = &TpEngine,
+    .queryFunc = clkSyncTp_Query,
+    .clientPtr = &clkSyncTp_Client,
+    .timeoutMs = CLKSYNC_TP_TIMEOUT_MS,
+    .backendPtr = &TpBackendPtr,
+};
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Time Protocol as given to the retrievals, NULL when left out
+ */
+//--------------------------------------------------------------------------------------------------
+#define TP_PROTOCOL_PTR     (&TpProtocol)
+#else
+#define TP_PROTOCOL_PTR     NULL
+#endif
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Network Time Protocol (NTP)
+ */
+//--------------------------------------------------------------------------------------------------
+static const ClkSync_Protocol_t NtpProtocol =
+{
+    .namePtr = "NTP",
+    .id = PA_CLKSYNC_PROTOCOL_NTP,
+    .enginePtr = &NtpEngine,
+    .queryFunc = clkSyncSntp_Query,
+    .clientPtr = &clkSyncSntp_Client,
+    .timeoutMs = CLKSYNC_SNTP_TIMEOUT_MS,
+    .backendPtr = &NtpBackendPtr,
+};
+
+
+#if PA_CLKSYNC_WITH_COMMANDS
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start the given command against the given server addresses. ntpdate and chronyd are given all
+ * of them and keep the best reply, rdate only takes the first one and a tracking command none.
+ * Unless the operation is CLKSYNC_OP_SET, the command prints the retrieved time; otherwise it sets
+ * it into the system clock. The command is launched directly from an argument array, without a
+ * shell, and the parser is initialized for its output.
+ *
+ * @return
+ *      - LE_OK             Command started
+ *      - LE_FAULT          The backend has no such command, or it couldn't be started
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t StartProtocolCommand
+(
+    const clkSync_AddrList_t* listPtr,      ///< [IN]  Time server IP addresses
+    ClkSync_Operation_t operation,          ///< [IN]  Operation to run
+    const ClkSync_Command_t* commandPtr,    ///< [IN]  Command to run, may be NULL
+    clkSyncSpawn_Process_t* procPtr,        ///< [OUT] Command started
+    clkSyncParse_Parser_t* parserPtr        ///< [OUT] Parser of the command's output
+)
+{
+    char addrArgs[CLKSYNC_MAX_ADDRS][CLKSYNC_COMMAND_ARG_BYTES];
+    const char* argv[CLKSYNC_SPAWN_MAX_ARGS];
+    const char* const* optionsPtr;
+    clkSyncSpawn_Errors_t errors;
+    bool getsTime = (CLKSYNC_OP_SET != operation);
+    size_t i, argc = 0, addrCount;
+
+    if (NULL == commandPtr)
+    {
+        LE_ERROR("No command to run with the selected backend");
+        return LE_FAULT;
+    }
+
+    optionsPtr = getsTime ? commandPtr->getArgs : commandPtr->setArgs;
+    addrCount = listPtr ? listPtr->count : 0;
+    if (addrCount > commandPtr->maxAddrs)
+    {
+        addrCount = commandPtr->maxAddrs;
+    }
+
+    // The server is passed as its already resolved IP addresses, which saves the command a second
+    // name resolution
+    argv[argc++] = commandPtr->path;
+    for (i = 0; optionsPtr[i] && (argc < CLKSYNC_SPAWN_MAX_ARGS - 1); i++)
+    {
+        argv[argc++] = optionsPtr[i];
+    }
+    for (i = 0; (i < addrCount) && (argc < CLKSYNC_SPAWN_MAX_ARGS - 1); i++)
+    {
+        if (NULL == commandPtr->addrFormatPtr)
+        {
+            argv[argc++] = listPtr->addrs[i];
+            continue;
+        }
+        snprintf(addrArgs[i], sizeof(addrArgs[i]), commandPtr->addrFormatPtr, listPtr->addrs[i]);
+        argv[argc++] = addrArgs[i];
+    }
+    argv[argc] = NULL;
+
+    // Only the exit code of a command setting the clock is looked at
+    errors = CLKSYNC_SPAWN_ERRORS_KEEP;
+    if (!getsTime)
+    {
+        errors = CLKSYNC_SPAWN_ERRORS_DISCARD;
+    }
+    else if (commandPtr->printsOnStderr)
+    {
+        errors = CLKSYNC_SPAWN_ERRORS_CAPTURE;
+    }
+    if (LE_OK != clkSyncSpawn_Start(argv, errors, procPtr))
+    {
+        return LE_FAULT;
+    }
+
+    clkSyncParse_Init(parserPtr, getsTime ? commandPtr->getFormatPtr : NULL);
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the result of a protocol's command once it exited. Unless the operation is CLKSYNC_OP_SET,
+ * the retrieved time is taken from the parsed output and returned, and set into the system clock
+ * for CLKSYNC_OP_GET_AND_SET; otherwise the command's exit code is checked.
+ *
+ * @return
+ *      - LE_OK             Function succeeded to get and/or update clock time
+ *      - LE_FAULT          Function failed to get or update clock time
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ParseCommandOutput
+(
+    clkSyncParse_Parser_t* parserPtr,       ///< [IN]  Parser fed with the command's output
+    int exitCode,                           ///< [IN]  Exit code of the command, -1 if abnormal
+    ClkSync_Operation_t operation,          ///< [IN]  Operation to run
+    const ClkSync_Command_t* commandPtr,    ///< [IN]  Command run
+    le_clkSync_ClockTime_t* timePtr,        ///< [OUT] Time structure
+    ClkSync_Stamp_t* stampPtr               ///< [OUT] Time retrieved and when, may be NULL
+)
+{
+    le_result_t result;
+    int64_t localTimeNs;
+
+    LE_INFO("Result: %d", exitCode);
+    if (CLKSYNC_OP_SET == operation)
+    {
+        if (0 != exitCode)
+        {
+            return LE_FAULT;
+        }
+        clkSyncAdjust_ReportCommand();
+        return LE_OK;
+    }
+
+    if (LE_OK != clkSyncParse_Finish(parserPtr))
+    {
+        if ('\0' != parserPtr->error[0])
+        {
+            LE_WARN("%s", parserPtr->error);
+        }
+        LE_ERROR("Failed to get time with %s command", commandPtr->namePtr);
+        return LE_FAULT;
+    }
+
+    localTimeNs = clkSync_GetClockNs(CLOCK_REALTIME);
+    ConvertNsToClockTime(localTimeNs + parserPtr->offsetNs, timePtr);
+    StampTime(localTimeNs + parserPtr->offsetNs, localTimeNs, stampPtr);
+    result = LE_OK;
+    if (CLKSYNC_OP_GET_AND_SET == operation)
+    {
+        result = clkSyncAdjust_Apply(parserPtr->offsetNs);
+    }
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Read a command's output and feed it to the parser, draining it to the end so that the command
+ * isn't blocked on a full pipe
+ *
+ * @return
+ *      - LE_OK             End of the output reached
+ *      - LE_WOULD_BLOCK    More output to come on a non-blocking stream
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ReadCommandOutput
+(
+    int fd,                                 ///< [IN] Command's output pipe
+    clkSyncParse_Parser_t* parserPtr        ///< [IN] Parser of the output
+)
+{
+    char buf[SYSTEM_CMD_READ_LENGTH];
+
+    for (;;)
+    {
+        ssize_t len = read(fd, buf, sizeof(buf));
+
+        if (len > 0)
+        {
+            clkSyncParse_Feed(parserPtr, buf, len);
+            continue;
+        }
+        if (0 == len)
+        {
+            return LE_OK;
+        }
+        if (EINTR == errno)
+        {
+            continue;
+        }
+        if (EAGAIN == errno)
+        {
+            return LE_WOULD_BLOCK;
+        }
+        LE_ERROR("Failed to read command output (%m)");
+        return LE_OK;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Retrieve current clock time by running the given command against the given server
+ * addresses. Unless the operation is CLKSYNC_OP_SET, the retrieved time is parsed from the
+ * command's output and returned, then set into the system clock by this adaptor for
+ * CLKSYNC_OP_GET_AND_SET; for CLKSYNC_OP_SET the command sets it into the system clock. The
+ * command is killed if it doesn't exit before the deadline. The time spent is accounted to the
+ * launch of the command, the wait for its output, i.e. its own exchange with the server, and the
+ * parsing of the output.
+ *
+ * @return
+ *      - LE_OK             Function succeeded to get and/or update clock time
+ *      - LE_UNAVAILABLE    No current clock time retrieved from the given server
+ *      - LE_TIMEOUT        The command didn't exit before the deadline
+ *      - LE_FAULT          Function failed to get clock time
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t RunProtocolCommand
+(
+    const clkSync_AddrList_t* listPtr,      ///< [IN]  Time server IP addresses
+    ClkSync_Operation_t operation,          ///< [IN]  Operation to run
+    const ClkSync_Command_t* commandPtr,    ///< [IN]  Command to run, may be NULL
+    int64_t deadlineNs,                     ///< [IN]  CLOCK_MONOTONIC time to give up at,
+                                            ///<       INT64_MAX if none
+    clkSyncTiming_Record_t* timingPtr,      ///< [IN]  Measurement of the retrieval, may be NULL
+    le_clkSync_ClockTime_t* timePtr,        ///< [OUT] Time structure
+    ClkSync_Stamp_t* stampPtr               ///< [OUT] Time retrieved and when, may be NULL
+)
+{
+    clkSyncParse_Parser_t parser;
+    clkSyncSpawn_Process_t proc;
+    le_result_t result;
+    int exitCode;
+
+    result = StartProtocolCommand(listPtr, operation, commandPtr, &proc, &parser);
+    clkSyncTiming_Lap(timingPtr, PA_CLKSYNC_PHASE_SPAWN);
+    if (LE_OK != result)
+    {
+        return LE_FAULT;
+    }
+
+    // The output is polled so that a command hanging on an unreachable server can be stopped
+    fcntl(proc.outputFd, F_SETFL, fcntl(proc.outputFd, F_GETFL) | O_NONBLOCK);
+    for (;;)
+    {
+        struct pollfd pfd = { .fd = proc.outputFd, .events = POLLIN };
+        int waitMs = -1;
+        int rc;
+
+        result = ReadCommandOutput(proc.outputFd, &parser);
+        clkSyncTiming_Lap(timingPtr, PA_CLKSYNC_PHASE_PARSE);
+        if (LE_WOULD_BLOCK != result)
+        {
+            break;
+        }
+
+        if (INT64_MAX != deadlineNs)
+        {
+            int64_t waitNs = deadlineNs - clkSync_GetClockNs(CLOCK_MONOTONIC);
+
+            waitMs = (waitNs > 0) ? (int)((waitNs + CLKSYNC_NS_PER_MSEC - 1) /
+                                          CLKSYNC_NS_PER_MSEC) : 0;
+        }
+
+        rc = poll(&pfd, 1, waitMs);
+        clkSyncTiming_Lap(timingPtr, PA_CLKSYNC_PHASE_NETWORK);
+        if (0 == rc)
+        {
+            LE_WARN("%s command not completed before the deadline, killed",
+                    commandPtr->namePtr);
+            clkSyncSpawn_Kill(&proc);
+            return LE_TIMEOUT;
+        }
+        if ((rc < 0) && (EINTR != errno))
+        {
+            LE_ERROR("Failed to wait for command output (%m)");
+            clkSyncSpawn_Kill(&proc);
+            return LE_FAULT;
+        }
+    }
+    exitCode = clkSyncSpawn_Wait(&proc);
+    clkSyncTiming_Lap(timingPtr, PA_CLKSYNC_PHASE_NETWORK);
+
+    result = ParseCommandOutput(&parser, exitCode, operation, commandPtr, timePtr, stampPtr);
+    clkSyncTiming_Lap(timingPtr, PA_CLKSYNC_PHASE_PARSE);
+    return result;
+}
+#else
+//--------------------------------------------------------------------------------------------------
+/**
+ * Stand-in for the run of a command when the commands are left out
+ *
+ * @return
+ *      - LE_FAULT          No command to run
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t RunProtocolCommand
+(
+    const clkSync_AddrList_t* listPtr,      ///< [IN]  Time server IP addresses
+    ClkSync_Operation_t operation,          ///< [IN]  Operation to run
+    const ClkSync_Command_t* commandPtr,    ///< [IN]  Command to run, may be NULL
+    int64_t deadlineNs,                     ///< [IN]  CLOCK_MONOTONIC time to give up at,
+                                            ///<       INT64_MAX if none
+    clkSyncTiming_Record_t* timingPtr,      ///< [IN]  Measurement of the retrieval, may be NULL
+    le_clkSync_ClockTime_t* timePtr,        ///< [OUT] Time structure
+    ClkSync_Stamp_t* stampPtr               ///< [OUT] Time retrieved and when, may be NULL
+)
+{
+    LE_ERROR("Commands not compiled in");
+    return LE_FAULT;
+}
+#endif
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Retrieve current clock time from the tracking of the given backend's daemon, when it already
+ * disciplines the system clock, without a network round trip: chrony's is reported by chronyc
+ * through the daemon's control socket, the others' read from the kernel discipline state. The
+ * daemon keeps correcting the system clock itself, which is thus left untouched whatever the
+ * operation; for CLKSYNC_OP_SET no time is returned.
+ *
+ * @return
+ *      - LE_OK             Function succeeded to get clock time
+ *      - LE_UNAVAILABLE    No daemon disciplines the system clock
+ *      - LE_TIMEOUT        The tracking command didn't exit before the deadline
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t QueryDaemon
+(
+    const ClkSync_Backend_t* backendPtr,    ///< [IN]  Backend whose daemon is queried
+    ClkSync_Operation_t operation,          ///< [IN]  Operation to run
+    int64_t deadlineNs,                     ///< [IN]  CLOCK_MONOTONIC time to give up at,
+                                            ///<       INT64_MAX if none
+    clkSyncTiming_Record_t* timingPtr,      ///< [IN]  Measurement of the retrieval, may be NULL
+    le_clkSync_ClockTime_t* timePtr,        ///< [OUT] Time structure
+    ClkSync_Stamp_t* stampPtr               ///< [OUT] Time retrieved and when, may be NULL
+)
+{
+    le_clkSync_ClockTime_t trackedTime;
+    le_result_t result;
+    int64_t offsetNs, localTimeNs;
+
+    if (backendPtr->trackingPtr)
+    {
+        result = RunProtocolCommand(NULL, CLKSYNC_OP_GET, backendPtr->trackingPtr, deadlineNs,
+                                    timingPtr, &trackedTime, stampPtr);
+    }
+    else
+    {
+        result = clkSyncAdjust_GetKernelSync(&offsetNs);
+        clkSyncTiming_Lap(timingPtr, PA_CLKSYNC_PHASE_NETWORK);
+        if (LE_OK == result)
+        {
+            localTimeNs = clkSync_GetClockNs(CLOCK_REALTIME);
+            ConvertNsToClockTime(localTimeNs + offsetNs, &trackedTime);
+            StampTime(localTimeNs + offsetNs, localTimeNs, stampPtr);
+        }
+    }
+
+    if (LE_TIMEOUT == result)
+    {
+        return result;
+    }
+    if (LE_OK != result)
+    {
+        LE_DEBUG("No %s daemon disciplining the system clock", backendPtr->namePtr);
+        return LE_UNAVAILABLE;
+    }
+
+    LE_DEBUG("Time retrieved from the tracking of %s", backendPtr->namePtr);
+    if (CLKSYNC_OP_SET != operation)
+    {
+        *timePtr = trackedTime;
+    }
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Return the time given by a sample and/or set it into the system clock, according to the
+ * operation
+ *
+ * @return
+ *      - LE_OK             Function succeeded to get and/or update clock time
+ *      - LE_FAULT          Function failed to update clock time
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ApplySample
+(
+    const clkSync_Sample_t* samplePtr,      ///< [IN]  Sample retrieved from a server
+    ClkSync_Operation_t operation,          ///< [IN]  Operation to run
+    le_clkSync_ClockTime_t* timePtr,        ///< [OUT] Time structure
+    ClkSync_Stamp_t* stampPtr               ///< [OUT] Time retrieved and when, may be NULL
+)
+{
+    if (CLKSYNC_OP_SET != operation)
+    {
+        ConvertNsToClockTime(samplePtr->localTimeNs + samplePtr->offsetNs, timePtr);
+    }
+    StampTime(samplePtr->localTimeNs + samplePtr->offsetNs, samplePtr->localTimeNs, stampPtr);
+    if (CLKSYNC_OP_GET == operation)
+    {
+        return LE_OK;
+    }
+
+    // The offset is applied as measured, without a second exchange with the server
+    return clkSyncAdjust_Apply(samplePtr->offsetNs);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Retrieve a sample of current clock time from the given server addresses with a protocol's
+ * native client. The addresses are raced, the first valid reply winning.
+ *
+ * @return
+ *      - LE_OK             Function succeeded to get clock time
+ *      - LE_UNAVAILABLE    No current clock time retrieved from the given server
+ *      - LE_TIMEOUT        No current clock time retrieved before the deadline
+ *      - LE_FAULT          Function failed to get clock time
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t RunNativeClient
+(
+    const clkSync_AddrList_t* listPtr,      ///< [IN]  Time server IP addresses
+    const ClkSync_Protocol_t* protocolPtr,  ///< [IN]  Protocol to run
+    int64_t deadlineNs,                     ///< [IN]  CLOCK_MONOTONIC time to give up at,
+                                            ///<       INT64_MAX if none
+    clkSyncTiming_Record_t* timingPtr,      ///< [IN]  Measurement of the retrieval
+    clkSync_Sample_t* samplePtr             ///< [OUT] Sample retrieved
+)
+{
+    le_result_t result;
+
+    result = protocolPtr->queryFunc(listPtr, protocolPtr->timeoutMs, deadlineNs, samplePtr);
+    if (result != LE_OK)
+    {
+        LE_ERROR("Failed to get time from server %s", listPtr->addrs[0]);
+        return result;
+    }
+    timingPtr->rttNs = samplePtr->delayNs;
+    LE_DEBUG("Time retrieved from server address %s", listPtr->addrs[samplePtr->addrIndex]);
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Retrieve current clock time from the given server with the given protocol. The server is
+ * resolved once into its IP addresses, which are then used by the protocol's selected engine and by
+ * the command fallback of the native engine. The daemon engine first looks for a daemon already
+ * disciplining the system clock, and falls back to the native engine otherwise. The 2nd input
+ * argument specifies if this operation is to only get the time, to set it into the system clock,
+ * or both from a single exchange with the server. Unless it is a set only operation, the retrieved
+ * current time will be returned in the output and last argument. The whole retrieval is bounded by
+ * the query deadline.
+ *
+ * @return
+ *      - LE_OK             Function succeeded to get and/or update clock time
+ *      - LE_BAD_PARAMETER  Incorrect parameter
+ *      - LE_NOT_FOUND      Given server as name or address not found or resolvable into an IP addr
+ *      - LE_UNAVAILABLE    No current clock time retrieved from the given server
+ *      - LE_TIMEOUT        No current clock time retrieved before the query deadline
+ *      - LE_FAULT          Function failed to get or update clock time
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t GetTimeFromServer
+(
+    const char* serverStrPtr,               ///< [IN]  Time server name or address
+    ClkSync_Operation_t operation,          ///< [IN]  Operation to run
+    const ClkSync_Protocol_t* protocolPtr,  ///< [IN]  Protocol to run, i.e. TP or NTP
+    clkSyncTiming_Record_t* timingPtr,      ///< [IN]  Measurement of the retrieval
+    le_clkSync_ClockTime_t* timePtr,        ///< [OUT] Time structure
+    ClkSync_Stamp_t* stampPtr               ///< [OUT] Time retrieved and when, may be NULL
+)
+{
+    le_result_t result;
+    clkSync_AddrList_t addrList = {0};
+    clkSync_Sample_t sample;
+    int64_t deadlineNs;
+
+    if (!timePtr)
+    {
+        // Not supposed to happen
+        LE_ERROR("Null time data structure");
+        return LE_BAD_PARAMETER;
+    }
+
+    memset(timePtr, 0, sizeof(le_clkSync_ClockTime_t));
+    deadlineNs = GetQueryDeadline();
+
+    // The server is only needed when no daemon already tracks the time
+    if (PA_CLKSYNC_ENGINE_DAEMON == *protocolPtr->enginePtr)
+    {
+        result = QueryDaemon(*protocolPtr->backendPtr, operation, deadlineNs, timingPtr,
+                             timePtr, stampPtr);
+        if (LE_UNAVAILABLE != result)
+        {
+            return result;
+        }
+        LE_WARN("No %s daemon tracking the time, falling back to native client",
+                protocolPtr->namePtr);
+    }
+
+    // Without a data connection, the server could only be reached after the resolution times out
+    if (!IsConnected)
+    {
+        LE_WARN("Data connection down, %s time not retrieved", protocolPtr->namePtr);
+        return LE_UNAVAILABLE;
+    }
+
+    // Validate time server name resolution if given as a name
+    result = ValidateServer(serverStrPtr, deadlineNs, &addrList, &timingPtr->dnsNs);
+    clkSyncTiming_Lap(timingPtr, PA_CLKSYNC_PHASE_DNS);
+    if (result != LE_OK)
+    {
+        return result;
+    }
+
+    if (PA_CLKSYNC_ENGINE_COMMAND != *protocolPtr->enginePtr)
+    {
+        result = RunNativeClient(&addrList, protocolPtr, deadlineNs, timingPtr, &sample);
+        clkSyncTiming_Lap(timingPtr, PA_CLKSYNC_PHASE_NETWORK);
+        if (LE_OK == result)
+        {
+            // Only a failed exchange falls back to the command, not a failed clock update
+            return ApplySample(&sample, operation, timePtr, stampPtr);
+        }
+        if ((LE_FAULT != result) || !PA_CLKSYNC_WITH_COMMANDS)
+        {
+            return result;
+        }
+        LE_WARN("Native %s client failed, falling back to command", protocolPtr->namePtr);
+    }
+
+    return RunProtocolCommand(&addrList, operation, (*protocolPtr->backendPtr)->commandPtr,
+                              deadlineNs, timingPtr, timePtr, stampPtr);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Retrieve current clock time from the given server with the given protocol as
+ * GetTimeFromServer() does, measuring the retrieval for the latency report of the protocol's
+ * selected engine and counting it into the statistics. A caller arriving while a retrieval from
+ * the same server with the same protocol serving its operation is in progress waits for it and
+ * shares its result instead.
+ *
+ * @return
+ *      See GetTimeFromServer()
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t pa_clkSync_GetTimeFromServer
+(
+    const char* serverStrPtr,               ///< [IN]  Time server name or address
+    ClkSync_Operation_t operation,          ///< [IN]  Operation to run
+    const ClkSync_Protocol_t* protocolPtr,  ///< [IN]  Protocol to run, i.e. TP or NTP
+    le_clkSync_ClockTime_t* timePtr         ///< [OUT] Time structure
+)
+{
+    clkSyncCoalesce_Flight_t* flightPtr = NULL;
+    clkSyncTiming_Record_t timing;
+    ClkSync_Stamp_t stamp = {0};
+    pa_clkSync_Engine_t engine;
+    bool isLeader = true;
+    le_result_t result;
+
+    if (!protocolPtr)
+    {
+        LE_ERROR("Protocol not compiled in");
+        return LE_UNSUPPORTED;
+    }
+    engine = *protocolPtr->enginePtr;
+
+    if (timePtr)
+    {
+        flightPtr = clkSyncCoalesce_Join(protocolPtr->id, serverStrPtr,
+                                         CLKSYNC_OP_SET != operation, CLKSYNC_OP_GET != operation,
+                                         &isLeader);
+    }
+    if (!isLeader)
+    {
+        result = clkSyncCoalesce_Wait(flightPtr, timePtr);
+        if (CLKSYNC_OP_SET == operation)
+        {
+            memset(timePtr, 0, sizeof(le_clkSync_ClockTime_t));
+        }
+        return result;
+    }
+
+    clkSyncTiming_Start(&timing);
+    result = GetTimeFromServer(serverStrPtr, operation, protocolPtr, &timing, timePtr, &stamp);
+    clkSyncTiming_Stop(&timing, protocolPtr->id, engine);
+    clkSyncStats_AddQuery(protocolPtr->id, clkSyncStats_GetServer(serverStrPtr), result,
+                          timing.dnsNs, timing.rttNs);
+    if (LE_OK == result)
+    {
+        CacheTime(protocolPtr->id, serverStrPtr, &stamp);
+    }
+    if (flightPtr)
+    {
+        clkSyncCoalesce_Complete(flightPtr, result, timePtr);
+    }
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the time of the given server with the given protocol without updating the system clock.
+ * Within the freshness window of the last time retrieved from this server with this protocol, the
+ * time is extrapolated from it rather than retrieved again.
+ *
+ * @return
+ *      See GetTimeFromServer()
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t GetTimeFromCacheOrServer
+(
+    const char* serverStrPtr,               ///< [IN]  Time server name or address
+    const ClkSync_Protocol_t* protocolPtr,  ///< [IN]  Protocol to run, i.e. TP or NTP
+    le_clkSync_ClockTime_t* timePtr,        ///< [OUT] Time structure
+    pa_clkSync_TimeInfo_t* infoPtr          ///< [OUT] Origin of the time, may be NULL
+)
+{
+    int64_t timeNs;
+    uint32_t ageMs;
+
+    if (!protocolPtr)
+    {
+        LE_ERROR("Protocol not compiled in");
+        return LE_UNSUPPORTED;
+    }
+    if (infoPtr)
+    {
+        memset(infoPtr, 0, sizeof(pa_clkSync_TimeInfo_t));
+    }
+
+    if (timePtr && (LE_OK == clkSyncCache_Estimate(protocolPtr->id, serverStrPtr, &timeNs,
+                                                   &ageMs)))
+    {
+        LE_DEBUG("%s time of %s estimated from a retrieval %" PRIu32 " ms old",
+                 protocolPtr->namePtr, serverStrPtr, ageMs);
+        ConvertNsToClockTime(timeNs, timePtr);
+        if (infoPtr)
+        {
+            infoPtr->isEstimate = true;
+            infoPtr->ageMs = ageMs;
+        }
+        return LE_OK;
+    }
+
+    return pa_clkSync_GetTimeFromServer(serverStrPtr, CLKSYNC_OP_GET, protocolPtr, timePtr);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Retrieve time from a server using the Time Protocol.
+ *
+ * @return
+ *      - LE_OK             Function succeeded to get (if getOnly) or update clock time
+ *      - LE_BAD_PARAMETER  Incorrect parameter
+ *      - LE_NOT_FOUND      Given server as name or address not found or resolvable into an IP addr
+ *      - LE_UNAVAILABLE    No current clock time retrieved from the given server
+ *      - LE_TIMEOUT        No current clock time retrieved before the query deadline
+ *      - LE_UNSUPPORTED    Function not supported by the target
+ *      - LE_FAULT          Function failed to get clock time
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t pa_clkSync_GetTimeWithTimeProtocol
+(
+    const char* serverStrPtr,       ///< [IN]  Time server
+    bool getOnly,                   ///< [IN]  Get the time acquired without updating system clock
+    le_clkSync_ClockTime_t* timePtr ///< [OUT] Time structure
+)
+{
+    if (getOnly)
+    {
+        return GetTimeFromCacheOrServer(serverStrPtr, TP_PROTOCOL_PTR, timePtr, NULL);
+    }
+    return pa_clkSync_GetTimeFromServer(serverStrPtr, CLKSYNC_OP_SET, TP_PROTOCOL_PTR, timePtr);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Retrieve time from a server using the Network Time Protocol.
+ *
+ * @return
+ *      - LE_OK             Function succeeded to get (if getOnly) or update clock time
+ *      - LE_BAD_PARAMETER  Incorrect parameter
+ *      - LE_NOT_FOUND      Given server as name or address not found or resolvable into an IP addr
+ *      - LE_UNAVAILABLE    No current clock time retrieved from the given server
+ *      - LE_TIMEOUT        No current clock time retrieved before the query deadline
+ *      - LE_UNSUPPORTED    Function not supported by the target
+ *      - LE_FAULT          Function failed to get clock time
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t pa_clkSync_GetTimeWithNetworkTimeProtocol
+(
+    const char* serverStrPtr,       ///< [IN]  Time server
+    bool getOnly,                   ///< [IN]  Get the time acquired without updating system clock
+    le_clkSync_ClockTime_t* timePtr ///< [OUT] Time structure
+)
+{
+    if (getOnly)
+    {
+        return GetTimeFromCacheOrServer(serverStrPtr, &NtpProtocol, timePtr, NULL);
+    }
+    return pa_clkSync_GetTimeFromServer(serverStrPtr, CLKSYNC_OP_SET, &NtpProtocol, timePtr);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Retrieve time from a server using the Time Protocol, set it into the system clock and return
+ * it, all from a single exchange with the server.
+ *
+ * @return
+ *      - LE_OK             Function succeeded to get and update clock time
+ *      - LE_BAD_PARAMETER  Incorrect parameter
+ *      - LE_NOT_FOUND      Given server as name or address not found or resolvable into an IP addr
+ *      - LE_UNAVAILABLE    No current clock time retrieved from the given server
+ *      - LE_TIMEOUT        No current clock time retrieved before the query deadline
+ *      - LE_UNSUPPORTED    TP not compiled in
+ *      - LE_FAULT          Function failed to get or update clock time
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t pa_clkSync_SyncWithTimeProtocol
+(
+    const char* serverStrPtr,       ///< [IN]  Time server
+    le_clkSync_ClockTime_t* timePtr ///< [OUT] Time retrieved and set
+)
+{
+    return pa_clkSync_GetTimeFromServer(serverStrPtr, CLKSYNC_OP_GET_AND_SET, TP_PROTOCOL_PTR,
+                                        timePtr);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Retrieve time from a server using the Network Time Protocol, set it into the system clock and
+ * return it, all from a single exchange with the server.
+ *
+ * @return
+ *      - LE_OK             Function succeeded to get and update clock time
+ *      - LE_BAD_PARAMETER  Incorrect parameter
+ *      - LE_NOT_FOUND      Given server as name or address not found or resolvable into an IP addr
+ *      - LE_UNAVAILABLE    No current clock time retrieved from the given server
+ *      - LE_TIMEOUT        No current clock time retrieved before the query deadline
+ *      - LE_FAULT          Function failed to get or update clock time
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t pa_clkSync_SyncWithNetworkTimeProtocol
+(
+    const char* serverStrPtr,       ///< [IN]  Time server
+    le_clkSync_ClockTime_t* timePtr ///< [OUT] Time retrieved and set
+)
+{
+    return pa_clkSync_GetTimeFromServer(serverStrPtr, CLKSYNC_OP_GET_AND_SET, &NtpProtocol,
+                                        timePtr);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Retrieve time from several servers together as pa_clkSync_GetTimeWithNetworkTimeProtocolServers()
+ * does, also returning the round-trip delay of the sample used
+ *
+ * @return
+ *      See pa_clkSync_GetTimeWithNetworkTimeProtocolServers()
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t GetTimeFromServers
+(
+    const char* const* serverStrPtrs,   ///< [IN]  Time servers
+    size_t serverCount,                 ///< [IN]  Number of time servers, up to
+                                        ///<       PA_CLKSYNC_MAX_SERVERS
+    bool getOnly,                       ///< [IN]  Get the time acquired without updating system
+                                        ///<       clock
+    int64_t* rttNsPtr,                  ///< [OUT] Round-trip delay of the sample used, -1 if
+                                        ///<       none
+    le_clkSync_ClockTime_t* timePtr     ///< [OUT] Time structure
+)
+{
+    clkSync_AddrList_t addrList = {0};
+    clkSync_Sample_t samples[CLKSYNC_MAX_ADDRS];
+    size_t serverIndexes[CLKSYNC_MAX_ADDRS];
+    clkSync_Sample_t best;
+    ClkSync_Stamp_t stamp = {0};
+    size_t i, sampleCount = 0;
+    int64_t deadlineNs;
+    le_result_t result;
+
+    if (!serverStrPtrs || !timePtr || (0 == serverCount) ||
+        (serverCount > PA_CLKSYNC_MAX_SERVERS))
+    {
+        LE_ERROR("Incorrect parameter");
+        return LE_BAD_PARAMETER;
+    }
+
+    memset(timePtr, 0, sizeof(le_clkSync_ClockTime_t));
+    deadlineNs = GetQueryDeadline();
+    *rttNsPtr = -1;
+
+    if (PA_CLKSYNC_ENGINE_DAEMON == NtpEngine)
+    {
+        result = QueryDaemon(NtpBackendPtr, CLKSYNC_OPERATION(getOnly), deadlineNs, NULL,
+                             timePtr, NULL);
+        if (LE_UNAVAILABLE != result)
+        {
+            return result;
+        }
+        LE_WARN("No %s daemon tracking the time, falling back to native client",
+                NtpProtocol.namePtr);
+    }
+
+    if (!IsConnected)
+    {
+        LE_WARN("Data connection down, %s time not retrieved", NtpProtocol.namePtr);
+        return LE_UNAVAILABLE;
+    }
+
+    // Each server is queried on its first address only; the servers back each other up
+    for (i = 0; i < serverCount; i++)
+    {
+        clkSync_AddrList_t serverList = {0};
+
+        if (LE_OK != ValidateServer(serverStrPtrs[i], deadlineNs, &serverList, NULL))
+        {
+            continue;
+        }
+        le_utf8_Copy(addrList.addrs[addrList.count], serverList.addrs[0],
+                     LE_DCS_IPADDR_MAX_LEN, NULL);
+        serverIndexes[addrList.count] = i;
+        addrList.count++;
+    }
+    if (0 == addrList.count)
+    {
+        return LE_NOT_FOUND;
+    }
+
+    if (PA_CLKSYNC_ENGINE_COMMAND != NtpEngine)
+    {
+        result = clkSyncSntp_QueryServers(&addrList, NtpProtocol.timeoutMs, deadlineNs,
+                                          samples, &sampleCount);
+        if (LE_OK == result)
+        {
+            clkSyncSelect_Best(samples, sampleCount, &best);
+            *rttNsPtr = best.delayNs;
+            LE_DEBUG("Time retrieved from server address %s", addrList.addrs[best.addrIndex]);
+            result = ApplySample(&best, CLKSYNC_OPERATION(getOnly), timePtr, &stamp);
+            if (LE_OK == result)
+            {
+                CacheTime(NtpProtocol.id, serverStrPtrs[serverIndexes[best.addrIndex]], &stamp);
+            }
+            return result;
+        }
+        if ((LE_FAULT != result) || !PA_CLKSYNC_WITH_COMMANDS)
+        {
+            LE_ERROR("Failed to get time from %zu servers", addrList.count);
+            return result;
+        }
+        LE_WARN("Native %s client failed, falling back to command", NtpProtocol.namePtr);
+    }
+
+    // ntpdate and chronyd do their own selection among the servers they're given
+    return RunProtocolCommand(&addrList, CLKSYNC_OPERATION(getOnly), NtpBackendPtr->commandPtr,
+                              deadlineNs, NULL, timePtr, NULL);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Retrieve time from several servers together using the Network Time Protocol. The servers are
+ * queried concurrently, the falsetickers among them are discarded and the most accurate of the
+ * remaining replies is used. Servers that fail to resolve are skipped.
+ *
+ * @return
+ *      - LE_OK             Function succeeded to get (if getOnly) or update clock time
+ *      - LE_BAD_PARAMETER  Incorrect parameter
+ *      - LE_NOT_FOUND      None of the given servers found or resolvable into an IP addr
+ *      - LE_UNAVAILABLE    No current clock time retrieved from the given servers
+ *      - LE_TIMEOUT        No current clock time retrieved before the query deadline
+ *      - LE_FAULT          Function failed to get clock time
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t pa_clkSync_GetTimeWithNetworkTimeProtocolServers
+(
+    const char* const* serverStrPtrs,   ///< [IN]  Time servers
+    size_t serverCount,                 ///< [IN]  Number of time servers, up to
+                                        ///<       PA_CLKSYNC_MAX_SERVERS
+    bool getOnly,                       ///< [IN]  Get the time acquired without updating system
+                                        ///<       clock
+    le_clkSync_ClockTime_t* timePtr     ///< [OUT] Time structure
+)
+{
+    int64_t rttNs = -1;
+    le_result_t result;
+
+    // The servers back each other up, the retrieval is only counted for the protocol
+    result = GetTimeFromServers(serverStrPtrs, serverCount, getOnly, &rttNs, timePtr);
+    clkSyncStats_AddQuery(PA_CLKSYNC_PROTOCOL_NTP, NULL, result, -1, rttNs);
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Retrieve time from an NTP server authenticated with Network Time Security (RFC 8915). The given
+ * NTS-KE server is contacted over TLS only when no cookie is left from the previous retrievals,
+ * so that in the common case the time is retrieved in a single authenticated UDP exchange.
+ *
+ * @return
+ *      - LE_OK             Function succeeded to get (if getOnly) or update clock time
+ *      - LE_BAD_PARAMETER  Incorrect parameter
+ *      - LE_NOT_FOUND      Given server as name or address not found or resolvable into an IP addr
+ *      - LE_UNAVAILABLE    No authenticated time retrieved from the given server
+ *      - LE_TIMEOUT        No authenticated time retrieved before the query deadline
+ *      - LE_FAULT          Function failed to get clock time, e.g. the server's certificate isn't
+ *                          trusted
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t pa_clkSync_GetTimeWithNetworkTimeSecurity
+(
+    const char* serverStrPtr,           ///< [IN]  NTS-KE server
+    bool getOnly,                       ///< [IN]  Get the time acquired without updating system
+                                        ///<       clock
+    le_clkSync_ClockTime_t* timePtr     ///< [OUT] Time structure
+)
+{
+    clkSync_Sample_t sample;
+    le_result_t result;
+
+    if (!serverStrPtr || !timePtr)
+    {
+        LE_ERROR("Incorrect parameter");
+        return LE_BAD_PARAMETER;
+    }
+
+    memset(timePtr, 0, sizeof(le_clkSync_ClockTime_t));
+
+    // Neither the commands nor the daemons report whether their time was authenticated
+    result = LE_UNAVAILABLE;
+    if (IsConnected)
+    {
+        result = clkSyncNts_Query(serverStrPtr, NtpProtocol.timeoutMs, GetQueryDeadline(),
+                                  &sample);
+    }
+    else
+    {
+        LE_WARN("Data connection down, authenticated time not retrieved");
+    }
+    if (LE_OK != result)
+    {
+        LE_ERROR("Failed to get authenticated time from %s", serverStrPtr);
+        clkSyncStats_AddQuery(PA_CLKSYNC_PROTOCOL_NTP, clkSyncStats_GetServer(serverStrPtr), result,
+                              -1, -1);
+        return result;
+    }
+    result = ApplySample(&sample, CLKSYNC_OPERATION(getOnly), timePtr, NULL);
+    clkSyncStats_AddQuery(PA_CLKSYNC_PROTOCOL_NTP, clkSyncStats_GetServer(serverStrPtr), result, -1,
+                          sample.delayNs);
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Retrieve time from a local reference clock: the PTP hardware clock of a network interface
+ * synchronized by a PTP (IEEE 1588) daemon, or a PPS source. The device is read locally, without
+ * any network exchange, the offset of a hardware clock being measured within the time taken to
+ * read it. A PPS source only marks the start of each second, so it only corrects a system clock
+ * already within half a second of the time, e.g. set beforehand with NTP. The system clock being
+ * slewed in whole microseconds, it follows the device to a microsecond at best, however finely the
+ * offset is measured.
+ *
+ * @return
+ *      - LE_OK             Function succeeded to get (if getOnly) or update clock time
+ *      - LE_BAD_PARAMETER  Incorrect parameter
+ *      - LE_NOT_FOUND      Given device not found
+ *      - LE_UNSUPPORTED    Given device is neither a PTP hardware clock nor a PPS source
+ *      - LE_TIMEOUT        No pulse received from the PPS source before the query deadline
+ *      - LE_FAULT          Function failed to get clock time
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t pa_clkSync_GetTimeWithPrecisionTimeProtocol
+(
+    const char* devicePtr,              ///< [IN]  Device, e.g. /dev/ptp0 or /dev/pps0
+    bool getOnly,                       ///< [IN]  Get the time acquired without updating system
+                                        ///<       clock
+    le_clkSync_ClockTime_t* timePtr     ///< [OUT] Time structure
+)
+{
+    clkSyncTiming_Record_t timing;
+    clkSync_Sample_t sample;
+    le_result_t result;
+
+    if (!devicePtr || !timePtr)
+    {
+        LE_ERROR("Incorrect parameter");
+        return LE_BAD_PARAMETER;
+    }
+
+    memset(timePtr, 0, sizeof(le_clkSync_ClockTime_t));
+
+    // The device is local, so neither the data connection nor the result cache matter
+    clkSyncTiming_Start(&timing);
+    result = clkSyncPhc_Query(devicePtr, GetQueryDeadline(), &sample);
+    if (LE_OK == result)
+    {
+        timing.rttNs = sample.delayNs;
+        result = ApplySample(&sample, CLKSYNC_OPERATION(getOnly), timePtr, NULL);
+    }
+    else
+    {
+        LE_ERROR("Failed to get time from %s", devicePtr);
+    }
+    clkSyncTiming_Stop(&timing, PA_CLKSYNC_PROTOCOL_PTP, PA_CLKSYNC_ENGINE_NATIVE);
+    clkSyncStats_AddQuery(PA_CLKSYNC_PROTOCOL_PTP, clkSyncStats_GetServer(devicePtr), result, -1,
+                          timing.rttNs);
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Time retrieval in progress from the event loop
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    pa_clkSync_GetTimeRequestRef_t ref;          ///< Safe reference of the retrieval
+    char server[NI_MAXHOST + 1];                 ///< Time server name or address
+    const ClkSync_Protocol_t* protocolPtr;       ///< Protocol run
+    ClkSync_Operation_t operation;               ///< Operation run
+    clkSync_AddrList_t addrList;                 ///< Time server IP addresses
+    const ClkSync_Backend_t* backendPtr;         ///< Backend of the protocol when started
+    clkSyncDns_LookupRef_t lookupRef;            ///< Server name resolution in progress
+    int64_t lookupStartNs;                       ///< CLOCK_MONOTONIC time the resolution started
+    bool isTracking;                             ///< Whether the daemon's tracking is queried
+    le_clkSync_ClockTime_t trackedTime;          ///< Time read from the kernel discipline state
+    ClkSync_Stamp_t stamp;                       ///< Time retrieved and when, if any
+    clkSyncAsync_RaceRef_t raceRef;              ///< Native client's race in progress
+#if PA_CLKSYNC_WITH_COMMANDS
+    const ClkSync_Command_t* commandPtr;         ///< Command in progress
+    clkSyncSpawn_Process_t command;              ///< Command process in progress
+    le_fdMonitor_Ref_t commandMonitorRef;        ///< Monitor of the command's output
+    clkSyncParse_Parser_t parser;                ///< Parser of the command's output
+#endif
+    int64_t deadlineNs;                          ///< CLOCK_MONOTONIC time to give up at,
+                                                 ///< INT64_MAX if none
+    le_timer_Ref_t deadlineTimerRef;             ///< Timer of the query deadline, NULL if none
+    clkSyncStats_Server_t* statsPtr;             ///< Statistics of the server, NULL if none
+    int64_t dnsNs;                               ///< Time of the name resolution, -1 if none
+    int64_t rttNs;                               ///< Round-trip delay measured, -1 if none
+    pa_clkSync_ClockAdjust_t adjust;             ///< Update of the system clock made, if any
+    int64_t adjustNs;                            ///< Offset corrected, 0 if unknown
+    pa_clkSync_GetTimeHandlerFunc_t handlerFunc; ///< Completion handler, NULL if a periodic
+                                                 ///< synchronization
+    clkSyncSched_SyncHandlerFunc_t schedFunc;    ///< Completion handler of a periodic
+                                                 ///< synchronization, NULL if none
+    void* contextPtr;                            ///< Context given to the handler
+}
+ClkSync_Request_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Time retrieval queued while the data connection is down, NULL if none
+ */
+//--------------------------------------------------------------------------------------------------
+static ClkSync_Request_t* PendingRequestPtr;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Stop whatever a time retrieval has in progress: its server name resolution, its native client
+ * race, its command, which is killed, and its deadline
+ */
+//--------------------------------------------------------------------------------------------------
+static void StopRequest
+(
+    ClkSync_Request_t* requestPtr           ///< [IN] Time retrieval to stop
+)
+{
+    if (requestPtr->lookupRef)
+    {
+        clkSyncDns_CancelResolve(requestPtr->lookupRef);
+        requestPtr->lookupRef = NULL;
+    }
+    if (requestPtr->raceRef)
+    {
+        clkSyncAsync_CancelRace(requestPtr->raceRef);
+        requestPtr->raceRef = NULL;
+    }
+#if PA_CLKSYNC_WITH_COMMANDS
+    if (requestPtr->commandMonitorRef)
+    {
+        le_fdMonitor_Delete(requestPtr->commandMonitorRef);
+        requestPtr->commandMonitorRef = NULL;
+        clkSyncSpawn_Kill(&requestPtr->command);
+    }
+#endif
+    if (requestPtr->deadlineTimerRef)
+    {
+        le_timer_Delete(requestPtr->deadlineTimerRef);
+        requestPtr->deadlineTimerRef = NULL;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Complete a time retrieval and release it
+ */
+//--------------------------------------------------------------------------------------------------
+static void CompleteRequest
+(
+    ClkSync_Request_t* requestPtr,          ///< [IN] Time retrieval to complete
+    le_result_t result,                     ///< [IN] Result of the retrieval
+    const le_clkSync_ClockTime_t* timePtr   ///< [IN] Time retrieved
+)
+{
+    StopRequest(requestPtr);
+    le_ref_DeleteRef(RequestRefMap, requestPtr->ref);
+    clkSyncStats_AddQuery(requestPtr->protocolPtr->id, requestPtr->statsPtr, result,
+                          requestPtr->dnsNs, requestPtr->rttNs);
+    if (LE_OK == result)
+    {
+        CacheTime(requestPtr->protocolPtr->id, requestPtr->server, &requestPtr->stamp);
+    }
+    if (requestPtr->schedFunc)
+    {
+        requestPtr->schedFunc(result, requestPtr->adjust, requestPtr->adjustNs,
+                              requestPtr->contextPtr);
+    }
+    else
+    {
+        requestPtr->handlerFunc(result, timePtr, requestPtr->contextPtr);
+    }
+    le_mem_Release(requestPtr);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Record the update of the system clock a time retrieval just made, given to the handler of a
+ * periodic synchronization
+ */
+//--------------------------------------------------------------------------------------------------
+static void RecordAdjust
+(
+    ClkSync_Request_t* requestPtr           ///< [IN] Time retrieval
+)
+{
+    if (CLKSYNC_OP_GET != requestPtr->operation)
+    {
+        requestPtr->adjust = clkSyncAdjust_GetLast(&requestPtr->adjustNs);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Queue a time retrieval found the data connection down, to be launched again once it is up, if
+ * enabled and none is queued yet. Whatever the retrieval has in progress is stopped.
+ *
+ * @return
+ *      true if the retrieval was queued
+ */
+//--------------------------------------------------------------------------------------------------
+static bool QueueRequest
+(
+    ClkSync_Request_t* requestPtr           ///< [IN] Time retrieval
+)
+{
+    if (IsConnected || !QueueUntilConnected || PendingRequestPtr)
+    {
+        return false;
+    }
+
+    StopRequest(requestPtr);
+    LE_INFO("Data connection down, %s retrieval from %s queued",
+            requestPtr->protocolPtr->namePtr, requestPtr->server);
+    PendingRequestPtr = requestPtr;
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handler of the completion of a time retrieval's native client race, defined below
+ */
+//--------------------------------------------------------------------------------------------------
+static void RaceHandler
+(
+    le_result_t result,                     ///< [IN] Result of the race
+    const clkSync_Sample_t* samplePtr,      ///< [IN] Winning sample
+    void* contextPtr                        ///< [IN] Time retrieval
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start the native client race of a time retrieval
+ */
+//--------------------------------------------------------------------------------------------------
+static void StartRequestClient
+(
+    ClkSync_Request_t* requestPtr           ///< [IN] Time retrieval
+)
+{
+    const ClkSync_Protocol_t* protocolPtr = requestPtr->protocolPtr;
+
+    requestPtr->raceRef = clkSyncAsync_StartRace(protocolPtr->clientPtr, &requestPtr->addrList,
+                                                 protocolPtr->timeoutMs, RaceHandler, requestPtr);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Resolve the server of a time retrieval and start the selected engine, defined below
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ResolveRequest
+(
+    ClkSync_Request_t* requestPtr           ///< [IN] Time retrieval
+);
+
+
+#if PA_CLKSYNC_WITH_COMMANDS
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handler of the output of a time retrieval's command, which completes the retrieval once the
+ * command exited
+ */
+//--------------------------------------------------------------------------------------------------
+static void CommandOutputHandler
+(
+    int fd,                                 ///< [IN] Command's output pipe
+    short events                            ///< [IN] Events received
+)
+{
+    ClkSync_Request_t* requestPtr = le_fdMonitor_GetContextPtr();
+    le_clkSync_ClockTime_t time = {0};
+    le_result_t result;
+    int exitCode;
+
+    if (LE_WOULD_BLOCK == ReadCommandOutput(fd, &requestPtr->parser))
+    {
+        return;
+    }
+
+    // The command closed its output, and exits
+    le_fdMonitor_Delete(requestPtr->commandMonitorRef);
+    requestPtr->commandMonitorRef = NULL;
+    exitCode = clkSyncSpawn_Wait(&requestPtr->command);
+
+    if (!requestPtr->isTracking)
+    {
+        result = ParseCommandOutput(&requestPtr->parser, exitCode, requestPtr->operation,
+                                    requestPtr->commandPtr, &time, &requestPtr->stamp);
+        if (LE_OK == result)
+        {
+            RecordAdjust(requestPtr);
+        }
+        CompleteRequest(requestPtr, result, &time);
+        return;
+    }
+
+    // The daemon keeps correcting the system clock itself, which is left untouched
+    requestPtr->isTracking = false;
+    result = ParseCommandOutput(&requestPtr->parser, exitCode, CLKSYNC_OP_GET,
+                                requestPtr->commandPtr, &time, &requestPtr->stamp);
+    if (LE_OK != result)
+    {
+        LE_WARN("No %s daemon tracking the time, falling back to native client",
+                requestPtr->protocolPtr->namePtr);
+        result = ResolveRequest(requestPtr);
+        if ((LE_OK != result) && !((LE_UNAVAILABLE == result) && QueueRequest(requestPtr)))
+        {
+            memset(&time, 0, sizeof(time));
+            CompleteRequest(requestPtr, result, &time);
+        }
+        return;
+    }
+    if (CLKSYNC_OP_SET == requestPtr->operation)
+    {
+        memset(&time, 0, sizeof(time));
+    }
+    CompleteRequest(requestPtr, LE_OK, &time);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start the command of a time retrieval, whose output is then read from the event loop
+ *
+ * @return
+ *      - LE_OK             Command started
+ *      - LE_FAULT          The command couldn't be started
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t StartRequestCommand
+(
+    ClkSync_Request_t* requestPtr,          ///< [IN] Time retrieval
+    const ClkSync_Command_t* commandPtr,    ///< [IN] Command to run, may be NULL
+    ClkSync_Operation_t operation           ///< [IN] Operation run by the command
+)
+{
+    int fd;
+
+    if (LE_OK != StartProtocolCommand(&requestPtr->addrList, operation, commandPtr,
+                                      &requestPtr->command, &requestPtr->parser))
+    {
+        return LE_FAULT;
+    }
+
+    requestPtr->commandPtr = commandPtr;
+    fd = requestPtr->command.outputFd;
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    requestPtr->commandMonitorRef = le_fdMonitor_Create(commandPtr->namePtr, fd,
+                                                        CommandOutputHandler, POLLIN);
+    le_fdMonitor_SetContextPtr(requestPtr->commandMonitorRef, requestPtr);
+    return LE_OK;
+}
+#else
+//--------------------------------------------------------------------------------------------------
+/**
+ * Stand-in for the start of a time retrieval's command when the commands are left out
+ *
+ * @return
+ *      - LE_FAULT          No command to start
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t StartRequestCommand
+(
+    ClkSync_Request_t* requestPtr,          ///< [IN] Time retrieval
+    const ClkSync_Command_t* commandPtr,    ///< [IN] Command to run, may be NULL
+    ClkSync_Operation_t operation           ///< [IN] Operation run by the command
+)
+{
+    LE_ERROR("Commands not compiled in");
+    return LE_FAULT;
+}
+#endif
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handler of the completion of a time retrieval's native client race
+ */
+//--------------------------------------------------------------------------------------------------
+static void RaceHandler
+(
+    le_result_t result,                     ///< [IN] Result of the race
+    const clkSync_Sample_t* samplePtr,      ///< [IN] Winning sample
+    void* contextPtr                        ///< [IN] Time retrieval
+)
+{
+    ClkSync_Request_t* requestPtr = contextPtr;
+    le_clkSync_ClockTime_t time = {0};
+
+    requestPtr->raceRef = NULL;
+    if (LE_OK == result)
+    {
+        LE_DEBUG("Time retrieved from server address %s",
+                 requestPtr->addrList.addrs[samplePtr->addrIndex]);
+        requestPtr->rttNs = samplePtr->delayNs;
+        result = ApplySample(samplePtr, requestPtr->operation, &time, &requestPtr->stamp);
+        if (LE_OK == result)
+        {
+            RecordAdjust(requestPtr);
+        }
+    }
+    else if ((LE_FAULT == result) && PA_CLKSYNC_WITH_COMMANDS)
+    {
+        LE_WARN("Native %s client failed, falling back to command",
+                requestPtr->protocolPtr->namePtr);
+        if (LE_OK == StartRequestCommand(requestPtr, requestPtr->backendPtr->commandPtr,
+                                         requestPtr->operation))
+        {
+            return;
+        }
+    }
+    else
+    {
+        LE_ERROR("Failed to get time from server %s", requestPtr->addrList.addrs[0]);
+    }
+
+    CompleteRequest(requestPtr, result, &time);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Complete a time retrieval served from the kernel discipline state, from the event loop once its
+ * start returned, unless it was cancelled in the meantime
+ */
+//--------------------------------------------------------------------------------------------------
+static void CompleteTrackedRequest
+(
+    void* param1Ptr,                        ///< [IN] Time retrieval
+    void* param2Ptr                         ///< [IN] Unused
+)
+{
+    ClkSync_Request_t* requestPtr = param1Ptr;
+
+    if (le_ref_Lookup(RequestRefMap, requestPtr->ref) == requestPtr)
+    {
+        CompleteRequest(requestPtr, LE_OK, &requestPtr->trackedTime);
+    }
+    le_mem_Release(requestPtr);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start querying the tracking of the backend's daemon for a time retrieval: chronyc is run from
+ * the event loop, while the kernel discipline state is read right away, the retrieval being then
+ * completed from the event loop
+ *
+ * @return
+ *      - LE_OK             Query started
+ *      - LE_UNAVAILABLE    No daemon disciplines the system clock
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t StartRequestTracking
+(
+    ClkSync_Request_t* requestPtr           ///< [IN] Time retrieval
+)
+{
+    const ClkSync_Backend_t* backendPtr = requestPtr->backendPtr;
+    int64_t offsetNs, localTimeNs;
+
+    if (backendPtr->trackingPtr)
+    {
+        if (LE_OK != StartRequestCommand(requestPtr, backendPtr->trackingPtr, CLKSYNC_OP_GET))
+        {
+            return LE_UNAVAILABLE;
+        }
+        requestPtr->isTracking = true;
+        return LE_OK;
+    }
+
+    if (LE_OK != clkSyncAdjust_GetKernelSync(&offsetNs))
+    {
+        return LE_UNAVAILABLE;
+    }
+    localTimeNs = clkSync_GetClockNs(CLOCK_REALTIME);
+    if (CLKSYNC_OP_SET != requestPtr->operation)
+    {
+        ConvertNsToClockTime(localTimeNs + offsetNs, &requestPtr->trackedTime);
+    }
+    StampTime(localTimeNs + offsetNs, localTimeNs, &requestPtr->stamp);
+    le_mem_AddRef(requestPtr);
+    le_event_QueueFunction(CompleteTrackedRequest, requestPtr, NULL);
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handler of the expiry of a time retrieval's deadline, which abandons the retrieval
+ */
+//--------------------------------------------------------------------------------------------------
+static void DeadlineHandler
+(
+    le_timer_Ref_t timerRef                 ///< [IN] Deadline timer
+)
+{
+    ClkSync_Request_t* requestPtr = le_timer_GetContextPtr(timerRef);
+    le_clkSync_ClockTime_t time = {0};
+
+    LE_WARN("No %s time retrieved from server %s before the deadline",
+            requestPtr->protocolPtr->namePtr, requestPtr->server);
+    CompleteRequest(requestPtr, LE_TIMEOUT, &time);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start the selected engine of a time retrieval on its resolved server, the native client falling
+ * back to the command
+ *
+ * @return
+ *      - LE_OK             Engine started, the retrieval is completed from the event loop
+ *      - LE_FAULT          Function failed to start the engine
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t StartRequestEngine
+(
+    ClkSync_Request_t* requestPtr           ///< [IN] Time retrieval
+)
+{
+    if (PA_CLKSYNC_ENGINE_COMMAND != *requestPtr->protocolPtr->enginePtr)
+    {
+        StartRequestClient(requestPtr);
+        return LE_OK;
+    }
+    return StartRequestCommand(requestPtr, requestPtr->backendPtr->commandPtr,
+                               requestPtr->operation);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handler of the resolution of a time retrieval's server name, which starts the selected engine
+ * or completes the retrieval if the name isn't resolvable
+ */
+//--------------------------------------------------------------------------------------------------
+static void ResolveHandler
+(
+    le_result_t result,                     ///< [IN] Result of the resolution
+    const clkSync_AddrList_t* listPtr,      ///< [IN] Resolved addresses
+    void* contextPtr                        ///< [IN] Time retrieval
+)
+{
+    ClkSync_Request_t* requestPtr = contextPtr;
+    le_clkSync_ClockTime_t time = {0};
+
+    requestPtr->lookupRef = NULL;
+    requestPtr->dnsNs = clkSync_GetClockNs(CLOCK_MONOTONIC) - requestPtr->lookupStartNs;
+    if (LE_OK == result)
+    {
+        requestPtr->addrList = *listPtr;
+        result = StartRequestEngine(requestPtr);
+    }
+    else
+    {
+        LE_WARN("Failed to resolve server %s into IP address to get clock time",
+                requestPtr->server);
+        result = LE_NOT_FOUND;
+    }
+
+    if (LE_OK != result)
+    {
+        CompleteRequest(requestPtr, result, &time);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Resolve the server of a time retrieval and start the selected engine. The server is only
+ * resolved with the data connection up, as it could only be reached after the resolution times
+ * out otherwise. A server name missing from the cache is resolved in a thread, the engine being
+ * then started from the event loop, within the query deadline.
+ *
+ * @return
+ *      - LE_OK             Resolution or engine started, the retrieval is completed from the event
+ *                          loop
+ *      - LE_BAD_PARAMETER  Incorrect parameter
+ *      - LE_NOT_FOUND      Given server as name or address not found or resolvable into an IP addr
+ *      - LE_UNAVAILABLE    The data connection is down, or too many name lookups already running
+ *      - LE_FAULT          Function failed to start the engine
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t ResolveRequest
+(
+    ClkSync_Request_t* requestPtr           ///< [IN] Time retrieval
+)
+{
+    le_result_t result;
+
+    if (!IsConnected)
+    {
+        LE_WARN("Data connection down, %s time not retrieved", requestPtr->protocolPtr->namePtr);
+        return LE_UNAVAILABLE;
+    }
+
+    if (IsIpAddress(requestPtr->server))
+    {
+        result = ValidateServer(requestPtr->server, requestPtr->deadlineNs,
+                                &requestPtr->addrList, &requestPtr->dnsNs);
+        if (LE_OK != result)
+        {
+            return result;
+        }
+        return StartRequestEngine(requestPtr);
+    }
+
+    requestPtr->lookupStartNs = clkSync_GetClockNs(CLOCK_MONOTONIC);
+    result = clkSyncDns_StartResolve(requestPtr->server, ResolveHandler, requestPtr,
+                                     &requestPtr->addrList, &requestPtr->lookupRef);
+    if (LE_IN_PROGRESS == result)
+    {
+        return LE_OK;
+    }
+    requestPtr->dnsNs = clkSync_GetClockNs(CLOCK_MONOTONIC) - requestPtr->lookupStartNs;
+    if (LE_UNAVAILABLE == result)
+    {
+        return result;
+    }
+    if (LE_OK != result)
+    {
+        LE_WARN("Failed to resolve server %s into IP address to get clock time",
+                requestPtr->server);
+        return LE_NOT_FOUND;
+    }
+    return StartRequestEngine(requestPtr);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Launch a time retrieval in the order of the blocking retrievals: query the daemon's tracking
+ * with the daemon engine, which needs no network, then resolve the server and start the selected
+ * engine, and arm the query deadline
+ *
+ * @return
+ *      - LE_OK             Retrieval launched, its result is given to the handler
+ *      - LE_BAD_PARAMETER  Incorrect parameter
+ *      - LE_NOT_FOUND      Given server as name or address not found or resolvable into an IP addr
+ *      - LE_UNAVAILABLE    The data connection is down
+ *      - LE_FAULT          Function failed to start the retrieval
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t LaunchRequest
+(
+    ClkSync_Request_t* requestPtr           ///< [IN] Time retrieval
+)
+{
+    const ClkSync_Protocol_t* protocolPtr = requestPtr->protocolPtr;
+    le_result_t result = LE_UNAVAILABLE;
+
+    requestPtr->deadlineNs = GetQueryDeadline();
+    if (PA_CLKSYNC_ENGINE_DAEMON == *protocolPtr->enginePtr)
+    {
+        result = StartRequestTracking(requestPtr);
+        if (LE_OK != result)
+        {
+            LE_WARN("No %s daemon tracking the time, falling back to native client",
+                    protocolPtr->namePtr);
+        }
+    }
+    if (LE_OK != result)
+    {
+        result = ResolveRequest(requestPtr);
+        if (LE_OK != result)
+        {
+            return result;
+        }
+    }
+
+    if (INT64_MAX != requestPtr->deadlineNs)
+    {
+        int64_t remainingNs = requestPtr->deadlineNs - clkSync_GetClockNs(CLOCK_MONOTONIC);
+        uint32_t remainingMs = 0;
+
+        if (remainingNs > 0)
+        {
+            remainingMs = (uint32_t)(remainingNs / CLKSYNC_NS_PER_MSEC);
+        }
+
+        requestPtr->deadlineTimerRef = le_timer_Create("ClkSyncDeadline");
+        le_timer_SetMsInterval(requestPtr->deadlineTimerRef, remainingMs);
+        le_timer_SetHandler(requestPtr->deadlineTimerRef, DeadlineHandler);
+        le_timer_SetContextPtr(requestPtr->deadlineTimerRef, requestPtr);
+        le_timer_Start(requestPtr->deadlineTimerRef);
+    }
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Launch the time retrieval queued while the data connection was down, completing it right away
+ * if it can't be launched
+ */
+//--------------------------------------------------------------------------------------------------
+static void LaunchPendingRequest
+(
+    void
+)
+{
+    ClkSync_Request_t* requestPtr = PendingRequestPtr;
+    le_clkSync_ClockTime_t time = {0};
+    le_result_t result;
+
+    if (!requestPtr)
+    {
+        return;
+    }
+
+    PendingRequestPtr = NULL;
+    LE_INFO("Data connection up, starting the queued %s retrieval from %s",
+            requestPtr->protocolPtr->namePtr, requestPtr->server);
+    result = LaunchRequest(requestPtr);
+    if (LE_OK != result)
+    {
+        CompleteRequest(requestPtr, result, &time);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start retrieving current clock time from the given server with the given protocol, from the
+ * event loop of the calling thread. The retrieval is abandoned when the query deadline expires,
+ * its handler then getting LE_TIMEOUT. While the data connection is down, a retrieval which no
+ * daemon serves is refused, or queued to start once the connection is up if enabled and none is
+ * queued yet.
+ *
+ * @return
+ *      - LE_OK             Retrieval started or queued, its result is given to the handler
+ *      - LE_BAD_PARAMETER  Incorrect parameter
+ *      - LE_NOT_FOUND      Given server as name or address not found or resolvable into an IP addr
+ *      - LE_UNAVAILABLE    The data connection is down
+ *      - LE_FAULT          Function failed to start the retrieval
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t StartGetTimeFromServer
+(
+    const char* serverStrPtr,                    ///< [IN]  Time server name or address
+    ClkSync_Operation_t operation,               ///< [IN]  Operation to run
+    const ClkSync_Protocol_t* protocolPtr,       ///< [IN]  Protocol to run, i.e. TP or NTP
+    pa_clkSync_GetTimeHandlerFunc_t handlerFunc, ///< [IN]  Completion handler, NULL if a
+                                                 ///<       periodic synchronization
+    clkSyncSched_SyncHandlerFunc_t schedFunc,    ///< [IN]  Completion handler of a periodic
+                                                 ///<       synchronization, NULL if none
+    void* contextPtr,                            ///< [IN]  Context given to the handler
+    pa_clkSync_GetTimeRequestRef_t* refPtr       ///< [OUT] Reference of the retrieval, may be NULL
+)
+{
+    ClkSync_Request_t* requestPtr;
+    le_result_t result;
+
+    if (!handlerFunc && !schedFunc)
+    {
+        LE_ERROR("Null handler");
+        return LE_BAD_PARAMETER;
+    }
+    if (!protocolPtr)
+    {
+        LE_ERROR("Protocol not compiled in");
+        return LE_UNSUPPORTED;
+    }
+
+    if (!serverStrPtr || ('\0' == serverStrPtr[0]))
+    {
+        LE_ERROR("Incorrect parameter");
+        return LE_BAD_PARAMETER;
+    }
+
+    requestPtr = le_mem_ForceAlloc(RequestPool);
+    memset(requestPtr, 0, sizeof(*requestPtr));
+    if (LE_OK != le_utf8_Copy(requestPtr->server, serverStrPtr, sizeof(requestPtr->server), NULL))
+    {
+        LE_ERROR("Server name %s too long", serverStrPtr);
+        le_mem_Release(requestPtr);
+        return LE_BAD_PARAMETER;
+    }
+    requestPtr->protocolPtr = protocolPtr;
+    requestPtr->backendPtr = *protocolPtr->backendPtr;
+    requestPtr->operation = operation;
+    requestPtr->handlerFunc = handlerFunc;
+    requestPtr->schedFunc = schedFunc;
+    requestPtr->contextPtr = contextPtr;
+    requestPtr->statsPtr = clkSyncStats_GetServer(serverStrPtr);
+    requestPtr->dnsNs = -1;
+    requestPtr->rttNs = -1;
+
+    result = LaunchRequest(requestPtr);
+    if ((LE_UNAVAILABLE == result) && QueueRequest(requestPtr))
+    {
+        result = LE_OK;
+    }
+    if (LE_OK != result)
+    {
+        clkSyncStats_AddQuery(protocolPtr->id, requestPtr->statsPtr, result, requestPtr->dnsNs,
+                              -1);
+        le_mem_Release(requestPtr);
+        return result;
+    }
+
+    requestPtr->ref = le_ref_CreateRef(RequestRefMap, requestPtr);
+    if (refPtr)
+    {
+        *refPtr = requestPtr->ref;
+    }
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start retrieving time from a server using the Time Protocol, without blocking the calling
+ * thread. The handler is called from the thread's event loop once the time is retrieved, or set
+ * into the system clock unless getOnly is set.
+ *
+ * @return
+ *      - LE_OK             Retrieval started or queued, its result is given to the handler
+ *      - LE_BAD_PARAMETER  Incorrect parameter
+ *      - LE_NOT_FOUND      Given server as name or address not found or resolvable into an IP addr
+ *      - LE_UNAVAILABLE    The data connection is down
+ *      - LE_UNSUPPORTED    TP not compiled in
+ *      - LE_FAULT          Function failed to start the retrieval
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t pa_clkSync_StartGetTimeWithTimeProtocol
+(
+    const char* serverStrPtr,                    ///< [IN]  Time server
+    bool getOnly,                                ///< [IN]  Get the time acquired without updating
+                                                 ///<       system clock
+    pa_clkSync_GetTimeHandlerFunc_t handlerFunc, ///< [IN]  Completion handler
+    void* contextPtr,                            ///< [IN]  Context given to the handler
+    pa_clkSync_GetTimeRequestRef_t* refPtr       ///< [OUT] Reference of the retrieval, may be NULL
+)
+{
+    return StartGetTimeFromServer(serverStrPtr, CLKSYNC_OPERATION(getOnly), TP_PROTOCOL_PTR,
+                                  handlerFunc, NULL, contextPtr, refPtr);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start retrieving time from a server using the Network Time Protocol, without blocking the
+ * calling thread. The handler is called from the thread's event loop once the time is retrieved,
+ * or set into the system clock unless getOnly is set.
+ *
+ * @return
+ *      - LE_OK             Retrieval started or queued, its result is given to the handler
+ *      - LE_BAD_PARAMETER  Incorrect parameter
+ *      - LE_NOT_FOUND      Given server as name or address not found or resolvable into an IP addr
+ *      - LE_UNAVAILABLE    The data connection is down
+ *      - LE_FAULT          Function failed to start the retrieval
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t pa_clkSync_StartGetTimeWithNetworkTimeProtocol
+(
+    const char* serverStrPtr,                    ///< [IN]  Time server
+    bool getOnly,                                ///< [IN]  Get the time acquired without updating
+                                                 ///<       system clock
+    pa_clkSync_GetTimeHandlerFunc_t handlerFunc, ///< [IN]  Completion handler
+    void* contextPtr,                            ///< [IN]  Context given to the handler
+    pa_clkSync_GetTimeRequestRef_t* refPtr       ///< [OUT] Reference of the retrieval, may be NULL
+)
+{
+    return StartGetTimeFromServer(serverStrPtr, CLKSYNC_OPERATION(getOnly), &NtpProtocol,
+                                  handlerFunc, NULL, contextPtr, refPtr);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start synchronizing the system clock with a server using the Network Time Protocol, the time
+ * being set from a single exchange with the server. This is run on each poll of the periodic
+ * synchronization.
+ *
+ * @return
+ *      - LE_OK             Synchronization started, its result is given to the handler
+ *      - LE_BAD_PARAMETER  Incorrect parameter
+ *      - LE_NOT_FOUND      Given server as name or address not found or resolvable into an IP addr
+ *      - LE_FAULT          Function failed to start the synchronization
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t StartSyncWithNetworkTimeProtocol
+(
+    const char* serverStrPtr,                    ///< [IN]  Time server
+    clkSyncSched_SyncHandlerFunc_t handlerFunc,  ///< [IN]  Completion handler
+    void* contextPtr,                            ///< [IN]  Context given to the handler
+    pa_clkSync_GetTimeRequestRef_t* refPtr       ///< [OUT] Reference of the synchronization
+)
+{
+    return StartGetTimeFromServer(serverStrPtr, CLKSYNC_OP_GET_AND_SET, &NtpProtocol,
+                                  NULL, handlerFunc, contextPtr, refPtr);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Cancel a time retrieval in progress; its handler is not called. A command already running is
+ * killed.
+ */
+//--------------------------------------------------------------------------------------------------
+void pa_clkSync_CancelGetTime
+(
+    pa_clkSync_GetTimeRequestRef_t ref          ///< [IN] Reference of the retrieval
+)
+{
+    ClkSync_Request_t* requestPtr = le_ref_Lookup(RequestRefMap, ref);
+
+    if (!requestPtr)
+    {
+        LE_WARN("Invalid time retrieval reference %p", ref);
+        return;
+    }
+
+    if (PendingRequestPtr == requestPtr)
+    {
+        PendingRequestPtr = NULL;
+    }
+    StopRequest(requestPtr);
+    le_ref_DeleteRef(RequestRefMap, ref);
+    le_mem_Release(requestPtr);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start synchronizing the system clock periodically with a server using the Network Time
+ * Protocol, from the event loop of the calling thread. The poll interval adapts between 2^minPoll
+ * and 2^maxPoll seconds to the drift measured, replacing any periodic synchronization in progress.
+ *
+ * @return
+ *      - LE_OK             Synchronization scheduled, the first one being run right away
+ *      - LE_BAD_PARAMETER  Incorrect parameter
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t pa_clkSync_StartPeriodicSync
+(
+    const char* serverStrPtr,       ///< [IN] Time server
+    uint8_t minPoll,                ///< [IN] Log2 of the shortest interval in seconds
+    uint8_t maxPoll                 ///< [IN] Log2 of the longest interval in seconds
+)
+{
+    return clkSyncSched_Start(serverStrPtr, minPoll, maxPoll);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Stop the periodic synchronization of the system clock
+ */
+//--------------------------------------------------------------------------------------------------
+void pa_clkSync_StopPeriodicSync
+(
+    void
+)
+{
+    clkSyncSched_Stop();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Select the engine used by pa_clkSync_GetTimeWithTimeProtocol()
+ *
+ * @return
+ *      - LE_OK             Engine selected
+ *      - LE_BAD_PARAMETER  Unknown engine
+ *      - LE_UNSUPPORTED    Engine not compiled in
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t pa_clkSync_SetTpEngine
+(
+    pa_clkSync_Engine_t engine      ///< [IN] Engine to use for TP
+)
+{
+    if ((PA_CLKSYNC_ENGINE_NATIVE != engine) && (PA_CLKSYNC_ENGINE_COMMAND != engine) &&
+        (PA_CLKSYNC_ENGINE_DAEMON != engine))
+    {
+        LE_ERROR("Unknown engine %d", engine);
+        return LE_BAD_PARAMETER;
+    }
+    if (!PA_CLKSYNC_WITH_TP ||
+        ((PA_CLKSYNC_ENGINE_COMMAND == engine) && !PA_CLKSYNC_WITH_COMMANDS))
+    {
+        LE_ERROR("Engine %d not compiled in for TP", engine);
+        return LE_UNSUPPORTED;
+    }
+
+    TpEngine = engine;
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Select the engine used by pa_clkSync_GetTimeWithNetworkTimeProtocol()
+ *
+ * @return
+ *      - LE_OK             Engine selected
+ *      - LE_BAD_PARAMETER  Unknown engine
+ *      - LE_UNSUPPORTED    Engine not compiled in
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t pa_clkSync_SetNtpEngine
+(
+    pa_clkSync_Engine_t engine      ///< [IN] Engine to use for NTP
+)
+{
+    if ((PA_CLKSYNC_ENGINE_NATIVE != engine) && (PA_CLKSYNC_ENGINE_COMMAND != engine) &&
+        (PA_CLKSYNC_ENGINE_DAEMON != engine))
+    {
+        LE_ERROR("Unknown engine %d", engine);
+        return LE_BAD_PARAMETER;
+    }
+    if ((PA_CLKSYNC_ENGINE_COMMAND == engine) && !PA_CLKSYNC_WITH_COMMANDS)
+    {
+        LE_ERROR("Engine %d not compiled in for NTP", engine);
+        return LE_UNSUPPORTED;
+    }
+
+    NtpEngine = engine;
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Select the backend whose tools the command and daemon engines run for NTP
+ *
+ * @return
+ *      - LE_OK             Backend selected
+ *      - LE_BAD_PARAMETER  Unknown backend
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t pa_clkSync_SetNtpBackend
+(
+    pa_clkSync_Backend_t backend    ///< [IN] Backend to use for NTP
+)
+{
+    if ((backend < 0) || (backend >= NUM_ARRAY_MEMBERS(NtpBackends)))
+    {
+        LE_ERROR("Unknown backend %d", backend);
+        return LE_BAD_PARAMETER;
+    }
+
+    NtpBackendPtr = &NtpBackends[backend];
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the number of requests the native NTP client sends in a row to a server address, each as
+ * soon as the previous reply is received, keeping the sample of the least round-trip delay; 1
+ * sends a single request. The whole burst is bounded by the time given to each address.
+ *
+ * @return
+ *      - LE_OK             Number of requests set
+ *      - LE_BAD_PARAMETER  Number of requests not within 1 and PA_CLKSYNC_NTP_BURST_MAX
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t pa_clkSync_SetNtpBurst
+(
+    uint32_t count                  ///< [IN] Number of requests
+)
+{
+    if ((0 == count) || (count > PA_CLKSYNC_NTP_BURST_MAX))
+    {
+        LE_ERROR("Invalid burst of %" PRIu32 " requests", count);
+        return LE_BAD_PARAMETER;
+    }
+
+    clkSyncSntp_SetBurst(count);
+    return LE_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the offset of the timescale of the PTP hardware clocks from UTC, in seconds: the current
+ * TAI-UTC offset for the TAI timescale of PTP, or 0 for a hardware clock kept at UTC
+ */
+//--------------------------------------------------------------------------------------------------
+void pa_clkSync_SetPtpUtcOffset
+(
+    int32_t offsetSec                   ///< [IN] Offset of the hardware clocks from UTC
+)
+{
+    clkSyncPhc_SetUtcOffset(offsetSec);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the largest offset corrected by slewing the system clock rather than stepping it; a
+ * threshold of 0 always steps the clock
+ */
+//--------------------------------------------------------------------------------------------------
+void pa_clkSync_SetStepThreshold
+(
+    uint32_t thresholdMs            ///< [IN] Largest offset slewed
+)
+{
+    clkSyncAdjust_SetStepThreshold(thresholdMs);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the time allowed for each whole time retrieval, from the name resolution to the server's
+ * reply, past which the retrieval is abandoned with LE_TIMEOUT; 0 leaves it unbounded
+ */
+//--------------------------------------------------------------------------------------------------
+void pa_clkSync_SetQueryDeadline
+(
+    uint32_t deadlineMs             ///< [IN] Time allowed
+)
+{
+    QueryDeadlineMs = deadlineMs;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get how the system clock was last updated by this adaptor
+ *
+ * @return
+ *      Kind of the last update, PA_CLKSYNC_CLOCK_ADJUST_NONE if none yet
+ */
+//--------------------------------------------------------------------------------------------------
+pa_clkSync_ClockAdjust_t pa_clkSync_GetLastClockAdjust
+(
+    int64_t* offsetNsPtr            ///< [OUT] Offset corrected, 0 if unknown; may be NULL
+)
+{
+    return clkSyncAdjust_GetLast(offsetNsPtr);
+}
 
 
 //--------------------------------------------------------------------------------------------------
-// Data structures
+/**
+ * Set the file the measured clock frequency is saved into, and restore the frequency saved in it
+ * if any; an empty path disables the saving
+ *
+ * @return
+ *      - LE_OK             File set
+ *      - LE_BAD_PARAMETER  Incorrect parameter
+ */
 //--------------------------------------------------------------------------------------------------
+le_result_t pa_clkSync_SetDriftFile
+(
+    const char* pathPtr             ///< [IN] Drift file
+)
+{
+    return clkSyncDrift_SetFile(pathPtr);
+}
+
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Typedef of the protocol-specific function vector for parsing the output line of a retrieved
- * clock time from a time server
+ * Set the file the last synchronized time is saved into, and restore the system clock from it if
+ * the clock is behind; an empty path disables the snapshot
  *
  * @return
- *     - LE_BAD_PARAMETER: invalid inputs
- *     - LE_NOT_FOUND: valid result not found
- *     - LE_FAULT: failure to parse output
- *     - LE_OK: output successfully parsed & retrieved
+ *      - LE_OK             File set
+ *      - LE_BAD_PARAMETER  Incorrect parameter
  */
 //--------------------------------------------------------------------------------------------------
-typedef le_result_t (*ClkSync_ProtocolParserFunc_t)
+le_result_t pa_clkSync_SetSnapshotFile
 (
-    char *output,           ///< [IN] the output line to be parsed
-    struct tm* timePtr      ///< [OUT] pointer to the time struct holding the parsed results
-);
+    const char* pathPtr             ///< [IN] Snapshot file
+)
+{
+    return clkSyncSnapshot_SetFile(pathPtr);
+}
 
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Validate a char string as an IPv4/v6 address or not
+ * Get the frequency correction applied to the system clock to compensate its drift
  *
  * @return
- *      - true    the input char string contains an IPv4/v6 address valid in format
- *      - false   otherwise
+ *      - LE_OK             Frequency returned
+ *      - LE_BAD_PARAMETER  Incorrect parameter
+ *      - LE_FAULT          Failed to read the frequency
  */
 //--------------------------------------------------------------------------------------------------
-static bool IsIpAddress
+le_result_t pa_clkSync_GetClockFrequency
 (
-    const char* addStr  ///< [IN] IP address to classify
+    int32_t* ppbPtr                 ///< [OUT] Frequency correction in parts per billion
 )
 {
-    struct sockaddr_in6 sa;
-    if (inet_pton(AF_INET, addStr, &(sa.sin6_addr)) ||
-        inet_pton(AF_INET6, addStr, &(sa.sin6_addr)))
+    if (!ppbPtr)
     {
-        return true;
+        LE_ERROR("Incorrect parameter");
+        return LE_BAD_PARAMETER;
     }
-    return false;
+    return clkSyncDrift_GetFrequency(ppbPtr);
 }
 
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Resolve the given host name into an IP address
+ * Set the lifetimes of time server name resolutions in the cache; a lifetime of 0 disables the
+ * caching of the corresponding results
+ */
+//--------------------------------------------------------------------------------------------------
+void pa_clkSync_SetDnsCacheTtl
+(
+    uint32_t ttlSecs,               ///< [IN] Lifetime of successful resolutions
+    uint32_t negativeTtlSecs        ///< [IN] Lifetime of failed resolutions
+)
+{
+    clkSyncDns_SetTtl(ttlSecs, negativeTtlSecs);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the freshness window within which a get only retrieval with the Time Protocol or the
+ * Network Time Protocol is answered without querying the server, by extrapolating the last time
+ * retrieved from the same server with the same protocol; 0 always queries the server. The default
+ * is PA_CLKSYNC_RESULT_CACHE_MS_DEFAULT.
+ */
+//--------------------------------------------------------------------------------------------------
+void pa_clkSync_SetResultCacheWindow
+(
+    uint32_t windowMs               ///< [IN] Freshness window
+)
+{
+    clkSyncCache_SetWindow(windowMs);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the time of a server with the given protocol without updating the system clock, as a get
+ * only pa_clkSync_GetTimeWithTimeProtocol() or pa_clkSync_GetTimeWithNetworkTimeProtocol() does,
+ * also telling whether the time returned is an estimate extrapolated within the freshness window
+ * and how old the retrieval it is extrapolated from is.
  *
  * @return
- *      - LE_OK         name resolution into IP addr succeeded
- *      - LE_FAULT      name resolution execution failed or unable to resolve into an IP addr
+ *      - LE_OK             Function succeeded to get clock time
+ *      - LE_BAD_PARAMETER  Incorrect parameter
+ *      - LE_NOT_FOUND      Given server as name or address not found or resolvable into an IP addr
+ *      - LE_UNAVAILABLE    No current clock time retrieved from the given server
+ *      - LE_TIMEOUT        No current clock time retrieved before the query deadline
+ *      - LE_UNSUPPORTED    Protocol not compiled in
+ *      - LE_FAULT          Function failed to get clock time
  */
 //--------------------------------------------------------------------------------------------------
-static le_result_t ResolveIpAddress
+le_result_t pa_clkSync_GetTimeWithInfo
 (
-    const char* namePtr, ///< [IN] Host name to resolve
-    char* ipAddrPtr      ///< [OUT] Resolved IP address in string of length LE_DCS_IPADDR_MAX_LEN
+    pa_clkSync_Protocol_t protocol,     ///< [IN]  Protocol, i.e. TP or NTP
+    const char* serverStrPtr,           ///< [IN]  Time server
+    le_clkSync_ClockTime_t* timePtr,    ///< [OUT] Time structure
+    pa_clkSync_TimeInfo_t* infoPtr      ///< [OUT] Origin of the time, may be NULL
 )
 {
-    int rc;
-    struct addrinfo *resultPtr, *nextPtr;
-    struct sockaddr_in* serverPtr;
-    struct addrinfo hints = {0};
-    hints.ai_family = AF_UNSPEC;
-    hints.ai_socktype = SOCK_DGRAM;
-    rc = getaddrinfo(namePtr, NULL, &hints, &resultPtr);
-    if (rc)
+    if (PA_CLKSYNC_PROTOCOL_TP == protocol)
     {
-        LE_ERROR("getaddrinfo() failed to resolve host name %s with error %s", namePtr,
-                 gai_strerror(rc));
-        return LE_FAULT;
+        return GetTimeFromCacheOrServer(serverStrPtr, TP_PROTOCOL_PTR, timePtr, infoPtr);
     }
-
-    for (nextPtr = resultPtr; nextPtr != NULL; nextPtr = nextPtr->ai_next)
+    if (PA_CLKSYNC_PROTOCOL_NTP == protocol)
     {
-        serverPtr = (struct sockaddr_in*)nextPtr->ai_addr;
-        inet_ntop(serverPtr->sin_family, &serverPtr->sin_addr, ipAddrPtr, LE_DCS_IPADDR_MAX_LEN);
-        LE_DEBUG("Name %s resolved to IP address %s", namePtr, ipAddrPtr);
-        freeaddrinfo(resultPtr);
-        return LE_OK;
+        return GetTimeFromCacheOrServer(serverStrPtr, &NtpProtocol, timePtr, infoPtr);
     }
 
-    LE_ERROR("Name %s not resolved to any valid IP address", namePtr);
-    freeaddrinfo(resultPtr);
-    return LE_FAULT;
+    LE_ERROR("Unknown protocol %d", protocol);
+    return LE_BAD_PARAMETER;
 }
 
 
 //--------------------------------------------------------------------------------------------------
 /**
- * This is the vector function for the Time Protocol (TP) for parsing its output line for the
- * returned clock time.
+ * Report the time just received by the modem from a local source, i.e. GNSS or NITZ, to be used
+ * by pa_clkSync_GetTimeFromSources(). The time is given as UTC since the Unix epoch, so that it is
+ * neither rounded nor subject to the time zone.
  *
  * @return
- *     - LE_BAD_PARAMETER: invalid inputs
- *     - LE_FAULT: failure to parse output
- *     - LE_OK: output successfully parsed & retrieved
+ *      - LE_OK             Time reported
+ *      - LE_BAD_PARAMETER  Incorrect parameter, or the source isn't GNSS nor NITZ
  */
 //--------------------------------------------------------------------------------------------------
-static le_result_t TpParseOutput
+le_result_t pa_clkSync_ReportExternalTime
 (
-    char *output,
-    struct tm* timePtr
+    pa_clkSync_Source_t source,             ///< [IN] GNSS or NITZ
+    const struct timespec* timePtr,         ///< [IN] Time received, since the Unix epoch
+    uint32_t accuracyMs                     ///< [IN] Bound of the error of the time received
 )
 {
-    if (!output || !timePtr)
+    if (!timePtr || (timePtr->tv_nsec < 0) || (timePtr->tv_nsec >= CLKSYNC_NS_PER_SEC) ||
+        (LE_OK != clkSyncSource_Report(source, clkSync_TimespecToNs(timePtr),
+                                       (int64_t)accuracyMs * CLKSYNC_NS_PER_MSEC)))
     {
-        LE_ERROR("Input error");
+        LE_ERROR("Incorrect parameter");
         return LE_BAD_PARAMETER;
     }
-
-    if (!strptime(output, "%a %b %d %H:%M:%S %Y", timePtr))
-    {
-        LE_ERROR("Failed to retrieve return clock time");
-        return LE_FAULT;
-    }
-
-    LE_DEBUG("TP present time retrieved: %d/%d/%d %d:%d:%d",
-             timePtr->tm_year + 1900, timePtr->tm_mon + 1, timePtr->tm_mday,
-             timePtr->tm_hour, timePtr->tm_min, timePtr->tm_sec);
     return LE_OK;
 }
 
 
 //--------------------------------------------------------------------------------------------------
 /**
- * This is the vector function for the Network Time Protocol (NTP) for parsing its output line for
- * the returned clock time. Note that the NTP returned time is an offset of the device's system
- * time from the NTP server's given UTC time. Thus, this function needs to calculate the returned
- * UTC time by adding the offset to the device's system time, and return this back to its caller.
+ * Set the order pa_clkSync_GetTimeFromSources() tries the sources in; the sources left out are
+ * not tried
  *
  * @return
- *     - LE_BAD_PARAMETER: invalid inputs
- *     - LE_NOT_FOUND: valid result not found
- *     - LE_OK: output successfully parsed & retrieved
+ *      - LE_OK             Order set
+ *      - LE_BAD_PARAMETER  No source, unknown source or source given twice
  */
 //--------------------------------------------------------------------------------------------------
-static le_result_t NtpParseOutput
+le_result_t pa_clkSync_SetSourceChain
 (
-    char *output,
-    struct tm* currentTimePtr
+    const pa_clkSync_Source_t* sourcesPtr,  ///< [IN] Sources, from the first tried
+    size_t count                            ///< [IN] Number of sources
 )
 {
-    time_t offSetSecs = 0;
-    le_clk_Time_t currentAbsTime;
-    char *searchPtr, *stringEnd, *offSetString = "offset ", *offSetUnitString = " sec";
-
-    if (!output || !currentTimePtr)
+    if (LE_OK != clkSyncSource_SetChain(sourcesPtr, count))
     {
-        LE_ERROR("Input error");
+        LE_ERROR("Invalid chain of %zu sources", count);
         return LE_BAD_PARAMETER;
     }
+    return LE_OK;
+}
 
-    // Output of the ntpdate command in LXSWI looks like the following example which gives the
-    // NTP offset of the present clock time on the device:
-    // 1 Jan 07:33:20 ntpdate[29329]: step time server 5.196.160.139 offset 1558374338.202418 sec
-    // i.e. 1558374338.202418 sec from 1 Jan 07:33:20 1971
-    searchPtr = strstr(output, "ntpdate");
-    if (!searchPtr)
-    {
-        return LE_NOT_FOUND;
-    }
 
-    searchPtr = strstr(output, offSetString);
-    if (!searchPtr)
+//--------------------------------------------------------------------------------------------------
+/**
+ * Estimate the current time with a source costing no network exchange: GNSS, NITZ, or the last
+ * time retrieved from the NTP server, else from the TP server
+ *
+ * @return
+ *      - LE_OK             Time estimated
+ *      - LE_NOT_FOUND      No time known by the source
+ */
+//--------------------------------------------------------------------------------------------------
+static le_result_t EstimateLocalTime
+(
+    pa_clkSync_Source_t source,         ///< [IN]  Local source
+    const char* ntpServerStrPtr,        ///< [IN]  NTP server, NULL if none
+    const char* tpServerStrPtr,         ///< [IN]  TP server, NULL if none
+    int64_t* timeNsPtr,                 ///< [OUT] Time estimated, since the Unix epoch
+    int64_t* errorNsPtr                 ///< [OUT] Bound of the error of the estimate
+)
+{
+    uint32_t ageMs;
+
+    if (PA_CLKSYNC_SOURCE_CACHE != source)
     {
-        return LE_NOT_FOUND;
+        return clkSyncSource_Estimate(source, timeNsPtr, errorNsPtr);
     }
-    searchPtr += strlen(offSetString);
-    stringEnd = strstr(searchPtr, offSetUnitString);
-    if (!stringEnd)
+
+    // The error of the retrieval itself isn't kept, only its age is accounted
+    if ((ntpServerStrPtr && (LE_OK == clkSyncCache_Estimate(PA_CLKSYNC_PROTOCOL_NTP,
+                                                            ntpServerStrPtr, timeNsPtr,
+                                                            &ageMs))) ||
+        (tpServerStrPtr && (LE_OK == clkSyncCache_Estimate(PA_CLKSYNC_PROTOCOL_TP,
+                                                           tpServerStrPtr, timeNsPtr, &ageMs))))
     {
-        return LE_NOT_FOUND;
+        *errorNsPtr = clkSyncSource_GetHoldoverError((int64_t)ageMs * CLKSYNC_NS_PER_MSEC);
+        return LE_OK;
     }
-
-    *stringEnd = '\0';
-    // After the above, searchPtr is a char* with content 1558374338.202418 in the above example
-    offSetSecs = strtol(searchPtr, NULL, 10);
-    LE_DEBUG("NTP offset time retrieved: %ld secs", (long int)offSetSecs);
-
-    // Get the present clock time on the device
-    currentAbsTime = le_clk_GetAbsoluteTime();
-    LE_DEBUG("Device present absolute time: %ld", (long int)currentAbsTime.sec);
-
-    // Add the offset to the present clock time to get the NTP provided present time
-    // In the above example, it's to add 1558374338 secs to 1 Jan 07:33:20 1971
-    offSetSecs += currentAbsTime.sec;
-    LE_DEBUG("NTP present absolute time: %ld secs", (long int)offSetSecs);
-    localtime_r(&offSetSecs, currentTimePtr);
-    LE_DEBUG("NTP present time retrieved: %d/%d/%d %d:%d:%d",
-             currentTimePtr->tm_year + 1900, currentTimePtr->tm_mon + 1, currentTimePtr->tm_mday,
-             currentTimePtr->tm_hour, currentTimePtr->tm_min, currentTimePtr->tm_sec);
-    return LE_OK;
+    return LE_NOT_FOUND;
 }
 
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Retrieve current clock time using the given Linux protocol specific server command in which,
- * and also in the 1st input argument a particular server is specified. The 2nd input argument
- * specifies if this operation is to only get the time or to get it & set it into the system clock.
- * If it is a get only operation, the retrieved current time will be returned in the output and
- * last argument.
+ * Retrieve time from the first adequate source of the chain. A local source is adequate when it
+ * has a time whose error, growing with its age, is within the given bound; it costs no network
+ * exchange. The NTP and TP servers are only queried when no source before them is adequate, a
+ * source without a server given being passed over. Unless getOnly, the time retrieved is set into
+ * the system clock.
  *
  * @return
  *      - LE_OK             Function succeeded to get (if getOnly) or update clock time
  *      - LE_BAD_PARAMETER  Incorrect parameter
- *      - LE_NOT_FOUND      Given server as name or address not found or resolvable into an IP addr
- *      - LE_UNAVAILABLE    No current clock time retrieved from the given server
- *      - LE_FAULT          Function failed to get clock time
+ *      - LE_UNAVAILABLE    No adequate local source and no server to query
+ *      - Others            Result of the last server queried, see
+ *                          pa_clkSync_GetTimeWithNetworkTimeProtocol()
  */
 //--------------------------------------------------------------------------------------------------
-static le_result_t pa_clkSync_GetTimeFromServer
+le_result_t pa_clkSync_GetTimeFromSources
 (
-    const char* serverStrPtr,        ///< [IN]  Time server name or address
-    bool getOnly,                    ///< [IN]  Get the time acquired without updating system clock
-    char* protocolCommand,           ///< [IN]  Protocol dependent command to run, i.e. TP or NTP
-    ClkSync_ProtocolParserFunc_t parseFunc, ///< [IN]  Parsing function for protocol's output line
-    le_clkSync_ClockTime_t* timePtr  ///< [OUT] Time structure
+    const char* ntpServerStrPtr,        ///< [IN]  NTP server, NULL if none
+    const char* tpServerStrPtr,         ///< [IN]  TP server, NULL if none
+    uint32_t maxErrorMs,                ///< [IN]  Largest error accepted from a local source
+    bool getOnly,                       ///< [IN]  Get the time acquired without updating system
+                                        ///<       clock
+    le_clkSync_ClockTime_t* timePtr,    ///< [OUT] Time structure
+    pa_clkSync_Source_t* sourcePtr      ///< [OUT] Source the time was retrieved from, may be NULL
 )
 {
-    le_result_t result;
-    FILE* fp;
-    char output[MAX_SYSTEM_CMD_OUTPUT_LENGTH], serverIpAddrStr[LE_DCS_IPADDR_MAX_LEN] = {};
+    pa_clkSync_Source_t chain[PA_CLKSYNC_SOURCE_MAX];
+    le_result_t result = LE_UNAVAILABLE;
+    int64_t timeNs, errorNs;
+    size_t count, i;
 
     if (!timePtr)
-    {
-        // Not supposed to happen
-        LE_ERROR("Null time data structure");
-        return LE_BAD_PARAMETER;
-    }
-
-    memset(timePtr, 0, sizeof(le_clkSync_ClockTime_t));
-    if ((!serverStrPtr) || ('\0' == serverStrPtr[0]))
     {
         LE_ERROR("Incorrect parameter");
         return LE_BAD_PARAMETER;
     }
 
-    // Validate time server name resolution if given as a name
-    if (!IsIpAddress(serverStrPtr))
-    {
-        result = ResolveIpAddress(serverStrPtr, serverIpAddrStr);
-        if (result != LE_OK)
-        {
-            LE_WARN("Failed to resolve server %s into IP address to get clock time",
-                    serverStrPtr);
-            return LE_NOT_FOUND;
-        }
-    }
-
-    if (getOnly)
+    memset(timePtr, 0, sizeof(le_clkSync_ClockTime_t));
+    count = clkSyncSource_GetChain(chain);
+    for (i = 0; i < count; i++)
     {
-        fp = popen(protocolCommand, "r");
-        if (!fp)
-        {
-            LE_ERROR("Failed to run command '%s' (%m)", protocolCommand);
-            return LE_FAULT;
-        }
-
-        // Retrieve output
-        struct tm tm = {0};
-        result = LE_FAULT;
-        while (NULL != fgets(output, sizeof(output)-1, fp))
+        if (PA_CLKSYNC_SOURCE_NTP == chain[i])
         {
-            if (parseFunc && (parseFunc(output, &tm) == LE_OK))
+            if (!ntpServerStrPtr)
             {
-                timePtr->msec = 0;
-                timePtr->sec  = tm.tm_sec;
-                timePtr->min  = tm.tm_min;
-                timePtr->hour = tm.tm_hour;
-                timePtr->day  = tm.tm_mday;
-                timePtr->mon  = 1 + tm.tm_mon; // Convert month range to [1..12]
-                timePtr->year = 1900 + tm.tm_year;
-                result = LE_OK;
-                break;
+                continue;
             }
+            result = pa_clkSync_GetTimeWithNetworkTimeProtocol(ntpServerStrPtr, getOnly, timePtr);
         }
-        if (result != LE_OK)
+        else if (PA_CLKSYNC_SOURCE_TP == chain[i])
         {
-            LE_ERROR("Failed to get time from server %s", serverStrPtr);
+            if (!tpServerStrPtr)
+            {
+                continue;
+            }
+            result = pa_clkSync_GetTimeWithTimeProtocol(tpServerStrPtr, getOnly, timePtr);
         }
-    }
-    else
-    {
-        fp = popen(protocolCommand, "r");
-        if (!fp)
+        else
         {
-            LE_ERROR("Failed to run command '%s' (%m)", protocolCommand);
-            return LE_FAULT;
+            if (LE_OK != EstimateLocalTime(chain[i], ntpServerStrPtr, tpServerStrPtr, &timeNs,
+                                           &errorNs))
+            {
+                continue;
+            }
+            if (errorNs > (int64_t)maxErrorMs * CLKSYNC_NS_PER_MSEC)
+            {
+                LE_DEBUG("Time of source %d too stale, error up to %" PRId64 " ms", chain[i],
+                         errorNs / CLKSYNC_NS_PER_MSEC);
+                continue;
+            }
+
+            ConvertNsToClockTime(timeNs, timePtr);
+            result = LE_OK;
+            if (!getOnly)
+            {
+                result = clkSyncAdjust_ApplyEstimate(timeNs - clkSync_GetClockNs(CLOCK_REALTIME));
+            }
         }
 
-        result = LE_UNAVAILABLE;
-        while (fgets(output, sizeof(output)-1, fp))
+        if (LE_OK == result)
         {
-            if (strlen(output) > 1)
+            LE_DEBUG("Time retrieved from source %d", chain[i]);
+            if (sourcePtr)
             {
-                char *tmp_ptr = NULL;
-                int16_t resultCode = (int16_t)strtol(output, &tmp_ptr, 10);
-                LE_INFO("Result: %d", resultCode);
-                result = (resultCode == 0) ? LE_OK : LE_FAULT;
-                break;
+                *sourcePtr = chain[i];
             }
+            return LE_OK;
         }
     }
-    pclose(fp);
+
+    LE_ERROR("No time retrieved from the chained sources");
     return result;
 }
 
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Retrieve time from a server using the Time Protocol.
+ * Get the latency and cost of the last time retrievals from a single server run with the given
+ * engine of the given protocol, e.g. to compare the engines against the same server
  *
  * @return
- *      - LE_OK             Function succeeded to get (if getOnly) or update clock time
+ *      - LE_OK             Report returned
  *      - LE_BAD_PARAMETER  Incorrect parameter
- *      - LE_NOT_FOUND      Given server as name or address not found or resolvable into an IP addr
- *      - LE_UNAVAILABLE    No current clock time retrieved from the given server
- *      - LE_UNSUPPORTED    Function not supported by the target
- *      - LE_FAULT          Function failed to get clock time
+ *      - LE_NOT_FOUND      No retrieval run with this engine yet
  */
 //--------------------------------------------------------------------------------------------------
-le_result_t pa_clkSync_GetTimeWithTimeProtocol
+le_result_t pa_clkSync_GetLatencyReport
 (
-    const char* serverStrPtr,       ///< [IN]  Time server
-    bool getOnly,                   ///< [IN]  Get the time acquired without updating system clock
-    le_clkSync_ClockTime_t* timePtr ///< [OUT] Time structure
+    pa_clkSync_Protocol_t protocol,         ///< [IN]  Protocol
+    pa_clkSync_Engine_t engine,             ///< [IN]  Engine selected for the retrievals
+    pa_clkSync_LatencyReport_t* reportPtr   ///< [OUT] Report
 )
 {
-    le_result_t result;
-    char protocolCommand[MAX_SYSTEM_CMD_LENGTH] = {0};
+    return clkSyncTiming_GetReport(protocol, engine, reportPtr);
+}
 
-    if (getOnly)
-    {
-        snprintf(protocolCommand, sizeof(protocolCommand), "/usr/sbin/rdate -p %s", serverStrPtr);
-    }
-    else
-    {
-        snprintf(protocolCommand, sizeof(protocolCommand),
-                 "/usr/sbin/rdate %s >& /dev/null; echo $?", serverStrPtr);
-    }
 
-    result = pa_clkSync_GetTimeFromServer(serverStrPtr, getOnly, protocolCommand,
-                                          TpParseOutput, timePtr);
-    return result;
+//--------------------------------------------------------------------------------------------------
+/**
+ * Discard the measurements of all the time retrievals run so far
+ */
+//--------------------------------------------------------------------------------------------------
+void pa_clkSync_ResetLatencyReports
+(
+    void
+)
+{
+    clkSyncTiming_Reset();
 }
 
 
 //--------------------------------------------------------------------------------------------------
 /**
- * Retrieve time from a server using the Network Time Protocol.
+ * Get the statistics of all the time retrievals with a protocol since the start or the last
+ * reset; the retrievals from several servers together count as NTP ones
  *
  * @return
- *      - LE_OK             Function succeeded to get (if getOnly) or update clock time
+ *      - LE_OK             Statistics returned
  *      - LE_BAD_PARAMETER  Incorrect parameter
- *      - LE_NOT_FOUND      Given server as name or address not found or resolvable into an IP addr
- *      - LE_UNAVAILABLE    No current clock time retrieved from the given server
- *      - LE_UNSUPPORTED    Function not supported by the target
- *      - LE_FAULT          Function failed to get clock time
  */
 //--------------------------------------------------------------------------------------------------
-le_result_t pa_clkSync_GetTimeWithNetworkTimeProtocol
+le_result_t pa_clkSync_GetQueryStats
 (
-    const char* serverStrPtr,       ///< [IN]  Time server
-    bool getOnly,                   ///< [IN]  Get the time acquired without updating system clock
-    le_clkSync_ClockTime_t* timePtr ///< [OUT] Time structure
+    pa_clkSync_Protocol_t protocol,         ///< [IN]  Protocol
+    pa_clkSync_QueryStats_t* statsPtr       ///< [OUT] Statistics
 )
 {
-    le_result_t result;
-    char protocolCommand[MAX_SYSTEM_CMD_LENGTH] = {0};
+    return clkSyncStats_GetProtocol(protocol, statsPtr);
+}
 
-    if (getOnly)
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the statistics of the time retrievals from the server of the given index, in the order the
+ * servers were first queried. Only the first PA_CLKSYNC_STATS_MAX_SERVERS servers are followed.
+ *
+ * @return
+ *      - LE_OK             Statistics returned
+ *      - LE_BAD_PARAMETER  Incorrect parameter
+ *      - LE_NOT_FOUND      No server of this index
+ *      - LE_OVERFLOW       Server name too long for the buffer, the statistics are returned
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t pa_clkSync_GetServerQueryStats
+(
+    uint32_t index,                         ///< [IN]  Index of the server
+    char* serverStrPtr,                     ///< [OUT] Server name or address
+    size_t serverStrSize,                   ///< [IN]  Size of the server name buffer
+    pa_clkSync_QueryStats_t* statsPtr       ///< [OUT] Statistics
+)
+{
+    return clkSyncStats_GetServerByIndex(index, serverStrPtr, serverStrSize, statsPtr);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the statistics of the updates of the system clock since the start or the last reset
+ *
+ * @return
+ *      - LE_OK             Statistics returned
+ *      - LE_BAD_PARAMETER  Incorrect parameter
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t pa_clkSync_GetAdjustStats
+(
+    pa_clkSync_AdjustStats_t* statsPtr      ///< [OUT] Statistics
+)
+{
+    return clkSyncStats_GetAdjust(statsPtr);
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Zero all the statistics; the servers already followed keep their index
+ */
+//--------------------------------------------------------------------------------------------------
+void pa_clkSync_ResetStats
+(
+    void
+)
+{
+    clkSyncStats_Reset();
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set whether a time retrieval started from the event loop while the data connection is down is
+ * queued to start once the connection is up, rather than failing with LE_UNAVAILABLE. Only one
+ * retrieval is queued at a time; it isn't bounded by the query deadline until started.
+ */
+//--------------------------------------------------------------------------------------------------
+void pa_clkSync_SetQueueUntilConnected
+(
+    bool enable                     ///< [IN] Whether to queue the retrieval
+)
+{
+    QueueUntilConnected = enable;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Report a data connection event, on which the state depending on the network is reset. While
+ * the data connection is down, the time retrievals needing the network fail right away with
+ * LE_UNAVAILABLE; once it is up, the retrieval queued meanwhile is started.
+ */
+//--------------------------------------------------------------------------------------------------
+void pa_clkSync_NotifyConnectionEvent
+(
+    le_dcs_Event_t event            ///< [IN] Data connection event
+)
+{
+    LE_DEBUG("Data connection event %d", event);
+
+    // Name servers and reachable addresses may differ on the new connection
+    clkSyncDns_Flush();
+
+    // Cookies reused on another network would let the requests be linked to each other
+    clkSyncNts_Flush();
+
+    // Connected sockets keep the local address of the connection they were connected over
+    clkSyncSocket_Flush();
+
+    IsConnected = (LE_DCS_EVENT_UP == event);
+
+    // The clock may have drifted unchecked while the network was down
+    if (IsConnected)
     {
-        snprintf(protocolCommand, sizeof(protocolCommand),
-                 "/usr/sbin/ntpdate -t 1.0 -p 1 -q %s; echo $?", serverStrPtr);
+        LaunchPendingRequest();
+        clkSyncSched_Reset();
     }
-    else
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Answer the requests of the native NTP client from a script instead of the time servers. Each
+ * request sent takes the next step of the script, going back to the first step after the last,
+ * whatever the server.
+ *
+ * @return
+ *      - LE_OK             Replay started, or its script replaced
+ *      - LE_BAD_PARAMETER  No step or more than PA_CLKSYNC_REPLAY_MAX_STEPS
+ *      - LE_UNSUPPORTED    Replay not compiled in
+ *      - LE_FAULT          The replay couldn't be started
+ */
+//--------------------------------------------------------------------------------------------------
+le_result_t pa_clkSync_StartReplay
+(
+    const pa_clkSync_ReplayStep_t* stepsPtr,    ///< [IN] Steps of the script
+    size_t count                                ///< [IN] Number of steps
+)
+{
+#if PA_CLKSYNC_WITH_REPLAY
+    le_result_t result = clkSyncReplay_Start(stepsPtr, count);
+
+    if (LE_BAD_PARAMETER == result)
     {
-        snprintf(protocolCommand, sizeof(protocolCommand),
-                 "/usr/sbin/ntpdate -t 1.0 -p 1 %s >& /dev/null; echo $?", serverStrPtr);
+        LE_ERROR("Invalid replay script of %zu steps", count);
     }
-
-    result = pa_clkSync_GetTimeFromServer(serverStrPtr, getOnly, protocolCommand,
-                                          NtpParseOutput, timePtr);
     return result;
+#else
+    LE_ERROR("Replay not compiled in");
+    return LE_UNSUPPORTED;
+#endif
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Stop replaying the script, the native NTP client exchanging with the time servers again
+ */
+//--------------------------------------------------------------------------------------------------
+void pa_clkSync_StopReplay
+(
+    void
+)
+{
+#if PA_CLKSYNC_WITH_REPLAY
+    clkSyncReplay_Stop();
+#endif
 }
 
 
@@ -419,4 +3228,21 @@ le_result_t pa_clkSync_GetTimeWithNetworkTimeProtocol
 //--------------------------------------------------------------------------------------------------
 COMPONENT_INIT
 {
+    RequestPool = le_mem_CreatePool("ClkSyncRequestPool", sizeof(ClkSync_Request_t));
+    RequestRefMap = le_ref_CreateMap("ClkSyncRequestRefMap", PA_CLKSYNC_MAX_REQUESTS);
+
+    clkSyncDns_Init();
+    clkSyncTiming_Init();
+    clkSyncNts_Init();
+    clkSyncCoalesce_Init();
+    clkSyncCache_Init();
+    clkSyncSocket_Init();
+#if PA_CLKSYNC_WITH_REPLAY
+    clkSyncReplay_Init();
+#endif
+    clkSyncSource_Init();
+    clkSyncDrift_Init();
+    clkSyncSnapshot_Init();
+    clkSyncAsync_Init();
+    clkSyncSched_Init(StartSyncWithNetworkTimeProtocol);
 }
@@ -0,0 +1,1028 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file pa_clkSync_linux.h
+ *
+ * Linux specific extensions of the Clock Service Adapter, on top of the generic interface found in
+ * pa_clkSync.h
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef PA_CLKSYNC_LINUX_H_INCLUDE_GUARD
+#define PA_CLKSYNC_LINUX_H_INCLUDE_GUARD
+
+#include "legato.h"
+#include "interfaces.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Default largest offset corrected by slewing the system clock; 0 always steps it
+ */
+//--------------------------------------------------------------------------------------------------
+#ifndef PA_CLKSYNC_STEP_THRESHOLD_MS_DEFAULT
+#define PA_CLKSYNC_STEP_THRESHOLD_MS_DEFAULT    0
+#endif
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Default time allowed for a whole time retrieval, from the name resolution to the server's reply;
+ * 0 leaves it unbounded
+ */
+//--------------------------------------------------------------------------------------------------
+#ifndef PA_CLKSYNC_QUERY_DEADLINE_MS_DEFAULT
+#define PA_CLKSYNC_QUERY_DEADLINE_MS_DEFAULT    10000
+#endif
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Default file the measured clock frequency is saved into, restored on start; empty by default,
+ * the frequency being neither saved nor restored unless a file is given here or with
+ * pa_clkSync_SetDriftFile(), e.g. "/var/lib/clkSync.drift"
+ */
+//--------------------------------------------------------------------------------------------------
+#ifndef PA_CLKSYNC_DRIFT_FILE_DEFAULT
+#define PA_CLKSYNC_DRIFT_FILE_DEFAULT           ""
+#endif
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Default file the last synchronized time is saved into, restored on start; empty by default,
+ * the system clock being neither saved nor restored unless a file is given here or with
+ * pa_clkSync_SetSnapshotFile(), e.g. "/var/lib/clkSync.time"
+ */
+//--------------------------------------------------------------------------------------------------
+#ifndef PA_CLKSYNC_SNAPSHOT_FILE_DEFAULT
+#define PA_CLKSYNC_SNAPSHOT_FILE_DEFAULT        ""
+#endif
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Default freshness window within which a get only retrieval is answered from the last time
+ * retrieved from the same server; 0 always queries the server
+ */
+//--------------------------------------------------------------------------------------------------
+#ifndef PA_CLKSYNC_RESULT_CACHE_MS_DEFAULT
+#define PA_CLKSYNC_RESULT_CACHE_MS_DEFAULT      0
+#endif
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Default number of requests sent in a row to an NTP server address by the native client; 1
+ * sends a single request
+ */
+//--------------------------------------------------------------------------------------------------
+#ifndef PA_CLKSYNC_NTP_BURST_DEFAULT
+#define PA_CLKSYNC_NTP_BURST_DEFAULT            1
+#endif
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Default offset of the timescale of the PTP hardware clocks from UTC, in seconds: the TAI-UTC
+ * offset in effect since 2017, PTP running on the TAI timescale
+ */
+//--------------------------------------------------------------------------------------------------
+#ifndef PA_CLKSYNC_PTP_UTC_OFFSET_DEFAULT
+#define PA_CLKSYNC_PTP_UTC_OFFSET_DEFAULT       37
+#endif
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Bound of the drift of the local oscillator, in parts per million, by which the error of a time
+ * extrapolated from a previous report or retrieval is taken to grow
+ */
+//--------------------------------------------------------------------------------------------------
+#ifndef PA_CLKSYNC_HOLDOVER_PPM_DEFAULT
+#define PA_CLKSYNC_HOLDOVER_PPM_DEFAULT         100
+#endif
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Maximum number of servers queried together by pa_clkSync_GetTimeWithNetworkTimeProtocolServers()
+ */
+//--------------------------------------------------------------------------------------------------
+#define PA_CLKSYNC_MAX_SERVERS      4
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Maximum number of requests sent in a row to an NTP server address, as many as the samples kept
+ * by the NTP clock filter
+ */
+//--------------------------------------------------------------------------------------------------
+#define PA_CLKSYNC_NTP_BURST_MAX    8
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Expected maximum number of time retrievals in progress from the event loop
+ */
+//--------------------------------------------------------------------------------------------------
+#define PA_CLKSYNC_MAX_REQUESTS     4
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Maximum number of servers whose statistics are kept
+ */
+//--------------------------------------------------------------------------------------------------
+#define PA_CLKSYNC_STATS_MAX_SERVERS    8
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Maximum number of steps of a script of server replies replayed
+ */
+//--------------------------------------------------------------------------------------------------
+#define PA_CLKSYNC_REPLAY_MAX_STEPS     64
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Range of the poll interval of the periodic synchronization, as log2 of seconds, and its
+ * defaults: 16 s to 36 h, by default 64 s to 1024 s as ntpd
+ */
+//--------------------------------------------------------------------------------------------------
+#define PA_CLKSYNC_POLL_MIN         4
+#define PA_CLKSYNC_POLL_MAX         17
+#define PA_CLKSYNC_MINPOLL_DEFAULT  6
+#define PA_CLKSYNC_MAXPOLL_DEFAULT  10
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Reference to a time retrieval in progress from the event loop
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct pa_clkSync_GetTimeRequest* pa_clkSync_GetTimeRequestRef_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Handler called from the event loop when a time retrieval completes
+ */
+//--------------------------------------------------------------------------------------------------
+typedef void (*pa_clkSync_GetTimeHandlerFunc_t)
+(
+    le_result_t result,                     ///< [IN] Result, as returned by the blocking variant
+    const le_clkSync_ClockTime_t* timePtr,  ///< [IN] Time retrieved, if getOnly was set
+    void* contextPtr                        ///< [IN] Context given at the start of the retrieval
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Ways the system clock is updated
+ */
+//--------------------------------------------------------------------------------------------------
+typedef enum
+{
+    PA_CLKSYNC_CLOCK_ADJUST_NONE = 0,   ///< Not updated
+    PA_CLKSYNC_CLOCK_ADJUST_SLEW,       ///< Gradually slewed by adjtimex()
+    PA_CLKSYNC_CLOCK_ADJUST_STEP,       ///< Stepped by clock_settime()
+    PA_CLKSYNC_CLOCK_ADJUST_COMMAND,    ///< Updated by a command such as ntpdate, not reported
+    PA_CLKSYNC_CLOCK_ADJUST_RESTORE     ///< Stepped to the estimate of the time snapshot on start
+}
+pa_clkSync_ClockAdjust_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Time protocols retrieved from a single server or local reference clock
+ */
+//--------------------------------------------------------------------------------------------------
+typedef enum
+{
+    PA_CLKSYNC_PROTOCOL_TP = 0,     ///< Time Protocol, RFC 868
+    PA_CLKSYNC_PROTOCOL_NTP,        ///< Network Time Protocol
+    PA_CLKSYNC_PROTOCOL_PTP,        ///< Precision Time Protocol hardware clock or PPS source
+    PA_CLKSYNC_PROTOCOL_MAX
+}
+pa_clkSync_Protocol_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Sources of the time chained by pa_clkSync_GetTimeFromSources(), the local ones costing no
+ * network exchange
+ */
+//--------------------------------------------------------------------------------------------------
+typedef enum
+{
+    PA_CLKSYNC_SOURCE_GNSS = 0,     ///< Time of the GNSS receiver, reported by the Clock Service
+    PA_CLKSYNC_SOURCE_NITZ,         ///< Time of the cellular network, reported by the Clock Service
+    PA_CLKSYNC_SOURCE_CACHE,        ///< Last time retrieved from the NTP or TP server, within the
+                                    ///< freshness window
+    PA_CLKSYNC_SOURCE_NTP,          ///< Network Time Protocol server
+    PA_CLKSYNC_SOURCE_TP,           ///< Time Protocol server
+    PA_CLKSYNC_SOURCE_MAX
+}
+pa_clkSync_Source_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Engines able to run a time protocol
+ */
+//--------------------------------------------------------------------------------------------------
+typedef enum
+{
+    PA_CLKSYNC_ENGINE_NATIVE = 0,   ///< In-process client, falling back to the command on failure
+    PA_CLKSYNC_ENGINE_COMMAND,      ///< External command line tool of the selected backend
+    PA_CLKSYNC_ENGINE_DAEMON        ///< Tracking of a local daemon already disciplining the
+                                    ///< system clock, falling back to the native client if none
+}
+pa_clkSync_Engine_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Time packages able to back NTP, whose tools are run by the command and daemon engines
+ */
+//--------------------------------------------------------------------------------------------------
+typedef enum
+{
+    PA_CLKSYNC_BACKEND_NTPDATE = 0, ///< ntpdate, beside ntpd if any
+    PA_CLKSYNC_BACKEND_CHRONY,      ///< chronyd and chronyc
+    PA_CLKSYNC_BACKEND_TIMESYNCD    ///< systemd-timesyncd, which has no command line tool
+}
+pa_clkSync_Backend_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Phases a time retrieval spends its time in
+ */
+//--------------------------------------------------------------------------------------------------
+typedef enum
+{
+    PA_CLKSYNC_PHASE_DNS = 0,       ///< Resolution of the server name
+    PA_CLKSYNC_PHASE_SPAWN,         ///< Launch of a command
+    PA_CLKSYNC_PHASE_NETWORK,       ///< Exchange with the server, or wait for a command's output
+    PA_CLKSYNC_PHASE_PARSE,         ///< Parsing of a command's output and use of its result
+    PA_CLKSYNC_PHASE_MAX
+}
+pa_clkSync_Phase_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Latency and cost of the last time retrievals run with a protocol's engine, whether they
+ * succeeded or not
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    uint32_t count;                         ///< Number of retrievals measured
+    int64_t p50Ns[PA_CLKSYNC_PHASE_MAX];    ///< Median time spent in each phase
+    int64_t p99Ns[PA_CLKSYNC_PHASE_MAX];    ///< 99th percentile of the time spent in each phase
+    int64_t totalP50Ns;                     ///< Median time of the whole retrieval
+    int64_t totalP99Ns;                     ///< 99th percentile time of the whole retrieval
+    int64_t cpuNs;                          ///< Mean CPU time of a retrieval in its thread, the
+                                            ///< commands' own included
+    uint32_t peakRssKb;                     ///< Peak resident set size of the process
+    uint32_t childPeakRssKb;                ///< Peak resident set size of the largest command run
+}
+pa_clkSync_LatencyReport_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Number of buckets of a histogram: bucket 0 counts the values below 2 us, bucket i those from
+ * 2^i up to 2^(i+1) us, and the last one all those from 2^23 us, about 8.4 s
+ */
+//--------------------------------------------------------------------------------------------------
+#define PA_CLKSYNC_HISTOGRAM_BUCKETS    24
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Number of result codes counted, indexed by the negated le_result_t; the last index also counts
+ * any further code
+ */
+//--------------------------------------------------------------------------------------------------
+#define PA_CLKSYNC_RESULT_CODES         32
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Histogram of durations or magnitudes on a log2 scale of microseconds
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    uint32_t counts[PA_CLKSYNC_HISTOGRAM_BUCKETS];  ///< Number of values in each bucket
+}
+pa_clkSync_Histogram_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Statistics of the time retrievals with a protocol or from a server
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    uint32_t queries;                               ///< Number of retrievals
+    uint32_t results[PA_CLKSYNC_RESULT_CODES];      ///< Retrievals by result, LE_OK first
+    pa_clkSync_Histogram_t dnsTime;                 ///< Time of the server name resolutions
+    pa_clkSync_Histogram_t rtt;                     ///< Round-trip delays measured by the native
+                                                    ///< clients
+}
+pa_clkSync_QueryStats_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Statistics of the updates of the system clock: the magnitudes of the offsets corrected, by kind
+ * of update. Those of the commands are unknown and counted as 0.
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    pa_clkSync_Histogram_t offsets[PA_CLKSYNC_CLOCK_ADJUST_RESTORE + 1];   ///< By kind of update
+}
+pa_clkSync_AdjustStats_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Origin of a time returned by a get only retrieval
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    bool isEstimate;        ///< Whether the time is extrapolated from a previous retrieval instead
+                            ///< of retrieved from the server
+    uint32_t ageMs;         ///< Time elapsed since the retrieval the time is extrapolated from, 0
+                            ///< if retrieved from the server
+}
+pa_clkSync_TimeInfo_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Step of a script of server replies replayed: how the server answers one request
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    bool isLost;            ///< Whether the request or its reply is lost, the rest being ignored
+    uint32_t delayMs;       ///< Round-trip delay of the exchange
+    int64_t offsetNs;       ///< Offset of the server's clock from the system clock
+    uint8_t stratum;        ///< Stratum of the server, 0 for a RATE Kiss-o'-Death
+}
+pa_clkSync_ReplayStep_t;
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Select the engine used by pa_clkSync_GetTimeWithTimeProtocol()
+ *
+ * @return
+ *      - LE_OK             Engine selected
+ *      - LE_BAD_PARAMETER  Unknown engine
+ *      - LE_UNSUPPORTED    Engine not compiled in
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t pa_clkSync_SetTpEngine
+(
+    pa_clkSync_Engine_t engine      ///< [IN] Engine to use for TP
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Select the engine used by pa_clkSync_GetTimeWithNetworkTimeProtocol()
+ *
+ * @return
+ *      - LE_OK             Engine selected
+ *      - LE_BAD_PARAMETER  Unknown engine
+ *      - LE_UNSUPPORTED    Engine not compiled in
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t pa_clkSync_SetNtpEngine
+(
+    pa_clkSync_Engine_t engine      ///< [IN] Engine to use for NTP
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Select the backend whose tools the command and daemon engines run for NTP
+ *
+ * @return
+ *      - LE_OK             Backend selected
+ *      - LE_BAD_PARAMETER  Unknown backend
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t pa_clkSync_SetNtpBackend
+(
+    pa_clkSync_Backend_t backend    ///< [IN] Backend to use for NTP
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the number of requests the native NTP client sends in a row to a server address, each as
+ * soon as the previous reply is received, keeping the sample of the least round-trip delay; 1
+ * sends a single request. The whole burst is bounded by the time given to each address. The
+ * default is PA_CLKSYNC_NTP_BURST_DEFAULT.
+ *
+ * @return
+ *      - LE_OK             Number of requests set
+ *      - LE_BAD_PARAMETER  Number of requests not within 1 and PA_CLKSYNC_NTP_BURST_MAX
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t pa_clkSync_SetNtpBurst
+(
+    uint32_t count                  ///< [IN] Number of requests
+);
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Retrieve time from a server using the Time Protocol, set it into the system clock and return
+ * it, all from a single exchange with the server. This replaces a get only call followed by a set
+ * call, which queries the server twice.
+ *
+ * @return
+ *      - LE_OK             Function succeeded to get and update clock time
+ *      - LE_BAD_PARAMETER  Incorrect parameter
+ *      - LE_NOT_FOUND      Given server as name or address not found or resolvable into an IP addr
+ *      - LE_UNAVAILABLE    No current clock time retrieved from the given server
+ *      - LE_TIMEOUT        No current clock time retrieved before the query deadline
+ *      - LE_UNSUPPORTED    TP not compiled in
+ *      - LE_FAULT          Function failed to get or update clock time
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t pa_clkSync_SyncWithTimeProtocol
+(
+    const char* serverStrPtr,       ///< [IN]  Time server
+    le_clkSync_ClockTime_t* timePtr ///< [OUT] Time retrieved and set
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Retrieve time from a server using the Network Time Protocol, set it into the system clock and
+ * return it, all from a single exchange with the server. This replaces a get only call followed
+ * by a set call, which queries the server twice.
+ *
+ * @return
+ *      - LE_OK             Function succeeded to get and update clock time
+ *      - LE_BAD_PARAMETER  Incorrect parameter
+ *      - LE_NOT_FOUND      Given server as name or address not found or resolvable into an IP addr
+ *      - LE_UNAVAILABLE    No current clock time retrieved from the given server
+ *      - LE_TIMEOUT        No current clock time retrieved before the query deadline
+ *      - LE_FAULT          Function failed to get or update clock time
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t pa_clkSync_SyncWithNetworkTimeProtocol
+(
+    const char* serverStrPtr,       ///< [IN]  Time server
+    le_clkSync_ClockTime_t* timePtr ///< [OUT] Time retrieved and set
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Retrieve time from several servers together using the Network Time Protocol. The servers are
+ * queried concurrently, the falsetickers among them are discarded and the most accurate of the
+ * remaining replies is used. Servers that fail to resolve are skipped.
+ *
+ * @return
+ *      - LE_OK             Function succeeded to get (if getOnly) or update clock time
+ *      - LE_BAD_PARAMETER  Incorrect parameter
+ *      - LE_NOT_FOUND      None of the given servers found or resolvable into an IP addr
+ *      - LE_UNAVAILABLE    No current clock time retrieved from the given servers
+ *      - LE_TIMEOUT        No current clock time retrieved before the query deadline
+ *      - LE_FAULT          Function failed to get clock time
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t pa_clkSync_GetTimeWithNetworkTimeProtocolServers
+(
+    const char* const* serverStrPtrs,   ///< [IN]  Time servers
+    size_t serverCount,                 ///< [IN]  Number of time servers, up to
+                                        ///<       PA_CLKSYNC_MAX_SERVERS
+    bool getOnly,                       ///< [IN]  Get the time acquired without updating system
+                                        ///<       clock
+    le_clkSync_ClockTime_t* timePtr     ///< [OUT] Time structure
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Retrieve time from an NTP server authenticated with Network Time Security (RFC 8915). The given
+ * NTS-KE server is contacted over TLS only when no cookie is left from the previous retrievals,
+ * so that in the common case the time is retrieved in a single authenticated UDP exchange.
+ *
+ * @return
+ *      - LE_OK             Function succeeded to get (if getOnly) or update clock time
+ *      - LE_BAD_PARAMETER  Incorrect parameter
+ *      - LE_NOT_FOUND      Given server as name or address not found or resolvable into an IP addr
+ *      - LE_UNAVAILABLE    No authenticated time retrieved from the given server
+ *      - LE_TIMEOUT        No authenticated time retrieved before the query deadline
+ *      - LE_FAULT          Function failed to get clock time, e.g. the server's certificate isn't
+ *                          trusted
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t pa_clkSync_GetTimeWithNetworkTimeSecurity
+(
+    const char* serverStrPtr,           ///< [IN]  NTS-KE server
+    bool getOnly,                       ///< [IN]  Get the time acquired without updating system
+                                        ///<       clock
+    le_clkSync_ClockTime_t* timePtr     ///< [OUT] Time structure
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Retrieve time from a local reference clock: the PTP hardware clock of a network interface
+ * synchronized by a PTP (IEEE 1588) daemon, or a PPS source. The device is read locally, without
+ * any network exchange, the offset of a hardware clock being measured within the time taken to
+ * read it. A PPS source only marks the start of each second, so it only corrects a system clock
+ * already within half a second of the time, e.g. set beforehand with NTP. The system clock being
+ * slewed in whole microseconds, it follows the device to a microsecond at best, however finely the
+ * offset is measured.
+ *
+ * @return
+ *      - LE_OK             Function succeeded to get (if getOnly) or update clock time
+ *      - LE_BAD_PARAMETER  Incorrect parameter
+ *      - LE_NOT_FOUND      Given device not found
+ *      - LE_UNSUPPORTED    Given device is neither a PTP hardware clock nor a PPS source
+ *      - LE_TIMEOUT        No pulse received from the PPS source before the query deadline
+ *      - LE_FAULT          Function failed to get clock time
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t pa_clkSync_GetTimeWithPrecisionTimeProtocol
+(
+    const char* devicePtr,              ///< [IN]  Device, e.g. /dev/ptp0 or /dev/pps0
+    bool getOnly,                       ///< [IN]  Get the time acquired without updating system
+                                        ///<       clock
+    le_clkSync_ClockTime_t* timePtr     ///< [OUT] Time structure
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the offset of the timescale of the PTP hardware clocks from UTC, in seconds: the current
+ * TAI-UTC offset for the TAI timescale of PTP, or 0 for a hardware clock kept at UTC. The default
+ * is PA_CLKSYNC_PTP_UTC_OFFSET_DEFAULT.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void pa_clkSync_SetPtpUtcOffset
+(
+    int32_t offsetSec                   ///< [IN] Offset of the hardware clocks from UTC
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start retrieving time from a server using the Time Protocol, without blocking the calling
+ * thread, which has to run the Legato event loop. The handler is called from the event loop once
+ * the time is retrieved, or set into the system clock unless getOnly is set.
+ *
+ * @return
+ *      - LE_OK             Retrieval started or queued, its result is given to the handler
+ *      - LE_BAD_PARAMETER  Incorrect parameter
+ *      - LE_NOT_FOUND      Given server as name or address not found or resolvable into an IP addr
+ *      - LE_UNAVAILABLE    The data connection is down
+ *      - LE_UNSUPPORTED    TP not compiled in
+ *      - LE_FAULT          Function failed to start the retrieval
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t pa_clkSync_StartGetTimeWithTimeProtocol
+(
+    const char* serverStrPtr,                    ///< [IN]  Time server
+    bool getOnly,                                ///< [IN]  Get the time acquired without updating
+                                                 ///<       system clock
+    pa_clkSync_GetTimeHandlerFunc_t handlerFunc, ///< [IN]  Completion handler
+    void* contextPtr,                            ///< [IN]  Context given to the handler
+    pa_clkSync_GetTimeRequestRef_t* refPtr       ///< [OUT] Reference of the retrieval, may be NULL
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start retrieving time from a server using the Network Time Protocol, without blocking the
+ * calling thread, which has to run the Legato event loop. The handler is called from the event
+ * loop once the time is retrieved, or set into the system clock unless getOnly is set.
+ *
+ * @return
+ *      - LE_OK             Retrieval started or queued, its result is given to the handler
+ *      - LE_BAD_PARAMETER  Incorrect parameter
+ *      - LE_NOT_FOUND      Given server as name or address not found or resolvable into an IP addr
+ *      - LE_UNAVAILABLE    The data connection is down
+ *      - LE_FAULT          Function failed to start the retrieval
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t pa_clkSync_StartGetTimeWithNetworkTimeProtocol
+(
+    const char* serverStrPtr,                    ///< [IN]  Time server
+    bool getOnly,                                ///< [IN]  Get the time acquired without updating
+                                                 ///<       system clock
+    pa_clkSync_GetTimeHandlerFunc_t handlerFunc, ///< [IN]  Completion handler
+    void* contextPtr,                            ///< [IN]  Context given to the handler
+    pa_clkSync_GetTimeRequestRef_t* refPtr       ///< [OUT] Reference of the retrieval, may be NULL
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Cancel a time retrieval in progress; its handler is not called. A command already running is
+ * killed.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void pa_clkSync_CancelGetTime
+(
+    pa_clkSync_GetTimeRequestRef_t ref          ///< [IN] Reference of the retrieval
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Start synchronizing the system clock periodically with a server using the Network Time
+ * Protocol, from the event loop of the calling thread. The poll interval adapts between 2^minPoll
+ * and 2^maxPoll seconds to the drift measured, replacing any periodic synchronization in progress.
+ *
+ * @return
+ *      - LE_OK             Synchronization scheduled, the first one being run right away
+ *      - LE_BAD_PARAMETER  Incorrect parameter
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t pa_clkSync_StartPeriodicSync
+(
+    const char* serverStrPtr,       ///< [IN] Time server
+    uint8_t minPoll,                ///< [IN] Log2 of the shortest interval in seconds
+    uint8_t maxPoll                 ///< [IN] Log2 of the longest interval in seconds
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Stop the periodic synchronization of the system clock
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void pa_clkSync_StopPeriodicSync
+(
+    void
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the largest offset corrected by slewing the system clock rather than stepping it, when the
+ * clock is set by a native client; a threshold of 0 always steps the clock. The default is
+ * PA_CLKSYNC_STEP_THRESHOLD_MS_DEFAULT.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void pa_clkSync_SetStepThreshold
+(
+    uint32_t thresholdMs            ///< [IN] Largest offset slewed
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the time allowed for each whole time retrieval, from the name resolution to the server's
+ * reply, past which the retrieval is abandoned with LE_TIMEOUT and any command it runs is killed;
+ * 0 leaves it unbounded. The default is PA_CLKSYNC_QUERY_DEADLINE_MS_DEFAULT.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void pa_clkSync_SetQueryDeadline
+(
+    uint32_t deadlineMs             ///< [IN] Time allowed
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get how the system clock was last updated by this adaptor, e.g. to know whether the last set
+ * operation stepped the clock
+ *
+ * @return
+ *      Kind of the last update, PA_CLKSYNC_CLOCK_ADJUST_NONE if none yet
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED pa_clkSync_ClockAdjust_t pa_clkSync_GetLastClockAdjust
+(
+    int64_t* offsetNsPtr            ///< [OUT] Offset corrected, 0 if unknown; may be NULL
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the file the measured clock frequency is saved into, and restore the frequency saved in it
+ * if any; an empty path disables the saving
+ *
+ * @return
+ *      - LE_OK             File set
+ *      - LE_BAD_PARAMETER  Incorrect parameter
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t pa_clkSync_SetDriftFile
+(
+    const char* pathPtr             ///< [IN] Drift file
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the file the last synchronized time is saved into, and restore the system clock from it if
+ * the clock is behind; an empty path disables the snapshot
+ *
+ * @return
+ *      - LE_OK             File set
+ *      - LE_BAD_PARAMETER  Incorrect parameter
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t pa_clkSync_SetSnapshotFile
+(
+    const char* pathPtr             ///< [IN] Snapshot file
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the frequency correction applied to the system clock to compensate its drift
+ *
+ * @return
+ *      - LE_OK             Frequency returned
+ *      - LE_BAD_PARAMETER  Incorrect parameter
+ *      - LE_FAULT          Failed to read the frequency
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t pa_clkSync_GetClockFrequency
+(
+    int32_t* ppbPtr                 ///< [OUT] Frequency correction in parts per billion
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the lifetimes of time server name resolutions in the cache; a lifetime of 0 disables the
+ * caching of the corresponding results
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void pa_clkSync_SetDnsCacheTtl
+(
+    uint32_t ttlSecs,               ///< [IN] Lifetime of successful resolutions
+    uint32_t negativeTtlSecs        ///< [IN] Lifetime of failed resolutions
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the freshness window within which a get only retrieval with the Time Protocol or the
+ * Network Time Protocol is answered without querying the server, by extrapolating the last time
+ * retrieved from the same server with the same protocol, whether by a retrieval, started or not
+ * from the event loop, or by a synchronization; 0 always queries the server. The default is
+ * PA_CLKSYNC_RESULT_CACHE_MS_DEFAULT.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void pa_clkSync_SetResultCacheWindow
+(
+    uint32_t windowMs               ///< [IN] Freshness window
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the time of a server with the given protocol without updating the system clock, as a get
+ * only pa_clkSync_GetTimeWithTimeProtocol() or pa_clkSync_GetTimeWithNetworkTimeProtocol() does,
+ * also telling whether the time returned is an estimate extrapolated within the freshness window
+ * and how old the retrieval it is extrapolated from is.
+ *
+ * @return
+ *      - LE_OK             Function succeeded to get clock time
+ *      - LE_BAD_PARAMETER  Incorrect parameter
+ *      - LE_NOT_FOUND      Given server as name or address not found or resolvable into an IP addr
+ *      - LE_UNAVAILABLE    No current clock time retrieved from the given server
+ *      - LE_TIMEOUT        No current clock time retrieved before the query deadline
+ *      - LE_UNSUPPORTED    Protocol not compiled in
+ *      - LE_FAULT          Function failed to get clock time
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t pa_clkSync_GetTimeWithInfo
+(
+    pa_clkSync_Protocol_t protocol,     ///< [IN]  Protocol, i.e. TP or NTP
+    const char* serverStrPtr,           ///< [IN]  Time server
+    le_clkSync_ClockTime_t* timePtr,    ///< [OUT] Time structure
+    pa_clkSync_TimeInfo_t* infoPtr      ///< [OUT] Origin of the time, may be NULL
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Report the time just received by the modem from a local source, i.e. GNSS or NITZ, to be used
+ * by pa_clkSync_GetTimeFromSources(). To be called by the Clock Service as it gets the time, given
+ * as UTC since the Unix epoch so that it is neither rounded nor subject to the time zone.
+ *
+ * @return
+ *      - LE_OK             Time reported
+ *      - LE_BAD_PARAMETER  Incorrect parameter, or the source isn't GNSS nor NITZ
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t pa_clkSync_ReportExternalTime
+(
+    pa_clkSync_Source_t source,             ///< [IN] GNSS or NITZ
+    const struct timespec* timePtr,         ///< [IN] Time received, since the Unix epoch
+    uint32_t accuracyMs                     ///< [IN] Bound of the error of the time received
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set the order pa_clkSync_GetTimeFromSources() tries the sources in; the sources left out are
+ * not tried. The default order is GNSS, NITZ, cache, NTP then TP.
+ *
+ * @return
+ *      - LE_OK             Order set
+ *      - LE_BAD_PARAMETER  No source, unknown source or source given twice
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t pa_clkSync_SetSourceChain
+(
+    const pa_clkSync_Source_t* sourcesPtr,  ///< [IN] Sources, from the first tried
+    size_t count                            ///< [IN] Number of sources
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Retrieve time from the first adequate source of the chain. A local source is adequate when it
+ * has a time whose error, growing with its age, is within the given bound; it costs no network
+ * exchange. The NTP and TP servers are only queried when no source before them is adequate, a
+ * source without a server given being passed over. Unless getOnly, the time retrieved is set into
+ * the system clock.
+ *
+ * @return
+ *      - LE_OK             Function succeeded to get (if getOnly) or update clock time
+ *      - LE_BAD_PARAMETER  Incorrect parameter
+ *      - LE_UNAVAILABLE    No adequate local source and no server to query
+ *      - Others            Result of the last server queried, see
+ *                          pa_clkSync_GetTimeWithNetworkTimeProtocol()
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t pa_clkSync_GetTimeFromSources
+(
+    const char* ntpServerStrPtr,        ///< [IN]  NTP server, NULL if none
+    const char* tpServerStrPtr,         ///< [IN]  TP server, NULL if none
+    uint32_t maxErrorMs,                ///< [IN]  Largest error accepted from a local source
+    bool getOnly,                       ///< [IN]  Get the time acquired without updating system
+                                        ///<       clock
+    le_clkSync_ClockTime_t* timePtr,    ///< [OUT] Time structure
+    pa_clkSync_Source_t* sourcePtr      ///< [OUT] Source the time was retrieved from, may be NULL
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the latency and cost of the last time retrievals from a single server run with the given
+ * engine of the given protocol, e.g. to compare the engines against the same server
+ *
+ * @return
+ *      - LE_OK             Report returned
+ *      - LE_BAD_PARAMETER  Incorrect parameter
+ *      - LE_NOT_FOUND      No retrieval run with this engine yet
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t pa_clkSync_GetLatencyReport
+(
+    pa_clkSync_Protocol_t protocol,         ///< [IN]  Protocol
+    pa_clkSync_Engine_t engine,             ///< [IN]  Engine selected for the retrievals
+    pa_clkSync_LatencyReport_t* reportPtr   ///< [OUT] Report
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Discard the measurements of all the time retrievals run so far
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void pa_clkSync_ResetLatencyReports
+(
+    void
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the statistics of all the time retrievals with a protocol since the start or the last
+ * reset; the retrievals from several servers together count as NTP ones
+ *
+ * @return
+ *      - LE_OK             Statistics returned
+ *      - LE_BAD_PARAMETER  Incorrect parameter
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t pa_clkSync_GetQueryStats
+(
+    pa_clkSync_Protocol_t protocol,         ///< [IN]  Protocol
+    pa_clkSync_QueryStats_t* statsPtr       ///< [OUT] Statistics
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the statistics of the time retrievals from the server of the given index, in the order the
+ * servers were first queried. Only the first PA_CLKSYNC_STATS_MAX_SERVERS servers are followed.
+ *
+ * @return
+ *      - LE_OK             Statistics returned
+ *      - LE_BAD_PARAMETER  Incorrect parameter
+ *      - LE_NOT_FOUND      No server of this index
+ *      - LE_OVERFLOW       Server name too long for the buffer, the statistics are returned
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t pa_clkSync_GetServerQueryStats
+(
+    uint32_t index,                         ///< [IN]  Index of the server
+    char* serverStrPtr,                     ///< [OUT] Server name or address
+    size_t serverStrSize,                   ///< [IN]  Size of the server name buffer
+    pa_clkSync_QueryStats_t* statsPtr       ///< [OUT] Statistics
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Get the statistics of the updates of the system clock since the start or the last reset
+ *
+ * @return
+ *      - LE_OK             Statistics returned
+ *      - LE_BAD_PARAMETER  Incorrect parameter
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t pa_clkSync_GetAdjustStats
+(
+    pa_clkSync_AdjustStats_t* statsPtr      ///< [OUT] Statistics
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Zero all the statistics; the servers already followed keep their index
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void pa_clkSync_ResetStats
+(
+    void
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Set whether a time retrieval started from the event loop while the data connection is down is
+ * queued to start once the connection is up, rather than failing with LE_UNAVAILABLE. Only one
+ * retrieval is queued at a time; it isn't bounded by the query deadline until started.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void pa_clkSync_SetQueueUntilConnected
+(
+    bool enable                     ///< [IN] Whether to queue the retrieval
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Report a data connection event, on which the state depending on the network is reset. While
+ * the data connection is down, the time retrievals needing the network fail right away with
+ * LE_UNAVAILABLE; once it is up, the retrieval queued meanwhile is started. To be called by the
+ * Clock Service from its le_dcs event handler.
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void pa_clkSync_NotifyConnectionEvent
+(
+    le_dcs_Event_t event            ///< [IN] Data connection event
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Answer the requests of the native NTP client from a script instead of the time servers, e.g. to
+ * load or regression test the retrievals, the periodic synchronization and the caches
+ * reproducibly. Each request sent, burst requests included, takes the next step of the script,
+ * going back to the first step after the last, whatever the server. The servers are best given as
+ * numeric addresses, as their names are still resolved. The queries of several servers together,
+ * NTS and the command backends keep exchanging with the servers. The replay is only compiled in
+ * when PA_CLKSYNC_WITH_REPLAY is set.
+ *
+ * @return
+ *      - LE_OK             Replay started, or its script replaced
+ *      - LE_BAD_PARAMETER  No step or more than PA_CLKSYNC_REPLAY_MAX_STEPS
+ *      - LE_UNSUPPORTED    Replay not compiled in
+ *      - LE_FAULT          The replay couldn't be started
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED le_result_t pa_clkSync_StartReplay
+(
+    const pa_clkSync_ReplayStep_t* stepsPtr,    ///< [IN] Steps of the script
+    size_t count                                ///< [IN] Number of steps
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Stop replaying the script, the native NTP client exchanging with the time servers again
+ */
+//--------------------------------------------------------------------------------------------------
+LE_SHARED void pa_clkSync_StopReplay
+(
+    void
+);
+
+#endif // PA_CLKSYNC_LINUX_H_INCLUDE_GUARD
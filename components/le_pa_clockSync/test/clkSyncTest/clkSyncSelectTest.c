@@ -0,0 +1,108 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file clkSyncSelectTest.c
+ *
+ * Test of the selection among the samples of several time servers of clkSyncSelect.c. Each case
+ * of the table gives the samples replied and the one to select: the most accurate one when all
+ * agree, a truechimer over a more accurate falseticker, the most accurate one when no majority
+ * agrees on the time, and the only one given.
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "clkSyncLocal.h"
+#include "clkSyncSelect.h"
+#include "clkSyncTest.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Sample of a test case, in milliseconds
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    int64_t offsetMs;           ///< Offset of the server clock
+    int64_t delayMs;            ///< Round-trip delay
+    int64_t rootDistanceMs;     ///< Root distance
+}
+SelectTest_Sample_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Test case
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    const char* namePtr;                            ///< Name printed
+    size_t count;                                   ///< Number of samples
+    SelectTest_Sample_t samples[CLKSYNC_MAX_ADDRS]; ///< Samples replied
+    size_t bestIndex;                               ///< Index of the sample to select
+}
+SelectTest_Case_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Test cases
+ */
+//--------------------------------------------------------------------------------------------------
+static const SelectTest_Case_t Cases[] =
+{
+    {
+        "All agree, the lowest root distance is selected",
+        3, { { 1, 20, 15 }, { 2, 10, 8 }, { 0, 30, 20 } }, 1
+    },
+    {
+        "One falseticker, discarded despite the lowest root distance",
+        3, { { 0, 20, 10 }, { 2, 10, 10 }, { 5000, 2, 1 } }, 1
+    },
+    {
+        "No majority, the lowest root distance among all is selected",
+        4, { { 0, 20, 5 }, { 1, 20, 5 }, { 1000, 4, 2 }, { 1001, 30, 6 } }, 2
+    },
+    {
+        "One sample, selected",
+        1, { { 42, 50, 25 } }, 0
+    },
+};
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Test the selection among the samples of several time servers of clkSyncSelect.c
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncTest_Select
+(
+    void
+)
+{
+    clkSync_Sample_t samples[CLKSYNC_MAX_ADDRS + 1];
+    clkSync_Sample_t best;
+    size_t i, j;
+    le_result_t result;
+
+    for (i = 0; i < NUM_ARRAY_MEMBERS(Cases); i++)
+    {
+        const SelectTest_Case_t* casePtr = &Cases[i];
+
+        memset(samples, 0, sizeof(samples));
+        for (j = 0; j < casePtr->count; j++)
+        {
+            samples[j].offsetNs = casePtr->samples[j].offsetMs * CLKSYNC_NS_PER_MSEC;
+            samples[j].delayNs = casePtr->samples[j].delayMs * CLKSYNC_NS_PER_MSEC;
+            samples[j].rootDistanceNs = casePtr->samples[j].rootDistanceMs * CLKSYNC_NS_PER_MSEC;
+            samples[j].addrIndex = j;
+        }
+
+        memset(&best, 0, sizeof(best));
+        result = clkSyncSelect_Best(samples, casePtr->count, &best);
+        LE_TEST_OK((LE_OK == result) && (casePtr->bestIndex == best.addrIndex), "%s",
+                   casePtr->namePtr);
+    }
+
+    LE_TEST_OK(LE_BAD_PARAMETER == clkSyncSelect_Best(samples, 0, &best), "No sample, rejected");
+    LE_TEST_OK(LE_BAD_PARAMETER == clkSyncSelect_Best(samples, CLKSYNC_MAX_ADDRS + 1, &best),
+               "More samples than addresses, rejected");
+}
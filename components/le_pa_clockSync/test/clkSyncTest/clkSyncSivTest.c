@@ -0,0 +1,206 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file clkSyncSivTest.c
+ *
+ * Test of the AEAD_AES_SIV_CMAC_256 of clkSyncSiv.c against the test vectors of RFC 5297
+ * appendix A: the deterministic example, whose associated data is a single component, and the
+ * nonce-based one, whose two associated data components and nonce make three. Each sealed message
+ * is then opened back, and opened again tampered with, which must be rejected.
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "clkSyncSiv.h"
+#include "clkSyncTest.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Largest number of associated data components of a test vector
+ */
+//--------------------------------------------------------------------------------------------------
+#define SIV_TEST_MAX_AD             3
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Largest plaintext of a test vector, in bytes
+ */
+//--------------------------------------------------------------------------------------------------
+#define SIV_TEST_MAX_PLAIN_BYTES    64
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Test vector, given in hexadecimal
+ */
+//--------------------------------------------------------------------------------------------------
+typedef struct
+{
+    const char* namePtr;                        ///< Name printed
+    const char* keyPtr;                         ///< Key, both halves
+    const char* adPtrs[SIV_TEST_MAX_AD];        ///< Associated data components, NULL ended
+    const char* plainPtr;                       ///< Plaintext
+    const char* sealedPtr;                      ///< Synthetic IV and ciphertext expected
+}
+SivTest_Vector_t;
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Test vectors of RFC 5297 appendix A
+ */
+//--------------------------------------------------------------------------------------------------
+static const SivTest_Vector_t Vectors[] =
+{
+    {
+        "RFC 5297 A.1 deterministic",
+        "fffefdfcfbfaf9f8f7f6f5f4f3f2f1f0f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff",
+        { "101112131415161718191a1b1c1d1e1f2021222324252627", NULL },
+        "112233445566778899aabbccddee",
+        "85632d07c6e8f37f950acd320a2ecc9340c02b9690c4dc04daef7f6afe5c"
+    },
+    {
+        "RFC 5297 A.2 nonce-based",
+        "7f7e7d7c7b7a79787776757473727170404142434445464748494a4b4c4d4e4f",
+        {
+            "00112233445566778899aabbccddeeffdeaddadadeaddadaffeeddccbbaa99887766554433221100",
+            "102030405060708090a0",
+            "09f911029d74e35bd84156c5635688c0"
+        },
+        "7468697320697320736f6d6520706c61696e7465787420746f20656e6372797074207573696e67205349"
+        "562d414553",
+        "7bdb6e3b432667eb06f4d14bff2fbd0fcb900f2fddbe404326601965c889bf17dba77ceb094fa663b7a3f748"
+        "ba8af829ea64ad544a272e9c485b62a3fd5c0d"
+    },
+};
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Decode a string of hexadecimal digits
+ *
+ * @return
+ *      The number of bytes decoded
+ */
+//--------------------------------------------------------------------------------------------------
+static size_t DecodeHex
+(
+    const char* hexPtr,             ///< [IN]  Hexadecimal digits, two per byte
+    uint8_t* bufPtr,                ///< [OUT] Bytes decoded
+    size_t bufSize                  ///< [IN]  Size of the buffer
+)
+{
+    size_t len = 0;
+    unsigned int byte;
+
+    while (hexPtr[0] && hexPtr[1] && (len < bufSize) && (1 == sscanf(hexPtr, "%2x", &byte)))
+    {
+        bufPtr[len++] = (uint8_t)byte;
+        hexPtr += 2;
+    }
+    return len;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Run a test vector: seal its plaintext, open the result back, and check that a tampered tag, a
+ * tampered ciphertext and tampered associated data are all rejected
+ */
+//--------------------------------------------------------------------------------------------------
+static void RunVector
+(
+    const SivTest_Vector_t* vectorPtr   ///< [IN] Test vector
+)
+{
+    uint8_t key[CLKSYNC_SIV_KEY_BYTES];
+    uint8_t adBufs[SIV_TEST_MAX_AD][SIV_TEST_MAX_PLAIN_BYTES];
+    clkSyncSiv_Data_t ad[SIV_TEST_MAX_AD];
+    uint8_t plain[SIV_TEST_MAX_PLAIN_BYTES];
+    uint8_t expected[CLKSYNC_SIV_BYTES + SIV_TEST_MAX_PLAIN_BYTES];
+    uint8_t sealed[CLKSYNC_SIV_BYTES + SIV_TEST_MAX_PLAIN_BYTES];
+    uint8_t opened[SIV_TEST_MAX_PLAIN_BYTES];
+    size_t plainLen, sealedLen, openedLen = 0;
+    size_t adCount = 0;
+    le_result_t result;
+
+    LE_TEST_INFO("%s", vectorPtr->namePtr);
+    DecodeHex(vectorPtr->keyPtr, key, sizeof(key));
+    while ((adCount < SIV_TEST_MAX_AD) && vectorPtr->adPtrs[adCount])
+    {
+        ad[adCount].dataPtr = adBufs[adCount];
+        ad[adCount].len = DecodeHex(vectorPtr->adPtrs[adCount], adBufs[adCount],
+                                    sizeof(adBufs[adCount]));
+        adCount++;
+    }
+    plainLen = DecodeHex(vectorPtr->plainPtr, plain, sizeof(plain));
+    sealedLen = DecodeHex(vectorPtr->sealedPtr, expected, sizeof(expected));
+    LE_TEST_ASSERT(sealedLen == CLKSYNC_SIV_BYTES + plainLen, "vector is consistent");
+
+    result = clkSyncSiv_Seal(key, ad, adCount, plain, plainLen, sealed);
+    LE_TEST_OK(LE_OK == result, "seal succeeds");
+    LE_TEST_OK(0 == memcmp(sealed, expected, CLKSYNC_SIV_BYTES), "synthetic IV matches");
+    LE_TEST_OK(0 == memcmp(sealed + CLKSYNC_SIV_BYTES, expected + CLKSYNC_SIV_BYTES, plainLen),
+               "ciphertext matches");
+
+    result = clkSyncSiv_Open(key, ad, adCount, expected, sealedLen, opened, &openedLen);
+    LE_TEST_OK((LE_OK == result) && (plainLen == openedLen) &&
+               (0 == memcmp(opened, plain, plainLen)), "open gives the plaintext back");
+
+    expected[CLKSYNC_SIV_BYTES - 1] ^= 0x01;
+    result = clkSyncSiv_Open(key, ad, adCount, expected, sealedLen, opened, &openedLen);
+    LE_TEST_OK(LE_FAULT == result, "open rejects a tampered tag");
+    expected[CLKSYNC_SIV_BYTES - 1] ^= 0x01;
+
+    expected[sealedLen - 1] ^= 0x80;
+    result = clkSyncSiv_Open(key, ad, adCount, expected, sealedLen, opened, &openedLen);
+    LE_TEST_OK(LE_FAULT == result, "open rejects a tampered ciphertext");
+    expected[sealedLen - 1] ^= 0x80;
+
+    adBufs[0][0] ^= 0x01;
+    result = clkSyncSiv_Open(key, ad, adCount, expected, sealedLen, opened, &openedLen);
+    LE_TEST_OK(LE_FAULT == result, "open rejects tampered associated data");
+    adBufs[0][0] ^= 0x01;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Test the AEAD_AES_SIV_CMAC_256 sealing and opening of clkSyncSiv.c
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncTest_Siv
+(
+    void
+)
+{
+    static const uint8_t header[] = { 0x23, 0x00, 0x06, 0x20 };
+    static const uint8_t nonce[16] = { 0x01 };
+    clkSyncSiv_Data_t ad[] =
+    {
+        { header, sizeof(header) },
+        { nonce, sizeof(nonce) },
+    };
+    uint8_t key[CLKSYNC_SIV_KEY_BYTES] = { 0x42 };
+    uint8_t sealed[CLKSYNC_SIV_BYTES];
+    uint8_t opened[1];
+    size_t i, openedLen = 1;
+
+    for (i = 0; i < NUM_ARRAY_MEMBERS(Vectors); i++)
+    {
+        RunVector(&Vectors[i]);
+    }
+
+    // Every NTS request is sealed with an empty plaintext, the tag alone authenticating it
+    LE_TEST_INFO("Empty plaintext");
+    LE_TEST_OK(LE_OK == clkSyncSiv_Seal(key, ad, NUM_ARRAY_MEMBERS(ad), NULL, 0, sealed),
+               "seal of an empty plaintext succeeds");
+    LE_TEST_OK((LE_OK == clkSyncSiv_Open(key, ad, NUM_ARRAY_MEMBERS(ad), sealed, sizeof(sealed),
+                                         opened, &openedLen)) && (0 == openedLen),
+               "open of an empty plaintext succeeds");
+    sealed[0] ^= 0x01;
+    LE_TEST_OK(LE_FAULT == clkSyncSiv_Open(key, ad, NUM_ARRAY_MEMBERS(ad), sealed, sizeof(sealed),
+                                           opened, &openedLen),
+               "open rejects a tampered tag");
+    LE_TEST_OK(LE_FAULT == clkSyncSiv_Open(key, ad, NUM_ARRAY_MEMBERS(ad), sealed,
+                                           CLKSYNC_SIV_BYTES - 1, opened, &openedLen),
+               "open rejects a truncated tag");
+}
@@ -0,0 +1,29 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file clkSyncTest.c
+ *
+ * Unit tests of the modules of the Linux Clock Service Adapter which don't depend on the network
+ * or on the system clock. Each suite checks one module against known answers, the results being
+ * reported in TAP format, and the process exits with a failure if any test failed.
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+
+#include "legato.h"
+#include "clkSyncTest.h"
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Run every suite
+ */
+//--------------------------------------------------------------------------------------------------
+COMPONENT_INIT
+{
+    LE_TEST_PLAN(LE_TEST_NO_PLAN);
+
+    clkSyncTest_Siv();
+    clkSyncTest_Select();
+
+    LE_TEST_EXIT;
+}
@@ -0,0 +1,36 @@
+//--------------------------------------------------------------------------------------------------
+/**
+ * @file clkSyncTest.h
+ *
+ * Test suites of the unit tests of the Linux Clock Service Adapter
+ *
+ */
+//--------------------------------------------------------------------------------------------------
+
+#ifndef CLKSYNC_TEST_H_INCLUDE_GUARD
+#define CLKSYNC_TEST_H_INCLUDE_GUARD
+
+#include "legato.h"
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Test the AEAD_AES_SIV_CMAC_256 sealing and opening of clkSyncSiv.c
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncTest_Siv
+(
+    void
+);
+
+
+//--------------------------------------------------------------------------------------------------
+/**
+ * Test the selection among the samples of several time servers of clkSyncSelect.c
+ */
+//--------------------------------------------------------------------------------------------------
+void clkSyncTest_Select
+(
+    void
+);
+
+#endif // CLKSYNC_TEST_H_INCLUDE_GUARD